@@ -21,11 +21,15 @@ DEFS = \
 
 ifdef DEBUG
 FLAGS := $(FLAGS) -O0 -g
-DEFS := $(DEFS) -DMTY_VK_DEBUG
+DEFS := $(DEFS) -DMTY_VK_DEBUG -DMTY_TLOCAL_DEBUG
 else
 FLAGS := $(FLAGS) -O3 -g0 -fvisibility=hidden
 endif
 
+ifdef TRACE
+DEFS := $(DEFS) -DMTY_TRACE
+endif
+
 LOCAL_MODULE_FILENAME := libmatoya
 LOCAL_MODULE := libmatoya
 
@@ -51,11 +55,19 @@ LOCAL_SRC_FILES := \
 	src/list.c \
 	src/log.c \
 	src/memory.c \
+	src/metrics.c \
+	src/number.c \
+	src/parallel.c \
 	src/queue.c \
 	src/resample.c \
+	src/sort.c \
+	src/strbuf.c \
 	src/system.c \
 	src/thread.c \
+	src/timer.c \
 	src/tlocal.c \
+	src/trace.c \
+	src/vec.c \
 	src/version.c \
 	src/gfx/gl/gl.c \
 	src/gfx/gl/gl-ui.c \
@@ -71,6 +83,7 @@ LOCAL_SRC_FILES := \
 	src/unix/time.c \
 	src/unix/linux/ws.c \
 	src/unix/linux/dialog.c \
+	src/unix/linux/perf.c \
 	src/unix/linux/android/aes-gcm.c \
 	src/unix/linux/android/app.c \
 	src/unix/linux/android/audio.c \
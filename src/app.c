@@ -10,6 +10,7 @@
 #include "gfx/mod.h"
 #include "gfx/mod-ui.h"
 #include "gfx/viewport.h"
+#include "metrics.h"
 
 
 // GFX
@@ -254,10 +255,18 @@ void MTY_WindowPresent(MTY_App *app, MTY_Window window)
 	if (!cmn || cmn->api == MTY_GFX_NONE)
 		return;
 
+	MTY_TRACE_BEGIN("MTY_WindowPresent");
+
+	uint64_t ts = MTY_GetTicks();
+
 	if (cmn->webview)
 		mty_webview_render(cmn->webview);
 
 	gfx_ctx_present(cmn);
+
+	mty_metrics_record("mty.window.present_us", MTY_TicksToNS(MTY_GetTicks() - ts) / 1000);
+
+	MTY_TRACE_END();
 }
 
 MTY_GFX MTY_WindowGetGFX(MTY_App *app, MTY_Window window)
@@ -74,6 +74,9 @@ static void http_async_thread(void *opaque)
 {
 	struct async_state *s = opaque;
 
+	MTY_TRACE_BEGIN("http_async_thread");
+	MTY_TRACE_FLOW_END("MTY_HttpAsyncRequest", (uintptr_t) s);
+
 	bool req_ok = MTY_HttpRequest(s->req.url, s->req.method, s->req.headers,
 		s->req.body, s->req.body_size, s->req.proxy, s->timeout,
 		&s->res.body, &s->res.body_size, &s->res.code);
@@ -91,6 +94,8 @@ static void http_async_thread(void *opaque)
 	}
 
 	s->status = !req_ok ? MTY_ASYNC_ERROR : MTY_ASYNC_OK;
+
+	MTY_TRACE_END();
 }
 
 void MTY_HttpAsyncRequest(uint32_t *index, const char *url, const char *method, const char *headers,
@@ -113,8 +118,13 @@ void MTY_HttpAsyncRequest(uint32_t *index, const char *url, const char *method,
 	s->req.body = body ? MTY_Dup(body, bodySize) : NULL;
 	s->req.proxy = proxy ? MTY_Strdup(proxy) : NULL;
 
+	MTY_TRACE_BEGIN("MTY_HttpAsyncRequest");
+	MTY_TRACE_FLOW_BEGIN("MTY_HttpAsyncRequest", (uintptr_t) s);
+
 	*index = MTY_ThreadPoolDispatch(ASYNC_CTX, http_async_thread, s);
 
+	MTY_TRACE_END();
+
 	if (*index == 0) {
 		MTY_Log("Failed to start %s", url);
 		http_async_free_state(s);
@@ -114,12 +114,7 @@ void MTY_FreeFileList(MTY_FileList **fileList)
 
 const char *MTY_JoinPath(const char *path0, const char *path1)
 {
-	char *path = MTY_SprintfD("%s%c%s", path0, FSUTIL_DELIM, path1);
-	char *local = mty_tlocal_strcpy(path);
-
-	MTY_Free(path);
-
-	return local;
+	return mty_tlocal_sprintf("%s%c%s", path0, FSUTIL_DELIM, path1);
 }
 
 const char *MTY_GetFileName(const char *path, bool extension)
@@ -3,6 +3,7 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "hash.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,14 +12,22 @@
 
 #define HASH_DEFAULT_BUCKETS 100
 
+#define HASH_KEY_COPY 0
+#define HASH_KEY_VIEW 1
+#define HASH_KEY_MOVE 2
+
 struct hash_node {
 	char *key;
 	void *val;
+	bool view;
 };
 
+// Buckets start out zeroed and empty, and only allocate nodes once something is set,
+// growing geometrically from a single node
 struct hash_bucket {
-	uint32_t num_nodes;
 	struct hash_node *nodes;
+	uint32_t num_nodes;
+	uint32_t capacity;
 };
 
 struct MTY_Hash {
@@ -49,7 +58,8 @@ void MTY_HashDestroy(MTY_Hash **hash, MTY_FreeFunc freeFunc)
 		for (uint32_t y = 0; y < b->num_nodes; y++) {
 			struct hash_node *n = &b->nodes[y];
 
-			MTY_Free(n->key);
+			if (!n->view)
+				MTY_Free(n->key);
 
 			if (freeFunc && n->val)
 				freeFunc((void *) n->val);
@@ -75,7 +85,9 @@ static void *hash_get(MTY_Hash *ctx, const char *key, bool pop)
 			void *r = n->val;
 
 			if (pop) {
-				MTY_Free(n->key);
+				if (!n->view)
+					MTY_Free(n->key);
+
 				n->key = NULL;
 				n->val = NULL;
 			}
@@ -100,7 +112,20 @@ void *MTY_HashGetInt(MTY_Hash *ctx, int64_t key)
 	return hash_get(ctx, key_str, false);
 }
 
-void *MTY_HashSet(MTY_Hash *ctx, const char *key, void *value)
+static struct hash_node *hash_bucket_push(struct hash_bucket *b)
+{
+	if (b->num_nodes == b->capacity) {
+		b->capacity = b->capacity > 0 ? b->capacity * 2 : 1;
+		b->nodes = MTY_Realloc(b->nodes, b->capacity, sizeof(struct hash_node));
+	}
+
+	struct hash_node *n = &b->nodes[b->num_nodes++];
+	memset(n, 0, sizeof(struct hash_node));
+
+	return n;
+}
+
+static void *hash_set(MTY_Hash *ctx, const char *key, void *value, uint8_t mode)
 {
 	struct hash_bucket *b = &ctx->buckets[MTY_DJB2(key) % ctx->num_buckets];
 	struct hash_node *n = NULL;
@@ -115,21 +140,41 @@ void *MTY_HashSet(MTY_Hash *ctx, const char *key, void *value)
 			void *r = this_n->val;
 			this_n->val = value;
 
+			if (mode == HASH_KEY_MOVE)
+				MTY_Free((char *) key);
+
 			return r;
 		}
 	}
 
-	if (!n) {
-		b->nodes = MTY_Realloc(b->nodes, ++b->num_nodes, sizeof(struct hash_node));
-		n = &b->nodes[b->num_nodes - 1];
-	}
+	if (!n)
+		n = hash_bucket_push(b);
 
-	n->key = MTY_Strdup(key);
+	n->key = mode == HASH_KEY_COPY ? MTY_Strdup(key) : (char *) key;
 	n->val = value;
+	n->view = mode == HASH_KEY_VIEW;
 
 	return NULL;
 }
 
+void *MTY_HashSet(MTY_Hash *ctx, const char *key, void *value)
+{
+	return hash_set(ctx, key, value, HASH_KEY_COPY);
+}
+
+void *mty_hash_set_view(MTY_Hash *ctx, const char *key, void *value)
+{
+	// The key is referenced rather than copied, so it must outlive the hash
+	return hash_set(ctx, key, value, HASH_KEY_VIEW);
+}
+
+void *mty_hash_set_move(MTY_Hash *ctx, char *key, void *value)
+{
+	// The hash takes ownership of a key allocated with MTY_Alloc, and frees it right
+	// away if the key is already present
+	return hash_set(ctx, key, value, HASH_KEY_MOVE);
+}
+
 void *MTY_HashSetInt(MTY_Hash *ctx, int64_t key, void *value)
 {
 	char key_str[32];
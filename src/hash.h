@@ -0,0 +1,8 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+void *mty_hash_set_view(MTY_Hash *ctx, const char *key, void *value);
+void *mty_hash_set_move(MTY_Hash *ctx, char *key, void *value);
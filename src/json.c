@@ -3,17 +3,35 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "hash.h"
+#include "number.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <math.h>
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define JSON_SSE2
+
+#elif defined(__aarch64__)
+	#include <arm_neon.h>
+	#define JSON_NEON
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+#include "fsutil.h"
 
 struct MTY_JSON {
 	MTY_JSONType type;
 	MTY_JSON *parent;
 	uint8_t stage;
+	bool view;
 
 	union {
 		bool boolean;
@@ -36,10 +54,397 @@ struct MTY_JSON {
 };
 
 
+// Structural index
+
+// Parsing happens in two stages. The first stage classifies the input 64 bytes at a time
+// into bitmasks and records the position of every structural character: brackets,
+// colons, commas, both quotes of each string, and the first character of every other
+// value. Strings are tracked across the masks without branching, so characters inside
+// strings are never looked at one at a time. The second stage walks the positions and
+// builds the MTY_JSON tree.
+
+#define JSON_BLOCK 64
+
+#define JSON_CLASS_OP     0x01
+#define JSON_CLASS_WS     0x02
+#define JSON_CLASS_QUOTE  0x04
+#define JSON_CLASS_BSLASH 0x08
+
+static const uint8_t JSON_CLASS[UINT8_MAX + 1] = {
+	['{']  = JSON_CLASS_OP, ['}'] = JSON_CLASS_OP,
+	['[']  = JSON_CLASS_OP, [']'] = JSON_CLASS_OP,
+	[':']  = JSON_CLASS_OP, [','] = JSON_CLASS_OP,
+	[' ']  = JSON_CLASS_WS, ['\t'] = JSON_CLASS_WS,
+	['\n'] = JSON_CLASS_WS, ['\r'] = JSON_CLASS_WS,
+	['"']  = JSON_CLASS_QUOTE,
+	['\\'] = JSON_CLASS_BSLASH,
+};
+
+struct json_block {
+	uint64_t op;
+	uint64_t ws;
+	uint64_t quote;
+	uint64_t bslash;
+	uint64_t ctrl;
+	uint64_t high;
+};
+
+struct json_utf8 {
+	uint8_t need;
+	uint8_t lo;
+	uint8_t hi;
+};
+
+struct json_scan {
+	uint64_t prev_escaped;
+	uint64_t prev_in_string;
+	uint64_t prev_scalar;
+	struct json_utf8 utf8;
+};
+
+struct json_index {
+	uint32_t *pos;
+	uint32_t len;
+	uint32_t size;
+};
+
+static uint32_t json_ctz(uint64_t v)
+{
+	#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward64(&index, v);
+
+		return index;
+
+	#else
+		return __builtin_ctzll(v);
+	#endif
+}
+
+static uint32_t json_msb(uint64_t v)
+{
+	#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, v);
+
+		return index;
+
+	#else
+		return 63 - __builtin_clzll(v);
+	#endif
+}
+
+#if defined(JSON_SSE2)
+
+static uint64_t json_movemask(__m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+	return (uint64_t) (uint16_t) _mm_movemask_epi8(m0) |
+		(uint64_t) (uint16_t) _mm_movemask_epi8(m1) << 16 |
+		(uint64_t) (uint16_t) _mm_movemask_epi8(m2) << 32 |
+		(uint64_t) (uint16_t) _mm_movemask_epi8(m3) << 48;
+}
+
+static void json_classify(const uint8_t *b, struct json_block *blk)
+{
+	__m128i v[4];
+	__m128i op[4], ws[4], quote[4], bslash[4], ctrl[4];
+
+	const __m128i lbrace = _mm_set1_epi8('{');
+	const __m128i rbrace = _mm_set1_epi8('}');
+	const __m128i lower = _mm_set1_epi8(0x20);
+	const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+
+	for (uint8_t x = 0; x < 4; x++) {
+		v[x] = _mm_loadu_si128((const __m128i *) (b + x * 16));
+
+		// Setting 0x20 folds '[' and ']' onto '{' and '}'
+		__m128i folded = _mm_or_si128(v[x], lower);
+
+		op[x] = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(folded, lbrace), _mm_cmpeq_epi8(folded, rbrace)),
+			_mm_or_si128(_mm_cmpeq_epi8(v[x], _mm_set1_epi8(':')), _mm_cmpeq_epi8(v[x], _mm_set1_epi8(','))));
+
+		ws[x] = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v[x], _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v[x], _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v[x], _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v[x], _mm_set1_epi8('\r'))));
+
+		quote[x] = _mm_cmpeq_epi8(v[x], _mm_set1_epi8('"'));
+		bslash[x] = _mm_cmpeq_epi8(v[x], _mm_set1_epi8('\\'));
+
+		// Unsigned v <= 0x1F
+		ctrl[x] = _mm_cmpeq_epi8(_mm_max_epu8(v[x], ctrl_max), ctrl_max);
+	}
+
+	blk->op = json_movemask(op[0], op[1], op[2], op[3]);
+	blk->ws = json_movemask(ws[0], ws[1], ws[2], ws[3]);
+	blk->quote = json_movemask(quote[0], quote[1], quote[2], quote[3]);
+	blk->bslash = json_movemask(bslash[0], bslash[1], bslash[2], bslash[3]);
+	blk->ctrl = json_movemask(ctrl[0], ctrl[1], ctrl[2], ctrl[3]);
+	blk->high = json_movemask(v[0], v[1], v[2], v[3]);
+}
+
+#elif defined(JSON_NEON)
+
+static uint64_t json_movemask(uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3)
+{
+	// NEON has no movemask, so each lane keeps its own bit and pairwise adds pack them
+	static const uint8_t bits[16] = {
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+	};
+
+	uint8x16_t bit = vld1q_u8(bits);
+
+	uint8x16_t sum0 = vpaddq_u8(vandq_u8(m0, bit), vandq_u8(m1, bit));
+	uint8x16_t sum1 = vpaddq_u8(vandq_u8(m2, bit), vandq_u8(m3, bit));
+
+	sum0 = vpaddq_u8(sum0, sum1);
+	sum0 = vpaddq_u8(sum0, sum0);
+
+	return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+static void json_classify(const uint8_t *b, struct json_block *blk)
+{
+	uint8x16_t v[4];
+	uint8x16_t op[4], ws[4], quote[4], bslash[4], ctrl[4], high[4];
+
+	for (uint8_t x = 0; x < 4; x++) {
+		v[x] = vld1q_u8(b + x * 16);
+
+		// Setting 0x20 folds '[' and ']' onto '{' and '}'
+		uint8x16_t folded = vorrq_u8(v[x], vdupq_n_u8(0x20));
+
+		op[x] = vorrq_u8(
+			vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+			vorrq_u8(vceqq_u8(v[x], vdupq_n_u8(':')), vceqq_u8(v[x], vdupq_n_u8(','))));
+
+		ws[x] = vorrq_u8(
+			vorrq_u8(vceqq_u8(v[x], vdupq_n_u8(' ')), vceqq_u8(v[x], vdupq_n_u8('\t'))),
+			vorrq_u8(vceqq_u8(v[x], vdupq_n_u8('\n')), vceqq_u8(v[x], vdupq_n_u8('\r'))));
+
+		quote[x] = vceqq_u8(v[x], vdupq_n_u8('"'));
+		bslash[x] = vceqq_u8(v[x], vdupq_n_u8('\\'));
+		ctrl[x] = vcleq_u8(v[x], vdupq_n_u8(0x1F));
+		high[x] = vcgeq_u8(v[x], vdupq_n_u8(0x80));
+	}
+
+	blk->op = json_movemask(op[0], op[1], op[2], op[3]);
+	blk->ws = json_movemask(ws[0], ws[1], ws[2], ws[3]);
+	blk->quote = json_movemask(quote[0], quote[1], quote[2], quote[3]);
+	blk->bslash = json_movemask(bslash[0], bslash[1], bslash[2], bslash[3]);
+	blk->ctrl = json_movemask(ctrl[0], ctrl[1], ctrl[2], ctrl[3]);
+	blk->high = json_movemask(high[0], high[1], high[2], high[3]);
+}
+
+#else
+
+static void json_classify(const uint8_t *b, struct json_block *blk)
+{
+	memset(blk, 0, sizeof(struct json_block));
+
+	for (uint8_t x = 0; x < JSON_BLOCK; x++) {
+		uint8_t c = JSON_CLASS[b[x]];
+		uint64_t bit = (uint64_t) 1 << x;
+
+		if (c & JSON_CLASS_OP)
+			blk->op |= bit;
+
+		if (c & JSON_CLASS_WS)
+			blk->ws |= bit;
+
+		if (c & JSON_CLASS_QUOTE)
+			blk->quote |= bit;
+
+		if (c & JSON_CLASS_BSLASH)
+			blk->bslash |= bit;
+
+		if (b[x] < 0x20)
+			blk->ctrl |= bit;
+
+		if (b[x] & 0x80)
+			blk->high |= bit;
+	}
+}
+
+#endif
+
+static uint64_t json_prefix_xor(uint64_t v)
+{
+	// Each bit becomes the xor of itself and every bit below it
+	v ^= v << 1;
+	v ^= v << 2;
+	v ^= v << 4;
+	v ^= v << 8;
+	v ^= v << 16;
+	v ^= v << 32;
+
+	return v;
+}
+
+static uint64_t json_find_escaped(struct json_scan *s, uint64_t bslash)
+{
+	// A character is escaped when it follows an odd length run of backslashes. Adding
+	// the odd positioned run starts to the backslashes carries through each run and
+	// leaves the parity of its length at the bit after it, which may carry out of the block
+	if (bslash == 0) {
+		uint64_t escaped = s->prev_escaped;
+		s->prev_escaped = 0;
+
+		return escaped;
+	}
+
+	const uint64_t even = 0x5555555555555555ull;
+
+	bslash &= ~s->prev_escaped;
+	uint64_t follows_escape = bslash << 1 | s->prev_escaped;
+
+	uint64_t odd_starts = bslash & ~even & ~follows_escape;
+	uint64_t even_runs = odd_starts + bslash;
+	s->prev_escaped = even_runs < bslash;
+
+	return (even ^ (even_runs << 1)) & follows_escape;
+}
+
+static bool json_validate_utf8(const uint8_t *b, size_t len, struct json_utf8 *u)
+{
+	for (size_t x = 0; x < len; x++) {
+		uint8_t c = b[x];
+
+		if (u->need > 0) {
+			if (c < u->lo || c > u->hi)
+				return false;
+
+			u->need--;
+			u->lo = 0x80;
+			u->hi = 0xBF;
+			continue;
+		}
+
+		if (c < 0x80)
+			continue;
+
+		// Overlong encodings, surrogates and code points past U+10FFFF are rejected by
+		// narrowing the range of the first continuation byte
+		if (c >= 0xC2 && c <= 0xDF) {
+			u->need = 1;
+
+		} else if (c >= 0xE0 && c <= 0xEF) {
+			u->need = 2;
+			u->lo = c == 0xE0 ? 0xA0 : 0x80;
+			u->hi = c == 0xED ? 0x9F : 0xBF;
+
+		} else if (c >= 0xF0 && c <= 0xF4) {
+			u->need = 3;
+			u->lo = c == 0xF0 ? 0x90 : 0x80;
+			u->hi = c == 0xF4 ? 0x8F : 0xBF;
+
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void json_index_push(struct json_index *index, uint32_t base, uint64_t bits)
+{
+	if (index->len + JSON_BLOCK > index->size) {
+		index->size = index->size > 0 ? index->size * 2 : JSON_BLOCK * 16;
+		index->pos = MTY_Realloc(index->pos, index->size, sizeof(uint32_t));
+	}
+
+	uint32_t *pos = index->pos + index->len;
+
+	for (; bits; bits &= bits - 1)
+		*pos++ = base + json_ctz(bits);
+
+	index->len = (uint32_t) (pos - index->pos);
+}
+
+static bool json_index_build(const char *input, size_t len, struct json_index *index)
+{
+	struct json_scan s = {0};
+	s.utf8.lo = 0x80;
+	s.utf8.hi = 0xBF;
+
+	if (len > UINT32_MAX - JSON_BLOCK) {
+		MTY_Log("Input of %zu bytes is too large", len);
+		return false;
+	}
+
+	for (size_t base = 0; base < len; base += JSON_BLOCK) {
+		const uint8_t *b = (const uint8_t *) input + base;
+		uint8_t tail[JSON_BLOCK];
+
+		// The final partial block is padded with white space
+		if (len - base < JSON_BLOCK) {
+			memset(tail, ' ', JSON_BLOCK);
+			memcpy(tail, b, len - base);
+			b = tail;
+		}
+
+		struct json_block blk;
+		json_classify(b, &blk);
+
+		// Blocks that are entirely ASCII are valid UTF-8. Otherwise validation stops one
+		// byte past the last non-ASCII byte, which is enough to catch a sequence cut short
+		if (blk.high || s.utf8.need > 0) {
+			uint32_t start = s.utf8.need > 0 ? 0 : json_ctz(blk.high);
+			uint32_t end = blk.high ? json_msb(blk.high) + 2 : 1;
+
+			if (end > JSON_BLOCK)
+				end = JSON_BLOCK;
+
+			if (!json_validate_utf8(b + start, end - start, &s.utf8)) {
+				MTY_Log("Invalid UTF-8 near position %zu", base + start);
+				return false;
+			}
+		}
+
+		uint64_t escaped = json_find_escaped(&s, blk.bslash);
+		uint64_t quote = blk.quote & ~escaped;
+
+		// Set from each opening quote up to, but not including, its closing quote
+		uint64_t in_string = json_prefix_xor(quote) ^ s.prev_in_string;
+		s.prev_in_string = (uint64_t) ((int64_t) in_string >> 63);
+
+		uint64_t ctrl = blk.ctrl & in_string;
+
+		if (ctrl) {
+			MTY_Log("Parse error at position %zu", base + json_ctz(ctrl));
+			return false;
+		}
+
+		// Anything else outside of strings belongs to a scalar, which is indexed at its
+		// first character
+		uint64_t scalar = ~(blk.op | blk.ws | quote | in_string);
+		uint64_t scalar_start = scalar & ~(scalar << 1 | s.prev_scalar);
+		s.prev_scalar = scalar >> 63;
+
+		json_index_push(index, (uint32_t) base, (blk.op & ~in_string) | quote | scalar_start);
+	}
+
+	if (s.prev_in_string) {
+		MTY_Log("Unterminated string");
+		return false;
+	}
+
+	if (s.utf8.need > 0) {
+		MTY_Log("Invalid UTF-8 at end of input");
+		return false;
+	}
+
+	return true;
+}
+
+
 // Parse
 
 #define JSON_ARRAY_PAD  64
-#define JSON_STRING_PAD 64
+
+#define JSON_OBJECT_BUCKETS 64
+#define JSON_OBJECT_CHAIN   4
 
 #define JSON_NONE   0
 #define JSON_OPEN   1
@@ -47,7 +452,7 @@ struct MTY_JSON {
 #define JSON_COLON  3
 #define JSON_CLOSED 4
 
-static const char JSON_UNESCAPE[UINT8_MAX] = {
+static const char JSON_UNESCAPE[UINT8_MAX + 1] = {
 	['"']  = '"',
 	['/']  = '/',
 	['\\'] = '\\',
@@ -58,7 +463,7 @@ static const char JSON_UNESCAPE[UINT8_MAX] = {
 	['t']  = '\t',
 };
 
-static const uint8_t JSON_CHARS[UINT8_MAX] = {
+static const uint8_t JSON_CHARS[UINT8_MAX + 1] = {
 	['{'] = 1, ['['] = 1, // Opening object/array
 	['}'] = 2, [']'] = 2, // Closing object array
 	['t'] = 3, ['f'] = 3, // Boolean
@@ -78,9 +483,16 @@ static const uint8_t JSON_CHARS[UINT8_MAX] = {
 	['\0'] = 10,
 };
 
+static bool json_atom_end(const char *input, size_t len, size_t p)
+{
+	// Scalars are only indexed at their first character, so the parser has to make sure
+	// nothing runs on past the end of a literal
+	return p >= len || (JSON_CLASS[(uint8_t) input[p]] & (JSON_CLASS_OP | JSON_CLASS_WS | JSON_CLASS_QUOTE));
+}
+
 static MTY_JSON *json_parse_null(const char *input, size_t len, uint32_t *p)
 {
-	if (len - *p >= 4 && !memcmp(input + *p, "null", 4)) {
+	if (len - *p >= 4 && !memcmp(input + *p, "null", 4) && json_atom_end(input, len, *p + 4)) {
 		*p += 3;
 		return MTY_JSONNullCreate();
 	}
@@ -90,12 +502,12 @@ static MTY_JSON *json_parse_null(const char *input, size_t len, uint32_t *p)
 
 static MTY_JSON *json_parse_bool(const char *input, size_t len, uint32_t *p)
 {
-	if (len - *p >= 4 && !memcmp(input + *p, "true", 4)) {
+	if (len - *p >= 4 && !memcmp(input + *p, "true", 4) && json_atom_end(input, len, *p + 4)) {
 		*p += 3;
 		return MTY_JSONBoolCreate(true);
 	}
 
-	if (len - *p >= 5 && !memcmp(input + *p, "false", 5)) {
+	if (len - *p >= 5 && !memcmp(input + *p, "false", 5) && json_atom_end(input, len, *p + 5)) {
 		*p += 4;
 		return MTY_JSONBoolCreate(false);
 	}
@@ -103,62 +515,38 @@ static MTY_JSON *json_parse_bool(const char *input, size_t len, uint32_t *p)
 	return NULL;
 }
 
-static bool json_validate_number(const char *number, uint32_t len)
+static size_t json_scan_number(const char *input, size_t len, uint32_t p, double *val, bool *integer)
 {
-	if (len >= 1 && number[len - 1] == '.')
-		return false;
-
-	if (len >= 2 && number[0] == '0' && isdigit(number[1]))
-		return false;
-
-	if (len >= 2 && number[0] == '-' && number[1] == '.')
-		return false;
-
-	if (len >= 3 && number[0] == '-' && number[1] == '0' && isdigit(number[2]))
-		return false;
-
-	if (len >= 3 && isdigit(number[0]) && number[1] == '.' && (number[2] == 'e' || number[2] == 'E'))
-		return false;
-
-	return true;
+	size_t n = mty_number_parse(input + p, len - p, val, integer);
+	if (n == 0 || p + n == len)
+		return n;
+
+	// Numbers end at a delimiter, white space, or the end of the input
+	switch (JSON_CHARS[(uint8_t) input[p + n]]) {
+		case 2:
+		case 5:
+		case 10:
+			return n;
+		default:
+			return 0;
+	}
 }
 
 static MTY_JSON *json_parse_number(const char *input, size_t len, uint32_t *p)
 {
-	char number[96];
-
-	// We allow this to scan up to len + 1 for the '\0' character
-	for (uint32_t x = 0; *p < len + 1 && x < 96; (*p)++, x++) {
-		char c = number[x] = input[*p];
-
-		switch (JSON_CHARS[(uint8_t) c]) {
-			case 2:
-			case 5:
-			case 10:
-				(*p)--;
-				number[x] = '\0';
-
-				if (!json_validate_number(number, x))
-					return NULL;
+	double val = 0;
+	bool integer = false;
 
-				char *end = NULL;
-				int64_t ival = strtoll(number, &end, 10);
-
-				if (!*end && ival >= INT32_MIN && ival <= INT32_MAX)
-					return MTY_JSONIntCreate((int32_t) ival);
+	size_t n = json_scan_number(input, len, *p, &val, &integer);
+	if (n == 0)
+		return NULL;
 
-				double val = strtod(number, &end);
+	*p += (uint32_t) n - 1;
 
-				return *end ? NULL : MTY_JSONNumberCreate(val);
-			case 8:
-			case 9:
-				break;
-			default:
-				return NULL;
-		}
-	}
+	if (integer && val >= INT32_MIN && val <= INT32_MAX)
+		return MTY_JSONIntCreate((int32_t) val);
 
-	return NULL;
+	return MTY_JSONNumberCreate(val);
 }
 
 static size_t json_utf16_to_utf8(uint32_t code, char *str)
@@ -192,13 +580,30 @@ static size_t json_utf16_to_utf8(uint32_t code, char *str)
 
 static uint32_t json_parse_hex(const char *input)
 {
-	char hex[5] = {0};
-	memcpy(hex, input, 4);
+	uint32_t code = 0;
+
+	// Exactly four hex digits, strtoul would also accept signs and white space
+	for (uint8_t x = 0; x < 4; x++) {
+		char c = input[x];
+		uint32_t d = 0;
 
-	char *end = NULL;
-	uint32_t code = strtoul(hex, &end, 16);
+		if (c >= '0' && c <= '9') {
+			d = c - '0';
 
-	return *end ? 0x10000 : code;
+		} else if (c >= 'a' && c <= 'f') {
+			d = c - 'a' + 10;
+
+		} else if (c >= 'A' && c <= 'F') {
+			d = c - 'A' + 10;
+
+		} else {
+			return 0x10000;
+		}
+
+		code = code << 4 | d;
+	}
+
+	return code;
 }
 
 static bool json_utf16(const char *input, size_t len, uint32_t *p, char *str, size_t *out)
@@ -226,57 +631,63 @@ static bool json_utf16(const char *input, size_t len, uint32_t *p, char *str, si
 		code = 0x10000 | (code & 0x3FF) << 10 | (code2 & 0x3FF);
 	}
 
-	*out += json_utf16_to_utf8(code, str + *out);
+	// Validation alone passes no output
+	if (str)
+		*out += json_utf16_to_utf8(code, str + *out);
 
 	return true;
 }
 
-static char *json_parse_string(const char *input, size_t len, uint32_t *p)
+static bool json_unescape(const char *input, size_t len, uint32_t open, uint32_t close, char *str)
 {
 	size_t out = 0;
-	size_t slen = 0;
-	char *str = NULL;
 
-	for ((*p)++; *p < len; (*p)++) {
-		char c = input[*p];
+	// Output never overtakes input, so `str` may point into `input` itself
+	for (uint32_t p = open + 1; p < close; p++) {
+		// Copy everything up to the next escape sequence at once
+		const char *bslash = memchr(input + p, '\\', close - p);
+		uint32_t run = bslash ? (uint32_t) (bslash - input) - p : close - p;
+
+		if (str + out != input + p)
+			memmove(str + out, input + p, run);
 
-		if (c > 0 && c < 0x20)
+		out += run;
+		p += run;
+
+		if (p == close)
 			break;
 
-		if (out + 4 >= slen) {
-			slen += JSON_STRING_PAD;
-			str = MTY_Realloc(str, slen, 1);
-		}
+		char c = input[++p];
 
-		if (c == '"') {
-			str[out] = '\0';
-			return str;
+		if (c == 'u') {
+			if (!json_utf16(input, len, &p, str, &out))
+				return false;
 
-		} else if (c == '\\') {
-			if (++(*p) >= len)
-				break;
+		} else {
+			c = JSON_UNESCAPE[(uint8_t) c];
+			if (c == 0)
+				return false;
 
-			c = input[*p];
+			str[out++] = c;
+		}
+	}
 
-			if (c == 'u') {
-				if (!json_utf16(input, len, p, str, &out))
-					break;
+	str[out] = '\0';
 
-				continue;
+	return true;
+}
 
-			} else {
-				c = JSON_UNESCAPE[(uint8_t) c];
-				if (c == 0)
-					break;
-			}
-		}
+static char *json_parse_string(const char *input, size_t len, uint32_t open, uint32_t close)
+{
+	// Unescaping never lengthens a string, so the span between the quotes is enough
+	char *str = MTY_Alloc(close - open, 1);
 
-		str[out++] = c;
+	if (!json_unescape(input, len, open, close, str)) {
+		MTY_Free(str);
+		return NULL;
 	}
 
-	MTY_Free(str);
-
-	return NULL;
+	return str;
 }
 
 static bool json_attach_to_array(MTY_JSON *parent, MTY_JSON *j)
@@ -287,7 +698,7 @@ static bool json_attach_to_array(MTY_JSON *parent, MTY_JSON *j)
 		return false;
 
 	if (a->len == a->size) {
-		a->size += JSON_ARRAY_PAD;
+		a->size = a->size > 0 ? a->size * 2 : JSON_ARRAY_PAD;
 		a->values = MTY_Realloc(a->values, a->size, sizeof(MTY_JSON *));
 	}
 
@@ -297,20 +708,29 @@ static bool json_attach_to_array(MTY_JSON *parent, MTY_JSON *j)
 	return true;
 }
 
-static bool json_attach_to_object(MTY_JSON *parent, char **key, MTY_JSON *j)
+static bool json_attach_to_object(MTY_JSON *parent, char **key, bool view, MTY_JSON *j)
 {
 	if (!*key || parent->stage != JSON_COLON)
 		return false;
 
-	MTY_JSONObjSetItem(parent, *key, j);
+	// Parsed keys are handed to the hash rather than copied again. A duplicate key
+	// replaces the earlier value
+	MTY_JSON *prev = view ? mty_hash_set_view(parent->object.hash, *key, j) :
+		mty_hash_set_move(parent->object.hash, *key, j);
+
+	j->parent = parent;
+
+	if (prev) {
+		prev->parent = NULL;
+		MTY_JSONDestroy(&prev);
+	}
 
-	MTY_Free(*key);
 	*key = NULL;
 
 	return true;
 }
 
-static bool json_attach_item(MTY_JSON **root, MTY_JSON *parent, char **key, MTY_JSON *j)
+static bool json_attach_item(MTY_JSON **root, MTY_JSON *parent, char **key, bool view, MTY_JSON *j)
 {
 	if (!j)
 		return false;
@@ -327,7 +747,7 @@ static bool json_attach_item(MTY_JSON **root, MTY_JSON *parent, char **key, MTY_
 
 	bool r = parent->type == MTY_JSON_ARRAY ?
 		json_attach_to_array(parent, j) :
-		json_attach_to_object(parent, key, j);
+		json_attach_to_object(parent, key, view, j);
 
 	parent->stage = JSON_CLOSED;
 
@@ -337,25 +757,78 @@ static bool json_attach_item(MTY_JSON **root, MTY_JSON *parent, char **key, MTY_
 	return r;
 }
 
-MTY_JSON *MTY_JSONParse(const char *input)
+static uint32_t *json_count_members(const char *input, const uint32_t *pos, uint32_t count)
 {
-	size_t len = strlen(input);
+	// Each member of an object has exactly one colon directly inside it, so a pass over
+	// the index counts the members of every object in the order they are opened. An
+	// object takes at least two positions, which bounds both arrays
+	uint32_t *members = MTY_Alloc(count / 2 + 1, sizeof(uint32_t));
+	uint32_t *stack = MTY_Alloc(count / 2 + 1, sizeof(uint32_t));
+	uint32_t n = 0;
+	uint32_t depth = 0;
+
+	for (uint32_t x = 0; x < count; x++) {
+		char c = input[pos[x]];
 
+		if ((c == '{' || c == '[') && depth <= count / 2) {
+			stack[depth++] = c == '{' ? n++ : UINT32_MAX;
+
+		} else if ((c == '}' || c == ']') && depth > 0) {
+			depth--;
+
+		} else if (c == ':' && depth > 0 && stack[depth - 1] != UINT32_MAX) {
+			members[stack[depth - 1]]++;
+		}
+	}
+
+	MTY_Free(stack);
+
+	return members;
+}
+
+static MTY_JSON *json_build(const char *input, size_t len, const uint32_t *pos, uint32_t count,
+	bool in_place)
+{
 	MTY_JSON *root = NULL;
 	MTY_JSON *parent = NULL;
 	int32_t nest = 0;
 	char *key = NULL;
 
+	uint32_t x = 0;
 	uint32_t p = 0;
 
-	for (; p < len; p++) {
+	// Objects get the same buckets as MTY_JSONObjCreate, which keeps their keys in the
+	// same order when serialized, unless they have so many members that the chains would
+	// grow long. Those get at least a bucket per member, rounded up to a power of two so
+	// duplicate keys rarely change the size, and with it the order, after a round trip
+	uint32_t *members = json_count_members(input, pos, count);
+	uint32_t object = 0;
+
+	for (; x < count; x++) {
+		p = pos[x];
 		char c = input[p];
 
 		switch (JSON_CHARS[(uint8_t) c]) {
 			case 1: {
-				MTY_JSON *j = c == '{' ? MTY_JSONObjCreate() : MTY_JSONArrayCreate(0);
+				MTY_JSON *j = NULL;
+
+				if (c == '{') {
+					uint32_t n = members[object++];
+					uint32_t buckets = JSON_OBJECT_BUCKETS;
+
+					if (n > JSON_OBJECT_BUCKETS * JSON_OBJECT_CHAIN)
+						while (buckets < n && buckets < UINT32_MAX / 2)
+							buckets *= 2;
+
+					j = MTY_Alloc(1, sizeof(MTY_JSON));
+					j->type = MTY_JSON_OBJECT;
+					j->object.hash = MTY_HashCreate(buckets);
+
+				} else {
+					j = MTY_JSONArrayCreate(0);
+				}
 
-				if (!json_attach_item(&root, parent, &key, j))
+				if (!json_attach_item(&root, parent, &key, in_place, j))
 					goto except;
 
 				parent = j;
@@ -388,8 +861,12 @@ MTY_JSON *MTY_JSONParse(const char *input)
 				parent->stage = JSON_OPEN;
 				break;
 			case 6: {
-				char *str = json_parse_string(input, len, &p);
-				if (!str)
+				// Both quotes of a string are indexed. In place, the string is unescaped over
+				// its own source and the closing quote becomes the terminator
+				uint32_t close = pos[++x];
+				char *str = in_place ? (char *) input + p + 1 : json_parse_string(input, len, p, close);
+
+				if (!str || (in_place && !json_unescape(input, len, p, close, str)))
 					goto except;
 
 				if (parent && parent->type == MTY_JSON_OBJECT && parent->stage <= JSON_OPEN) {
@@ -400,26 +877,25 @@ MTY_JSON *MTY_JSONParse(const char *input)
 					MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
 					j->type = MTY_JSON_STRING;
 					j->string = str;
+					j->view = in_place;
 
-					if (!json_attach_item(&root, parent, &key, j))
+					if (!json_attach_item(&root, parent, &key, in_place, j))
 						goto except;
 				}
 				break;
 			}
 			case 3:
-				if (!json_attach_item(&root, parent, &key, json_parse_bool(input, len, &p)))
+				if (!json_attach_item(&root, parent, &key, in_place, json_parse_bool(input, len, &p)))
 					goto except;
 				break;
 			case 7:
-				if (!json_attach_item(&root, parent, &key, json_parse_null(input, len, &p)))
+				if (!json_attach_item(&root, parent, &key, in_place, json_parse_null(input, len, &p)))
 					goto except;
 				break;
 			case 8:
-				if (!json_attach_item(&root, parent, &key, json_parse_number(input, len, &p)))
+				if (!json_attach_item(&root, parent, &key, in_place, json_parse_number(input, len, &p)))
 					goto except;
 				break;
-			case 10:
-				break;
 			default:
 				goto except;
 		}
@@ -427,12 +903,43 @@ MTY_JSON *MTY_JSONParse(const char *input)
 
 	except:
 
-	if (key || nest != 0 || p != len) {
+	if (key || nest != 0 || x != count) {
 		MTY_Log("Parse error at position %u", p);
 		MTY_JSONDestroy(&root);
 	}
 
-	MTY_Free(key);
+	if (!in_place)
+		MTY_Free(key);
+
+	MTY_Free(members);
+
+	return root;
+}
+
+MTY_JSON *MTY_JSONParse(const char *input)
+{
+	size_t len = strlen(input);
+
+	struct json_index index = {0};
+	MTY_JSON *root = NULL;
+
+	if (json_index_build(input, len, &index))
+		root = json_build(input, len, index.pos, index.len, false);
+
+	MTY_Free(index.pos);
+
+	return root;
+}
+
+MTY_JSON *MTY_JSONParseInPlace(char *input, size_t size)
+{
+	struct json_index index = {0};
+	MTY_JSON *root = NULL;
+
+	if (json_index_build(input, size, &index))
+		root = json_build(input, size, index.pos, index.len, true);
+
+	MTY_Free(index.pos);
 
 	return root;
 }
@@ -485,7 +992,8 @@ static void json_delete_item(MTY_JSON *j)
 			case MTY_JSON_NUMBER:
 				break;
 			case MTY_JSON_STRING:
-				MTY_Free(j->string);
+				if (!j->view)
+					MTY_Free(j->string);
 				break;
 			case MTY_JSON_ARRAY: {
 				struct json_array *a = &j->array;
@@ -536,19 +1044,60 @@ void MTY_JSONDestroy(MTY_JSON **json)
 }
 
 
-// Serialize
+// Writer
+
+// Output is gathered into a buffer and emitted with bulk copies. A writer either grows
+// its buffer, fails when a caller supplied buffer is full, or hands the buffer to a
+// write function whenever it fills, which keeps memory bounded for large outputs.
+
+// The same calls can produce CBOR (RFC 8949). Containers written incrementally have an
+// unknown length, so they use CBOR's indefinite length encoding, while containers
+// written from an MTY_JSON item are prefixed with their length.
 
-#define JSON_SERIAL_PAD 512
+#define JSON_WRITER_MIN    512
+#define JSON_WRITER_CHUNK  (32 * 1024)
+#define JSON_WRITER_FRAMES 32
 
-struct json_serial {
-	char *str;
+#define JSON_FRAME_OBJECT 0x01
+#define JSON_FRAME_ITEMS  0x02
+#define JSON_FRAME_KEY    0x04
+#define JSON_FRAME_SIZED  0x08
+
+#define JSON_CBOR_UINT   0
+#define JSON_CBOR_NINT   1
+#define JSON_CBOR_BYTES  2
+#define JSON_CBOR_TEXT   3
+#define JSON_CBOR_ARRAY  4
+#define JSON_CBOR_MAP    5
+#define JSON_CBOR_TAG    6
+#define JSON_CBOR_SIMPLE 7
+
+#define JSON_CBOR_INDEFINITE 31
+#define JSON_CBOR_BREAK      0xFF
+
+struct MTY_JSONWriter {
+	char *buf;
+	size_t len;
 	size_t size;
-	size_t cur;
+	bool heap;
+
+	MTY_JSONWriteFunc func;
+	void *opaque;
+	FILE *f;
+
 	bool pretty;
-	uint32_t indent;
+	bool cbor;
+	bool done;
+	bool error;
+
+	// Frames for open containers are kept in the writer until the nesting outgrows them
+	uint8_t *stack;
+	size_t depth;
+	size_t stack_size;
+	uint8_t frames[JSON_WRITER_FRAMES];
 };
 
-static const char JSON_ESCAPE[UINT8_MAX] = {
+static const char JSON_ESCAPE[UINT8_MAX + 1] = {
 	['"']  = '"',
 	['\\'] = '\\',
 	['\b'] = 'b',
@@ -558,409 +1107,3204 @@ static const char JSON_ESCAPE[UINT8_MAX] = {
 	['\t'] = 't',
 };
 
-static void json_append_char(struct json_serial *s, char c)
+static const char JSON_INDENT[] = "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+static void json_writer_init(MTY_JSONWriter *w, MTY_JSONFormat format)
 {
-	if (s->cur == s->size) {
-		s->size += JSON_SERIAL_PAD;
-		s->str = MTY_Realloc(s->str, s->size + 1, 1);
-	}
+	memset(w, 0, sizeof(MTY_JSONWriter));
+	w->pretty = format == MTY_JSON_FORMAT_PRETTY;
+	w->cbor = format == MTY_JSON_FORMAT_CBOR;
 
-	s->str[s->cur++] = c;
+	w->stack = w->frames;
+	w->stack_size = JSON_WRITER_FRAMES;
 }
 
-static void json_append_string(struct json_serial *s, const char *add)
+static void json_writer_free_stack(MTY_JSONWriter *w)
 {
-	size_t len = strlen(add);
+	if (w->stack != w->frames)
+		MTY_Free(w->stack);
+}
 
-	for (size_t x = 0; x < len; x++) {
-		char c = add[x];
-		char ec = JSON_ESCAPE[(uint8_t) c];
+static bool json_writer_error(MTY_JSONWriter *w)
+{
+	w->error = true;
+
+	return false;
+}
+
+static bool json_writer_flush(MTY_JSONWriter *w)
+{
+	if (w->len > 0 && !w->func(w->buf, w->len, w->opaque))
+		return json_writer_error(w);
+
+	w->len = 0;
+
+	return true;
+}
+
+static bool json_writer_overflow(MTY_JSONWriter *w, const void *data, size_t size)
+{
+	if (w->func) {
+		if (!json_writer_flush(w))
+			return false;
+
+		// Anything that would not fit in an empty buffer is passed straight through
+		if (size >= w->size) {
+			if (!w->func(data, size, w->opaque))
+				return json_writer_error(w);
+
+			return true;
+		}
+
+	} else if (w->heap) {
+		size_t needed = w->len + size;
+		size_t wsize = w->size;
+
+		while (wsize < needed)
+			wsize = wsize > SIZE_MAX / 4 ? needed : wsize * 2;
+
+		w->buf = MTY_Realloc(w->buf, wsize + 1, 1);
+		w->size = wsize;
+
+	} else {
+		MTY_Log("Buffer of %zu bytes is too small", w->size + 1);
+		return json_writer_error(w);
+	}
+
+	memcpy(w->buf + w->len, data, size);
+	w->len += size;
+
+	return true;
+}
+
+static bool json_write(MTY_JSONWriter *w, const void *data, size_t size)
+{
+	if (w->error)
+		return false;
+
+	if (size > w->size - w->len)
+		return json_writer_overflow(w, data, size);
+
+	memcpy(w->buf + w->len, data, size);
+	w->len += size;
+
+	return true;
+}
+
+static bool json_cbor_head(MTY_JSONWriter *w, uint8_t major, uint64_t arg)
+{
+	uint8_t b[9];
+	size_t n = arg < 24 ? 1 : arg <= UINT8_MAX ? 2 : arg <= UINT16_MAX ? 3 : arg <= UINT32_MAX ? 5 : 9;
+
+	// The argument is stored in the smallest big endian integer that holds it
+	b[0] = (uint8_t) (major << 5 | (n == 1 ? arg : n == 2 ? 24 : n == 3 ? 25 : n == 5 ? 26 : 27));
+
+	for (size_t x = n - 1; x > 0; x--, arg >>= 8)
+		b[x] = (uint8_t) arg;
+
+	return json_write(w, b, n);
+}
+
+static bool json_cbor_single(double value, float *f)
+{
+	// Converting finite values outside of the float range is undefined
+	if (isfinite(value) && fabs(value) > FLT_MAX)
+		return false;
+
+	*f = (float) value;
+
+	return (double) *f == value || isnan(value);
+}
+
+static bool json_cbor_half(double value, uint16_t *half)
+{
+	float f = 0;
+	if (!json_cbor_single(value, &f))
+		return false;
+
+	uint32_t bits = 0;
+	memcpy(&bits, &f, sizeof(float));
+
+	uint16_t sign = bits >> 16 & 0x8000;
+	int32_t exp = (int32_t) (bits >> 23 & 0xFF) - 127;
+	uint32_t mant = bits & 0x7FFFFF;
+
+	// Infinity and NaN, NaN payloads are not preserved
+	if (exp == 128) {
+		*half = sign | 0x7C00 | (mant ? 0x200 : 0);
+		return true;
+	}
+
+	// Zero, single precision subnormals are too small for half precision
+	if (exp == -127) {
+		*half = sign;
+		return mant == 0;
+	}
+
+	if (exp > 15 || exp < -24)
+		return false;
+
+	if (exp >= -14) {
+		*half = (uint16_t) (sign | (exp + 15) << 10 | mant >> 13);
+		return (mant & 0x1FFF) == 0;
+	}
+
+	// Half precision subnormal
+	uint32_t m = mant | 0x800000;
+	uint32_t shift = (uint32_t) -(exp + 1);
+
+	*half = (uint16_t) (sign | m >> shift);
+
+	return (m & ((1u << shift) - 1)) == 0;
+}
+
+static bool json_cbor_float(MTY_JSONWriter *w, double value)
+{
+	// Floats are written at the smallest precision that represents them exactly
+	uint8_t b[9];
+	uint64_t bits = 0;
+	size_t n = 0;
+
+	uint16_t half = 0;
+	float f = 0;
+
+	if (json_cbor_half(value, &half)) {
+		b[0] = JSON_CBOR_SIMPLE << 5 | 25;
+		bits = half;
+		n = 3;
+
+	} else if (json_cbor_single(value, &f)) {
+		uint32_t fbits = 0;
+		memcpy(&fbits, &f, sizeof(float));
+
+		b[0] = JSON_CBOR_SIMPLE << 5 | 26;
+		bits = fbits;
+		n = 5;
+
+	} else {
+		memcpy(&bits, &value, sizeof(double));
+
+		b[0] = JSON_CBOR_SIMPLE << 5 | 27;
+		n = 9;
+	}
+
+	for (size_t x = n - 1; x > 0; x--, bits >>= 8)
+		b[x] = (uint8_t) bits;
+
+	return json_write(w, b, n);
+}
+
+static void json_write_indent(MTY_JSONWriter *w)
+{
+	if (!w->pretty)
+		return;
+
+	size_t tabs = w->depth;
+	size_t max = sizeof(JSON_INDENT) - 2;
+
+	json_write(w, JSON_INDENT, 1 + (tabs < max ? tabs : max));
+
+	for (tabs = tabs > max ? tabs - max : 0; tabs > 0; tabs--)
+		json_write(w, "\t", 1);
+}
+
+static size_t json_escape_run(const char *str, size_t len)
+{
+	size_t x = 0;
+
+	// Scan for the next character that needs escaping 16 bytes at a time
+	#if defined(JSON_SSE2)
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i bslash = _mm_set1_epi8('\\');
+		const __m128i ctrl = _mm_set1_epi8(0x1F);
+
+		for (; x + 16 <= len; x += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *) (str + x));
+			__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+				_mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+
+			uint32_t mask = _mm_movemask_epi8(m);
+			if (mask != 0)
+				return x + json_ctz(mask);
+		}
+
+	#elif defined(JSON_NEON)
+		for (; x + 16 <= len; x += 16) {
+			uint8x16_t v = vld1q_u8((const uint8_t *) str + x);
+			uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\'))),
+				vcltq_u8(v, vdupq_n_u8(0x20)));
+
+			if (vmaxvq_u8(m) != 0)
+				break;
+		}
+	#endif
+
+	while (x < len && JSON_ESCAPE[(uint8_t) str[x]] == 0 && (uint8_t) str[x] >= 0x20)
+		x++;
+
+	return x;
+}
+
+static void json_write_string(MTY_JSONWriter *w, const char *str)
+{
+	size_t len = strlen(str);
+
+	if (w->cbor) {
+		json_cbor_head(w, JSON_CBOR_TEXT, len);
+		json_write(w, str, len);
+		return;
+	}
+
+	json_write(w, "\"", 1);
+
+	for (size_t x = 0; x < len;) {
+		// Characters that do not need escaping are written in bulk
+		size_t run = json_escape_run(str + x, len - x);
+
+		json_write(w, str + x, run);
+		x += run;
+
+		if (x == len)
+			break;
+
+		uint8_t c = str[x++];
+		char ec = JSON_ESCAPE[c];
+
+		if (ec != 0) {
+			char esc[2] = {'\\', ec};
+			json_write(w, esc, 2);
+
+		} else {
+			const char *hex = "0123456789abcdef";
+			char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+			json_write(w, esc, 6);
+		}
+	}
+
+	json_write(w, "\"", 1);
+}
+
+static uint8_t *json_writer_top(MTY_JSONWriter *w)
+{
+	return w->depth > 0 ? &w->stack[w->depth - 1] : NULL;
+}
+
+static uint8_t *json_writer_push(MTY_JSONWriter *w)
+{
+	if (w->depth == w->stack_size) {
+		w->stack_size *= 2;
+
+		if (w->stack == w->frames) {
+			w->stack = MTY_Alloc(w->stack_size, 1);
+			memcpy(w->stack, w->frames, w->depth);
+
+		} else {
+			w->stack = MTY_Realloc(w->stack, w->stack_size, 1);
+		}
+	}
+
+	return &w->stack[w->depth++];
+}
+
+static bool json_writer_value(MTY_JSONWriter *w)
+{
+	if (w->error)
+		return false;
+
+	uint8_t *top = json_writer_top(w);
+
+	if (!top) {
+		if (w->done) {
+			MTY_Log("The root value has already been written");
+			return json_writer_error(w);
+		}
+
+		w->done = true;
+		return true;
+	}
+
+	if (*top & JSON_FRAME_OBJECT) {
+		if (!(*top & JSON_FRAME_KEY)) {
+			MTY_Log("Values in an object must follow a key");
+			return json_writer_error(w);
+		}
+
+		*top &= ~JSON_FRAME_KEY;
+		return true;
+	}
+
+	if ((*top & JSON_FRAME_ITEMS) && !w->cbor)
+		json_write(w, ",", 1);
+
+	*top |= JSON_FRAME_ITEMS;
+	json_write_indent(w);
+
+	return !w->error;
+}
+
+static bool json_writer_begin(MTY_JSONWriter *w, bool object, int64_t len)
+{
+	if (!json_writer_value(w))
+		return false;
+
+	uint8_t *frame = json_writer_push(w);
+	*frame = object ? JSON_FRAME_OBJECT : 0;
+
+	if (!w->cbor)
+		return json_write(w, object ? "{" : "[", 1);
+
+	uint8_t major = object ? JSON_CBOR_MAP : JSON_CBOR_ARRAY;
+
+	if (len < 0) {
+		uint8_t b = (uint8_t) (major << 5 | JSON_CBOR_INDEFINITE);
+		return json_write(w, &b, 1);
+	}
+
+	*frame |= JSON_FRAME_SIZED;
+
+	return json_cbor_head(w, major, len);
+}
+
+static bool json_writer_end(MTY_JSONWriter *w, bool object)
+{
+	if (w->error)
+		return false;
+
+	uint8_t *top = json_writer_top(w);
+
+	if (!top || (*top & JSON_FRAME_OBJECT) != (object ? JSON_FRAME_OBJECT : 0)) {
+		MTY_Log("No %s is open", object ? "object" : "array");
+		return json_writer_error(w);
+	}
+
+	if (*top & JSON_FRAME_KEY) {
+		MTY_Log("Key is missing a value");
+		return json_writer_error(w);
+	}
+
+	uint8_t frame = *top;
+	w->depth--;
+
+	if (w->cbor) {
+		uint8_t b = JSON_CBOR_BREAK;
+		return (frame & JSON_FRAME_SIZED) ? true : json_write(w, &b, 1);
+	}
+
+	if (frame & JSON_FRAME_ITEMS)
+		json_write_indent(w);
+
+	return json_write(w, object ? "}" : "]", 1);
+}
+
+static bool json_writer_fwrite(const void *buf, size_t size, void *opaque)
+{
+	FILE *f = opaque;
+
+	if (fwrite(buf, 1, size, f) != size) {
+		MTY_Log("'fwrite' failed with ferror %d", ferror(f));
+		return false;
+	}
+
+	return true;
+}
+
+MTY_JSONWriter *MTY_JSONWriterCreate(MTY_JSONFormat format)
+{
+	MTY_JSONWriter *ctx = MTY_Alloc(1, sizeof(MTY_JSONWriter));
+	json_writer_init(ctx, format);
+
+	ctx->heap = true;
+	ctx->size = JSON_WRITER_MIN;
+	ctx->buf = MTY_Alloc(ctx->size + 1, 1);
+
+	return ctx;
+}
+
+MTY_JSONWriter *MTY_JSONWriterCreateBuffer(char *buf, size_t size, MTY_JSONFormat format)
+{
+	if (!buf || size == 0) {
+		MTY_Log("Buffer must be at least 1 byte");
+		return NULL;
+	}
+
+	MTY_JSONWriter *ctx = MTY_Alloc(1, sizeof(MTY_JSONWriter));
+	json_writer_init(ctx, format);
+
+	// One byte is held back for the null terminator
+	ctx->buf = buf;
+	ctx->buf[0] = '\0';
+	ctx->size = size - 1;
+
+	return ctx;
+}
+
+MTY_JSONWriter *MTY_JSONWriterCreateFunc(MTY_JSONWriteFunc func, void *opaque, MTY_JSONFormat format)
+{
+	MTY_JSONWriter *ctx = MTY_Alloc(1, sizeof(MTY_JSONWriter));
+	json_writer_init(ctx, format);
+
+	ctx->func = func;
+	ctx->opaque = opaque;
+	ctx->size = JSON_WRITER_CHUNK;
+	ctx->buf = MTY_Alloc(ctx->size + 1, 1);
+
+	return ctx;
+}
+
+MTY_JSONWriter *MTY_JSONWriterCreateFile(const char *path, MTY_JSONFormat format)
+{
+	FILE *f = fsutil_open(path, "wb");
+	if (!f)
+		return NULL;
+
+	MTY_JSONWriter *ctx = MTY_JSONWriterCreateFunc(json_writer_fwrite, f, format);
+	ctx->f = f;
+
+	return ctx;
+}
+
+void MTY_JSONWriterDestroy(MTY_JSONWriter **writer)
+{
+	if (!writer || !*writer)
+		return;
+
+	MTY_JSONWriter *ctx = *writer;
+
+	if (ctx->f)
+		fclose(ctx->f);
+
+	if (ctx->heap || ctx->func)
+		MTY_Free(ctx->buf);
+
+	json_writer_free_stack(ctx);
+
+	MTY_Free(ctx);
+	*writer = NULL;
+}
+
+bool MTY_JSONWriterBeginObject(MTY_JSONWriter *ctx)
+{
+	return json_writer_begin(ctx, true, -1);
+}
+
+bool MTY_JSONWriterEndObject(MTY_JSONWriter *ctx)
+{
+	return json_writer_end(ctx, true);
+}
+
+bool MTY_JSONWriterBeginArray(MTY_JSONWriter *ctx)
+{
+	return json_writer_begin(ctx, false, -1);
+}
+
+bool MTY_JSONWriterEndArray(MTY_JSONWriter *ctx)
+{
+	return json_writer_end(ctx, false);
+}
+
+bool MTY_JSONWriterKey(MTY_JSONWriter *ctx, const char *key)
+{
+	if (ctx->error)
+		return false;
+
+	uint8_t *top = json_writer_top(ctx);
+
+	if (!top || !(*top & JSON_FRAME_OBJECT) || (*top & JSON_FRAME_KEY)) {
+		MTY_Log("Keys must be written inside an object and followed by a value");
+		return json_writer_error(ctx);
+	}
+
+	if ((*top & JSON_FRAME_ITEMS) && !ctx->cbor)
+		json_write(ctx, ",", 1);
+
+	*top |= JSON_FRAME_ITEMS | JSON_FRAME_KEY;
+
+	json_write_indent(ctx);
+	json_write_string(ctx, key);
+
+	if (ctx->cbor)
+		return !ctx->error;
+
+	return json_write(ctx, ": ", ctx->pretty ? 2 : 1);
+}
+
+bool MTY_JSONWriterString(MTY_JSONWriter *ctx, const char *value)
+{
+	if (!json_writer_value(ctx))
+		return false;
+
+	json_write_string(ctx, value);
+
+	return !ctx->error;
+}
+
+bool MTY_JSONWriterNumber(MTY_JSONWriter *ctx, double value)
+{
+	if (!json_writer_value(ctx))
+		return false;
+
+	if (ctx->cbor)
+		return json_cbor_float(ctx, value);
+
+	char tmp[NUMBER_FORMAT_MAX];
+	size_t len = mty_number_format(value, tmp);
+
+	return json_write(ctx, tmp, len);
+}
+
+bool MTY_JSONWriterInt(MTY_JSONWriter *ctx, int64_t value)
+{
+	if (!json_writer_value(ctx))
+		return false;
+
+	// Negative integers are stored as -1 - n
+	if (ctx->cbor)
+		return value < 0 ? json_cbor_head(ctx, JSON_CBOR_NINT, ~(uint64_t) value) :
+			json_cbor_head(ctx, JSON_CBOR_UINT, value);
+
+	char tmp[24];
+	char *end = tmp + sizeof(tmp);
+	char *p = end;
+
+	uint64_t u = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+
+	do {
+		*--p = (char) ('0' + u % 10);
+		u /= 10;
+	} while (u > 0);
+
+	if (value < 0)
+		*--p = '-';
+
+	return json_write(ctx, p, end - p);
+}
+
+bool MTY_JSONWriterBool(MTY_JSONWriter *ctx, bool value)
+{
+	if (!json_writer_value(ctx))
+		return false;
+
+	if (ctx->cbor) {
+		uint8_t b = JSON_CBOR_SIMPLE << 5 | (value ? 21 : 20);
+		return json_write(ctx, &b, 1);
+	}
+
+	return value ? json_write(ctx, "true", 4) : json_write(ctx, "false", 5);
+}
+
+bool MTY_JSONWriterNull(MTY_JSONWriter *ctx)
+{
+	if (!json_writer_value(ctx))
+		return false;
+
+	if (ctx->cbor) {
+		uint8_t b = JSON_CBOR_SIMPLE << 5 | 22;
+		return json_write(ctx, &b, 1);
+	}
+
+	return json_write(ctx, "null", 4);
+}
+
+bool MTY_JSONWriterItem(MTY_JSONWriter *ctx, const MTY_JSON *json)
+{
+	MTY_JSON *j = (MTY_JSON *) json;
+
+	if (!j)
+		return MTY_JSONWriterNull(ctx);
+
+	// The traversal runs to the end even after an error so the iteration state kept
+	// in each array and object is reset
+	for (MTY_JSON *root = j; j;) {
+		MTY_JSON *parent = j != root ? j->parent : NULL;
+
+		switch (j->type) {
+			case MTY_JSON_NULL:
+				MTY_JSONWriterNull(ctx);
+				break;
+			case MTY_JSON_BOOL:
+				MTY_JSONWriterBool(ctx, j->boolean);
+				break;
+			case MTY_JSON_NUMBER:
+				if (j->number.isint) {
+					MTY_JSONWriterInt(ctx, llrint(j->number.value));
+
+				} else {
+					MTY_JSONWriterNumber(ctx, j->number.value);
+				}
+				break;
+			case MTY_JSON_STRING:
+				MTY_JSONWriterString(ctx, j->string);
+				break;
+			case MTY_JSON_ARRAY: {
+				struct json_array *a = &j->array;
+
+				if (a->index == 0) {
+					// CBOR containers are prefixed with their length, unset elements are skipped
+					int64_t len = ctx->cbor ? 0 : -1;
+
+					for (uint32_t x = 0; ctx->cbor && x < a->len; x++)
+						len += a->values[x] != NULL;
+
+					json_writer_begin(ctx, false, len);
+				}
+
+				for (j = NULL; !j && a->index < a->len; a->index++)
+					j = a->values[a->index];
+
+				if (j)
+					continue;
+
+				MTY_JSONWriterEndArray(ctx);
+				a->index = 0;
+				break;
+			}
+			case MTY_JSON_OBJECT: {
+				struct json_object *o = &j->object;
+
+				const char *key = NULL;
+
+				if (o->iter == 0) {
+					int64_t len = ctx->cbor ? 0 : -1;
+
+					for (uint64_t iter = 0; ctx->cbor && MTY_HashGetNextKey(o->hash, &iter, &key);)
+						len++;
+
+					json_writer_begin(ctx, true, len);
+				}
+
+				if (MTY_HashGetNextKey(o->hash, &o->iter, &key)) {
+					MTY_JSONWriterKey(ctx, key);
+
+					j = MTY_HashGet(o->hash, key);
+					continue;
+				}
+
+				MTY_JSONWriterEndObject(ctx);
+				o->iter = 0;
+				break;
+			}
+		}
+
+		j = parent;
+	}
+
+	return !ctx->error;
+}
+
+bool MTY_JSONWriterFinish(MTY_JSONWriter *ctx)
+{
+	if (ctx->error)
+		return false;
+
+	if (!ctx->done || ctx->depth > 0) {
+		MTY_Log("Output is incomplete");
+		return json_writer_error(ctx);
+	}
+
+	if (ctx->func && !json_writer_flush(ctx))
+		return false;
+
+	if (ctx->f && fflush(ctx->f) != 0) {
+		MTY_Log("'fflush' failed with ferror %d", ferror(ctx->f));
+		return json_writer_error(ctx);
+	}
+
+	return true;
+}
+
+const char *MTY_JSONWriterGetString(MTY_JSONWriter *ctx, size_t *len)
+{
+	if (ctx->func || ctx->error)
+		return NULL;
+
+	ctx->buf[ctx->len] = '\0';
+
+	if (len)
+		*len = ctx->len;
+
+	return ctx->buf;
+}
+
+char *MTY_JSONSerialize(const MTY_JSON *json)
+{
+	MTY_JSONWriter w;
+	json_writer_init(&w, MTY_JSON_FORMAT_TEXT);
+
+	w.heap = true;
+	w.size = JSON_WRITER_MIN;
+	w.buf = MTY_Alloc(w.size + 1, 1);
+
+	MTY_JSONWriterItem(&w, json);
+	json_writer_free_stack(&w);
+
+	// A heap writer can not fail, the buffer becomes the returned string
+	w.buf[w.len] = '\0';
+
+	return w.buf;
+}
+
+bool MTY_JSONWriteFile(const char *path, const MTY_JSON *json)
+{
+	MTY_JSONWriter *w = MTY_JSONWriterCreateFile(path, MTY_JSON_FORMAT_PRETTY);
+	if (!w)
+		return false;
+
+	bool r = MTY_JSONWriterItem(w, json) && MTY_JSONWriterFinish(w);
+
+	MTY_JSONWriterDestroy(&w);
+
+	return r;
+}
+
+
+// CBOR
+
+struct json_cbor {
+	const uint8_t *b;
+	size_t len;
+	size_t p;
+};
+
+struct json_cbor_frame {
+	MTY_JSON *item;
+	uint64_t left;
+	char *key;
+};
+
+#define JSON_CBOR_UNBOUNDED UINT64_MAX
+
+static const uint8_t *json_cbor_read(struct json_cbor *c, size_t n)
+{
+	if (c->len - c->p < n)
+		return NULL;
+
+	const uint8_t *b = c->b + c->p;
+	c->p += n;
+
+	return b;
+}
+
+static bool json_cbor_arg(struct json_cbor *c, uint8_t info, uint64_t *arg)
+{
+	if (info < 24) {
+		*arg = info;
+		return true;
+	}
+
+	if (info > 27)
+		return false;
+
+	size_t n = (size_t) 1 << (info - 24);
+
+	const uint8_t *b = json_cbor_read(c, n);
+	if (!b)
+		return false;
+
+	*arg = 0;
+
+	for (size_t x = 0; x < n; x++)
+		*arg = *arg << 8 | b[x];
+
+	return true;
+}
+
+static bool json_cbor_text_chunk(struct json_cbor *c, uint64_t len, MTY_StrBuf *sb)
+{
+	const uint8_t *b = len <= SIZE_MAX ? json_cbor_read(c, (size_t) len) : NULL;
+	if (!b)
+		return false;
+
+	// MTY_JSON strings are null terminated UTF-8
+	if (memchr(b, '\0', (size_t) len))
+		return false;
+
+	struct json_utf8 u = {0};
+	u.lo = 0x80;
+	u.hi = 0xBF;
+
+	if (!json_validate_utf8(b, (size_t) len, &u) || u.need > 0)
+		return false;
+
+	MTY_StrBufAppendLen(sb, (const char *) b, (size_t) len);
+
+	return true;
+}
+
+static char *json_cbor_text(struct json_cbor *c, uint8_t info)
+{
+	MTY_StrBuf sb;
+	MTY_StrBufInit(&sb, NULL, 0);
+
+	uint64_t len = 0;
+	bool r = true;
+
+	if (info == JSON_CBOR_INDEFINITE) {
+		// A sequence of definite length chunks terminated by a break
+		for (const uint8_t *b = json_cbor_read(c, 1); r; b = json_cbor_read(c, 1)) {
+			if (!b || *b == JSON_CBOR_BREAK) {
+				r = b != NULL;
+				break;
+			}
+
+			r = *b >> 5 == JSON_CBOR_TEXT && json_cbor_arg(c, *b & 0x1F, &len) &&
+				json_cbor_text_chunk(c, len, &sb);
+		}
+
+	} else {
+		r = json_cbor_arg(c, info, &len) && json_cbor_text_chunk(c, len, &sb);
+	}
+
+	if (!r) {
+		MTY_StrBufFree(&sb);
+		return NULL;
+	}
+
+	return MTY_StrBufMove(&sb);
+}
+
+static double json_cbor_half_to_double(uint16_t half)
+{
+	int32_t exp = half >> 10 & 0x1F;
+	double mant = half & 0x3FF;
+
+	double v = exp == 0 ? ldexp(mant, -24) : exp != 31 ? ldexp(mant + 1024, exp - 25) :
+		mant == 0 ? INFINITY : NAN;
+
+	return (half & 0x8000) ? -v : v;
+}
+
+static MTY_JSON *json_cbor_simple(struct json_cbor *c, uint8_t info)
+{
+	uint64_t arg = 0;
+
+	switch (info) {
+		case 20:
+		case 21:
+			return MTY_JSONBoolCreate(info == 21);
+		case 22:
+		case 23:
+			// Undefined has no JSON equivalent
+			return MTY_JSONNullCreate();
+		case 25:
+			if (!json_cbor_arg(c, info, &arg))
+				return NULL;
+
+			return MTY_JSONNumberCreate(json_cbor_half_to_double((uint16_t) arg));
+		case 26: {
+			if (!json_cbor_arg(c, info, &arg))
+				return NULL;
+
+			uint32_t bits = (uint32_t) arg;
+			float f = 0;
+			memcpy(&f, &bits, sizeof(float));
+
+			return MTY_JSONNumberCreate(f);
+		}
+		case 27: {
+			if (!json_cbor_arg(c, info, &arg))
+				return NULL;
+
+			double d = 0;
+			memcpy(&d, &arg, sizeof(double));
+
+			return MTY_JSONNumberCreate(d);
+		}
+	}
+
+	return NULL;
+}
+
+static MTY_JSON *json_cbor_container(struct json_cbor *c, uint8_t major, uint8_t info,
+	uint64_t *left)
+{
+	*left = JSON_CBOR_UNBOUNDED;
+
+	if (info != JSON_CBOR_INDEFINITE) {
+		if (!json_cbor_arg(c, info, left))
+			return NULL;
+
+		// Every element takes at least one byte, which bounds the allocation
+		uint64_t min = major == JSON_CBOR_MAP ? 2 : 1;
+
+		if (*left > (c->len - c->p) / min || *left > UINT32_MAX)
+			return NULL;
+	}
+
+	if (major == JSON_CBOR_MAP)
+		return MTY_JSONObjCreate();
+
+	MTY_JSON *j = MTY_JSONArrayCreate(0);
+
+	if (*left != JSON_CBOR_UNBOUNDED && *left > 0) {
+		MTY_Free(j->array.values);
+
+		j->array.size = (uint32_t) *left;
+		j->array.values = MTY_Alloc(j->array.size, sizeof(MTY_JSON *));
+	}
+
+	return j;
+}
+
+static MTY_JSON *json_cbor_item(struct json_cbor *c, uint8_t major, uint8_t info)
+{
+	uint64_t arg = 0;
+
+	switch (major) {
+		case JSON_CBOR_UINT:
+			if (!json_cbor_arg(c, info, &arg))
+				return NULL;
+
+			return arg <= INT32_MAX ? MTY_JSONIntCreate((int32_t) arg) :
+				MTY_JSONNumberCreate((double) arg);
+		case JSON_CBOR_NINT:
+			if (!json_cbor_arg(c, info, &arg))
+				return NULL;
+
+			return arg <= INT32_MAX ? MTY_JSONIntCreate(-1 - (int32_t) arg) :
+				MTY_JSONNumberCreate(-1.0 - (double) arg);
+		case JSON_CBOR_TEXT: {
+			char *str = json_cbor_text(c, info);
+			if (!str)
+				return NULL;
+
+			MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+			j->type = MTY_JSON_STRING;
+			j->string = str;
+
+			return j;
+		}
+		case JSON_CBOR_SIMPLE:
+			return json_cbor_simple(c, info);
+	}
+
+	// Byte strings have no JSON equivalent
+	return NULL;
+}
+
+MTY_JSON *MTY_JSONParseCBOR(const void *buf, size_t size, size_t *used)
+{
+	struct json_cbor c = {0};
+	c.b = buf;
+	c.len = size;
+
+	MTY_Vec stack;
+	MTY_VecInit(&stack, sizeof(struct json_cbor_frame));
+
+	MTY_JSON *root = NULL;
+	bool r = false;
+
+	// Containers are tracked on a stack rather than with recursion, so deeply nested
+	// input can not overflow the call stack
+	while (true) {
+		struct json_cbor_frame *top = stack.len > 0 ?
+			(struct json_cbor_frame *) stack.data + stack.len - 1 : NULL;
+
+		if (top && top->left == 0) {
+			stack.len--;
+
+			if (stack.len == 0) {
+				r = true;
+				break;
+			}
+
+			continue;
+		}
+
+		const uint8_t *b = json_cbor_read(&c, 1);
+		if (!b)
+			break;
+
+		uint8_t major = *b >> 5;
+		uint8_t info = *b & 0x1F;
+
+		if (*b == JSON_CBOR_BREAK) {
+			if (!top || top->left != JSON_CBOR_UNBOUNDED || top->key)
+				break;
+
+			top->left = 0;
+			continue;
+		}
+
+		// Tags only add meaning to the item that follows
+		if (major == JSON_CBOR_TAG) {
+			uint64_t tag = 0;
+			if (!json_cbor_arg(&c, info, &tag))
+				break;
+
+			continue;
+		}
+
+		bool object = top && top->item->type == MTY_JSON_OBJECT;
+
+		// Map keys must be text
+		if (object && !top->key) {
+			if (major != JSON_CBOR_TEXT)
+				break;
+
+			top->key = json_cbor_text(&c, info);
+			if (!top->key)
+				break;
+
+			continue;
+		}
+
+		if (top && top->left != JSON_CBOR_UNBOUNDED)
+			top->left--;
+
+		uint64_t left = 0;
+		bool container = major == JSON_CBOR_ARRAY || major == JSON_CBOR_MAP;
+
+		MTY_JSON *j = container ? json_cbor_container(&c, major, info, &left) :
+			json_cbor_item(&c, major, info);
+
+		if (!j)
+			break;
+
+		if (!top) {
+			root = j;
+
+		} else if (object) {
+			MTY_JSONObjSetItem(top->item, top->key, j);
+
+			MTY_Free(top->key);
+			top->key = NULL;
+
+		} else {
+			json_attach_to_array(top->item, j);
+		}
+
+		if (container) {
+			struct json_cbor_frame *frame = MTY_VecPush(&stack);
+			frame->item = j;
+			frame->left = left;
+
+		} else if (!top) {
+			r = true;
+			break;
+		}
+	}
+
+	if (!r) {
+		MTY_Log("Malformed or truncated CBOR near offset %zu", c.p);
+		MTY_JSONDestroy(&root);
+	}
+
+	for (size_t x = 0; x < stack.len; x++)
+		MTY_Free(((struct json_cbor_frame *) stack.data)[x].key);
+
+	MTY_VecFree(&stack);
+
+	if (used)
+		*used = r ? c.p : 0;
+
+	return root;
+}
+
+void *MTY_JSONSerializeCBOR(const MTY_JSON *json, size_t *size)
+{
+	MTY_JSONWriter w;
+	json_writer_init(&w, MTY_JSON_FORMAT_CBOR);
+
+	w.heap = true;
+	w.size = JSON_WRITER_MIN;
+	w.buf = MTY_Alloc(w.size + 1, 1);
+
+	MTY_JSONWriterItem(&w, json);
+	json_writer_free_stack(&w);
+
+	*size = w.len;
+
+	return w.buf;
+}
+
+
+// Null
+
+MTY_JSON *MTY_JSONNullCreate(void)
+{
+	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+	j->type = MTY_JSON_NULL;
+
+	return j;
+}
+
+
+// Bool
+
+MTY_JSON *MTY_JSONBoolCreate(bool value)
+{
+	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+	j->type = MTY_JSON_BOOL;
+	j->boolean = value;
+
+	return j;
+}
+
+bool MTY_JSONBool(const MTY_JSON *json, bool *value)
+{
+	if (!json || json->type != MTY_JSON_BOOL)
+		return false;
+
+	*value = json->boolean;
+
+	return true;
+}
+
+
+// Number
+
+MTY_JSON *MTY_JSONNumberCreate(double value)
+{
+	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+	j->type = MTY_JSON_NUMBER;
+
+	if (!isnan(value) && !isinf(value))
+		j->number.value = value;
+
+	return j;
+}
+
+MTY_JSON *MTY_JSONIntCreate(int32_t value)
+{
+	MTY_JSON *j = MTY_JSONNumberCreate(value);
+	j->number.isint = true;
+
+	return j;
+}
+
+bool MTY_JSONNumber(const MTY_JSON *json, double *value)
+{
+	if (!json || json->type != MTY_JSON_NUMBER)
+		return false;
+
+	*value = json->number.value;
+
+	return true;
+}
+
+bool MTY_JSONInt8(const MTY_JSON *json, int8_t *value)
+{
+	double v = 0;
+	bool r = MTY_JSONNumber(json, &v);
+
+	*value = (int8_t) lrint(v);
+
+	return r;
+}
+
+bool MTY_JSONInt16(const MTY_JSON *json, int16_t *value)
+{
+	double v = 0;
+	bool r = MTY_JSONNumber(json, &v);
+
+	*value = (int16_t) lrint(v);
+
+	return r;
+}
+
+bool MTY_JSONInt32(const MTY_JSON *json, int32_t *value)
+{
+	double v = 0;
+	bool r = MTY_JSONNumber(json, &v);
+
+	*value = lrint(v);
+
+	return r;
+}
+
+bool MTY_JSONFloat(const MTY_JSON *json, float *value)
+{
+	double v = 0;
+	bool r = MTY_JSONNumber(json, &v);
+
+	*value = (float) v;
+
+	return r;
+}
+
+
+// String
+
+MTY_JSON *MTY_JSONStringCreate(const char *value)
+{
+	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+	j->type = MTY_JSON_STRING;
+	j->string = MTY_Strdup(value);
+
+	return j;
+}
+
+bool MTY_JSONString(const MTY_JSON *json, char *value, size_t size)
+{
+	if (!json || json->type != MTY_JSON_STRING)
+		return false;
+
+	int32_t n = snprintf(value, size, "%s", json->string);
+
+	return n >= 0 && (uint32_t) n < size;
+}
+
+const char *MTY_JSONStringPtr(const MTY_JSON *json)
+{
+	if (!json || json->type != MTY_JSON_STRING)
+		return NULL;
+
+	return json->string;
+}
+
+
+// Array
+
+MTY_JSON *MTY_JSONArrayCreate(uint32_t len)
+{
+	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+	j->type = MTY_JSON_ARRAY;
+	j->array.values = MTY_Alloc(len, sizeof(MTY_JSON *));
+	j->array.len = j->array.size = len;
+
+	return j;
+}
+
+uint32_t MTY_JSONArrayGetLength(const MTY_JSON *json)
+{
+	if (!json || json->type != MTY_JSON_ARRAY)
+		return 0;
+
+	return json->array.len;
+}
+
+const MTY_JSON *MTY_JSONArrayGetItem(const MTY_JSON *json, uint32_t index)
+{
+	if (!json || json->type != MTY_JSON_ARRAY)
+		return NULL;
+
+	return index < json->array.len ? json->array.values[index] : NULL;
+}
+
+bool MTY_JSONArraySetItem(MTY_JSON *json, uint32_t index, MTY_JSON *value)
+{
+	if (!json || json->type != MTY_JSON_ARRAY)
+		return false;
+
+	struct json_array *a = &json->array;
+
+	if (index >= a->len)
+		return false;
+
+	if (value) {
+		if (value->parent)
+			return false;
+
+		value->parent = json;
+	}
+
+	json_delete_item(a->values[index]);
+	a->values[index] = value;
+
+	return true;
+}
+
+
+// Object
+
+MTY_JSON *MTY_JSONObjCreate(void)
+{
+	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
+	j->type = MTY_JSON_OBJECT;
+	j->object.hash = MTY_HashCreate(JSON_OBJECT_BUCKETS);
+
+	return j;
+}
+
+bool MTY_JSONObjGetNextKey(const MTY_JSON *json, uint64_t *iter, const char **key)
+{
+	if (!json || json->type != MTY_JSON_OBJECT)
+		return false;
+
+	return MTY_HashGetNextKey(json->object.hash, iter, key);
+}
+
+const MTY_JSON *MTY_JSONObjGetItem(const MTY_JSON *json, const char *key)
+{
+	if (!json || json->type != MTY_JSON_OBJECT)
+		return NULL;
+
+	return MTY_HashGet(json->object.hash, key);
+}
+
+bool MTY_JSONObjSetItem(MTY_JSON *json, const char *key, MTY_JSON *value)
+{
+	if (!json || json->type != MTY_JSON_OBJECT)
+		return false;
+
+	if (value) {
+		if (value->parent)
+			return false;
+
+		value->parent = json;
+		json_delete_item(MTY_HashSet(json->object.hash, key, value));
+
+	} else {
+		json_delete_item(MTY_HashPop(json->object.hash, key));
+	}
+
+	return true;
+}
+
+
+// Document
+
+// A document keeps the input and its structural index instead of building a tree. The
+// index is validated up front and each bracket is linked to its partner, so any value
+// can be stepped over in constant time. Values are only decoded when they are read.
+
+#define JSON_DOC_VALUE 0
+#define JSON_DOC_KEY   1
+#define JSON_DOC_COLON 2
+#define JSON_DOC_NEXT  3
+
+struct MTY_JSONDoc {
+	char *input;
+	size_t len;
+	uint32_t *pos;
+	uint32_t *match;
+	uint32_t count;
+};
+
+static bool json_check_string(const char *input, size_t len, uint32_t open, uint32_t close)
+{
+	for (uint32_t p = open + 1; p < close; p++) {
+		const char *bslash = memchr(input + p, '\\', close - p);
+		if (!bslash)
+			break;
+
+		p = (uint32_t) (bslash - input) + 1;
+
+		if (input[p] == 'u') {
+			size_t out = 0;
+
+			if (!json_utf16(input, len, &p, NULL, &out))
+				return false;
+
+		} else if (JSON_UNESCAPE[(uint8_t) input[p]] == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool json_check_atom(const char *input, size_t len, uint32_t p)
+{
+	const char *atom = input[p] == 't' ? "true" : input[p] == 'f' ? "false" : "null";
+	size_t n = strlen(atom);
+
+	return len - p >= n && !memcmp(input + p, atom, n) && json_atom_end(input, len, p + n);
+}
+
+static bool json_doc_validate(MTY_JSONDoc *doc)
+{
+	const char *input = doc->input;
+
+	MTY_Vec stack;
+	MTY_VecInit(&stack, sizeof(uint32_t));
+
+	uint8_t state = JSON_DOC_VALUE;
+	bool empty = false;
+	uint32_t x = 0;
+
+	for (; x < doc->count; x++) {
+		uint32_t p = doc->pos[x];
+		char c = input[p];
+
+		uint32_t *top = stack.len > 0 ? (uint32_t *) stack.data + stack.len - 1 : NULL;
+		bool object = top && input[doc->pos[*top]] == '{';
+
+		if (c == '}' || c == ']') {
+			if (!top || (c == '}') != object || (state != JSON_DOC_NEXT && !empty))
+				break;
+
+			doc->match[*top] = x;
+			stack.len--;
+
+			state = JSON_DOC_NEXT;
+			empty = false;
+			continue;
+		}
+
+		empty = false;
+
+		if (state == JSON_DOC_KEY) {
+			// Both quotes of a string are indexed
+			if (c != '"' || !json_check_string(input, doc->len, p, doc->pos[++x]))
+				break;
+
+			state = JSON_DOC_COLON;
+
+		} else if (state == JSON_DOC_COLON) {
+			if (c != ':')
+				break;
+
+			state = JSON_DOC_VALUE;
+
+		} else if (state == JSON_DOC_NEXT) {
+			if (!top || c != ',')
+				break;
+
+			state = object ? JSON_DOC_KEY : JSON_DOC_VALUE;
+
+		} else if (c == '{' || c == '[') {
+			uint32_t *open = MTY_VecPush(&stack);
+			*open = x;
+
+			state = c == '{' ? JSON_DOC_KEY : JSON_DOC_VALUE;
+			empty = true;
+
+		} else {
+			double val = 0;
+			bool integer = false;
+
+			bool ok = c == '"' ? json_check_string(input, doc->len, p, doc->pos[++x]) :
+				c == 't' || c == 'f' || c == 'n' ? json_check_atom(input, doc->len, p) :
+				json_scan_number(input, doc->len, p, &val, &integer) > 0;
+
+			if (!ok)
+				break;
+
+			state = JSON_DOC_NEXT;
+		}
+	}
+
+	bool r = x == doc->count && stack.len == 0 && state == JSON_DOC_NEXT;
+
+	if (!r)
+		MTY_Log("Parse error at position %u", x < doc->count ? doc->pos[x] : (uint32_t) doc->len);
+
+	MTY_VecFree(&stack);
+
+	return r;
+}
+
+static MTY_JSONDoc *json_doc_create(char *input, size_t len)
+{
+	MTY_JSONDoc *ctx = MTY_Alloc(1, sizeof(MTY_JSONDoc));
+	ctx->input = input;
+	ctx->len = len;
+
+	struct json_index index = {0};
+	bool r = json_index_build(input, len, &index);
+
+	ctx->pos = index.pos;
+	ctx->count = index.len;
+
+	if (r) {
+		ctx->match = MTY_Alloc(ctx->count + 1, sizeof(uint32_t));
+		r = json_doc_validate(ctx);
+	}
+
+	if (!r)
+		MTY_JSONDocDestroy(&ctx);
+
+	return ctx;
+}
+
+static char json_doc_char(const MTY_JSONDoc *doc, MTY_JSONDocItem item)
+{
+	return doc->input[doc->pos[item]];
+}
+
+static MTY_JSONDocItem json_doc_skip(const MTY_JSONDoc *doc, MTY_JSONDocItem item)
+{
+	char c = json_doc_char(doc, item);
+
+	return c == '{' || c == '[' ? doc->match[item] + 1 : c == '"' ? item + 2 : item + 1;
+}
+
+static bool json_doc_valid(const MTY_JSONDoc *doc, MTY_JSONDocItem item)
+{
+	return doc && item < doc->count;
+}
+
+static bool json_doc_key_equal(const MTY_JSONDoc *doc, MTY_JSONDocItem item, const char *key,
+	size_t len)
+{
+	uint32_t open = doc->pos[item];
+	uint32_t close = doc->pos[item + 1];
+
+	const char *raw = doc->input + open + 1;
+	size_t rlen = close - open - 1;
+
+	// Keys without escapes are compared in place
+	if (!memchr(raw, '\\', rlen))
+		return rlen == len && !memcmp(raw, key, len);
+
+	char *str = json_parse_string(doc->input, doc->len, open, close);
+	bool r = str && !strcmp(str, key);
+
+	MTY_Free(str);
+
+	return r;
+}
+
+static MTY_JSONDocItem json_doc_obj_get(const MTY_JSONDoc *doc, MTY_JSONDocItem item,
+	const char *key, size_t len)
+{
+	if (MTY_JSONDocGetType(doc, item) != MTY_JSON_OBJECT)
+		return MTY_JSON_DOC_NONE;
+
+	MTY_JSONDocItem found = MTY_JSON_DOC_NONE;
+
+	// Every member is visited so the last of any duplicate keys wins, the same as
+	// MTY_JSONParse
+	for (MTY_JSONDocItem x = item + 1; json_doc_char(doc, x) == '"'; x++) {
+		MTY_JSONDocItem value = x + 3;
+
+		if (json_doc_key_equal(doc, x, key, len))
+			found = value;
+
+		x = json_doc_skip(doc, value);
+
+		if (json_doc_char(doc, x) != ',')
+			break;
+	}
+
+	return found;
+}
+
+static MTY_JSONDocItem json_doc_array_get(const MTY_JSONDoc *doc, MTY_JSONDocItem item,
+	uint32_t index)
+{
+	if (MTY_JSONDocGetType(doc, item) != MTY_JSON_ARRAY)
+		return MTY_JSON_DOC_NONE;
+
+	MTY_JSONDocItem x = item + 1;
+
+	if (json_doc_char(doc, x) == ']')
+		return MTY_JSON_DOC_NONE;
+
+	for (uint32_t y = 0; y < index; y++) {
+		x = json_doc_skip(doc, x);
+
+		if (json_doc_char(doc, x) != ',')
+			return MTY_JSON_DOC_NONE;
+
+		x++;
+	}
+
+	return x;
+}
+
+static bool json_doc_pointer_index(const char *token, uint32_t *index)
+{
+	// Array indices are decimal without leading zeros, "-" refers past the end and so
+	// never to an existing value
+	if (token[0] == '\0' || (token[0] == '0' && token[1] != '\0'))
+		return false;
+
+	uint64_t v = 0;
+
+	for (const char *c = token; *c; c++) {
+		if (*c < '0' || *c > '9')
+			return false;
+
+		v = v * 10 + (*c - '0');
+		if (v > UINT32_MAX)
+			return false;
+	}
+
+	*index = (uint32_t) v;
+
+	return true;
+}
+
+static bool json_pointer_token(const char **pointer, char *token, size_t *len)
+{
+	// Reads the reference token following a '/', '~0' and '~1' unescape to '~' and '/'
+	const char *p = *pointer;
+
+	*len = 0;
+
+	for (p++; *p && *p != '/'; p++) {
+		if (*p == '~') {
+			if (p[1] != '0' && p[1] != '1') {
+				MTY_Log("Invalid escape in JSON Pointer");
+				return false;
+			}
+
+			token[(*len)++] = *++p == '0' ? '~' : '/';
+
+		} else {
+			token[(*len)++] = *p;
+		}
+	}
+
+	token[*len] = '\0';
+	*pointer = p;
+
+	return true;
+}
+
+MTY_JSONDoc *MTY_JSONDocParse(const char *input, size_t size)
+{
+	char *copy = MTY_Alloc(size + 1, 1);
+	memcpy(copy, input, size);
+
+	return json_doc_create(copy, size);
+}
+
+MTY_JSONDoc *MTY_JSONDocReadFile(const char *path)
+{
+	size_t size = 0;
+	char *input = MTY_ReadFile(path, &size);
+	if (!input)
+		return NULL;
+
+	return json_doc_create(input, size);
+}
+
+void MTY_JSONDocDestroy(MTY_JSONDoc **doc)
+{
+	if (!doc || !*doc)
+		return;
+
+	MTY_JSONDoc *ctx = *doc;
+
+	MTY_Free(ctx->input);
+	MTY_Free(ctx->pos);
+	MTY_Free(ctx->match);
+
+	MTY_Free(ctx);
+	*doc = NULL;
+}
+
+MTY_JSONType MTY_JSONDocGetType(const MTY_JSONDoc *doc, MTY_JSONDocItem item)
+{
+	if (!json_doc_valid(doc, item))
+		return MTY_JSON_NULL;
+
+	switch (json_doc_char(doc, item)) {
+		case '{': return MTY_JSON_OBJECT;
+		case '[': return MTY_JSON_ARRAY;
+		case '"': return MTY_JSON_STRING;
+		case 't':
+		case 'f': return MTY_JSON_BOOL;
+		case 'n': return MTY_JSON_NULL;
+		default:
+			return MTY_JSON_NUMBER;
+	}
+}
+
+MTY_JSON *MTY_JSONDocGetJSON(const MTY_JSONDoc *doc, MTY_JSONDocItem item)
+{
+	if (!json_doc_valid(doc, item))
+		return NULL;
+
+	MTY_JSONDocItem end = json_doc_skip(doc, item);
+
+	return json_build(doc->input, doc->len, doc->pos + item, end - item, false);
+}
+
+MTY_JSONDocItem MTY_JSONDocObjGetItem(const MTY_JSONDoc *doc, MTY_JSONDocItem item,
+	const char *key)
+{
+	return json_doc_obj_get(doc, item, key, strlen(key));
+}
+
+uint32_t MTY_JSONDocArrayGetLength(const MTY_JSONDoc *doc, MTY_JSONDocItem item)
+{
+	if (MTY_JSONDocGetType(doc, item) != MTY_JSON_ARRAY)
+		return 0;
+
+	MTY_JSONDocItem x = item + 1;
+
+	if (json_doc_char(doc, x) == ']')
+		return 0;
+
+	uint32_t len = 1;
+
+	for (x = json_doc_skip(doc, x); json_doc_char(doc, x) == ','; x = json_doc_skip(doc, x + 1))
+		len++;
+
+	return len;
+}
+
+MTY_JSONDocItem MTY_JSONDocArrayGetItem(const MTY_JSONDoc *doc, MTY_JSONDocItem item,
+	uint32_t index)
+{
+	return json_doc_array_get(doc, item, index);
+}
+
+MTY_JSONDocItem MTY_JSONDocPointer(const MTY_JSONDoc *doc, MTY_JSONDocItem item,
+	const char *pointer)
+{
+	if (!json_doc_valid(doc, item))
+		return MTY_JSON_DOC_NONE;
+
+	if (pointer[0] != '\0' && pointer[0] != '/') {
+		MTY_Log("JSON Pointer must be empty or begin with '/'");
+		return MTY_JSON_DOC_NONE;
+	}
+
+	// Unescaping never lengthens a reference token
+	char *token = MTY_Alloc(strlen(pointer) + 1, 1);
+
+	for (const char *p = pointer; *p == '/' && item != MTY_JSON_DOC_NONE;) {
+		size_t len = 0;
+
+		if (!json_pointer_token(&p, token, &len)) {
+			item = MTY_JSON_DOC_NONE;
+			break;
+		}
+
+		uint32_t index = 0;
+
+		if (MTY_JSONDocGetType(doc, item) == MTY_JSON_ARRAY) {
+			item = json_doc_pointer_index(token, &index) ?
+				json_doc_array_get(doc, item, index) : MTY_JSON_DOC_NONE;
+
+		} else {
+			item = json_doc_obj_get(doc, item, token, len);
+		}
+	}
+
+	MTY_Free(token);
+
+	return item;
+}
+
+bool MTY_JSONDocBool(const MTY_JSONDoc *doc, MTY_JSONDocItem item, bool *value)
+{
+	if (MTY_JSONDocGetType(doc, item) != MTY_JSON_BOOL)
+		return false;
+
+	*value = json_doc_char(doc, item) == 't';
+
+	return true;
+}
+
+bool MTY_JSONDocNumber(const MTY_JSONDoc *doc, MTY_JSONDocItem item, double *value)
+{
+	if (MTY_JSONDocGetType(doc, item) != MTY_JSON_NUMBER)
+		return false;
+
+	bool integer = false;
+
+	if (json_scan_number(doc->input, doc->len, doc->pos[item], value, &integer) == 0)
+		return false;
+
+	// Literals that overflow a double read as 0, the same as MTY_JSONNumberCreate makes
+	// them when parsed into a tree
+	if (isnan(*value) || isinf(*value))
+		*value = 0;
+
+	return true;
+}
+
+bool MTY_JSONDocInt32(const MTY_JSONDoc *doc, MTY_JSONDocItem item, int32_t *value)
+{
+	double v = 0;
+	bool r = MTY_JSONDocNumber(doc, item, &v);
+
+	*value = lrint(v);
+
+	return r;
+}
+
+bool MTY_JSONDocString(const MTY_JSONDoc *doc, MTY_JSONDocItem item, char *value, size_t size)
+{
+	if (MTY_JSONDocGetType(doc, item) != MTY_JSON_STRING)
+		return false;
+
+	uint32_t open = doc->pos[item];
+	uint32_t close = doc->pos[item + 1];
+
+	const char *raw = doc->input + open + 1;
+	size_t len = close - open - 1;
+
+	// Strings without escapes are copied straight out of the input
+	if (!memchr(raw, '\\', len)) {
+		if (len >= size)
+			return false;
+
+		memcpy(value, raw, len);
+		value[len] = '\0';
+
+		return true;
+	}
+
+	char *str = json_parse_string(doc->input, doc->len, open, close);
+	if (!str)
+		return false;
+
+	int32_t n = snprintf(value, size, "%s", str);
+	MTY_Free(str);
+
+	return n >= 0 && (uint32_t) n < size;
+}
+
+
+// Lines
+
+// Newline delimited input is split into batches, and each batch into chunks that end
+// on a line boundary. Raw newlines are not allowed inside JSON strings, so every newline
+// ends a value. Chunks are parsed on the parallel workers and the items are handed back
+// in order on the calling thread.
+
+#define JSON_LINES_BATCH (16 * 1024 * 1024)
+#define JSON_LINES_CHUNK (128 * 1024)
+
+struct json_line {
+	MTY_JSON *json;
+	size_t line;
+};
+
+struct json_lines_chunk {
+	size_t begin;
+	size_t end;
+	size_t lines;
+	MTY_Vec items;
+};
+
+struct json_lines {
+	MTY_JSONLineFunc func;
+	void *opaque;
+	size_t line;
+
+	char *input;
+	bool in_place;
+	struct json_lines_chunk *chunks;
+};
+
+static size_t json_lines_end(const char *input, size_t size, size_t end)
+{
+	// Move the end just past the next newline
+	if (end >= size)
+		return size;
+
+	const char *nl = memchr(input + end - 1, '\n', size - end + 1);
+
+	return nl ? (size_t) (nl - input) + 1 : size;
+}
+
+static bool json_lines_blank(const char *line, size_t len)
+{
+	for (size_t x = 0; x < len; x++)
+		if (line[x] != ' ' && line[x] != '\t' && line[x] != '\r')
+			return false;
+
+	return true;
+}
+
+static void json_lines_parse(int64_t begin, int64_t end, void *opaque)
+{
+	struct json_lines *ctx = opaque;
+	struct json_index index = {0};
+
+	for (int64_t c = begin; c < end; c++) {
+		struct json_lines_chunk *chunk = &ctx->chunks[c];
+
+		for (size_t p = chunk->begin; p < chunk->end; chunk->lines++) {
+			char *line = ctx->input + p;
+			const char *nl = memchr(line, '\n', chunk->end - p);
+			size_t len = nl ? (size_t) (nl - line) : chunk->end - p;
+
+			p += len + 1;
+
+			if (json_lines_blank(line, len))
+				continue;
+
+			// The index is reused from line to line
+			MTY_JSON *j = NULL;
+			index.len = 0;
+
+			if (json_index_build(line, len, &index))
+				j = json_build(line, len, index.pos, index.len, ctx->in_place);
+
+			struct json_line *item = MTY_VecPush(&chunk->items);
+			item->json = j;
+			item->line = chunk->lines;
+		}
+	}
+
+	MTY_Free(index.pos);
+}
+
+static bool json_lines_batch(struct json_lines *ctx, char *input, size_t size)
+{
+	// Every chunk but the last is at least JSON_LINES_CHUNK bytes
+	struct json_lines_chunk *chunks = MTY_Alloc(size / JSON_LINES_CHUNK + 1, sizeof(struct json_lines_chunk));
+	uint32_t count = 0;
+
+	for (size_t p = 0; p < size; count++) {
+		struct json_lines_chunk *chunk = &chunks[count];
+		chunk->begin = p;
+		chunk->end = json_lines_end(input, size, p + JSON_LINES_CHUNK);
+		MTY_VecInit(&chunk->items, sizeof(struct json_line));
+
+		p = chunk->end;
+	}
+
+	ctx->input = input;
+	ctx->chunks = chunks;
+
+	MTY_ParallelFor(0, count, 1, json_lines_parse, ctx);
+
+	bool r = true;
+
+	for (uint32_t x = 0; x < count; x++) {
+		struct json_lines_chunk *chunk = &chunks[x];
+		struct json_line *items = chunk->items.data;
+
+		// Items left over after the callback stops are still destroyed
+		for (size_t y = 0; y < chunk->items.len; y++) {
+			if (r)
+				r = ctx->func(ctx->line + items[y].line, items[y].json, ctx->opaque);
+
+			MTY_JSONDestroy(&items[y].json);
+		}
+
+		ctx->line += chunk->lines;
+		MTY_VecFree(&chunk->items);
+	}
+
+	MTY_Free(chunks);
+
+	return r;
+}
+
+bool MTY_JSONParseLines(const char *input, size_t size, MTY_JSONLineFunc func, void *opaque)
+{
+	struct json_lines ctx = {0};
+	ctx.func = func;
+	ctx.opaque = opaque;
+	ctx.line = 1;
+
+	// The input is only read since items are not parsed in place
+	for (size_t p = 0; p < size;) {
+		size_t end = json_lines_end(input, size, p + JSON_LINES_BATCH);
+
+		if (!json_lines_batch(&ctx, (char *) input + p, end - p))
+			return false;
+
+		p = end;
+	}
+
+	return true;
+}
+
+bool MTY_JSONReadLinesFile(const char *path, MTY_JSONLineFunc func, void *opaque)
+{
+	FILE *f = fsutil_open(path, "rb");
+	if (!f)
+		return false;
+
+	struct json_lines ctx = {0};
+	ctx.func = func;
+	ctx.opaque = opaque;
+	ctx.line = 1;
+
+	// Lines are parsed in place since the buffer belongs to this function
+	ctx.in_place = true;
+
+	size_t size = JSON_LINES_BATCH;
+	char *buf = MTY_Alloc(size, 1);
+	size_t len = 0;
+	bool r = true;
+
+	while (r) {
+		len += fread(buf + len, 1, size - len, f);
+
+		bool eof = len < size;
+
+		if (eof && ferror(f)) {
+			MTY_Log("'fread' failed with ferror %d", ferror(f));
+			r = false;
+			break;
+		}
+
+		// A partial line at the end of the buffer is carried over to the next read
+		size_t end = len;
+
+		if (!eof)
+			while (end > 0 && buf[end - 1] != '\n')
+				end--;
+
+		// A single line that does not fit grows the buffer
+		if (end == 0 && !eof) {
+			size *= 2;
+			buf = MTY_Realloc(buf, size, 1);
+			continue;
+		}
+
+		r = json_lines_batch(&ctx, buf, end);
+
+		if (eof)
+			break;
+
+		memmove(buf, buf + end, len - end);
+		len -= end;
+	}
+
+	MTY_Free(buf);
+	fclose(f);
+
+	return r;
+}
+
+
+// Struct
+
+// Structs described by a table of fields are read straight from the input and written
+// straight to a writer, no MTY_JSON items are created. The parser descends one level
+// per nested value with a depth limit, members that are not in the table are validated
+// and skipped.
+
+#define JSON_BIND_DEPTH 128
+#define JSON_BIND_KEY   128
+
+struct json_bind {
+	const char *input;
+	uint32_t len;
+	uint32_t p;
+};
+
+static bool json_bind_skip(struct json_bind *b, uint32_t depth);
+static bool json_bind_object(struct json_bind *b, const MTY_JSONField *fields, uint32_t num_fields,
+	uint8_t *base, uint32_t depth);
+
+static size_t json_field_size(const MTY_JSONField *f)
+{
+	switch (f->type) {
+		case MTY_JSON_FIELD_BOOL:   return sizeof(bool);
+		case MTY_JSON_FIELD_INT32:  return sizeof(int32_t);
+		case MTY_JSON_FIELD_UINT32: return sizeof(uint32_t);
+		case MTY_JSON_FIELD_INT64:  return sizeof(int64_t);
+		case MTY_JSON_FIELD_FLOAT:  return sizeof(float);
+		case MTY_JSON_FIELD_DOUBLE: return sizeof(double);
+		default:
+			return f->size;
+	}
+}
+
+static char json_bind_peek(struct json_bind *b)
+{
+	for (; b->p < b->len; b->p++) {
+		char c = b->input[b->p];
+
+		if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+			break;
+	}
+
+	return b->p < b->len ? b->input[b->p] : '\0';
+}
+
+static bool json_bind_expect(struct json_bind *b, char c)
+{
+	if (json_bind_peek(b) != c)
+		return false;
+
+	b->p++;
+
+	return true;
+}
+
+static bool json_bind_string(struct json_bind *b, uint32_t *open, uint32_t *close)
+{
+	if (json_bind_peek(b) != '"')
+		return false;
+
+	struct json_utf8 u = {0};
+	u.lo = 0x80;
+	u.hi = 0xBF;
+
+	for (uint32_t p = b->p + 1; p < b->len; p++) {
+		uint8_t c = b->input[p];
+
+		if (c == '"' && u.need == 0) {
+			*open = b->p;
+			*close = p;
+			b->p = p + 1;
+
+			return true;
+		}
+
+		// Escape sequences are checked when the string is decoded or skipped
+		if (c < 0x20 || ((c >= 0x80 || u.need > 0) && !json_validate_utf8(&c, 1, &u)))
+			return false;
+
+		if (c == '\\')
+			p++;
+	}
+
+	return false;
+}
+
+static bool json_bind_atom(struct json_bind *b, const char *atom)
+{
+	size_t n = strlen(atom);
+
+	if (b->len - b->p < n || memcmp(b->input + b->p, atom, n) || !json_atom_end(b->input, b->len, b->p + n))
+		return false;
+
+	b->p += (uint32_t) n;
+
+	return true;
+}
+
+static bool json_bind_number(struct json_bind *b, double *val)
+{
+	bool integer = false;
+
+	size_t n = json_scan_number(b->input, b->len, b->p, val, &integer);
+	b->p += (uint32_t) n;
+
+	return n > 0;
+}
+
+static bool json_bind_int64(struct json_bind *b, int64_t *val)
+{
+	// A double can not hold every int64_t, so plain integers are read digit by digit
+	const char *s = b->input;
+	uint32_t p = b->p;
+
+	bool neg = p < b->len && s[p] == '-';
+	p += neg;
+
+	uint32_t start = p;
+	uint64_t limit = neg ? (uint64_t) INT64_MAX + 1 : INT64_MAX;
+	uint64_t v = 0;
+
+	for (; p < b->len && s[p] >= '0' && s[p] <= '9'; p++) {
+		uint64_t d = s[p] - '0';
+
+		if (v > (limit - d) / 10)
+			return false;
+
+		v = v * 10 + d;
+	}
+
+	if (p < b->len && (s[p] == '.' || s[p] == 'e' || s[p] == 'E')) {
+		// 2^63 is the first double past the range
+		double d = 0;
+
+		if (!json_bind_number(b, &d) || d < -9223372036854775808.0 || d >= 9223372036854775808.0 ||
+			d != (int64_t) d)
+			return false;
+
+		*val = (int64_t) d;
+		return true;
+	}
+
+	if (p == start || (s[start] == '0' && p - start > 1))
+		return false;
+
+	*val = neg ? -(int64_t) (v - 1) - 1 : (int64_t) v;
+	b->p = p;
+
+	return true;
+}
+
+static bool json_bind_text(struct json_bind *b, char *str, size_t size)
+{
+	uint32_t open = 0;
+	uint32_t close = 0;
+
+	if (!json_bind_string(b, &open, &close))
+		return false;
+
+	// Unescaping never lengthens a string, only a string that might not fit is measured
+	if (close - open - 1 >= size) {
+		size_t n = 0;
+
+		for (uint32_t p = open + 1; p < close; p++, n++) {
+			if (b->input[p] != '\\')
+				continue;
+
+			if (b->input[++p] == 'u') {
+				char tmp[4];
+				size_t out = 0;
+
+				if (!json_utf16(b->input, b->len, &p, tmp, &out))
+					return false;
+
+				n += out - 1;
+			}
+		}
+
+		if (n >= size)
+			return false;
+	}
+
+	return json_unescape(b->input, b->len, open, close, str);
+}
+
+static bool json_bind_scalar(struct json_bind *b, const MTY_JSONField *f, uint8_t *dst, uint32_t depth)
+{
+	double val = 0;
+
+	switch (f->type) {
+		case MTY_JSON_FIELD_BOOL:
+			if (json_bind_atom(b, "true")) {
+				*(bool *) dst = true;
+
+			} else if (json_bind_atom(b, "false")) {
+				*(bool *) dst = false;
+
+			} else {
+				return false;
+			}
+			return true;
+		case MTY_JSON_FIELD_INT32:
+			if (!json_bind_number(b, &val) || val < INT32_MIN || val > INT32_MAX || val != (int32_t) val)
+				return false;
+
+			*(int32_t *) dst = (int32_t) val;
+			return true;
+		case MTY_JSON_FIELD_UINT32:
+			if (!json_bind_number(b, &val) || val < 0 || val > UINT32_MAX || val != (uint32_t) val)
+				return false;
+
+			*(uint32_t *) dst = (uint32_t) val;
+			return true;
+		case MTY_JSON_FIELD_INT64:
+			return json_bind_int64(b, (int64_t *) dst);
+		case MTY_JSON_FIELD_FLOAT:
+			if (!json_bind_number(b, &val) || fabs(val) > FLT_MAX)
+				return false;
+
+			*(float *) dst = (float) val;
+			return true;
+		case MTY_JSON_FIELD_DOUBLE:
+			if (!json_bind_number(b, &val))
+				return false;
+
+			*(double *) dst = val;
+			return true;
+		case MTY_JSON_FIELD_STRING:
+			return json_bind_text(b, (char *) dst, f->size);
+		case MTY_JSON_FIELD_STRUCT:
+			return json_bind_object(b, f->fields, f->numFields, dst, depth);
+		default:
+			return false;
+	}
+}
+
+static bool json_bind_field(struct json_bind *b, const MTY_JSONField *f, uint8_t *dst, uint32_t depth)
+{
+	if (depth > JSON_BIND_DEPTH)
+		return false;
+
+	// Null leaves the member unchanged
+	if (json_bind_peek(b) == 'n')
+		return json_bind_atom(b, "null");
+
+	if (f->count == 0)
+		return json_bind_scalar(b, f, dst, depth);
+
+	if (!json_bind_expect(b, '['))
+		return false;
+
+	if (json_bind_expect(b, ']'))
+		return true;
+
+	size_t stride = json_field_size(f);
+
+	for (uint32_t x = 0; x < f->count; x++) {
+		if (!json_bind_scalar(b, f, dst + x * stride, depth + 1))
+			return false;
+
+		if (json_bind_expect(b, ']'))
+			return true;
+
+		if (!json_bind_expect(b, ','))
+			return false;
+	}
+
+	// More elements than the array holds
+	return false;
+}
+
+static const MTY_JSONField *json_bind_find(struct json_bind *b, uint32_t open, uint32_t close,
+	const MTY_JSONField *fields, uint32_t num_fields)
+{
+	if (num_fields == 0)
+		return NULL;
+
+	const char *key = b->input + open + 1;
+	size_t len = close - open - 1;
+
+	// Keys with escape sequences are decoded to compare them
+	char tmp[JSON_BIND_KEY];
+
+	if (memchr(key, '\\', len)) {
+		if (len >= sizeof(tmp) || !json_unescape(b->input, b->len, open, close, tmp))
+			return NULL;
+
+		key = tmp;
+		len = strlen(tmp);
+	}
+
+	for (uint32_t x = 0; x < num_fields; x++)
+		if (!strncmp(fields[x].name, key, len) && fields[x].name[len] == '\0')
+			return &fields[x];
+
+	return NULL;
+}
+
+static bool json_bind_object(struct json_bind *b, const MTY_JSONField *fields, uint32_t num_fields,
+	uint8_t *base, uint32_t depth)
+{
+	if (!json_bind_expect(b, '{'))
+		return false;
+
+	if (json_bind_expect(b, '}'))
+		return true;
+
+	while (true) {
+		uint32_t open = 0;
+		uint32_t close = 0;
+
+		if (!json_bind_string(b, &open, &close) || !json_check_string(b->input, b->len, open, close))
+			return false;
+
+		if (!json_bind_expect(b, ':'))
+			return false;
+
+		const MTY_JSONField *f = json_bind_find(b, open, close, fields, num_fields);
+
+		if (f) {
+			if (!json_bind_field(b, f, base + f->offset, depth + 1))
+				return false;
+
+		} else if (!json_bind_skip(b, depth + 1)) {
+			return false;
+		}
+
+		if (json_bind_expect(b, '}'))
+			return true;
+
+		if (!json_bind_expect(b, ','))
+			return false;
+	}
+}
+
+static bool json_bind_skip(struct json_bind *b, uint32_t depth)
+{
+	if (depth > JSON_BIND_DEPTH)
+		return false;
+
+	double val = 0;
+	uint32_t open = 0;
+	uint32_t close = 0;
+
+	switch (json_bind_peek(b)) {
+		case '{':
+			return json_bind_object(b, NULL, 0, NULL, depth);
+		case '[':
+			b->p++;
+
+			if (json_bind_expect(b, ']'))
+				return true;
+
+			while (true) {
+				if (!json_bind_skip(b, depth + 1))
+					return false;
+
+				if (json_bind_expect(b, ']'))
+					return true;
+
+				if (!json_bind_expect(b, ','))
+					return false;
+			}
+		case '"':
+			return json_bind_string(b, &open, &close) && json_check_string(b->input, b->len, open, close);
+		case 't':
+			return json_bind_atom(b, "true");
+		case 'f':
+			return json_bind_atom(b, "false");
+		case 'n':
+			return json_bind_atom(b, "null");
+		default:
+			return json_bind_number(b, &val);
+	}
+}
+
+bool MTY_JSONParseStruct(const char *input, size_t size, const MTY_JSONField *fields,
+	uint32_t numFields, void *dst)
+{
+	if (size > UINT32_MAX) {
+		MTY_Log("Input of %zu bytes is too large", size);
+		return false;
+	}
+
+	struct json_bind b = {0};
+	b.input = input;
+	b.len = (uint32_t) size;
+
+	bool r = json_bind_object(&b, fields, numFields, dst, 0);
+
+	if (!r || json_bind_peek(&b) != '\0' || b.p != b.len) {
+		MTY_Log("Parse error at position %u", b.p);
+		return false;
+	}
+
+	return true;
+}
+
+static bool json_struct_write(MTY_JSONWriter *w, const MTY_JSONField *fields, uint32_t num_fields,
+	const uint8_t *base);
+
+static bool json_struct_write_value(MTY_JSONWriter *w, const MTY_JSONField *f, const uint8_t *src)
+{
+	switch (f->type) {
+		case MTY_JSON_FIELD_BOOL:
+			return MTY_JSONWriterBool(w, *(const bool *) src);
+		case MTY_JSON_FIELD_INT32:
+			return MTY_JSONWriterInt(w, *(const int32_t *) src);
+		case MTY_JSON_FIELD_UINT32:
+			return MTY_JSONWriterInt(w, *(const uint32_t *) src);
+		case MTY_JSON_FIELD_INT64:
+			return MTY_JSONWriterInt(w, *(const int64_t *) src);
+		case MTY_JSON_FIELD_FLOAT:
+			return MTY_JSONWriterNumber(w, *(const float *) src);
+		case MTY_JSON_FIELD_DOUBLE:
+			return MTY_JSONWriterNumber(w, *(const double *) src);
+		case MTY_JSON_FIELD_STRING:
+			if (!memchr(src, '\0', f->size)) {
+				MTY_Log("String '%s' is not null terminated", f->name);
+				return json_writer_error(w);
+			}
+
+			return MTY_JSONWriterString(w, (const char *) src);
+		case MTY_JSON_FIELD_STRUCT:
+			return json_struct_write(w, f->fields, f->numFields, src);
+		default:
+			MTY_Log("Field '%s' has an unknown type", f->name);
+			return json_writer_error(w);
+	}
+}
+
+static bool json_struct_write(MTY_JSONWriter *w, const MTY_JSONField *fields, uint32_t num_fields,
+	const uint8_t *base)
+{
+	if (!MTY_JSONWriterBeginObject(w))
+		return false;
+
+	for (uint32_t x = 0; x < num_fields; x++) {
+		const MTY_JSONField *f = &fields[x];
+		const uint8_t *src = base + f->offset;
+
+		if (!MTY_JSONWriterKey(w, f->name))
+			return false;
+
+		if (f->count == 0) {
+			if (!json_struct_write_value(w, f, src))
+				return false;
+
+			continue;
+		}
+
+		size_t stride = json_field_size(f);
+
+		if (!MTY_JSONWriterBeginArray(w))
+			return false;
+
+		for (uint32_t y = 0; y < f->count; y++)
+			if (!json_struct_write_value(w, f, src + y * stride))
+				return false;
+
+		if (!MTY_JSONWriterEndArray(w))
+			return false;
+	}
+
+	return MTY_JSONWriterEndObject(w);
+}
+
+bool MTY_JSONWriterStruct(MTY_JSONWriter *ctx, const MTY_JSONField *fields, uint32_t numFields,
+	const void *src)
+{
+	return json_struct_write(ctx, fields, numFields, src);
+}
+
+size_t MTY_JSONSerializeStruct(const MTY_JSONField *fields, uint32_t numFields, const void *src,
+	char *buf, size_t size)
+{
+	if (size == 0)
+		return 0;
+
+	MTY_JSONWriter w;
+	json_writer_init(&w, MTY_JSON_FORMAT_TEXT);
+
+	// One byte is held back for the terminator
+	w.buf = buf;
+	w.size = size - 1;
+
+	bool r = json_struct_write(&w, fields, numFields, src);
+	json_writer_free_stack(&w);
+
+	if (!r)
+		return 0;
+
+	buf[w.len] = '\0';
+
+	return w.len;
+}
+
+
+// Diff
+
+// A diff descends both trees together and only emits operations where they differ.
+// Members of objects are matched by key. Arrays first drop their common prefix and
+// suffix, the elements left over are hashed and aligned by their longest common
+// subsequence, so unchanged elements are matched with a hash compare and only the
+// runs in between produce operations. Paired elements in a run are diffed in turn, the
+// rest are added or removed.
+
+#define JSON_DIFF_DEPTH   128
+#define JSON_DIFF_LCS_MAX (1 << 20)
+
+struct json_diff {
+	MTY_JSON *patch;
+	MTY_StrBuf path;
+};
+
+static void json_diff_item(struct json_diff *d, const MTY_JSON *a, const MTY_JSON *b, uint32_t depth);
+
+static uint64_t json_diff_mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+
+	return h;
+}
+
+static uint64_t json_diff_hash(const MTY_JSON *j, uint32_t depth)
+{
+	// Equal items always hash the same, an unset array element counts as null. Object
+	// members are summed so the order of the keys does not matter.
+	MTY_JSONType type = MTY_JSONGetType(j);
+	uint64_t h = type;
+
+	if (!j || depth > JSON_DIFF_DEPTH)
+		return json_diff_mix(h);
+
+	switch (type) {
+		case MTY_JSON_NULL:
+			break;
+		case MTY_JSON_BOOL:
+			h = h * 31 + j->boolean;
+			break;
+		case MTY_JSON_NUMBER: {
+			uint64_t bits = 0;
+
+			// Zero and negative zero compare equal
+			if (j->number.value != 0)
+				memcpy(&bits, &j->number.value, sizeof(double));
+
+			h = (h * 31 + j->number.isint) ^ bits;
+			break;
+		}
+		case MTY_JSON_STRING:
+			h = h * 31 + MTY_DJB2(j->string);
+			break;
+		case MTY_JSON_ARRAY:
+			for (uint32_t x = 0; x < j->array.len; x++)
+				h = json_diff_mix(h + json_diff_hash(j->array.values[x], depth + 1));
+			break;
+		case MTY_JSON_OBJECT: {
+			const char *key = NULL;
+			uint64_t sum = 0;
+
+			for (uint64_t iter = 0; MTY_HashGetNextKey(j->object.hash, &iter, &key);)
+				sum += json_diff_mix(MTY_DJB2(key) ^ json_diff_hash(MTY_HashGet(j->object.hash, key), depth + 1));
+
+			h += sum;
+			break;
+		}
+	}
+
+	return json_diff_mix(h);
+}
+
+static bool json_diff_equal(const MTY_JSON *a, const MTY_JSON *b, bool strict, uint32_t depth)
+{
+	MTY_JSONType type = MTY_JSONGetType(a);
+
+	if (type != MTY_JSONGetType(b))
+		return false;
+
+	if (!a || !b)
+		return type == MTY_JSON_NULL;
+
+	if (depth > JSON_DIFF_DEPTH) {
+		char *sa = MTY_JSONSerialize(a);
+		char *sb = MTY_JSONSerialize(b);
+
+		bool r = !strcmp(sa, sb);
+
+		MTY_Free(sa);
+		MTY_Free(sb);
+
+		return r;
+	}
+
+	switch (type) {
+		case MTY_JSON_NULL:
+			return true;
+		case MTY_JSON_BOOL:
+			return a->boolean == b->boolean;
+		case MTY_JSON_NUMBER:
+			// A strict compare keeps integers and floats apart since they serialize differently
+			return a->number.value == b->number.value &&
+				(!strict || a->number.isint == b->number.isint);
+		case MTY_JSON_STRING:
+			return !strcmp(a->string, b->string);
+		case MTY_JSON_ARRAY:
+			if (a->array.len != b->array.len)
+				return false;
+
+			for (uint32_t x = 0; x < a->array.len; x++)
+				if (!json_diff_equal(a->array.values[x], b->array.values[x], strict, depth + 1))
+					return false;
+
+			return true;
+		case MTY_JSON_OBJECT: {
+			const char *key = NULL;
+			uint32_t na = 0;
+			uint32_t nb = 0;
+
+			for (uint64_t iter = 0; MTY_HashGetNextKey(a->object.hash, &iter, &key); na++) {
+				const MTY_JSON *bv = MTY_HashGet(b->object.hash, key);
+
+				if (!bv || !json_diff_equal(MTY_HashGet(a->object.hash, key), bv, strict, depth + 1))
+					return false;
+			}
+
+			for (uint64_t iter = 0; MTY_HashGetNextKey(b->object.hash, &iter, &key);)
+				nb++;
+
+			return na == nb;
+		}
+	}
+
+	return false;
+}
+
+static size_t json_diff_push_key(struct json_diff *d, const char *key)
+{
+	size_t len = d->path.len;
+
+	MTY_StrBufAppendChar(&d->path, '/');
+
+	for (const char *c = key; *c; c++) {
+		if (*c == '~') {
+			MTY_StrBufAppendLen(&d->path, "~0", 2);
+
+		} else if (*c == '/') {
+			MTY_StrBufAppendLen(&d->path, "~1", 2);
+
+		} else {
+			MTY_StrBufAppendChar(&d->path, *c);
+		}
+	}
+
+	return len;
+}
+
+static size_t json_diff_push_index(struct json_diff *d, uint32_t index)
+{
+	size_t len = d->path.len;
+
+	MTY_StrBufAppendChar(&d->path, '/');
+	MTY_StrBufAppendInt(&d->path, index);
+
+	return len;
+}
+
+static void json_diff_pop(struct json_diff *d, size_t len)
+{
+	d->path.len = len;
+	d->path.str[len] = '\0';
+}
+
+static void json_array_insert(MTY_JSON *json, uint32_t index, MTY_JSON *value)
+{
+	struct json_array *a = &json->array;
+
+	if (a->len == a->size) {
+		a->size = a->size > 0 ? a->size * 2 : JSON_ARRAY_PAD;
+		a->values = MTY_Realloc(a->values, a->size, sizeof(MTY_JSON *));
+	}
+
+	memmove(&a->values[index + 1], &a->values[index], (a->len - index) * sizeof(MTY_JSON *));
+
+	value->parent = json;
+	a->values[index] = value;
+	a->len++;
+}
+
+static MTY_JSON *json_array_remove(MTY_JSON *json, uint32_t index)
+{
+	struct json_array *a = &json->array;
+	MTY_JSON *value = a->values[index];
+
+	a->len--;
+	memmove(&a->values[index], &a->values[index + 1], (a->len - index) * sizeof(MTY_JSON *));
+
+	if (value)
+		value->parent = NULL;
+
+	return value;
+}
+
+static void json_diff_op(struct json_diff *d, const char *op, const MTY_JSON *value)
+{
+	MTY_JSON *j = MTY_JSONObjCreate();
+	MTY_JSONObjSetItem(j, "op", MTY_JSONStringCreate(op));
+	MTY_JSONObjSetItem(j, "path", MTY_JSONStringCreate(d->path.str));
+
+	if (strcmp(op, "remove"))
+		MTY_JSONObjSetItem(j, "value", MTY_JSONDuplicate(value));
+
+	json_array_insert(d->patch, d->patch->array.len, j);
+}
 
-		if (ec == 0 && c > 0 && c < 0x20) {
-			char hex[3] = {0};
-			snprintf(hex, 3, "%02x", c);
+static uint32_t json_diff_run(struct json_diff *d, const MTY_JSON *a, const MTY_JSON *b,
+	uint32_t ia, uint32_t ib, uint32_t removed, uint32_t added, uint32_t index, uint32_t depth)
+{
+	// 'index' is the position of the run in the array as patched so far
+	uint32_t paired = removed < added ? removed : added;
 
-			json_append_char(s, '\\');
-			json_append_char(s, 'u');
-			json_append_char(s, '0');
-			json_append_char(s, '0');
-			json_append_char(s, hex[0]);
-			json_append_char(s, hex[1]);
+	for (uint32_t x = 0; x < paired; x++) {
+		size_t len = json_diff_push_index(d, index + x);
+		json_diff_item(d, a->array.values[ia + x], b->array.values[ib + x], depth + 1);
+		json_diff_pop(d, len);
+	}
 
-		} else {
-			if (ec != 0) {
-				json_append_char(s, '\\');
-				c = ec;
-			}
+	for (uint32_t x = paired; x < removed; x++) {
+		size_t len = json_diff_push_index(d, index + paired);
+		json_diff_op(d, "remove", NULL);
+		json_diff_pop(d, len);
+	}
 
-			json_append_char(s, c);
-		}
+	for (uint32_t x = paired; x < added; x++) {
+		size_t len = json_diff_push_index(d, index + x);
+		json_diff_op(d, "add", b->array.values[ib + x]);
+		json_diff_pop(d, len);
 	}
+
+	return index + added;
 }
 
-static void json_append_pretty(struct json_serial *s)
+static bool json_diff_match(MTY_JSON * const *va, MTY_JSON * const *vb, const uint64_t *ha,
+	const uint64_t *hb, uint32_t x, uint32_t y)
 {
-	if (s->pretty) {
-		json_append_char(s, '\n');
-
-		for (uint32_t x = 0; x < s->indent; x++)
-			json_append_char(s, '\t');
-	}
+	// Hashes rule out nearly every mismatch before the elements are compared
+	return ha[x] == hb[y] && json_diff_equal(va[x], vb[y], true, 0);
 }
 
-static char *json_serialize(MTY_JSON *j, bool pretty)
+static void json_diff_array(struct json_diff *d, const MTY_JSON *a, const MTY_JSON *b, uint32_t depth)
 {
-	struct json_serial s = {
-		.str = MTY_Alloc(JSON_SERIAL_PAD + 1, 1),
-		.size = JSON_SERIAL_PAD,
-		.pretty = pretty,
-	};
+	const struct json_array *aa = &a->array;
+	const struct json_array *ab = &b->array;
 
-	if (!j)
-		json_append_string(&s, "null");
+	uint32_t pre = 0;
+	uint32_t na = aa->len;
+	uint32_t nb = ab->len;
 
-	for (MTY_JSON *root = j; j;) {
-		MTY_JSON *parent = j != root ? j->parent : NULL;
+	while (pre < na && pre < nb && json_diff_equal(aa->values[pre], ab->values[pre], true, depth + 1))
+		pre++;
 
-		switch (j->type) {
-			case MTY_JSON_NULL:
-				json_append_string(&s, "null");
-				break;
-			case MTY_JSON_BOOL:
-				json_append_string(&s, j->boolean ? "true" : "false");
-				break;
-			case MTY_JSON_NUMBER: {
-				char number[32] = {0};
+	while (na > pre && nb > pre && json_diff_equal(aa->values[na - 1], ab->values[nb - 1], true, depth + 1)) {
+		na--;
+		nb--;
+	}
 
-				if (j->number.isint) {
-					snprintf(number, 32, "%ld", lrint(j->number.value));
+	uint32_t ra = na - pre;
+	uint32_t rb = nb - pre;
 
-				} else {
-					snprintf(number, 32, "%.15g", j->number.value);
-				}
+	if (ra == 0 && rb == 0)
+		return;
 
-				json_append_string(&s, number);
-				break;
-			}
-			case MTY_JSON_STRING:
-				json_append_char(&s, '"');
-				json_append_string(&s, j->string);
-				json_append_char(&s, '"');
-				break;
-			case MTY_JSON_ARRAY: {
-				struct json_array *a = &j->array;
-				uint32_t index = a->index;
+	// Without anything to align, or with too much, the elements are paired by position
+	uint64_t cells = (uint64_t) (ra + 1) * (rb + 1);
 
-				if (index == 0) {
-					json_append_char(&s, '[');
-					s.indent++;
-				}
+	if (ra == 0 || rb == 0 || cells > JSON_DIFF_LCS_MAX) {
+		json_diff_run(d, a, b, pre, pre, ra, rb, pre, depth);
+		return;
+	}
 
-				for (j = NULL; !j && a->index < a->len; a->index++)
-					j = a->values[a->index];
+	MTY_JSON * const *va = aa->values + pre;
+	MTY_JSON * const *vb = ab->values + pre;
 
-				if (j) {
-					if (index > 0)
-						json_append_char(&s, ',');
+	uint64_t *ha = MTY_Alloc(ra, sizeof(uint64_t));
+	uint64_t *hb = MTY_Alloc(rb, sizeof(uint64_t));
 
-					json_append_pretty(&s);
-					continue;
-				}
+	for (uint32_t x = 0; x < ra; x++)
+		ha[x] = json_diff_hash(va[x], depth + 1);
 
-				s.indent--;
-				json_append_pretty(&s);
-				json_append_char(&s, ']');
-				a->index = 0;
-				break;
-			}
-			case MTY_JSON_OBJECT: {
-				struct json_object *o = &j->object;
-				uint64_t iter = o->iter;
+	for (uint32_t x = 0; x < rb; x++)
+		hb[x] = json_diff_hash(vb[x], depth + 1);
 
-				if (iter == 0) {
-					json_append_char(&s, '{');
-					s.indent++;
-				}
+	// lcs[x][y] is the length of the common subsequence of the elements from x and y on
+	uint32_t *lcs = MTY_Alloc((size_t) cells, sizeof(uint32_t));
+	uint32_t w = rb + 1;
 
-				const char *key = NULL;
+	for (uint32_t x = ra; x-- > 0;) {
+		for (uint32_t y = rb; y-- > 0;) {
+			uint32_t down = lcs[(x + 1) * w + y];
+			uint32_t right = lcs[x * w + y + 1];
 
-				if (MTY_HashGetNextKey(o->hash, &o->iter, &key)) {
-					if (iter > 0)
-						json_append_char(&s, ',');
+			lcs[x * w + y] = json_diff_match(va, vb, ha, hb, x, y) ?
+				lcs[(x + 1) * w + y + 1] + 1 : down > right ? down : right;
+		}
+	}
 
-					json_append_pretty(&s);
-					json_append_char(&s, '"');
-					json_append_string(&s, key);
-					json_append_char(&s, '"');
-					json_append_char(&s, ':');
-					if (s.pretty)
-						json_append_char(&s, ' ');
+	uint32_t index = pre;
 
-					j = MTY_HashGet(o->hash, key);
-					continue;
-				}
+	for (uint32_t x = 0, y = 0; x < ra || y < rb;) {
+		if (x < ra && y < rb && json_diff_match(va, vb, ha, hb, x, y)) {
+			x++;
+			y++;
+			index++;
+			continue;
+		}
 
-				s.indent--;
-				json_append_pretty(&s);
-				json_append_char(&s, '}');
-				o->iter = 0;
-				break;
+		uint32_t sx = x;
+		uint32_t sy = y;
+
+		while ((x < ra || y < rb) && !(x < ra && y < rb && json_diff_match(va, vb, ha, hb, x, y))) {
+			if (y < rb && (x == ra || lcs[x * w + y + 1] >= lcs[(x + 1) * w + y])) {
+				y++;
+
+			} else {
+				x++;
 			}
 		}
 
-		j = parent;
+		index = json_diff_run(d, a, b, pre + sx, pre + sy, x - sx, y - sy, index, depth);
 	}
 
-	s.str[s.cur] = '\0';
-
-	return s.str;
+	MTY_Free(lcs);
+	MTY_Free(ha);
+	MTY_Free(hb);
 }
 
-char *MTY_JSONSerialize(const MTY_JSON *json)
+static void json_diff_object(struct json_diff *d, const MTY_JSON *a, const MTY_JSON *b, uint32_t depth)
 {
-	return json_serialize((MTY_JSON *) json, false);
-}
+	const char *key = NULL;
 
-bool MTY_JSONWriteFile(const char *path, const MTY_JSON *json)
-{
-	char *jstr = json_serialize((MTY_JSON *) json, true);
+	for (uint64_t iter = 0; MTY_HashGetNextKey(a->object.hash, &iter, &key);) {
+		const MTY_JSON *bv = MTY_HashGet(b->object.hash, key);
+		size_t len = json_diff_push_key(d, key);
 
-	bool r = MTY_WriteFile(path, jstr, strlen(jstr));
-	MTY_Free(jstr);
+		if (bv) {
+			json_diff_item(d, MTY_HashGet(a->object.hash, key), bv, depth + 1);
 
-	return r;
-}
+		} else {
+			json_diff_op(d, "remove", NULL);
+		}
 
+		json_diff_pop(d, len);
+	}
 
-// Null
+	for (uint64_t iter = 0; MTY_HashGetNextKey(b->object.hash, &iter, &key);) {
+		if (!MTY_HashGet(a->object.hash, key)) {
+			size_t len = json_diff_push_key(d, key);
+			json_diff_op(d, "add", MTY_HashGet(b->object.hash, key));
+			json_diff_pop(d, len);
+		}
+	}
+}
 
-MTY_JSON *MTY_JSONNullCreate(void)
+static void json_diff_item(struct json_diff *d, const MTY_JSON *a, const MTY_JSON *b, uint32_t depth)
 {
-	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
-	j->type = MTY_JSON_NULL;
+	MTY_JSONType type = MTY_JSONGetType(a);
 
-	return j;
-}
+	// Past the depth limit a differing subtree is replaced as a whole
+	if (a && b && type == b->type && depth <= JSON_DIFF_DEPTH) {
+		if (type == MTY_JSON_ARRAY) {
+			json_diff_array(d, a, b, depth);
+			return;
+		}
 
+		if (type == MTY_JSON_OBJECT) {
+			json_diff_object(d, a, b, depth);
+			return;
+		}
+	}
 
-// Bool
+	if (!json_diff_equal(a, b, true, depth))
+		json_diff_op(d, "replace", b);
+}
 
-MTY_JSON *MTY_JSONBoolCreate(bool value)
+MTY_JSON *MTY_JSONDiff(const MTY_JSON *from, const MTY_JSON *to)
 {
-	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
-	j->type = MTY_JSON_BOOL;
-	j->boolean = value;
+	struct json_diff d = {0};
+	d.patch = MTY_JSONArrayCreate(0);
 
-	return j;
-}
+	MTY_StrBufInit(&d.path, NULL, 0);
 
-bool MTY_JSONBool(const MTY_JSON *json, bool *value)
-{
-	if (!json || json->type != MTY_JSON_BOOL)
-		return false;
+	json_diff_item(&d, from, to, 0);
 
-	*value = json->boolean;
+	MTY_StrBufFree(&d.path);
 
-	return true;
+	return d.patch;
 }
 
 
-// Number
+// Patch
 
-MTY_JSON *MTY_JSONNumberCreate(double value)
+static MTY_JSON *json_patch_child(MTY_JSON *j, const char *token)
 {
-	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
-	j->type = MTY_JSON_NUMBER;
-
-	if (!isnan(value) && !isinf(value))
-		j->number.value = value;
+	uint32_t index = 0;
 
-	return j;
-}
+	if (j->type == MTY_JSON_OBJECT)
+		return MTY_HashGet(j->object.hash, token);
 
-MTY_JSON *MTY_JSONIntCreate(int32_t value)
-{
-	MTY_JSON *j = MTY_JSONNumberCreate(value);
-	j->number.isint = true;
+	if (j->type == MTY_JSON_ARRAY && json_doc_pointer_index(token, &index) && index < j->array.len)
+		return j->array.values[index];
 
-	return j;
+	return NULL;
 }
 
-bool MTY_JSONNumber(const MTY_JSON *json, double *value)
+static MTY_JSON *json_patch_parent(MTY_JSON *root, const char *pointer, char *token)
 {
-	if (!json || json->type != MTY_JSON_NUMBER)
-		return false;
+	// Resolves every reference token but the last one, which is left in 'token'
+	if (pointer[0] != '/') {
+		MTY_Log("JSON Pointer must be empty or begin with '/'");
+		return NULL;
+	}
 
-	*value = json->number.value;
+	for (const char *p = pointer; root;) {
+		size_t len = 0;
 
-	return true;
-}
+		if (!json_pointer_token(&p, token, &len))
+			return NULL;
 
-bool MTY_JSONInt8(const MTY_JSON *json, int8_t *value)
-{
-	double v = 0;
-	bool r = MTY_JSONNumber(json, &v);
+		if (*p != '/')
+			return root->type == MTY_JSON_ARRAY || root->type == MTY_JSON_OBJECT ? root : NULL;
 
-	*value = (int8_t) lrint(v);
+		root = json_patch_child(root, token);
+	}
 
-	return r;
+	return NULL;
 }
 
-bool MTY_JSONInt16(const MTY_JSON *json, int16_t *value)
+static MTY_JSON *json_patch_get(MTY_JSON *root, const char *pointer, char *token)
 {
-	double v = 0;
-	bool r = MTY_JSONNumber(json, &v);
+	if (pointer[0] == '\0')
+		return root;
 
-	*value = (int16_t) lrint(v);
+	MTY_JSON *parent = json_patch_parent(root, pointer, token);
 
-	return r;
+	return parent ? json_patch_child(parent, token) : NULL;
 }
 
-bool MTY_JSONInt32(const MTY_JSON *json, int32_t *value)
+static bool json_patch_root(MTY_JSON **root, MTY_JSON *value)
 {
-	double v = 0;
-	bool r = MTY_JSONNumber(json, &v);
+	if (*root && (*root)->parent) {
+		MTY_Log("Attempted to replace child item");
+		MTY_JSONDestroy(&value);
+		return false;
+	}
 
-	*value = lrint(v);
+	MTY_JSONDestroy(root);
+	*root = value;
 
-	return r;
+	return true;
 }
 
-bool MTY_JSONFloat(const MTY_JSON *json, float *value)
+static bool json_patch_add(MTY_JSON **root, const char *pointer, MTY_JSON *value, char *token)
 {
-	double v = 0;
-	bool r = MTY_JSONNumber(json, &v);
+	if (pointer[0] == '\0')
+		return json_patch_root(root, value);
 
-	*value = (float) v;
+	MTY_JSON *parent = json_patch_parent(*root, pointer, token);
 
-	return r;
-}
+	if (parent && parent->type == MTY_JSON_OBJECT)
+		return MTY_JSONObjSetItem(parent, token, value);
 
+	if (parent) {
+		uint32_t index = parent->array.len;
 
-// String
+		if (!strcmp(token, "-") || (json_doc_pointer_index(token, &index) && index <= parent->array.len)) {
+			json_array_insert(parent, index, value);
+			return true;
+		}
+	}
 
-MTY_JSON *MTY_JSONStringCreate(const char *value)
-{
-	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
-	j->type = MTY_JSON_STRING;
-	j->string = MTY_Strdup(value);
+	MTY_Log("JSON Patch cannot add at '%s'", pointer);
+	MTY_JSONDestroy(&value);
 
-	return j;
+	return false;
 }
 
-bool MTY_JSONString(const MTY_JSON *json, char *value, size_t size)
+static bool json_patch_remove(MTY_JSON *root, const char *pointer, MTY_JSON **value, char *token)
 {
-	if (!json || json->type != MTY_JSON_STRING)
-		return false;
+	MTY_JSON *parent = pointer[0] != '\0' ? json_patch_parent(root, pointer, token) : NULL;
 
-	int32_t n = snprintf(value, size, "%s", json->string);
+	if (parent && parent->type == MTY_JSON_OBJECT) {
+		*value = MTY_HashPop(parent->object.hash, token);
 
-	return n >= 0 && (uint32_t) n < size;
+		if (*value) {
+			(*value)->parent = NULL;
+			return true;
+		}
+
+	} else if (parent) {
+		uint32_t index = 0;
+
+		if (json_doc_pointer_index(token, &index) && index < parent->array.len) {
+			*value = json_array_remove(parent, index);
+			return true;
+		}
+	}
+
+	MTY_Log("JSON Patch cannot remove '%s'", pointer);
+
+	return false;
 }
 
-const char *MTY_JSONStringPtr(const MTY_JSON *json)
+static bool json_patch_replace(MTY_JSON **root, const char *pointer, MTY_JSON *value, char *token)
 {
-	if (!json || json->type != MTY_JSON_STRING)
-		return NULL;
+	if (pointer[0] == '\0')
+		return json_patch_root(root, value);
 
-	return json->string;
-}
+	MTY_JSON *parent = json_patch_parent(*root, pointer, token);
 
+	if (parent && parent->type == MTY_JSON_OBJECT && MTY_HashGet(parent->object.hash, token))
+		return MTY_JSONObjSetItem(parent, token, value);
 
-// Array
+	uint32_t index = 0;
 
-MTY_JSON *MTY_JSONArrayCreate(uint32_t len)
-{
-	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
-	j->type = MTY_JSON_ARRAY;
-	j->array.values = MTY_Alloc(len, sizeof(MTY_JSON *));
-	j->array.len = j->array.size = len;
+	if (parent && parent->type == MTY_JSON_ARRAY && json_doc_pointer_index(token, &index) &&
+		index < parent->array.len)
+		return MTY_JSONArraySetItem(parent, index, value);
 
-	return j;
+	MTY_Log("JSON Patch cannot replace '%s'", pointer);
+	MTY_JSONDestroy(&value);
+
+	return false;
 }
 
-uint32_t MTY_JSONArrayGetLength(const MTY_JSON *json)
+static bool json_patch_move(MTY_JSON **root, const char *from, const char *pointer, char *token)
 {
-	if (!json || json->type != MTY_JSON_ARRAY)
-		return 0;
+	size_t len = strlen(from);
 
-	return json->array.len;
-}
+	if (!strcmp(from, pointer))
+		return json_patch_get(*root, from, token) != NULL;
 
-const MTY_JSON *MTY_JSONArrayGetItem(const MTY_JSON *json, uint32_t index)
-{
-	if (!json || json->type != MTY_JSON_ARRAY)
-		return NULL;
+	// A value can not be moved into one of its own children
+	if (!strncmp(from, pointer, len) && pointer[len] == '/') {
+		MTY_Log("JSON Patch cannot move '%s' into itself", from);
+		return false;
+	}
 
-	return index < json->array.len ? json->array.values[index] : NULL;
+	MTY_JSON *value = NULL;
+
+	if (!json_patch_remove(*root, from, &value, token))
+		return false;
+
+	return json_patch_add(root, pointer, value ? value : MTY_JSONNullCreate(), token);
 }
 
-bool MTY_JSONArraySetItem(MTY_JSON *json, uint32_t index, MTY_JSON *value)
+static bool json_patch_op(MTY_JSON **root, const MTY_JSON *op, char **token)
 {
-	if (!json || json->type != MTY_JSON_ARRAY)
+	const char *name = MTY_JSONStringPtr(MTY_JSONObjGetItem(op, "op"));
+	const char *pointer = MTY_JSONStringPtr(MTY_JSONObjGetItem(op, "path"));
+	const char *from = MTY_JSONStringPtr(MTY_JSONObjGetItem(op, "from"));
+	const MTY_JSON *value = MTY_JSONObjGetItem(op, "value");
+
+	if (!name || !pointer) {
+		MTY_Log("JSON Patch operation is missing 'op' or 'path'");
 		return false;
+	}
 
-	struct json_array *a = &json->array;
+	// Unescaping never lengthens a reference token
+	size_t size = strlen(pointer) + (from ? strlen(from) : 0) + 1;
+	*token = MTY_Realloc(*token, size, 1);
 
-	if (index >= a->len)
+	bool needs_value = !strcmp(name, "add") || !strcmp(name, "replace") || !strcmp(name, "test");
+	bool needs_from = !strcmp(name, "move") || !strcmp(name, "copy");
+
+	if ((needs_value && !value) || (needs_from && !from)) {
+		MTY_Log("JSON Patch '%s' operation is missing '%s'", name, needs_value ? "value" : "from");
 		return false;
+	}
 
-	if (value) {
-		if (value->parent)
+	if (!strcmp(name, "add"))
+		return json_patch_add(root, pointer, MTY_JSONDuplicate(value), *token);
+
+	if (!strcmp(name, "remove")) {
+		MTY_JSON *removed = NULL;
+
+		if (pointer[0] == '\0') {
+			MTY_Log("JSON Patch cannot remove the root");
 			return false;
+		}
 
-		value->parent = json;
+		if (!json_patch_remove(*root, pointer, &removed, *token))
+			return false;
+
+		MTY_JSONDestroy(&removed);
+
+		return true;
 	}
 
-	json_delete_item(a->values[index]);
-	a->values[index] = value;
+	if (!strcmp(name, "replace"))
+		return json_patch_replace(root, pointer, MTY_JSONDuplicate(value), *token);
 
-	return true;
-}
+	if (!strcmp(name, "move"))
+		return json_patch_move(root, from, pointer, *token);
 
+	if (!strcmp(name, "copy")) {
+		const MTY_JSON *src = json_patch_get(*root, from, *token);
 
-// Object
+		if (!src) {
+			MTY_Log("JSON Patch cannot copy '%s'", from);
+			return false;
+		}
 
-MTY_JSON *MTY_JSONObjCreate(void)
-{
-	MTY_JSON *j = MTY_Alloc(1, sizeof(MTY_JSON));
-	j->type = MTY_JSON_OBJECT;
-	j->object.hash = MTY_HashCreate(64);
+		return json_patch_add(root, pointer, MTY_JSONDuplicate(src), *token);
+	}
 
-	return j;
-}
+	if (!strcmp(name, "test")) {
+		const MTY_JSON *target = json_patch_get(*root, pointer, *token);
 
-bool MTY_JSONObjGetNextKey(const MTY_JSON *json, uint64_t *iter, const char **key)
-{
-	if (!json || json->type != MTY_JSON_OBJECT)
-		return false;
+		if (!target || !json_diff_equal(target, value, false, 0)) {
+			MTY_Log("JSON Patch test failed at '%s'", pointer);
+			return false;
+		}
 
-	return MTY_HashGetNextKey(json->object.hash, iter, key);
-}
+		return true;
+	}
 
-const MTY_JSON *MTY_JSONObjGetItem(const MTY_JSON *json, const char *key)
-{
-	if (!json || json->type != MTY_JSON_OBJECT)
-		return NULL;
+	MTY_Log("JSON Patch operation '%s' is unknown", name);
 
-	return MTY_HashGet(json->object.hash, key);
+	return false;
 }
 
-bool MTY_JSONObjSetItem(MTY_JSON *json, const char *key, MTY_JSON *value)
+bool MTY_JSONPatch(MTY_JSON **json, const MTY_JSON *patch)
 {
-	if (!json || json->type != MTY_JSON_OBJECT)
+	if (!json)
 		return false;
 
-	if (value) {
-		if (value->parent)
-			return false;
+	if (MTY_JSONGetType(patch) != MTY_JSON_ARRAY) {
+		MTY_Log("JSON Patch must be an array");
+		return false;
+	}
 
-		value->parent = json;
-		json_delete_item(MTY_HashSet(json->object.hash, key, value));
+	char *token = NULL;
+	bool r = true;
 
-	} else {
-		json_delete_item(MTY_HashPop(json->object.hash, key));
-	}
+	for (uint32_t x = 0; r && x < patch->array.len; x++)
+		r = json_patch_op(json, patch->array.values[x], &token);
 
-	return true;
+	MTY_Free(token);
+
+	return r;
 }
@@ -27,15 +27,10 @@ static void log_internal(const char *func, const char *fmt, va_list args)
 	if (LOG_PREVENT_RECURSIVE)
 		return;
 
-	char *fmt_name = MTY_SprintfD("%s: %s", func, fmt);
-	char *msg = MTY_VsprintfD(fmt_name, args);
+	const char *fmt_name = mty_tlocal_sprintf("%s: %s", func, fmt);
+	LOG_MSG = mty_tlocal_vsprintf(fmt_name, args);
 
-	LOG_MSG = mty_tlocal_strcpy(msg);
-
-	MTY_Free(msg);
-	MTY_Free(fmt_name);
-
-	if (!MTY_Atomic32Get(&LOG_DISABLED)) {
+	if (!MTY_Atomic32Load(&LOG_DISABLED, MTY_ATOMIC_RELAXED)) {
 		LOG_PREVENT_RECURSIVE = true;
 		LOG_FUNC(LOG_MSG, LOG_OPAQUE);
 		LOG_PREVENT_RECURSIVE = false;
@@ -55,7 +50,7 @@ void MTY_SetLogFunc(MTY_LogFunc func, void *opaque)
 
 void MTY_DisableLog(bool disabled)
 {
-	MTY_Atomic32Set(&LOG_DISABLED, disabled ? 1 : 0);
+	MTY_Atomic32Store(&LOG_DISABLED, disabled ? 1 : 0, MTY_ATOMIC_RELAXED);
 }
 
 void MTY_LogParams(const char *func, const char *fmt, ...)
@@ -1995,6 +1995,7 @@ typedef enum {
 typedef struct MTY_JSON MTY_JSON;
 
 /// @brief Parse a string into an MTY_JSON item.
+/// @details The input must be valid UTF-8, including inside strings.
 /// @param input Serialized JSON string.
 /// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
 ///   The returned MTY_JSON item should be destroyed with MTY_JSONDestroy if it
@@ -2002,6 +2003,21 @@ typedef struct MTY_JSON MTY_JSON;
 MTY_EXPORT MTY_JSON *
 MTY_JSONParse(const char *input);
 
+/// @brief Parse a buffer into an MTY_JSON item without copying strings.
+/// @details Strings and object keys are unescaped in place and referenced directly from
+///   `input` instead of being allocated, which makes parsing large documents
+///   considerably cheaper. The buffer is modified whether or not parsing succeeds, and
+///   it must not be changed or freed until the returned item has been destroyed, for
+///   example a buffer from MTY_ReadFile that is freed after MTY_JSONDestroy. Items
+///   added to the hierarchy later are copied as usual.
+/// @param input Serialized JSON, which does not need to be null terminated.
+/// @param size Size in bytes of `input`.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_JSON item should be destroyed with MTY_JSONDestroy if it
+///   remains the root item in the hierarchy.
+MTY_EXPORT MTY_JSON *
+MTY_JSONParseInPlace(char *input, size_t size);
+
 /// @brief Parse the contents of a file into an MTY_JSON item.
 /// @param path Path to the serialized JSON file.
 /// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
@@ -2022,6 +2038,41 @@ MTY_JSONDuplicate(const MTY_JSON *json);
 MTY_EXPORT MTY_JSONType
 MTY_JSONGetType(const MTY_JSON *json);
 
+/// @brief Compute the changes between two MTY_JSON items as a JSON Patch (RFC 6902).
+/// @details Both items are walked together and only the parts that differ produce
+///   operations, so the size of the patch follows the size of the change rather than
+///   the size of the items. Object members are matched by key. Array elements are
+///   matched by a hash of their contents, so elements inserted or removed in the middle
+///   of an array produce `add` and `remove` operations instead of replacing every
+///   element that follows. Only `add`, `remove`, and `replace` operations are
+///   produced.\n\n
+///   Numbers that are integers and numbers that are not are treated as different
+///   values, and an unset array element is treated as null.
+/// @param from The original MTY_JSON item.
+/// @param to The changed MTY_JSON item.
+/// @returns An array of operations that MTY_JSONPatch applies to `from` to produce
+///   `to`. The array is empty if the items are equal.\n\n
+///   The returned MTY_JSON item should be destroyed with MTY_JSONDestroy if it
+///   remains the root item in the hierarchy.
+MTY_EXPORT MTY_JSON *
+MTY_JSONDiff(const MTY_JSON *from, const MTY_JSON *to);
+
+/// @brief Apply a JSON Patch (RFC 6902) to an MTY_JSON item in place.
+/// @details All six operations are supported: `add`, `remove`, `replace`, `move`,
+///   `copy`, and `test`. Paths are JSON Pointers (RFC 6901). Operations are applied in
+///   order and only the items they touch are modified.\n\n
+///   Application stops at the first operation that fails, leaving the operations
+///   before it applied. To apply a patch all or nothing, patch a copy made with
+///   MTY_JSONDuplicate.
+/// @param json Pointer to the MTY_JSON item to patch. An operation whose path is
+///   empty replaces the item itself, in which case `json` is set to the new item and
+///   the old one is destroyed, so only a root item may be replaced.
+/// @param patch An array of operations, such as one returned by MTY_JSONDiff.
+/// @returns Returns true if every operation succeeded, otherwise false.\n\n
+///   Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONPatch(MTY_JSON **json, const MTY_JSON *patch);
+
 /// @brief Destroy an MTY_JSON item.
 /// @param json Passed by reference and set to NULL after being destroyed.\n\n
 ///   This function destroys all children of the item, meaning only the root item
@@ -2037,13 +2088,420 @@ MTY_JSONSerialize(const MTY_JSON *json);
 
 /// @brief Serialize an MTY_JSON item and write it to a file.
 /// @details This function "pretty prints" the JSON, adding spaces, newlines, and tabs
-///   where appropriate.
+///   where appropriate. The output is streamed to the file through an MTY_JSONWriter.
 /// @param path Path to a file where the serialized output will be written.
 /// @param json An MTY_JSON item to serialize.
 /// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
 MTY_EXPORT bool
 MTY_JSONWriteFile(const char *path, const MTY_JSON *json);
 
+/// @brief MTY_JSONWriter output formats.
+typedef enum {
+	MTY_JSON_FORMAT_TEXT    = 0, ///< Compact JSON text.
+	MTY_JSON_FORMAT_PRETTY  = 1, ///< JSON text with newlines and tabs where appropriate.
+	MTY_JSON_FORMAT_CBOR    = 2, ///< CBOR binary encoding (RFC 8949).
+	MTY_JSON_FORMAT_MAKE_32 = INT32_MAX,
+} MTY_JSONFormat;
+
+typedef struct MTY_JSONWriter MTY_JSONWriter;
+
+/// @brief Function called by an MTY_JSONWriter to emit output.
+/// @param buf The next chunk of serialized output.
+/// @param size Size in bytes of `buf`.
+/// @param opaque Pointer set via MTY_JSONWriterCreateFunc.
+/// @returns Return true to continue writing, false to fail the writer.
+typedef bool (*MTY_JSONWriteFunc)(const void *buf, size_t size, void *opaque);
+
+/// @brief Create an MTY_JSONWriter that builds its output in a growable buffer.
+/// @details Values are written incrementally with the MTY_JSONWriter functions, or
+///   from an existing hierarchy with MTY_JSONWriterItem. A writer produces exactly one
+///   root value.\n\n
+///   With MTY_JSON_FORMAT_CBOR, objects and arrays opened with the Begin functions use
+///   indefinite length encoding, while those written by MTY_JSONWriterItem are
+///   prefixed with their length.
+/// @param format Output format.
+/// @returns The returned MTY_JSONWriter must be destroyed with MTY_JSONWriterDestroy.
+MTY_EXPORT MTY_JSONWriter *
+MTY_JSONWriterCreate(MTY_JSONFormat format);
+
+/// @brief Create an MTY_JSONWriter that writes into a caller supplied buffer.
+/// @param buf Output buffer. One byte is reserved for the null terminator, which is
+///   written by MTY_JSONWriterGetString.
+/// @param size Size in bytes of `buf`.
+/// @param format Output format.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   Writing fails once `buf` is full. The returned MTY_JSONWriter must be destroyed
+///   with MTY_JSONWriterDestroy.
+MTY_EXPORT MTY_JSONWriter *
+MTY_JSONWriterCreateBuffer(char *buf, size_t size, MTY_JSONFormat format);
+
+/// @brief Create an MTY_JSONWriter that passes its output to a function in chunks.
+/// @details Memory use is bounded regardless of the size of the output.
+/// @param func Function called each time the internal buffer fills, and by
+///   MTY_JSONWriterFinish with the remainder.
+/// @param opaque Passed to `func`.
+/// @param format Output format.
+/// @returns The returned MTY_JSONWriter must be destroyed with MTY_JSONWriterDestroy.
+MTY_EXPORT MTY_JSONWriter *
+MTY_JSONWriterCreateFunc(MTY_JSONWriteFunc func, void *opaque, MTY_JSONFormat format);
+
+/// @brief Create an MTY_JSONWriter that streams its output to a file.
+/// @param path Path to a file where the serialized output will be written.
+/// @param format Output format.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_JSONWriter must be destroyed with MTY_JSONWriterDestroy, which
+///   closes the file. Call MTY_JSONWriterFinish first to make sure all output was written.
+MTY_EXPORT MTY_JSONWriter *
+MTY_JSONWriterCreateFile(const char *path, MTY_JSONFormat format);
+
+/// @brief Destroy an MTY_JSONWriter.
+/// @param writer Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_JSONWriterDestroy(MTY_JSONWriter **writer);
+
+/// @brief Open an object.
+/// @details Inside an object, each value must be preceded by MTY_JSONWriterKey.
+/// @param ctx An MTY_JSONWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.\n\n
+///   After a failure, all further calls on `ctx` fail.
+MTY_EXPORT bool
+MTY_JSONWriterBeginObject(MTY_JSONWriter *ctx);
+
+/// @brief Close the innermost object.
+/// @param ctx An MTY_JSONWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterEndObject(MTY_JSONWriter *ctx);
+
+/// @brief Open an array.
+/// @param ctx An MTY_JSONWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterBeginArray(MTY_JSONWriter *ctx);
+
+/// @brief Close the innermost array.
+/// @param ctx An MTY_JSONWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterEndArray(MTY_JSONWriter *ctx);
+
+/// @brief Write the key of the next value in an object.
+/// @param ctx An MTY_JSONWriter.
+/// @param key UTF-8 key.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterKey(MTY_JSONWriter *ctx, const char *key);
+
+/// @brief Write a string.
+/// @param ctx An MTY_JSONWriter.
+/// @param value UTF-8 string.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterString(MTY_JSONWriter *ctx, const char *value);
+
+/// @brief Write a number.
+/// @details The shortest representation that parses back to `value` exactly is written.
+/// @param ctx An MTY_JSONWriter.
+/// @param value The number to write.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterNumber(MTY_JSONWriter *ctx, double value);
+
+/// @brief Write an integer.
+/// @param ctx An MTY_JSONWriter.
+/// @param value The integer to write.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterInt(MTY_JSONWriter *ctx, int64_t value);
+
+/// @brief Write a boolean.
+/// @param ctx An MTY_JSONWriter.
+/// @param value The boolean to write.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterBool(MTY_JSONWriter *ctx, bool value);
+
+/// @brief Write `null`.
+/// @param ctx An MTY_JSONWriter.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterNull(MTY_JSONWriter *ctx);
+
+/// @brief Write an MTY_JSON item and all of its children.
+/// @param ctx An MTY_JSONWriter.
+/// @param json The MTY_JSON item to write. NULL is written as `null`.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterItem(MTY_JSONWriter *ctx, const MTY_JSON *json);
+
+/// @brief Check that a complete value was written and flush any buffered output.
+/// @param ctx An MTY_JSONWriter.
+/// @returns Returns true if the output is complete and was written successfully,
+///   otherwise false. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterFinish(MTY_JSONWriter *ctx);
+
+/// @brief Get the output of an MTY_JSONWriter writing to memory.
+/// @param ctx An MTY_JSONWriter created with MTY_JSONWriterCreate or
+///   MTY_JSONWriterCreateBuffer.
+/// @param len Set to the length of the output in bytes. May be NULL, but CBOR output
+///   may contain null bytes.
+/// @returns The null terminated output, valid until the next call on `ctx`.\n\n
+///   If `ctx` writes to a function or file, or writing has failed, NULL is returned.
+MTY_EXPORT const char *
+MTY_JSONWriterGetString(MTY_JSONWriter *ctx, size_t *len);
+
+/// @brief Encode an MTY_JSON item as CBOR (RFC 8949).
+/// @details Numbers created as integers are encoded as CBOR integers, other numbers as
+///   the smallest floating point type that represents them exactly. Use an
+///   MTY_JSONWriter with MTY_JSON_FORMAT_CBOR to stream the output instead.
+/// @param json An MTY_JSON item to encode.
+/// @param size Set to the size in bytes of the returned buffer.
+/// @returns The returned buffer must be destroyed with MTY_Free.
+MTY_EXPORT void *
+MTY_JSONSerializeCBOR(const MTY_JSON *json, size_t *size);
+
+/// @brief Decode a CBOR (RFC 8949) data item into an MTY_JSON item.
+/// @details Tags are ignored, `undefined` becomes `null`, and large integers become
+///   doubles. Byte strings, map keys that are not text, and text containing null
+///   characters are rejected.
+/// @param buf CBOR input.
+/// @param size Size in bytes of `buf`.
+/// @param used Set to the number of bytes consumed, so a stream of consecutive items
+///   can be decoded one after another. Set to 0 on failure. May be NULL.
+/// @returns On failure, including when `buf` ends before the item is complete, NULL
+///   is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_JSON item should be destroyed with MTY_JSONDestroy if it
+///   remains the root item in the hierarchy.
+MTY_EXPORT MTY_JSON *
+MTY_JSONParseCBOR(const void *buf, size_t size, size_t *used);
+
+typedef struct MTY_JSONDoc MTY_JSONDoc;
+
+/// @brief Reference to a value inside an MTY_JSONDoc.
+typedef uint32_t MTY_JSONDocItem;
+
+#define MTY_JSON_DOC_ROOT 0          ///< The root value of an MTY_JSONDoc.
+#define MTY_JSON_DOC_NONE UINT32_MAX ///< Returned when a value does not exist.
+
+/// @brief Parse a string into a lazily decoded MTY_JSONDoc.
+/// @details The input is validated and indexed in a single pass, but no values are
+///   decoded until they are read. This is much faster than MTY_JSONParse when only
+///   part of a document is accessed.\n\n
+///   Values are referenced by MTY_JSONDocItem, starting at MTY_JSON_DOC_ROOT. Functions
+///   that look up a value return MTY_JSON_DOC_NONE if it does not exist, and every
+///   function accepts MTY_JSON_DOC_NONE, so lookups may be chained.
+/// @param input Serialized JSON, which must be valid UTF-8. It does not need to be
+///   null terminated.
+/// @param size Size in bytes of `input`. The input is copied.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_JSONDoc must be destroyed with MTY_JSONDocDestroy.
+MTY_EXPORT MTY_JSONDoc *
+MTY_JSONDocParse(const char *input, size_t size);
+
+/// @brief Parse the contents of a file into a lazily decoded MTY_JSONDoc.
+/// @param path Path to the serialized JSON file.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_JSONDoc must be destroyed with MTY_JSONDocDestroy.
+MTY_EXPORT MTY_JSONDoc *
+MTY_JSONDocReadFile(const char *path);
+
+/// @brief Destroy an MTY_JSONDoc.
+/// @param doc Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_JSONDocDestroy(MTY_JSONDoc **doc);
+
+/// @brief Get the MTY_JSONType of a value in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item A value in `doc`.
+/// @returns If `item` is MTY_JSON_DOC_NONE, MTY_JSON_NULL is returned.
+MTY_EXPORT MTY_JSONType
+MTY_JSONDocGetType(const MTY_JSONDoc *doc, MTY_JSONDocItem item);
+
+/// @brief Decode a value in an MTY_JSONDoc and all of its children into an MTY_JSON item.
+/// @param doc An MTY_JSONDoc.
+/// @param item A value in `doc`.
+/// @returns If `item` is MTY_JSON_DOC_NONE, NULL is returned.\n\n
+///   The returned MTY_JSON item should be destroyed with MTY_JSONDestroy if it
+///   remains the root item in the hierarchy.
+MTY_EXPORT MTY_JSON *
+MTY_JSONDocGetJSON(const MTY_JSONDoc *doc, MTY_JSONDocItem item);
+
+/// @brief Look up a value in an MTY_JSONDoc with an RFC 6901 JSON Pointer.
+/// @param doc An MTY_JSONDoc.
+/// @param item The value `pointer` is relative to, usually MTY_JSON_DOC_ROOT.
+/// @param pointer JSON Pointer such as `/servers/0/name`. An empty string refers to
+///   `item` itself.
+/// @returns If the value does not exist, MTY_JSON_DOC_NONE is returned.
+MTY_EXPORT MTY_JSONDocItem
+MTY_JSONDocPointer(const MTY_JSONDoc *doc, MTY_JSONDocItem item, const char *pointer);
+
+/// @brief Get a value from an object in an MTY_JSONDoc.
+/// @details If a key appears more than once, the last value is returned.
+/// @param doc An MTY_JSONDoc.
+/// @param item An object in `doc`.
+/// @param key Key to lookup.
+/// @returns If the `key` does not exist, MTY_JSON_DOC_NONE is returned.
+MTY_EXPORT MTY_JSONDocItem
+MTY_JSONDocObjGetItem(const MTY_JSONDoc *doc, MTY_JSONDocItem item, const char *key);
+
+/// @brief Get the number of values in an array in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item An array in `doc`.
+MTY_EXPORT uint32_t
+MTY_JSONDocArrayGetLength(const MTY_JSONDoc *doc, MTY_JSONDocItem item);
+
+/// @brief Get a value from an array in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item An array in `doc`.
+/// @param index Index to lookup.
+/// @returns If the `index` does not exist, MTY_JSON_DOC_NONE is returned.
+MTY_EXPORT MTY_JSONDocItem
+MTY_JSONDocArrayGetItem(const MTY_JSONDoc *doc, MTY_JSONDocItem item, uint32_t index);
+
+/// @brief Get the bool value of a boolean in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item A boolean in `doc`.
+/// @param value The bool value of `item`.
+/// @returns Returns true on success, false if the type of `item` is not MTY_JSON_BOOL.
+MTY_EXPORT bool
+MTY_JSONDocBool(const MTY_JSONDoc *doc, MTY_JSONDocItem item, bool *value);
+
+/// @brief Get the double value of a number in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item A number in `doc`.
+/// @param value The double value of `item`. Numbers too large for a double are 0,
+///   matching MTY_JSONParse.
+/// @returns Returns true on success, false if the type of `item` is not MTY_JSON_NUMBER.
+MTY_EXPORT bool
+MTY_JSONDocNumber(const MTY_JSONDoc *doc, MTY_JSONDocItem item, double *value);
+
+/// @brief Get the int32_t value of a number in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item A number in `doc`.
+/// @param value The int32_t value of `item`.
+/// @returns Returns true on success, false if the type of `item` is not MTY_JSON_NUMBER.
+MTY_EXPORT bool
+MTY_JSONDocInt32(const MTY_JSONDoc *doc, MTY_JSONDocItem item, int32_t *value);
+
+/// @brief Get the string value of a string in an MTY_JSONDoc.
+/// @param doc An MTY_JSONDoc.
+/// @param item A string in `doc`.
+/// @param value Filled with the string value of `item`.
+/// @param size Size in bytes of `value`.
+/// @returns Returns true on success, false if the type of `item` is not MTY_JSON_STRING or
+///   the string value of `item` could not fit in `value`.
+MTY_EXPORT bool
+MTY_JSONDocString(const MTY_JSONDoc *doc, MTY_JSONDocItem item, char *value, size_t size);
+
+/// @brief Function called with each line of newline delimited JSON.
+/// @param line Line number of the item, starting at 1. Blank lines are skipped.
+/// @param json The parsed item, or NULL if the line is not valid JSON. It is destroyed
+///   after this function returns, use MTY_JSONDuplicate to keep it.
+/// @param opaque Pointer set via MTY_JSONParseLines or MTY_JSONReadLinesFile.
+/// @returns Return true to continue, false to stop.
+typedef bool (*MTY_JSONLineFunc)(size_t line, const MTY_JSON *json, void *opaque);
+
+/// @brief Parse newline delimited JSON, also known as NDJSON or JSON Lines.
+/// @details Each line holds one JSON value. The input is split into chunks at line
+///   boundaries which are parsed on the same persistent worker threads as
+///   MTY_ParallelFor, then the items are passed to `func` in order on the calling
+///   thread. Input is processed in batches so only part of it is held as MTY_JSON
+///   items at any time.
+/// @param input Newline delimited JSON, which does not need to be null terminated.
+/// @param size Size in bytes of `input`.
+/// @param func Function called with each item in order.
+/// @param opaque Passed to `func` when it is called.
+/// @returns Returns true if every line was passed to `func`, false if `func` stopped
+///   early.
+MTY_EXPORT bool
+MTY_JSONParseLines(const char *input, size_t size, MTY_JSONLineFunc func, void *opaque);
+
+/// @brief Parse a file of newline delimited JSON.
+/// @details The file is read in batches rather than all at once, see
+///   MTY_JSONParseLines.
+/// @param path Path to the newline delimited JSON file.
+/// @param func Function called with each item in order.
+/// @param opaque Passed to `func` when it is called.
+/// @returns Returns true if every line was passed to `func`, false if `func` stopped
+///   early or the file could not be read.\n\n
+///   Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONReadLinesFile(const char *path, MTY_JSONLineFunc func, void *opaque);
+
+/// @brief Type of a struct member bound to JSON by an MTY_JSONField.
+typedef enum {
+	MTY_JSON_FIELD_BOOL    = 1, ///< `bool`, a JSON boolean.
+	MTY_JSON_FIELD_INT32   = 2, ///< `int32_t`, a JSON number that is an integer.
+	MTY_JSON_FIELD_UINT32  = 3, ///< `uint32_t`, a JSON number that is an integer.
+	MTY_JSON_FIELD_INT64   = 4, ///< `int64_t`, a JSON number that is an integer.
+	MTY_JSON_FIELD_FLOAT   = 5, ///< `float`, a JSON number.
+	MTY_JSON_FIELD_DOUBLE  = 6, ///< `double`, a JSON number.
+	MTY_JSON_FIELD_STRING  = 7, ///< Null terminated `char` buffer of `size` bytes, a JSON string.
+	MTY_JSON_FIELD_STRUCT  = 8, ///< Nested struct of `size` bytes described by `fields`,
+	                            ///<   a JSON object.
+	MTY_JSON_FIELD_MAKE_32 = INT32_MAX,
+} MTY_JSONFieldType;
+
+/// @brief Binds a JSON object member to a struct member.
+/// @details A struct is described by an array of fields, usually a static table
+///   initialized with `offsetof`.
+typedef struct MTY_JSONField {
+	const char *name;                   ///< Key of the member in the JSON object.
+	MTY_JSONFieldType type;             ///< Type of the struct member.
+	size_t offset;                      ///< Offset in bytes of the struct member.
+	size_t size;                        ///< Size in bytes of a string buffer or nested struct.
+	uint32_t count;                     ///< Number of elements if the member is a fixed
+	                                    ///<   array, a JSON array, otherwise 0.
+	const struct MTY_JSONField *fields; ///< Fields of a nested struct.
+	uint32_t numFields;                 ///< Number of `fields`.
+} MTY_JSONField;
+
+/// @brief Parse a JSON object directly into a struct.
+/// @details No MTY_JSON items are created and nothing is allocated. Members of the
+///   object that are not described by `fields` are validated and skipped. Struct
+///   members whose key is missing or null are left unchanged, as are the trailing
+///   elements of a fixed array when the JSON array is shorter. A JSON array longer than
+///   its fixed array, a string that does not fit its buffer, a number out of range
+///   of its member, or any other mismatch fails the parse.
+/// @param input Serialized JSON object, which does not need to be null terminated.
+/// @param size Size in bytes of `input`.
+/// @param fields Fields describing the struct.
+/// @param numFields Number of `fields`.
+/// @param dst Struct to fill. On failure, it may be partially filled.
+/// @returns Returns true on success, false on failure.\n\n
+///   Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONParseStruct(const char *input, size_t size, const MTY_JSONField *fields,
+	uint32_t numFields, void *dst);
+
+/// @brief Write a struct as a JSON object to an MTY_JSONWriter.
+/// @details Every field is written, fixed arrays with all of their elements.
+/// @param ctx An MTY_JSONWriter.
+/// @param fields Fields describing the struct.
+/// @param numFields Number of `fields`.
+/// @param src Struct to write.
+/// @returns Returns true on success, false on failure.\n\n
+///   Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_JSONWriterStruct(MTY_JSONWriter *ctx, const MTY_JSONField *fields, uint32_t numFields,
+	const void *src);
+
+/// @brief Serialize a struct as a JSON object into a buffer.
+/// @details Nothing is allocated unless the struct is nested more than 32 levels deep,
+///   see MTY_JSONWriterStruct.
+/// @param fields Fields describing the struct.
+/// @param numFields Number of `fields`.
+/// @param src Struct to serialize.
+/// @param buf Output buffer.
+/// @param size Size in bytes of `buf`.
+/// @returns The length of the null terminated output, or 0 if `buf` is too small or a
+///   string member is not null terminated.\n\n
+///   Call MTY_GetLog for details.
+MTY_EXPORT size_t
+MTY_JSONSerializeStruct(const MTY_JSONField *fields, uint32_t numFields, const void *src,
+	char *buf, size_t size);
+
 /// @brief Create a new MTY_JSON null item.
 /// @returns The returned MTY_JSON item should be destroyed with MTY_JSONDestroy if it
 ///   remains the root item in the hierarchy.
@@ -2423,6 +2881,105 @@ MTY_SprintfD(const char *fmt, ...) MTY_FMT(1, 2);
 MTY_EXPORT const char *
 MTY_SprintfDL(const char *fmt, ...) MTY_FMT(1, 2);
 
+/// @brief String builder with amortized growth.
+/// @details Members may be read directly but should only be modified through the
+///   MTY_StrBuf functions. `str` is always null terminated, but any function that
+///   grows the string may move it.
+typedef struct {
+	char *str;   ///< The string being built.
+	size_t len;  ///< Length of `str` in bytes, excluding the null terminator.
+	size_t size; ///< Size in bytes of the buffer behind `str`.
+	bool heap;   ///< `str` was allocated by the builder rather than supplied to
+	             ///<   MTY_StrBufInit.
+} MTY_StrBuf;
+
+/// @brief Initialize an empty MTY_StrBuf.
+/// @details A small buffer, typically on the stack, can be supplied so short strings
+///   are built without allocating. Once the string outgrows it, the contents move to
+///   the heap and `buf` is no longer used.
+/// @param sb The MTY_StrBuf to initialize.
+/// @param buf Initial buffer for the string. May be NULL.
+/// @param size Size in bytes of `buf`.
+MTY_EXPORT void
+MTY_StrBufInit(MTY_StrBuf *sb, char *buf, size_t size);
+
+/// @brief Free any memory allocated by an MTY_StrBuf.
+/// @details The builder is left empty and may be reused.
+/// @param sb An MTY_StrBuf.
+MTY_EXPORT void
+MTY_StrBufFree(MTY_StrBuf *sb);
+
+/// @brief Make room to append at least `len` more bytes without growing again.
+/// @param sb An MTY_StrBuf.
+/// @param len Number of bytes, excluding the null terminator.
+MTY_EXPORT void
+MTY_StrBufReserve(MTY_StrBuf *sb, size_t len);
+
+/// @brief Set the length of an MTY_StrBuf to zero while keeping its buffer.
+/// @param sb An MTY_StrBuf.
+MTY_EXPORT void
+MTY_StrBufClear(MTY_StrBuf *sb);
+
+/// @brief Append a string to an MTY_StrBuf.
+/// @param sb An MTY_StrBuf.
+/// @param str String to append.
+MTY_EXPORT void
+MTY_StrBufAppend(MTY_StrBuf *sb, const char *str);
+
+/// @brief Append bytes to an MTY_StrBuf.
+/// @param sb An MTY_StrBuf.
+/// @param str Bytes to append. They do not need to be null terminated.
+/// @param len Number of bytes to append.
+MTY_EXPORT void
+MTY_StrBufAppendLen(MTY_StrBuf *sb, const char *str, size_t len);
+
+/// @brief Append a single character to an MTY_StrBuf.
+/// @param sb An MTY_StrBuf.
+/// @param c Character to append.
+MTY_EXPORT void
+MTY_StrBufAppendChar(MTY_StrBuf *sb, char c);
+
+/// @brief Append a formatted string to an MTY_StrBuf with a va_list.
+/// @details The string is formatted directly into the builder's spare capacity and
+///   is only formatted a second time if it did not fit.
+/// @param sb An MTY_StrBuf.
+/// @param fmt Format string.
+/// @param args Variable arguments in the form of a va_list as specified by `fmt`.
+MTY_EXPORT void
+MTY_StrBufVprintf(MTY_StrBuf *sb, const char *fmt, va_list args);
+
+/// @brief Append a formatted string to an MTY_StrBuf.
+/// @details See MTY_StrBufVprintf.
+/// @param sb An MTY_StrBuf.
+/// @param fmt Format string.
+/// @param ... Variable arguments as specified by `fmt`.
+MTY_EXPORT void
+MTY_StrBufPrintf(MTY_StrBuf *sb, const char *fmt, ...) MTY_FMT(2, 3);
+
+/// @brief Append an integer in decimal to an MTY_StrBuf.
+/// @param sb An MTY_StrBuf.
+/// @param value Integer to append.
+MTY_EXPORT void
+MTY_StrBufAppendInt(MTY_StrBuf *sb, int64_t value);
+
+/// @brief Append a floating point number to an MTY_StrBuf.
+/// @details The shortest decimal that converts back to exactly the same double is
+///   written, independent of the locale. Exponents are used for values below 1e-6 or at
+///   least 1e21, like JavaScript's number formatting.
+/// @param sb An MTY_StrBuf.
+/// @param value Number to append.
+MTY_EXPORT void
+MTY_StrBufAppendFloat(MTY_StrBuf *sb, double value);
+
+/// @brief Take ownership of the string built by an MTY_StrBuf.
+/// @details The builder is left empty and may be reused. If the string is still in
+///   the buffer supplied to MTY_StrBufInit, it is copied to the heap.
+/// @param sb An MTY_StrBuf.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned buffer must be destroyed with MTY_Free.
+MTY_EXPORT char *
+MTY_StrBufMove(MTY_StrBuf *sb);
+
 /// @brief Search a string for a list of substrings.
 /// @param a String to be searched.
 /// @param b List of substrings delimited by `delim`.
@@ -2464,7 +3021,11 @@ MTY_Strtok(char *str, const char *delim, char **saveptr);
 /// @brief Stable qsort.
 /// @details For more information, see `qsort` from the C standard library. The
 ///   difference between this function and `qsort` is that the order of elements
-///   that compare equally will be preserved.
+///   that compare equally will be preserved.\n\n
+///   This is an adaptive merge sort that takes advantage of runs of elements that
+///   are already in order, so sorted, reversed, or mostly sorted buffers are sorted
+///   in close to linear time. Scratch space for up to half of `buf` is needed while
+///   merging, which is taken from the stack for small buffers.
 /// @param buf The buffer to sort.
 /// @param len Number of elements in `buf`.
 /// @param size Size in bytes of each element.
@@ -2473,6 +3034,137 @@ MTY_Strtok(char *str, const char *delim, char **saveptr);
 MTY_EXPORT void
 MTY_Sort(void *buf, size_t len, size_t size, MTY_CompareFunc func);
 
+/// @brief Stable sort using multiple threads.
+/// @details Blocks of `buf` are sorted in parallel with MTY_Sort, then merged in
+///   rounds where each merge is split across threads. Threads come from the same
+///   persistent workers as MTY_ParallelFor. Small buffers are sorted on the calling
+///   thread with MTY_Sort.\n\n
+///   Scratch space the size of `buf` is allocated while sorting. `func` may be
+///   called from several threads at once.
+/// @param buf The buffer to sort.
+/// @param len Number of elements in `buf`.
+/// @param size Size in bytes of each element.
+/// @param func Function called to compare elements as the algorithm processes the
+///   buffer.
+MTY_EXPORT void
+MTY_SortParallel(void *buf, size_t len, size_t size, MTY_CompareFunc func);
+
+#define MTY_SORT_INSERTION 16   ///< Ranges at or below this length are insertion sorted.
+#define MTY_SORT_STACK     1024 ///< Bytes of merge scratch kept on the stack by MTY_SORT_DEFINE.
+
+/// @brief Define sort and binary search functions specialized for a type.
+/// @details Generates the following `static inline` functions, where `less` is
+///   expanded inline instead of being called through a function pointer:\n\n
+///   `void name_sort(type *buf, size_t len)` is a stable merge sort in ascending order
+///   that insertion sorts ranges of MTY_SORT_INSERTION elements or fewer.\n\n
+///   `size_t name_lower_bound(const type *buf, size_t len, const type *key)` returns
+///   the index of the first element in a sorted `buf` that does not go before `key`.\n\n
+///   `size_t name_upper_bound(const type *buf, size_t len, const type *key)` returns
+///   the index of the first element in a sorted `buf` that goes after `key`.\n\n
+///   `type *name_search(type *buf, size_t len, const type *key)` returns the first
+///   element in a sorted `buf` equal to `key`, or NULL if there is none.
+/// @param name Prefix for the generated functions.
+/// @param type Element type, which must be copyable by assignment.
+/// @param less Function or function-like macro taking two `const type *` that
+///   evaluates to true if the first element goes before the second.
+#define MTY_SORT_DEFINE(name, type, less) \
+	static inline void name##_insertion(type *buf, size_t len) \
+	{ \
+		for (size_t i = 1; i < len; i++) { \
+			type v = buf[i]; \
+			size_t j = i; \
+			for (; j > 0 && less(&v, &buf[j - 1]); j--) \
+				buf[j] = buf[j - 1]; \
+			buf[j] = v; \
+		} \
+	} \
+	\
+	static inline void name##_merge(type *buf, size_t len, type *tmp) \
+	{ \
+		if (len <= MTY_SORT_INSERTION) { \
+			name##_insertion(buf, len); \
+			return; \
+		} \
+		size_t half = len / 2; \
+		name##_merge(buf, half, tmp); \
+		name##_merge(buf + half, len - half, tmp); \
+		if (!less(&buf[half], &buf[half - 1])) \
+			return; \
+		for (size_t x = 0; x < half; x++) \
+			tmp[x] = buf[x]; \
+		size_t i = 0, j = half, k = 0; \
+		while (i < half && j < len) { \
+			if (less(&buf[j], &tmp[i])) { \
+				buf[k++] = buf[j++]; \
+			} else { \
+				buf[k++] = tmp[i++]; \
+			} \
+		} \
+		while (i < half) \
+			buf[k++] = tmp[i++]; \
+	} \
+	\
+	static inline void name##_sort(type *buf, size_t len) \
+	{ \
+		type stack[MTY_SORT_STACK / sizeof(type) + 1]; \
+		type *tmp = len / 2 <= MTY_SORT_STACK / sizeof(type) + 1 ? stack : \
+			(type *) MTY_Alloc(len / 2, sizeof(type)); \
+		name##_merge(buf, len, tmp); \
+		if (tmp != stack) \
+			MTY_Free(tmp); \
+	} \
+	\
+	static inline size_t name##_lower_bound(const type *buf, size_t len, const type *key) \
+	{ \
+		if (len == 0) \
+			return 0; \
+		const type *base = buf; \
+		for (size_t n = len; n > 1; n -= n / 2) \
+			base = less(&base[n / 2 - 1], key) ? base + n / 2 : base; \
+		return (size_t) (base - buf) + (less(base, key) ? 1 : 0); \
+	} \
+	\
+	static inline size_t name##_upper_bound(const type *buf, size_t len, const type *key) \
+	{ \
+		if (len == 0) \
+			return 0; \
+		const type *base = buf; \
+		for (size_t n = len; n > 1; n -= n / 2) \
+			base = !less(key, &base[n / 2 - 1]) ? base + n / 2 : base; \
+		return (size_t) (base - buf) + (!less(key, base) ? 1 : 0); \
+	} \
+	\
+	static inline type *name##_search(type *buf, size_t len, const type *key) \
+	{ \
+		size_t i = name##_lower_bound(buf, len, key); \
+		return i < len && !less(key, &buf[i]) ? &buf[i] : NULL; \
+	}
+
+/// @brief Type of the key used by MTY_RadixSort.
+typedef enum {
+	MTY_SORT_KEY_UINT32 = 0, ///< `uint32_t` key.
+	MTY_SORT_KEY_INT32  = 1, ///< `int32_t` key.
+	MTY_SORT_KEY_UINT64 = 2, ///< `uint64_t` key.
+	MTY_SORT_KEY_INT64  = 3, ///< `int64_t` key.
+	MTY_SORT_KEY_FLOAT  = 4, ///< `float` key.
+	MTY_SORT_KEY_DOUBLE = 5, ///< `double` key.
+	MTY_SORT_KEY_MAKE_32 = INT32_MAX,
+} MTY_SortKey;
+
+/// @brief Stable radix sort on a numeric key.
+/// @details Elements are sorted in ascending order of a key stored inside each
+///   element without calling a compare function, which is much faster than MTY_Sort
+///   for large buffers. The order of elements with equal keys is preserved.\n\n
+///   Floating point keys sort `-0.0` before `0.0`, and NaNs sort before or after
+///   all other values depending on their sign bit.
+/// @param buf The buffer to sort.
+/// @param len Number of elements in `buf`.
+/// @param size Size in bytes of each element.
+/// @param offset Offset in bytes of the key inside each element.
+/// @param key Type of the key at `offset`.
+MTY_EXPORT void
+MTY_RadixSort(void *buf, size_t len, size_t size, size_t offset, MTY_SortKey key);
+
 /// @brief Convert a wide character string to its UTF-8 equivalent.
 /// @param src Source wide character string.
 /// @param dst Destination UTF-8 string.
@@ -2577,6 +3269,7 @@ typedef struct MTY_Cond MTY_Cond;
 typedef struct MTY_RWLock MTY_RWLock;
 typedef struct MTY_Waitable MTY_Waitable;
 typedef struct MTY_ThreadPool MTY_ThreadPool;
+typedef struct MTY_TaskGraph MTY_TaskGraph;
 
 /// @brief Function that takes a single opaque argument.
 /// @param opaque Pointer set via various MTY_ThreadPool related functions.
@@ -2588,6 +3281,26 @@ typedef void (*MTY_AnonFunc)(void *opaque);
 ///   has not been run as detached.
 typedef void *(*MTY_ThreadFunc)(void *opaque);
 
+/// @brief Function called on a subrange by MTY_ParallelFor.
+/// @param begin First index of the subrange.
+/// @param end One past the last index of the subrange.
+/// @param opaque Pointer set via MTY_ParallelFor.
+typedef void (*MTY_RangeFunc)(int64_t begin, int64_t end, void *opaque);
+
+/// @brief Function called on a subrange by MTY_ParallelReduce.
+/// @param begin First index of the subrange.
+/// @param end One past the last index of the subrange.
+/// @param partial Partial result for this subrange to accumulate into. It starts
+///   as a copy of the identity value passed to MTY_ParallelReduce.
+/// @param opaque Pointer set via MTY_ParallelReduce.
+typedef void (*MTY_ReduceFunc)(int64_t begin, int64_t end, void *partial, void *opaque);
+
+/// @brief Function that merges a partial result into the final result.
+/// @param result Final result being accumulated.
+/// @param partial Partial result produced by an MTY_ReduceFunc.
+/// @param opaque Pointer set via MTY_ParallelReduce.
+typedef void (*MTY_CombineFunc)(void *result, const void *partial, void *opaque);
+
 /// @brief Status of an asynchronous task.
 typedef enum {
 	MTY_ASYNC_OK       = 0, ///< The task has completed and the result is ready.
@@ -2607,6 +3320,33 @@ typedef struct {
 	volatile int64_t value; ///< 64-bit integer wrapped in a struct for alignment.
 } MTY_Atomic64;
 
+/// @brief Pointer used for atomic operations.
+typedef struct {
+	void * volatile value; ///< Pointer wrapped in a struct for alignment.
+} MTY_AtomicPtr;
+
+/// @brief Memory ordering constraint for an atomic operation.
+/// @details Functions without an MTY_AtomicOrder argument always use
+///   MTY_ATOMIC_SEQ_CST. Loads treat MTY_ATOMIC_RELEASE as MTY_ATOMIC_SEQ_CST
+///   and MTY_ATOMIC_ACQ_REL as MTY_ATOMIC_ACQUIRE, stores treat MTY_ATOMIC_ACQUIRE
+///   as MTY_ATOMIC_SEQ_CST and MTY_ATOMIC_ACQ_REL as MTY_ATOMIC_RELEASE.
+typedef enum {
+	MTY_ATOMIC_RELAXED = 0, ///< Only atomicity is guaranteed, no ordering constraints.
+	MTY_ATOMIC_ACQUIRE = 1, ///< Later memory accesses can not be reordered before a load.
+	MTY_ATOMIC_RELEASE = 2, ///< Earlier memory accesses can not be reordered after a store.
+	MTY_ATOMIC_ACQ_REL = 3, ///< Both acquire and release, for read-modify-write operations.
+	MTY_ATOMIC_SEQ_CST = 4, ///< Full memory barrier with a single total order.
+	MTY_ATOMIC_MAKE_32 = INT32_MAX,
+} MTY_AtomicOrder;
+
+#define MTY_CACHE_LINE 64 ///< Assumed size in bytes of a CPU cache line.
+
+/// @brief Declare a padding member that fills out the rest of a cache line.
+/// @details Place after members totaling `size` bytes to keep the following
+///   members from sharing a cache line with them (false sharing).
+#define MTY_CACHE_PAD(name, size) \
+	uint8_t name[MTY_CACHE_LINE - (size) % MTY_CACHE_LINE]
+
 /// @brief Create an MTY_Thread that executes asynchronously.
 /// @param func Function that executes on its own thread.
 /// @param opaque Passed to `func` when it is called.
@@ -2806,34 +3546,112 @@ MTY_ThreadPoolDetach(MTY_ThreadPool *ctx, uint32_t index, MTY_AnonFunc detach);
 MTY_EXPORT MTY_Async
 MTY_ThreadPoolPoll(MTY_ThreadPool *ctx, uint32_t index, void **opaque);
 
+/// @brief Get the number of logical processors available to the process.
+MTY_EXPORT uint32_t
+MTY_GetCPUCount(void);
+
+/// @brief Run a function over a range of indices in parallel.
+/// @details The range is split into chunks of `grain` indices that are executed on
+///   a set of persistent worker threads shared by the whole process, one less than
+///   the number of logical processors. The calling thread executes chunks as well and
+///   this function does not return until the entire range has been processed.\n\n
+///   `func` may itself call MTY_ParallelFor. If the range fits in a single chunk,
+///   `func` is called directly on the calling thread.
+/// @param begin First index of the range.
+/// @param end One past the last index of the range.
+/// @param grain Number of indices per chunk. If 0 or less, a chunk size is chosen
+///   that gives each thread a few chunks for load balancing.
+/// @param func Function called with each chunk's subrange.
+/// @param opaque Passed to `func` when it is called.
+MTY_EXPORT void
+MTY_ParallelFor(int64_t begin, int64_t end, int64_t grain, MTY_RangeFunc func, void *opaque);
+
+/// @brief Reduce a range of indices to a single value in parallel.
+/// @details The chunks are split into one contiguous run per thread, at most one more
+///   than the number of workers. Each run accumulates its chunks in order into its own
+///   partial copy of `result`, then the partials are combined into `result` in order on
+///   the calling thread. Memory use therefore does not grow with the number of chunks,
+///   and the outcome is deterministic when `combine` is associative, even if it is not
+///   commutative.
+/// @param begin First index of the range.
+/// @param end One past the last index of the range.
+/// @param grain Number of indices per chunk, see MTY_ParallelFor.
+/// @param result On input the identity value of the reduction, on output the result.
+/// @param size Size in bytes of `result`.
+/// @param reduce Function called with each chunk's subrange and partial result.
+/// @param combine Function called to merge each partial result into `result`.
+/// @param opaque Passed to `reduce` and `combine` when they are called.
+MTY_EXPORT void
+MTY_ParallelReduce(int64_t begin, int64_t end, int64_t grain, void *result, size_t size,
+	MTY_ReduceFunc reduce, MTY_CombineFunc combine, void *opaque);
+
+/// @brief Create an MTY_TaskGraph for running tasks with dependencies.
+/// @details Tasks run on the same persistent worker threads as MTY_ParallelFor. A task
+///   is started as soon as all of the tasks it depends on have finished, usually on
+///   the thread that finished its last dependency.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_TaskGraph must be destroyed with MTY_TaskGraphDestroy.
+MTY_EXPORT MTY_TaskGraph *
+MTY_TaskGraphCreate(void);
+
+/// @brief Wait for all tasks in an MTY_TaskGraph to finish then destroy it.
+/// @param graph Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_TaskGraphDestroy(MTY_TaskGraph **graph);
+
+/// @brief Add a task to an MTY_TaskGraph.
+/// @details If all of `deps` have already finished, the task is scheduled immediately.
+///   Tasks may be added from any thread, including from inside a running task to
+///   create continuations.
+/// @param ctx An MTY_TaskGraph.
+/// @param func Function executed on a worker thread.
+/// @param opaque Passed to `func` when it is called.
+/// @param deps Array of task ids returned by previous calls to MTY_TaskGraphAdd that
+///   must finish before this task runs. May be NULL if `numDeps` is 0.
+/// @param numDeps Number of elements in `deps`.
+/// @returns The id of the new task, which is always greater than 0. Ids are only
+///   valid until MTY_TaskGraphWait returns true.
+MTY_EXPORT uint32_t
+MTY_TaskGraphAdd(MTY_TaskGraph *ctx, MTY_AnonFunc func, void *opaque,
+	const uint32_t *deps, uint32_t numDeps);
+
+/// @brief Wait for all tasks in an MTY_TaskGraph to finish.
+/// @details When all tasks have finished, the graph is cleared and may be reused.
+///   This function must not be called from inside one of the graph's own tasks.
+/// @param ctx An MTY_TaskGraph.
+/// @param timeout Time to wait in milliseconds. A negative value will not timeout.
+/// @returns Returns true if all tasks have finished, otherwise false on timeout.
+MTY_EXPORT bool
+MTY_TaskGraphWait(MTY_TaskGraph *ctx, int32_t timeout);
+
 /// @brief Set a 32-bit integer atomically.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic32.
 /// @param value Value to atomically set.
 MTY_EXPORT void
 MTY_Atomic32Set(MTY_Atomic32 *atomic, int32_t value);
 
 /// @brief Set a 64-bit integer atomically.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic64.
 /// @param value Value to atomically set.
 MTY_EXPORT void
 MTY_Atomic64Set(MTY_Atomic64 *atomic, int64_t value);
 
 /// @brief Get a 32-bit integer atomically.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic32.
 MTY_EXPORT int32_t
 MTY_Atomic32Get(MTY_Atomic32 *atomic);
 
 /// @brief Get a 64-bit integer atomically.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic64.
 MTY_EXPORT int64_t
 MTY_Atomic64Get(MTY_Atomic64 *atomic);
 
 /// @brief Add to a 32-bit integer atomically.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic32.
 /// @param value Value to atomically add. This value can be negative, effectively
 ///   performing subtraction.
@@ -2842,7 +3660,7 @@ MTY_EXPORT int32_t
 MTY_Atomic32Add(MTY_Atomic32 *atomic, int32_t value);
 
 /// @brief Add to a 64-bit integer atomically.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic64.
 /// @param value Value to atomically add. This value can be negative, effectively
 ///   performing subtraction.
@@ -2851,7 +3669,7 @@ MTY_EXPORT int64_t
 MTY_Atomic64Add(MTY_Atomic64 *atomic, int64_t value);
 
 /// @brief Compare two 32-bit values and if the same, atomically set to a new value.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic32.
 /// @param oldValue Value to compare against the atomic.
 /// @param newValue Value the atomic is set to if `oldValue` matches the atomic.
@@ -2860,7 +3678,7 @@ MTY_EXPORT bool
 MTY_Atomic32CAS(MTY_Atomic32 *atomic, int32_t oldValue, int32_t newValue);
 
 /// @brief Compare two 64-bit values and if the same, atomically set to a new value.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param atomic An MTY_Atomic64.
 /// @param oldValue Value to compare against the atomic.
 /// @param newValue Value the atomic is set to if `oldValue` matches the atomic.
@@ -2868,8 +3686,157 @@ MTY_Atomic32CAS(MTY_Atomic32 *atomic, int32_t oldValue, int32_t newValue);
 MTY_EXPORT bool
 MTY_Atomic64CAS(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue);
 
+/// @brief Load a 32-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic32.
+/// @param order Memory ordering constraint, typically MTY_ATOMIC_ACQUIRE or
+///   MTY_ATOMIC_RELAXED.
+MTY_EXPORT int32_t
+MTY_Atomic32Load(MTY_Atomic32 *atomic, MTY_AtomicOrder order);
+
+/// @brief Load a 64-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic64.
+/// @param order Memory ordering constraint, typically MTY_ATOMIC_ACQUIRE or
+///   MTY_ATOMIC_RELAXED.
+MTY_EXPORT int64_t
+MTY_Atomic64Load(MTY_Atomic64 *atomic, MTY_AtomicOrder order);
+
+/// @brief Store a 32-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic32.
+/// @param value Value to atomically store.
+/// @param order Memory ordering constraint, typically MTY_ATOMIC_RELEASE or
+///   MTY_ATOMIC_RELAXED.
+MTY_EXPORT void
+MTY_Atomic32Store(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order);
+
+/// @brief Store a 64-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic64.
+/// @param value Value to atomically store.
+/// @param order Memory ordering constraint, typically MTY_ATOMIC_RELEASE or
+///   MTY_ATOMIC_RELAXED.
+MTY_EXPORT void
+MTY_Atomic64Store(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order);
+
+/// @brief Add to a 32-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic32.
+/// @param value Value to atomically add. This value can be negative.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the addition.
+MTY_EXPORT int32_t
+MTY_Atomic32FetchAdd(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order);
+
+/// @brief Add to a 64-bit integer atomically with an explicit memory order.
+/// @param atomic An MTY_Atomic64.
+/// @param value Value to atomically add. This value can be negative.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the addition.
+MTY_EXPORT int64_t
+MTY_Atomic64FetchAdd(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order);
+
+/// @brief Bitwise OR a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value Bits to set.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the operation.
+MTY_EXPORT int32_t
+MTY_Atomic32FetchOr(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order);
+
+/// @brief Bitwise OR a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value Bits to set.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the operation.
+MTY_EXPORT int64_t
+MTY_Atomic64FetchOr(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order);
+
+/// @brief Bitwise AND a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value Mask of bits to keep.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the operation.
+MTY_EXPORT int32_t
+MTY_Atomic32FetchAnd(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order);
+
+/// @brief Bitwise AND a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value Mask of bits to keep.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the operation.
+MTY_EXPORT int64_t
+MTY_Atomic64FetchAnd(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order);
+
+/// @brief Swap a 32-bit integer atomically.
+/// @param atomic An MTY_Atomic32.
+/// @param value New value for the atomic.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the swap.
+MTY_EXPORT int32_t
+MTY_Atomic32Exchange(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order);
+
+/// @brief Swap a 64-bit integer atomically.
+/// @param atomic An MTY_Atomic64.
+/// @param value New value for the atomic.
+/// @param order Memory ordering constraint.
+/// @returns The value held by the atomic before the swap.
+MTY_EXPORT int64_t
+MTY_Atomic64Exchange(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order);
+
+/// @brief Compare and swap a 32-bit integer with an explicit memory order.
+/// @details If the comparison fails, the load is performed with the strongest
+///   valid load order implied by `order`.
+/// @param atomic An MTY_Atomic32.
+/// @param oldValue Value to compare against the atomic.
+/// @param newValue Value the atomic is set to if `oldValue` matches the atomic.
+/// @param order Memory ordering constraint when the swap succeeds.
+/// @returns If the atomic is set to `newValue`, returns true, otherwise false.
+MTY_EXPORT bool
+MTY_Atomic32CompareExchange(MTY_Atomic32 *atomic, int32_t oldValue, int32_t newValue,
+	MTY_AtomicOrder order);
+
+/// @brief Compare and swap a 64-bit integer with an explicit memory order.
+/// @details If the comparison fails, the load is performed with the strongest
+///   valid load order implied by `order`.
+/// @param atomic An MTY_Atomic64.
+/// @param oldValue Value to compare against the atomic.
+/// @param newValue Value the atomic is set to if `oldValue` matches the atomic.
+/// @param order Memory ordering constraint when the swap succeeds.
+/// @returns If the atomic is set to `newValue`, returns true, otherwise false.
+MTY_EXPORT bool
+MTY_Atomic64CompareExchange(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue,
+	MTY_AtomicOrder order);
+
+/// @brief Load a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param order Memory ordering constraint, typically MTY_ATOMIC_ACQUIRE.
+MTY_EXPORT void *
+MTY_AtomicPtrLoad(MTY_AtomicPtr *atomic, MTY_AtomicOrder order);
+
+/// @brief Store a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param value Pointer to atomically store.
+/// @param order Memory ordering constraint, typically MTY_ATOMIC_RELEASE.
+MTY_EXPORT void
+MTY_AtomicPtrStore(MTY_AtomicPtr *atomic, void *value, MTY_AtomicOrder order);
+
+/// @brief Swap a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param value New pointer for the atomic.
+/// @param order Memory ordering constraint.
+/// @returns The pointer held by the atomic before the swap.
+MTY_EXPORT void *
+MTY_AtomicPtrExchange(MTY_AtomicPtr *atomic, void *value, MTY_AtomicOrder order);
+
+/// @brief Compare and swap a pointer atomically.
+/// @param atomic An MTY_AtomicPtr.
+/// @param oldValue Pointer to compare against the atomic.
+/// @param newValue Pointer the atomic is set to if `oldValue` matches the atomic.
+/// @param order Memory ordering constraint when the swap succeeds.
+/// @returns If the atomic is set to `newValue`, returns true, otherwise false.
+MTY_EXPORT bool
+MTY_AtomicPtrCompareExchange(MTY_AtomicPtr *atomic, void *oldValue, void *newValue,
+	MTY_AtomicOrder order);
+
 /// @brief Globally lock via an atomic.
-/// @details All atomic operations in libmatoya create a full memory barrier.\n\n
+/// @details This function creates a full memory barrier.\n\n
 ///   Warning: There is a process wide maximum of UINT8_MAX global locks.\n\n
 ///   The global lock should be statically initialized to zero.
 /// @param lock An MTY_Atomic32.
@@ -2877,7 +3844,7 @@ MTY_EXPORT void
 MTY_GlobalLock(MTY_Atomic32 *lock);
 
 /// @brief Globally unlock via an atomic.
-/// @details All atomic operations in libmatoya create a full memory barrier.
+/// @details This function creates a full memory barrier.
 /// @param lock An MTY_Atomic32.
 MTY_EXPORT void
 MTY_GlobalUnlock(MTY_Atomic32 *lock);
@@ -3034,6 +4001,17 @@ typedef struct MTY_ListNode {
 	void *value;               ///< The value associated with the node.
 } MTY_ListNode;
 
+/// @brief Dynamic array with amortized geometric growth.
+/// @details Members may be read directly but should only be modified through the
+///   MTY_Vec functions. Any function that grows the array may move `data`,
+///   invalidating pointers to its elements.
+typedef struct {
+	void *data;      ///< The elements, NULL until the array first grows.
+	size_t len;      ///< Number of elements in the array.
+	size_t capacity; ///< Number of elements that fit in `data` before it is reallocated.
+	size_t size;     ///< Size in bytes of each element.
+} MTY_Vec;
+
 /// @brief Create an MTY_Hash for key/value lookup.
 /// @param numBuckets The number of buckets to use. The more buckets, the larger
 ///   the memory usage but less chance of collision. Specifying 0 chooses a reasonable
@@ -3235,6 +4213,62 @@ MTY_ListAppend(MTY_List *ctx, void *value);
 MTY_EXPORT void *
 MTY_ListRemove(MTY_List *ctx, MTY_ListNode *node);
 
+/// @brief Initialize an empty MTY_Vec.
+/// @details No memory is allocated until elements are added.
+/// @param vec The MTY_Vec to initialize.
+/// @param size Size in bytes of each element.
+MTY_EXPORT void
+MTY_VecInit(MTY_Vec *vec, size_t size);
+
+/// @brief Free the elements of an MTY_Vec.
+/// @details The array is left empty and may be reused.
+/// @param vec An MTY_Vec.
+MTY_EXPORT void
+MTY_VecFree(MTY_Vec *vec);
+
+/// @brief Make room for at least `capacity` elements without growing again.
+/// @param vec An MTY_Vec.
+/// @param capacity Number of elements to allocate space for.
+MTY_EXPORT void
+MTY_VecReserve(MTY_Vec *vec, size_t capacity);
+
+/// @brief Release unused capacity so `data` fits the current elements exactly.
+/// @param vec An MTY_Vec.
+MTY_EXPORT void
+MTY_VecShrink(MTY_Vec *vec);
+
+/// @brief Set the number of elements in an MTY_Vec.
+/// @details New elements are zeroed.
+/// @param vec An MTY_Vec.
+/// @param len New number of elements.
+MTY_EXPORT void
+MTY_VecResize(MTY_Vec *vec, size_t len);
+
+/// @brief Add a zeroed element to the end of an MTY_Vec.
+/// @param vec An MTY_Vec.
+/// @returns The new element, valid until the array grows again.
+MTY_EXPORT void *
+MTY_VecPush(MTY_Vec *vec);
+
+/// @brief Add multiple elements to the end of an MTY_Vec.
+/// @param vec An MTY_Vec.
+/// @param elements Elements to copy into the array. If NULL, the new elements are
+///   zeroed.
+/// @param len Number of elements to add.
+/// @returns The first new element, valid until the array grows again.
+MTY_EXPORT void *
+MTY_VecAppend(MTY_Vec *vec, const void *elements, size_t len);
+
+/// @brief Take ownership of the elements of an MTY_Vec.
+/// @details The array is left empty and may be reused. Call MTY_VecShrink beforehand
+///   if the unused capacity should not be kept.
+/// @param vec An MTY_Vec.
+/// @param len Set to the number of elements in the returned buffer. May be NULL.
+/// @returns The elements, or NULL if the array never grew.\n\n
+///   The returned buffer must be destroyed with MTY_Free.
+MTY_EXPORT void *
+MTY_VecMove(MTY_Vec *vec, size_t *len);
+
 
 //- #module System
 //- #mbrief Functions related to the OS and current process.
@@ -3508,12 +4542,33 @@ MTY_IsDTLSApplicationData(const void *buf, size_t size);
 
 
 //- #module Time
-//- #mbrief High precision time stamps. Sleep.
+//- #mbrief High precision time stamps. Sleep. Timers.
 
 typedef int64_t MTY_Time;
 
+typedef struct MTY_TimerWheel MTY_TimerWheel;
+typedef struct MTY_FramePacer MTY_FramePacer;
+
+/// @brief Function called when a timer expires.
+/// @param id The timer's id returned by MTY_TimerWheelAdd.
+/// @param opaque Pointer set via MTY_TimerWheelAdd.
+typedef void (*MTY_TimerFunc)(uint64_t id, void *opaque);
+
+/// @brief Frame pacing statistics.
+typedef struct {
+	uint64_t frames;     ///< Number of frames waited on.
+	uint64_t missed;     ///< Number of deadlines that had already passed and were dropped.
+	double overshootAvg; ///< Average milliseconds MTY_FramePacerWait returned past its deadline.
+	double overshootMax; ///< Maximum milliseconds MTY_FramePacerWait returned past its deadline.
+	double jitter;       ///< Standard deviation in milliseconds of the time between frames.
+} MTY_FramePacerStats;
+
 /// @brief Get a high precision time stamp.
-/// @details This value has at least microsecond precision.
+/// @details This value has at least microsecond precision.\n\n
+///   On Linux and Android the time comes from `CLOCK_MONOTONIC`, the clock
+///   MTY_SleepUntil sleeps on. It never jumps, but NTP may slew its rate by up to 500
+///   parts per million. Apple platforms use the unadjusted `CLOCK_MONOTONIC_RAW` and
+///   Windows uses `QueryPerformanceCounter`.
 MTY_EXPORT MTY_Time
 MTY_GetTime(void);
 
@@ -3524,6 +4579,28 @@ MTY_GetTime(void);
 MTY_EXPORT double
 MTY_TimeDiff(MTY_Time begin, MTY_Time end);
 
+/// @brief Get a raw time stamp from the fastest available counter.
+/// @details On x86 processors with an invariant TSC this reads the TSC directly, and on
+///   64-bit ARM the virtual counter, costing a few nanoseconds. Otherwise the
+///   `CLOCK_MONOTONIC` or `QueryPerformanceCounter` clock is used. The first call may
+///   block for a few milliseconds while the counter frequency is calibrated.\n\n
+///   Ticks are only meaningful relative to each other and should be converted with
+///   MTY_TicksToNS.
+MTY_EXPORT uint64_t
+MTY_GetTicks(void);
+
+/// @brief Convert a tick count from MTY_GetTicks to nanoseconds.
+/// @details The conversion uses integer arithmetic only. A calibrated counter can drift
+///   from MTY_GetTime by a few parts per million.
+/// @param ticks A tick count or the difference between two tick counts.
+MTY_EXPORT uint64_t
+MTY_TicksToNS(uint64_t ticks);
+
+/// @brief Get a nanosecond time stamp from the fastest available counter.
+/// @details Equivalent to `MTY_TicksToNS(MTY_GetTicks())`. The origin is unspecified.
+MTY_EXPORT uint64_t
+MTY_GetTimeNS(void);
+
 /// @brief Suspend the current thread.
 /// @param timeout The number of milliseconds to sleep.
 //- #support Windows macOS Android Linux
@@ -3531,15 +4608,28 @@ MTY_EXPORT void
 MTY_Sleep(uint32_t timeout);
 
 /// @brief Suspend the current thread with high precision.
-/// @details This function uses a spinlock at the end of the sleep to get closer to the
-///   requested `timeout`. Depending on the value of `spin`, it can consume much more of the CPU
-///   than MTY_Sleep.
+/// @details Equivalent to calling MTY_SleepUntil with the current time as `base`.
 /// @param timeout The total number of milliseconds to sleep.
-/// @param spin When less than `spin` milliseconds remain in the sleep, fall into a spinlock.
+/// @param spin The maximum number of milliseconds to spend in a spinlock at the end of
+///   the sleep.
 //- #support Windows macOS Android Linux
 MTY_EXPORT void
 MTY_PreciseSleep(double timeout, double spin);
 
+/// @brief Suspend the current thread until a deadline with high precision.
+/// @details The thread sleeps until shortly before the deadline, then uses a spinlock
+///   for the remainder. How early it wakes up is calibrated per thread from how late
+///   previous sleeps have returned, so the spinlock is usually much shorter than `spin`.
+///   Since the deadline is absolute, repeated calls with an increasing `offset` from the
+///   same `base` do not drift.
+/// @param base The MTY_Time stamp the deadline is relative to.
+/// @param offset The deadline in milliseconds after `base`.
+/// @param spin The maximum number of milliseconds to spend in a spinlock at the end of
+///   the sleep. If 0, the thread sleeps until the deadline without spinning.
+//- #support Windows macOS Android Linux
+MTY_EXPORT void
+MTY_SleepUntil(MTY_Time base, double offset, double spin);
+
 /// @brief Set the sleep precision of all waitable objects.
 /// @details See `timeBeginPeriod` on Windows.
 /// @param res The desired precision in milliseconds. This can not be less than 1.
@@ -3554,6 +4644,384 @@ MTY_SetTimerResolution(uint32_t res);
 MTY_EXPORT void
 MTY_RevertTimerResolution(uint32_t res);
 
+/// @brief Create an MTY_TimerWheel for scheduling large numbers of timers.
+/// @details Adding and canceling a timer is O(1) regardless of how many timers are
+///   scheduled. Timers are fired by MTY_TimerWheelAdvance, which can be driven from an
+///   existing event loop using MTY_TimerWheelGetTimeout, or from a dedicated thread
+///   started with MTY_TimerWheelStart. All functions are thread safe.
+/// @param resolution Length of a wheel tick in milliseconds, for example 1.0 for
+///   millisecond or 0.01 for 10 microsecond granularity. Timers more than 2^32 ticks
+///   in the future are moved down the wheel in several steps, but still fire on time.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_TimerWheel must be destroyed with MTY_TimerWheelDestroy.
+MTY_EXPORT MTY_TimerWheel *
+MTY_TimerWheelCreate(double resolution);
+
+/// @brief Destroy an MTY_TimerWheel, stopping its thread if it was started.
+/// @details Pending timers are discarded without being called.
+/// @param wheel Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_TimerWheelDestroy(MTY_TimerWheel **wheel);
+
+/// @brief Schedule a timer.
+/// @param ctx An MTY_TimerWheel.
+/// @param delay Time in milliseconds until the timer fires. The deadline is rounded up
+///   to a whole tick so timers never fire early.
+/// @param period If greater than 0, the timer repeats every `period` milliseconds on
+///   a fixed schedule until it is canceled. Otherwise the timer fires once.
+/// @param func Function called when the timer fires. It is called without any
+///   internal lock held, so it may add or cancel timers.
+/// @param opaque Passed to `func` when it is called.
+/// @returns A timer id that can be passed to MTY_TimerWheelCancel. Ids are never 0.
+MTY_EXPORT uint64_t
+MTY_TimerWheelAdd(MTY_TimerWheel *ctx, double delay, double period,
+	MTY_TimerFunc func, void *opaque);
+
+/// @brief Cancel a scheduled timer.
+/// @param ctx An MTY_TimerWheel.
+/// @param id Timer id returned by MTY_TimerWheelAdd.
+/// @returns Returns true if the timer was pending and has been canceled, false if it
+///   has already fired or was already canceled.
+MTY_EXPORT bool
+MTY_TimerWheelCancel(MTY_TimerWheel *ctx, uint64_t id);
+
+/// @brief Fire all timers that have expired.
+/// @param ctx An MTY_TimerWheel.
+/// @returns The number of timers fired.
+MTY_EXPORT uint32_t
+MTY_TimerWheelAdvance(MTY_TimerWheel *ctx);
+
+/// @brief Get the time until MTY_TimerWheelAdvance should next be called.
+/// @details Use this value as the timeout of an event loop's wait, then call
+///   MTY_TimerWheelAdvance when it wakes up.
+/// @param ctx An MTY_TimerWheel.
+/// @returns Milliseconds until the next timer may expire, or a negative value if no
+///   timers are scheduled. This may be earlier than the next expiry when timers far in
+///   the future need to be moved closer to their deadline.
+MTY_EXPORT double
+MTY_TimerWheelGetTimeout(MTY_TimerWheel *ctx);
+
+/// @brief Drive an MTY_TimerWheel from its own thread.
+/// @details Timer functions will be called on this thread. The thread is stopped by
+///   MTY_TimerWheelDestroy. MTY_TimerWheelAdvance should not be called elsewhere
+///   after this function has been called.
+/// @param ctx An MTY_TimerWheel.
+MTY_EXPORT void
+MTY_TimerWheelStart(MTY_TimerWheel *ctx);
+
+/// @brief Create an MTY_FramePacer to hold a loop at a fixed rate.
+/// @details Deadlines are computed from the time of the first wait, so the cadence does
+///   not drift no matter how long each frame takes.
+/// @param interval Target time between frames in milliseconds.
+/// @param spin The maximum number of milliseconds to spend in a spinlock at the end of
+///   each wait, see MTY_SleepUntil.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_FramePacer must be destroyed with MTY_FramePacerDestroy.
+MTY_EXPORT MTY_FramePacer *
+MTY_FramePacerCreate(double interval, double spin);
+
+/// @brief Destroy an MTY_FramePacer.
+/// @param pacer Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_FramePacerDestroy(MTY_FramePacer **pacer);
+
+/// @brief Wait until the next frame deadline.
+/// @details If the loop has fallen behind by one or more whole frames, the missed
+///   deadlines are skipped and counted rather than returning immediately several times.
+/// @param ctx An MTY_FramePacer.
+/// @returns Milliseconds past the deadline that this function returned.
+//- #support Windows macOS Android Linux
+MTY_EXPORT double
+MTY_FramePacerWait(MTY_FramePacer *ctx);
+
+/// @brief Restart pacing from the next wait and clear statistics.
+/// @param ctx An MTY_FramePacer.
+/// @param interval New target time between frames in milliseconds. If 0 or less, the
+///   current interval is kept.
+MTY_EXPORT void
+MTY_FramePacerReset(MTY_FramePacer *ctx, double interval);
+
+/// @brief Get statistics about how well an MTY_FramePacer has held its cadence.
+/// @param ctx An MTY_FramePacer.
+/// @param stats Set to the current statistics.
+MTY_EXPORT void
+MTY_FramePacerGetStats(MTY_FramePacer *ctx, MTY_FramePacerStats *stats);
+
+
+//- #module Trace
+//- #mbrief Lightweight instrumentation with Chrome trace export.
+//- #mdetails Trace events are recorded into a fixed size ring buffer per thread without
+//-   locking, so the oldest events are overwritten on long captures. Names passed to
+//-   these functions are stored by reference and must remain valid until after
+//-   MTY_TraceExport, string literals are recommended.\n\n
+//-   libmatoya's own hot paths are instrumented with the `MTY_TRACE_*` macros, which
+//-   expand to nothing unless `MTY_TRACE` is defined when libmatoya is built. The macros
+//-   can be used the same way in your own code.
+
+#if defined(MTY_TRACE)
+	#define MTY_TRACE_BEGIN(name)          MTY_TraceBegin(name)
+	#define MTY_TRACE_END()                MTY_TraceEnd()
+	#define MTY_TRACE_COUNTER(name, value) MTY_TraceCounter(name, value)
+	#define MTY_TRACE_FLOW_BEGIN(name, id) MTY_TraceFlowBegin(name, id)
+	#define MTY_TRACE_FLOW_STEP(name, id)  MTY_TraceFlowStep(name, id)
+	#define MTY_TRACE_FLOW_END(name, id)   MTY_TraceFlowEnd(name, id)
+#else
+	#define MTY_TRACE_BEGIN(name)          ((void) 0)
+	#define MTY_TRACE_END()                ((void) 0)
+	#define MTY_TRACE_COUNTER(name, value) ((void) 0)
+	#define MTY_TRACE_FLOW_BEGIN(name, id) ((void) 0)
+	#define MTY_TRACE_FLOW_STEP(name, id)  ((void) 0)
+	#define MTY_TRACE_FLOW_END(name, id)   ((void) 0)
+#endif
+
+/// @brief Start recording trace events.
+/// @details Events recorded by a previous capture are discarded and time stamps in the
+///   export are relative to this call.
+MTY_EXPORT void
+MTY_TraceStart(void);
+
+/// @brief Stop recording trace events.
+/// @details Events already recorded remain available to MTY_TraceExport.
+MTY_EXPORT void
+MTY_TraceStop(void);
+
+/// @brief Check if trace events are being recorded.
+MTY_EXPORT bool
+MTY_TraceIsActive(void);
+
+/// @brief Begin a zone on the current thread.
+/// @details Zones nest and must be closed in reverse order on the same thread with
+///   MTY_TraceEnd.
+/// @param name Name of the zone.
+MTY_EXPORT void
+MTY_TraceBegin(const char *name);
+
+/// @brief End the most recent zone begun with MTY_TraceBegin on the current thread.
+MTY_EXPORT void
+MTY_TraceEnd(void);
+
+/// @brief Record a sample of a named counter.
+/// @param name Name of the counter.
+/// @param value The counter's current value.
+MTY_EXPORT void
+MTY_TraceCounter(const char *name, double value);
+
+/// @brief Begin a flow, an arrow connecting zones across threads.
+/// @details Flow events are attached to the enclosing zone, so they should be recorded
+///   between MTY_TraceBegin and MTY_TraceEnd.
+/// @param name Name of the flow.
+/// @param id Identifier unique to this flow while it is in progress.
+MTY_EXPORT void
+MTY_TraceFlowBegin(const char *name, uint64_t id);
+
+/// @brief Add an intermediate step to a flow begun with MTY_TraceFlowBegin.
+/// @param name Name of the flow.
+/// @param id The flow's `id`.
+MTY_EXPORT void
+MTY_TraceFlowStep(const char *name, uint64_t id);
+
+/// @brief End a flow begun with MTY_TraceFlowBegin.
+/// @param name Name of the flow.
+/// @param id The flow's `id`.
+MTY_EXPORT void
+MTY_TraceFlowEnd(const char *name, uint64_t id);
+
+/// @brief Name the current thread in exported traces.
+/// @param name The thread's name. This string is copied.
+MTY_EXPORT void
+MTY_TraceSetThreadName(const char *name);
+
+/// @brief Export recorded events in the Chrome trace event format.
+/// @details The result can be written with MTY_JSONWriteFile and loaded by
+///   `chrome://tracing` or the Perfetto UI. This function may be called while recording
+///   is active.
+/// @returns The returned MTY_JSON item must be destroyed with MTY_JSONDestroy.
+MTY_EXPORT MTY_JSON *
+MTY_TraceExport(void);
+
+
+//- #module Metrics
+//- #mbrief Latency histograms, a registry of named metrics, and hardware performance
+//-   counters.
+//- #mdetails While the registry exists, libmatoya records some of its own latencies
+//-   into histograms named with an `mty.` prefix, for example `mty.window.present_us`,
+//-   `mty.queue.wait_us`, `mty.http.ttfb_us`, and `mty.audio.queued_ms`.
+
+typedef struct MTY_Histogram MTY_Histogram;
+typedef struct MTY_PerfCounters MTY_PerfCounters;
+
+/// @brief Hardware performance counters.
+typedef enum {
+	MTY_PERF_COUNTER_CYCLES        = 0x01, ///< CPU cycles.
+	MTY_PERF_COUNTER_INSTRUCTIONS  = 0x02, ///< Instructions retired.
+	MTY_PERF_COUNTER_CACHE_MISSES  = 0x04, ///< Last level cache misses.
+	MTY_PERF_COUNTER_BRANCH_MISSES = 0x08, ///< Mispredicted branches.
+	MTY_PERF_COUNTER_MAKE_32       = INT32_MAX,
+} MTY_PerfCounter;
+
+/// @brief Hardware performance counter values for a measured region.
+typedef struct {
+	uint32_t available;    ///< Bit flags of MTY_PerfCounter that were measured. Members
+	                       ///<   for counters that were not measured are 0.
+	uint64_t cycles;       ///< CPU cycles.
+	uint64_t instructions; ///< Instructions retired.
+	uint64_t cacheMisses;  ///< Last level cache misses.
+	uint64_t branchMisses; ///< Mispredicted branches.
+} MTY_PerfCounterValues;
+
+/// @brief Create an MTY_Histogram.
+/// @details An MTY_Histogram counts integer values in buckets whose width grows with
+///   the magnitude of the value, so it keeps a fixed relative precision over a large
+///   range using a small, fixed amount of memory. Values may be recorded from any number
+///   of threads without locking.
+/// @param max The largest value that can be recorded. Larger values are recorded as
+///   `max`.
+/// @param digits The number of significant decimal digits preserved, from 1 to 5. A
+///   value of 2 means values are accurate to within 1%.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_Histogram must be destroyed with MTY_HistogramDestroy.
+MTY_EXPORT MTY_Histogram *
+MTY_HistogramCreate(uint64_t max, uint32_t digits);
+
+/// @brief Destroy an MTY_Histogram.
+/// @param histogram Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_HistogramDestroy(MTY_Histogram **histogram);
+
+/// @brief Record a value.
+/// @details This function is thread safe and lock free.
+/// @param ctx An MTY_Histogram.
+/// @param value Value to record, for example a latency in microseconds.
+MTY_EXPORT void
+MTY_HistogramRecord(MTY_Histogram *ctx, uint64_t value);
+
+/// @brief Add all values recorded in another MTY_Histogram.
+/// @details A common pattern is to record into an MTY_Histogram per thread and merge
+///   them for reporting. The count, mean, min, and max are always merged exactly. The
+///   histograms do not need to have been created with the same parameters, but
+///   percentiles are only carried over exactly if they were.
+/// @param ctx The MTY_Histogram to add values to.
+/// @param other The MTY_Histogram to add values from.
+MTY_EXPORT void
+MTY_HistogramMerge(MTY_Histogram *ctx, const MTY_Histogram *other);
+
+/// @brief Clear all recorded values.
+/// @param ctx An MTY_Histogram.
+MTY_EXPORT void
+MTY_HistogramReset(MTY_Histogram *ctx);
+
+/// @brief Get the number of recorded values.
+/// @param ctx An MTY_Histogram.
+MTY_EXPORT uint64_t
+MTY_HistogramGetCount(MTY_Histogram *ctx);
+
+/// @brief Get the smallest recorded value.
+/// @param ctx An MTY_Histogram.
+/// @returns If nothing has been recorded, 0 is returned.
+MTY_EXPORT uint64_t
+MTY_HistogramGetMin(MTY_Histogram *ctx);
+
+/// @brief Get the largest recorded value.
+/// @param ctx An MTY_Histogram.
+/// @returns If nothing has been recorded, 0 is returned.
+MTY_EXPORT uint64_t
+MTY_HistogramGetMax(MTY_Histogram *ctx);
+
+/// @brief Get the mean of the recorded values.
+/// @param ctx An MTY_Histogram.
+/// @returns If nothing has been recorded, 0 is returned.
+MTY_EXPORT double
+MTY_HistogramGetMean(MTY_Histogram *ctx);
+
+/// @brief Get the value at a percentile.
+/// @details The result is the largest value in the same bucket as the value at the
+///   percentile, clamped to the recorded minimum and maximum. This function may be
+///   called while other threads are recording, in which case the result is approximate.
+/// @param ctx An MTY_Histogram.
+/// @param percentile Percentile from 0 to 100, for example 99.9.
+/// @returns If nothing has been recorded, 0 is returned.
+MTY_EXPORT uint64_t
+MTY_HistogramGetPercentile(MTY_Histogram *ctx, double percentile);
+
+/// @brief Create the global metrics registry.
+/// @details The registry owns named histograms and counters that can be looked up from
+///   anywhere in the process. Lookups take a global lock, so the returned pointers
+///   should be kept for use on hot paths.
+MTY_EXPORT void
+MTY_MetricsCreate(void);
+
+/// @brief Destroy the global metrics registry.
+/// @details All pointers returned by MTY_MetricsGetHistogram and MTY_MetricsGetCounter
+///   become invalid.
+MTY_EXPORT void
+MTY_MetricsDestroy(void);
+
+/// @brief Get or create a named histogram in the registry.
+/// @param name Name of the histogram.
+/// @param max Passed to MTY_HistogramCreate if the histogram does not exist yet.
+/// @param digits Passed to MTY_HistogramCreate if the histogram does not exist yet.
+/// @returns If the registry has not been created or `name` is already a counter, NULL
+///   is returned.\n\n
+///   The returned MTY_Histogram is owned by the registry and must not be destroyed.
+MTY_EXPORT MTY_Histogram *
+MTY_MetricsGetHistogram(const char *name, uint64_t max, uint32_t digits);
+
+/// @brief Get or create a named counter in the registry.
+/// @details Update the counter with the MTY_Atomic64 functions.
+/// @param name Name of the counter.
+/// @returns If the registry has not been created or `name` is already a histogram,
+///   NULL is returned.\n\n
+///   The returned MTY_Atomic64 is owned by the registry.
+MTY_EXPORT MTY_Atomic64 *
+MTY_MetricsGetCounter(const char *name);
+
+/// @brief Get the current value of every metric in the registry.
+/// @details The result is an object keyed by metric name. Counters are numbers and
+///   histograms are objects with `count`, `min`, `max`, `mean`, `p50`, `p90`, `p99`,
+///   and `p999` members.
+/// @param reset Clear all metrics after they are read, so the next snapshot only covers
+///   the interval since this one.
+/// @returns The returned MTY_JSON item must be destroyed with MTY_JSONDestroy.
+MTY_EXPORT MTY_JSON *
+MTY_MetricsSnapshot(bool reset);
+
+/// @brief Create an MTY_PerfCounters to measure hardware events on the calling thread.
+/// @details On Linux and Android the counters are read via `perf_event_open`, which may
+///   be restricted by `/proc/sys/kernel/perf_event_paranoid` or unavailable in virtual
+///   machines. On Windows only MTY_PERF_COUNTER_CYCLES is available. If a counter can
+///   not be opened it is simply left out of the `available` flags, so measuring code
+///   works everywhere.\n\n
+///   Only events on the thread that created the MTY_PerfCounters are counted, and only
+///   while running in user mode.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_PerfCounters must be destroyed with MTY_PerfCountersDestroy.
+MTY_EXPORT MTY_PerfCounters *
+MTY_PerfCountersCreate(void);
+
+/// @brief Destroy an MTY_PerfCounters.
+/// @param counters Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_PerfCountersDestroy(MTY_PerfCounters **counters);
+
+/// @brief Get the counters that can be measured.
+/// @param ctx An MTY_PerfCounters.
+/// @returns Bit flags of MTY_PerfCounter.
+MTY_EXPORT uint32_t
+MTY_PerfCountersGetAvailable(MTY_PerfCounters *ctx);
+
+/// @brief Reset and start counting.
+/// @param ctx An MTY_PerfCounters.
+MTY_EXPORT void
+MTY_PerfCountersBegin(MTY_PerfCounters *ctx);
+
+/// @brief Stop counting and get the number of events since MTY_PerfCountersBegin.
+/// @details If the kernel had to multiplex the counters with other users, the values
+///   are scaled up to estimate the full region.
+/// @param ctx An MTY_PerfCounters.
+/// @param values Set to the measured values.
+MTY_EXPORT void
+MTY_PerfCountersEnd(MTY_PerfCounters *ctx, MTY_PerfCounterValues *values);
+
 
 //- #module Version
 //- #mbrief libmatoya version information.
@@ -80,20 +80,15 @@ void MTY_Strcat(char *dst, size_t size, const char *src)
 
 char *MTY_VsprintfD(const char *fmt, va_list args)
 {
-	// va_list can be exhausted each time it is referenced
-	// by a ...v style function. Since we use it twice, make a copy
+	// Short strings are formatted once on the stack, only strings that do not fit
+	// are measured and formatted a second time
+	char stack[256];
 
-	va_list args_copy;
-	va_copy(args_copy, args);
+	MTY_StrBuf sb;
+	MTY_StrBufInit(&sb, stack, sizeof(stack));
+	MTY_StrBufVprintf(&sb, fmt, args);
 
-	size_t size = vsnprintf(NULL, 0, fmt, args_copy) + 1;
-
-	va_end(args_copy);
-
-	char *str = MTY_Alloc(size, 1);
-	vsnprintf(str, size, fmt, args);
-
-	return str;
+	return MTY_StrBufMove(&sb);
 }
 
 char *MTY_SprintfD(const char *fmt, ...)
@@ -113,13 +108,10 @@ const char *MTY_SprintfDL(const char *fmt, ...)
 	va_list args;
 	va_start(args, fmt);
 
-	char *str = MTY_VsprintfD(fmt, args);
+	char *local = mty_tlocal_vsprintf(fmt, args);
 
 	va_end(args);
 
-	char *local = mty_tlocal_strcpy(str);
-	MTY_Free(str);
-
 	return local;
 }
 
@@ -148,50 +140,6 @@ bool MTY_StrSearch(const char *s0, const char *s1, const char *delim)
 }
 
 
-// Stable qsort
-
-struct element {
-	MTY_CompareFunc compare;
-	const void *orig;
-};
-
-static int32_t sort_compare(const void *a, const void *b)
-{
-	const struct element *element_a = a;
-	const struct element *element_b = b;
-
-	int32_t r = element_a->compare(element_a->orig, element_b->orig);
-
-	// If zero is returned from original comare, use the memory address as the tie breaker
-	return r != 0 ? r : (int32_t) ((uint8_t *) element_a->orig - (uint8_t *) element_b->orig);
-}
-
-void MTY_Sort(void *buf, size_t len, size_t size, MTY_CompareFunc func)
-{
-	// Temporary copy of the array for wrapping
-	uint8_t *tmp = MTY_Alloc(len, size);
-	memcpy(tmp, buf, len * size);
-
-	// Wrap the array elements in a struct now with 'orig' memory addresses in ascending order
-	struct element *wrapped = MTY_Alloc(len, sizeof(struct element));
-
-	for (size_t x = 0; x < len; x++) {
-		wrapped[x].compare = func;
-		wrapped[x].orig = tmp + x * size;
-	}
-
-	// Perform qsort using the original compare function, falling back to memory address comparison
-	qsort(wrapped, len, sizeof(struct element), sort_compare);
-
-	// Copy the reordered elements back to the array
-	for (size_t x = 0; x < len; x++)
-		memcpy((uint8_t *) buf + x * size, wrapped[x].orig, size);
-
-	MTY_Free(tmp);
-	MTY_Free(wrapped);
-}
-
-
 // UTF-8 conversion
 
 char *MTY_WideToMultiD(const wchar_t *src)
@@ -0,0 +1,481 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+#include "metrics.h"
+
+#include <math.h>
+
+#define METRICS_DEFAULT_MAX    (60 * 1000 * 1000)
+#define METRICS_DEFAULT_DIGITS 2
+#define METRICS_CACHE_SIZE     64
+
+
+// Histogram
+
+// Values below `sub_count` get a bucket each. Above that, every power of two range is
+// split into `half` linear buckets, so the relative error of any value stays below
+// 1 / half regardless of magnitude
+
+struct MTY_Histogram {
+	uint64_t max;
+	uint32_t sub_bits;
+	uint32_t sub_count;
+	uint32_t half;
+	uint32_t num_counts;
+
+	MTY_Atomic64 total;
+	MTY_Atomic64 sum;
+	MTY_Atomic64 min;
+	MTY_Atomic64 max_seen;
+	MTY_Atomic64 *counts;
+};
+
+static uint32_t histogram_log2(uint64_t value)
+{
+	#if defined(__GNUC__)
+		return 63 - __builtin_clzll(value);
+
+	#else
+		uint32_t r = 0;
+
+		for (uint32_t shift = 32; shift > 0; shift /= 2) {
+			if (value >> shift) {
+				value >>= shift;
+				r += shift;
+			}
+		}
+
+		return r;
+	#endif
+}
+
+static uint32_t histogram_index(const MTY_Histogram *ctx, uint64_t value)
+{
+	if (value < ctx->sub_count)
+		return (uint32_t) value;
+
+	uint32_t shift = histogram_log2(value) - (ctx->sub_bits - 1);
+
+	return ctx->sub_count + (shift - 1) * ctx->half + (uint32_t) ((value >> shift) - ctx->half);
+}
+
+static uint64_t histogram_highest_value(const MTY_Histogram *ctx, uint32_t index)
+{
+	if (index < ctx->sub_count)
+		return index;
+
+	uint32_t rel = index - ctx->sub_count;
+	uint32_t shift = rel / ctx->half + 1;
+	uint64_t lowest = (uint64_t) (rel % ctx->half + ctx->half) << shift;
+
+	return lowest + (UINT64_C(1) << shift) - 1;
+}
+
+static void histogram_min_max(MTY_Histogram *ctx, int64_t min, int64_t max)
+{
+	int64_t cur = MTY_Atomic64Load(&ctx->min, MTY_ATOMIC_RELAXED);
+	while (min < cur && !MTY_Atomic64CompareExchange(&ctx->min, cur, min, MTY_ATOMIC_RELAXED))
+		cur = MTY_Atomic64Load(&ctx->min, MTY_ATOMIC_RELAXED);
+
+	cur = MTY_Atomic64Load(&ctx->max_seen, MTY_ATOMIC_RELAXED);
+	while (max > cur && !MTY_Atomic64CompareExchange(&ctx->max_seen, cur, max, MTY_ATOMIC_RELAXED))
+		cur = MTY_Atomic64Load(&ctx->max_seen, MTY_ATOMIC_RELAXED);
+}
+
+static void histogram_record(MTY_Histogram *ctx, uint64_t value, int64_t count)
+{
+	if (value > ctx->max)
+		value = ctx->max;
+
+	MTY_Atomic64FetchAdd(&ctx->counts[histogram_index(ctx, value)], count, MTY_ATOMIC_RELAXED);
+	MTY_Atomic64FetchAdd(&ctx->sum, (int64_t) value * count, MTY_ATOMIC_RELAXED);
+	MTY_Atomic64FetchAdd(&ctx->total, count, MTY_ATOMIC_RELAXED);
+
+	histogram_min_max(ctx, value, value);
+}
+
+MTY_Histogram *MTY_HistogramCreate(uint64_t max, uint32_t digits)
+{
+	if (digits < 1)
+		digits = 1;
+
+	if (digits > 5)
+		digits = 5;
+
+	if (max > INT64_MAX)
+		max = INT64_MAX;
+
+	MTY_Histogram *ctx = MTY_Alloc(1, sizeof(MTY_Histogram));
+
+	// The linear region must resolve 1 part in 10^digits in its upper half
+	uint64_t resolution = 2;
+	for (uint32_t x = 0; x < digits; x++)
+		resolution *= 10;
+
+	ctx->sub_bits = histogram_log2(resolution - 1) + 1;
+	ctx->sub_count = 1 << ctx->sub_bits;
+	ctx->half = ctx->sub_count / 2;
+	ctx->max = max < ctx->sub_count ? ctx->sub_count - 1 : max;
+	ctx->num_counts = histogram_index(ctx, ctx->max) + 1;
+	ctx->counts = MTY_Alloc(ctx->num_counts, sizeof(MTY_Atomic64));
+
+	MTY_HistogramReset(ctx);
+
+	return ctx;
+}
+
+void MTY_HistogramDestroy(MTY_Histogram **histogram)
+{
+	if (!histogram || !*histogram)
+		return;
+
+	MTY_Histogram *ctx = *histogram;
+
+	MTY_Free(ctx->counts);
+
+	MTY_Free(ctx);
+	*histogram = NULL;
+}
+
+void MTY_HistogramRecord(MTY_Histogram *ctx, uint64_t value)
+{
+	histogram_record(ctx, value, 1);
+}
+
+void MTY_HistogramMerge(MTY_Histogram *ctx, const MTY_Histogram *other)
+{
+	MTY_Histogram *o = (MTY_Histogram *) other;
+
+	// Counts are added bucket by bucket, a bucket only maps to a different index when
+	// the histograms were created with different precision or range. The sum, min and
+	// max are exact in `other` and are merged as they are.
+	for (uint32_t x = 0; x < o->num_counts; x++) {
+		int64_t count = MTY_Atomic64Load(&o->counts[x], MTY_ATOMIC_RELAXED);
+
+		if (count > 0) {
+			uint64_t value = histogram_highest_value(o, x);
+
+			if (value > ctx->max)
+				value = ctx->max;
+
+			MTY_Atomic64FetchAdd(&ctx->counts[histogram_index(ctx, value)], count, MTY_ATOMIC_RELAXED);
+		}
+	}
+
+	int64_t total = MTY_Atomic64Load(&o->total, MTY_ATOMIC_RELAXED);
+
+	if (total > 0) {
+		int64_t max = MTY_Atomic64Load(&o->max_seen, MTY_ATOMIC_RELAXED);
+
+		MTY_Atomic64FetchAdd(&ctx->sum, MTY_Atomic64Load(&o->sum, MTY_ATOMIC_RELAXED), MTY_ATOMIC_RELAXED);
+		MTY_Atomic64FetchAdd(&ctx->total, total, MTY_ATOMIC_RELAXED);
+
+		histogram_min_max(ctx, MTY_Atomic64Load(&o->min, MTY_ATOMIC_RELAXED),
+			max > (int64_t) ctx->max ? (int64_t) ctx->max : max);
+	}
+}
+
+void MTY_HistogramReset(MTY_Histogram *ctx)
+{
+	for (uint32_t x = 0; x < ctx->num_counts; x++)
+		MTY_Atomic64Store(&ctx->counts[x], 0, MTY_ATOMIC_RELAXED);
+
+	MTY_Atomic64Store(&ctx->total, 0, MTY_ATOMIC_RELAXED);
+	MTY_Atomic64Store(&ctx->sum, 0, MTY_ATOMIC_RELAXED);
+	MTY_Atomic64Store(&ctx->min, INT64_MAX, MTY_ATOMIC_RELAXED);
+	MTY_Atomic64Store(&ctx->max_seen, 0, MTY_ATOMIC_RELAXED);
+}
+
+uint64_t MTY_HistogramGetCount(MTY_Histogram *ctx)
+{
+	return MTY_Atomic64Load(&ctx->total, MTY_ATOMIC_RELAXED);
+}
+
+uint64_t MTY_HistogramGetMin(MTY_Histogram *ctx)
+{
+	int64_t min = MTY_Atomic64Load(&ctx->min, MTY_ATOMIC_RELAXED);
+
+	return min == INT64_MAX ? 0 : min;
+}
+
+uint64_t MTY_HistogramGetMax(MTY_Histogram *ctx)
+{
+	return MTY_Atomic64Load(&ctx->max_seen, MTY_ATOMIC_RELAXED);
+}
+
+double MTY_HistogramGetMean(MTY_Histogram *ctx)
+{
+	int64_t total = MTY_Atomic64Load(&ctx->total, MTY_ATOMIC_RELAXED);
+
+	return total > 0 ? (double) MTY_Atomic64Load(&ctx->sum, MTY_ATOMIC_RELAXED) / (double) total : 0;
+}
+
+uint64_t MTY_HistogramGetPercentile(MTY_Histogram *ctx, double percentile)
+{
+	int64_t total = MTY_Atomic64Load(&ctx->total, MTY_ATOMIC_RELAXED);
+	if (total <= 0)
+		return 0;
+
+	if (percentile < 0)
+		percentile = 0;
+
+	if (percentile > 100)
+		percentile = 100;
+
+	int64_t target = (int64_t) ceil(percentile / 100.0 * (double) total);
+	if (target < 1)
+		target = 1;
+
+	uint64_t min = MTY_HistogramGetMin(ctx);
+	uint64_t max = MTY_HistogramGetMax(ctx);
+	int64_t n = 0;
+
+	for (uint32_t x = 0; x < ctx->num_counts; x++) {
+		n += MTY_Atomic64Load(&ctx->counts[x], MTY_ATOMIC_RELAXED);
+
+		if (n >= target) {
+			uint64_t value = histogram_highest_value(ctx, x);
+
+			return value < min ? min : value > max ? max : value;
+		}
+	}
+
+	return max;
+}
+
+
+// Registry
+
+struct metric {
+	MTY_Histogram *histogram;
+	MTY_Atomic64 counter;
+};
+
+struct metrics_cache {
+	MTY_AtomicPtr name;
+	MTY_AtomicPtr histogram;
+};
+
+static MTY_Atomic32 METRICS_GLOCK;
+static MTY_Atomic32 METRICS_ACTIVE;
+static MTY_Atomic32 METRICS_RECORDING;
+static MTY_Hash *METRICS;
+
+// Internal metrics are named with string literals, so their histograms are cached by
+// the address of the name and recording only takes the lock the first time
+static struct metrics_cache METRICS_CACHE[METRICS_CACHE_SIZE];
+
+static void metrics_free(void *opaque)
+{
+	struct metric *m = opaque;
+
+	if (m) {
+		MTY_HistogramDestroy(&m->histogram);
+		MTY_Free(m);
+	}
+}
+
+static struct metric *metrics_get(const char *name, bool histogram, uint64_t max, uint32_t digits)
+{
+	struct metric *m = MTY_HashGet(METRICS, name);
+
+	if (!m) {
+		m = MTY_Alloc(1, sizeof(struct metric));
+
+		if (histogram)
+			m->histogram = MTY_HistogramCreate(max, digits);
+
+		MTY_HashSet(METRICS, name, m);
+	}
+
+	return (m->histogram != NULL) == histogram ? m : NULL;
+}
+
+static MTY_Histogram *metrics_cache_find(const char *name)
+{
+	uint32_t start = (uint32_t) (((uintptr_t) name >> 3) % METRICS_CACHE_SIZE);
+
+	for (uint32_t x = 0; x < METRICS_CACHE_SIZE; x++) {
+		struct metrics_cache *c = &METRICS_CACHE[(start + x) % METRICS_CACHE_SIZE];
+		const char *cname = MTY_AtomicPtrLoad(&c->name, MTY_ATOMIC_ACQUIRE);
+
+		if (cname == name)
+			return MTY_AtomicPtrLoad(&c->histogram, MTY_ATOMIC_RELAXED);
+
+		if (!cname)
+			break;
+	}
+
+	return NULL;
+}
+
+static void metrics_cache_insert(const char *name, MTY_Histogram *h)
+{
+	// Only called with the lock held, the name is published after its histogram
+	uint32_t start = (uint32_t) (((uintptr_t) name >> 3) % METRICS_CACHE_SIZE);
+
+	for (uint32_t x = 0; x < METRICS_CACHE_SIZE; x++) {
+		struct metrics_cache *c = &METRICS_CACHE[(start + x) % METRICS_CACHE_SIZE];
+
+		if (!MTY_AtomicPtrLoad(&c->name, MTY_ATOMIC_RELAXED)) {
+			MTY_AtomicPtrStore(&c->histogram, h, MTY_ATOMIC_RELAXED);
+			MTY_AtomicPtrStore(&c->name, (void *) name, MTY_ATOMIC_RELEASE);
+			break;
+		}
+	}
+}
+
+static void metrics_cache_clear(void)
+{
+	for (uint32_t x = 0; x < METRICS_CACHE_SIZE; x++) {
+		MTY_AtomicPtrStore(&METRICS_CACHE[x].name, NULL, MTY_ATOMIC_RELAXED);
+		MTY_AtomicPtrStore(&METRICS_CACHE[x].histogram, NULL, MTY_ATOMIC_RELAXED);
+	}
+}
+
+void mty_metrics_record(const char *name, uint64_t value)
+{
+	if (!MTY_Atomic32Load(&METRICS_ACTIVE, MTY_ATOMIC_ACQUIRE))
+		return;
+
+	// MTY_MetricsDestroy waits for recordings in progress before freeing the histograms
+	MTY_Atomic32FetchAdd(&METRICS_RECORDING, 1, MTY_ATOMIC_SEQ_CST);
+
+	if (MTY_Atomic32Load(&METRICS_ACTIVE, MTY_ATOMIC_SEQ_CST)) {
+		MTY_Histogram *h = metrics_cache_find(name);
+
+		if (!h) {
+			MTY_GlobalLock(&METRICS_GLOCK);
+
+			if (METRICS) {
+				struct metric *m = metrics_get(name, true, METRICS_DEFAULT_MAX, METRICS_DEFAULT_DIGITS);
+
+				if (m) {
+					h = m->histogram;
+
+					if (!metrics_cache_find(name))
+						metrics_cache_insert(name, h);
+				}
+			}
+
+			MTY_GlobalUnlock(&METRICS_GLOCK);
+		}
+
+		if (h)
+			MTY_HistogramRecord(h, value);
+	}
+
+	MTY_Atomic32FetchAdd(&METRICS_RECORDING, -1, MTY_ATOMIC_RELEASE);
+}
+
+void MTY_MetricsCreate(void)
+{
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	if (!METRICS) {
+		METRICS = MTY_HashCreate(0);
+		MTY_Atomic32Store(&METRICS_ACTIVE, 1, MTY_ATOMIC_RELEASE);
+	}
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+}
+
+void MTY_MetricsDestroy(void)
+{
+	MTY_Atomic32Store(&METRICS_ACTIVE, 0, MTY_ATOMIC_SEQ_CST);
+
+	// A recording in progress may be waiting for the lock to create its histogram
+	while (MTY_Atomic32Load(&METRICS_RECORDING, MTY_ATOMIC_ACQUIRE) > 0)
+		MTY_Sleep(0);
+
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	metrics_cache_clear();
+	MTY_HashDestroy(&METRICS, metrics_free);
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+}
+
+MTY_Histogram *MTY_MetricsGetHistogram(const char *name, uint64_t max, uint32_t digits)
+{
+	MTY_Histogram *h = NULL;
+
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	if (METRICS) {
+		struct metric *m = metrics_get(name, true, max, digits);
+
+		if (m)
+			h = m->histogram;
+	}
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+
+	return h;
+}
+
+MTY_Atomic64 *MTY_MetricsGetCounter(const char *name)
+{
+	MTY_Atomic64 *c = NULL;
+
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	if (METRICS) {
+		struct metric *m = metrics_get(name, false, 0, 0);
+
+		if (m)
+			c = &m->counter;
+	}
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+
+	return c;
+}
+
+static MTY_JSON *metrics_histogram_json(MTY_Histogram *h)
+{
+	MTY_JSON *j = MTY_JSONObjCreate();
+	MTY_JSONObjSetNumber(j, "count", (double) MTY_HistogramGetCount(h));
+	MTY_JSONObjSetNumber(j, "min", (double) MTY_HistogramGetMin(h));
+	MTY_JSONObjSetNumber(j, "max", (double) MTY_HistogramGetMax(h));
+	MTY_JSONObjSetNumber(j, "mean", MTY_HistogramGetMean(h));
+	MTY_JSONObjSetNumber(j, "p50", (double) MTY_HistogramGetPercentile(h, 50));
+	MTY_JSONObjSetNumber(j, "p90", (double) MTY_HistogramGetPercentile(h, 90));
+	MTY_JSONObjSetNumber(j, "p99", (double) MTY_HistogramGetPercentile(h, 99));
+	MTY_JSONObjSetNumber(j, "p999", (double) MTY_HistogramGetPercentile(h, 99.9));
+
+	return j;
+}
+
+MTY_JSON *MTY_MetricsSnapshot(bool reset)
+{
+	MTY_JSON *j = MTY_JSONObjCreate();
+
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	uint64_t iter = 0;
+	const char *name = NULL;
+
+	while (METRICS && MTY_HashGetNextKey(METRICS, &iter, &name)) {
+		struct metric *m = MTY_HashGet(METRICS, name);
+
+		if (m->histogram) {
+			MTY_JSONObjSetItem(j, name, metrics_histogram_json(m->histogram));
+
+			if (reset)
+				MTY_HistogramReset(m->histogram);
+
+		} else {
+			int64_t value = reset ? MTY_Atomic64Exchange(&m->counter, 0, MTY_ATOMIC_RELAXED) :
+				MTY_Atomic64Load(&m->counter, MTY_ATOMIC_RELAXED);
+
+			MTY_JSONObjSetNumber(j, name, (double) value);
+		}
+	}
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+
+	return j;
+}
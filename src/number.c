@@ -0,0 +1,607 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+#include "number.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <float.h>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+#include "number-pow10.h"
+
+#define NUMBER_MAX_DIGITS 19
+#define NUMBER_MASK_63    0x7FFFFFFFFFFFFFFFull
+
+#define NUMBER_C_MIN  (1ull << 52)
+#define NUMBER_C_TINY 3
+#define NUMBER_Q_MIN  -1074
+
+static const double NUMBER_POW10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+	1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+	1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+
+// 128 bit arithmetic
+
+static uint64_t number_mul128(uint64_t a, uint64_t b, uint64_t *lo)
+{
+	#if defined(__SIZEOF_INT128__)
+		unsigned __int128 r = (unsigned __int128) a * b;
+		*lo = (uint64_t) r;
+
+		return (uint64_t) (r >> 64);
+
+	#elif defined(_MSC_VER) && defined(_M_X64)
+		uint64_t hi = 0;
+		*lo = _umul128(a, b, &hi);
+
+		return hi;
+
+	#elif defined(_MSC_VER) && defined(_M_ARM64)
+		*lo = a * b;
+
+		return __umulh(a, b);
+
+	#else
+		uint64_t a0 = (uint32_t) a, a1 = a >> 32;
+		uint64_t b0 = (uint32_t) b, b1 = b >> 32;
+
+		uint64_t p00 = a0 * b0, p01 = a0 * b1;
+		uint64_t p10 = a1 * b0, p11 = a1 * b1;
+
+		uint64_t mid = (p00 >> 32) + (uint32_t) p01 + (uint32_t) p10;
+		*lo = mid << 32 | (uint32_t) p00;
+
+		return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+	#endif
+}
+
+static uint32_t number_clz(uint64_t v)
+{
+	#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, v);
+
+		return 63 - index;
+
+	#else
+		return __builtin_clzll(v);
+	#endif
+}
+
+static double number_from_bits(uint64_t bits)
+{
+	double value = 0;
+	memcpy(&value, &bits, sizeof(double));
+
+	return value;
+}
+
+static uint64_t number_to_bits(double value)
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &value, sizeof(double));
+
+	return bits;
+}
+
+
+// Parse
+
+// Eisel-Lemire: w * 10^q is converted to a double using the 128 most significant bits of
+// 10^q. This is exact except when the product lands so close to a halfway point between
+// two doubles that the truncated power can not decide it, in which case it gives up.
+
+static bool number_eisel_lemire(uint64_t w, int64_t q, bool neg, double *value)
+{
+	// Both w and 10^q are exact doubles, so a single multiplication or division is
+	// correctly rounded
+	#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+		if (q >= -22 && q <= 22 && w <= 1ull << 53) {
+			double v = (double) w;
+			v = q < 0 ? v / NUMBER_POW10[-q] : v * NUMBER_POW10[q];
+
+			*value = neg ? -v : v;
+			return true;
+		}
+	#endif
+
+	uint64_t sign = (uint64_t) neg << 63;
+
+	if (w == 0 || q < NUMBER_POW10_MIN) {
+		*value = number_from_bits(sign);
+		return true;
+	}
+
+	if (q > 308) {
+		*value = number_from_bits(sign | 0x7FF0000000000000ull);
+		return true;
+	}
+
+	int32_t lz = number_clz(w);
+	w <<= lz;
+
+	const uint64_t *pow10 = NUMBER_POW10_128[q - NUMBER_POW10_MIN];
+	uint64_t phi = pow10[0];
+	uint64_t plo = pow10[1];
+
+	// The error analysis of the algorithm expects small reciprocal powers rounded up
+	if (q >= -27 && q < 0 && ++plo == 0)
+		phi++;
+
+	uint64_t lo = 0;
+	uint64_t hi = number_mul128(w, phi, &lo);
+
+	// Only the low bits of the power can change the result when the bits below the
+	// mantissa are all ones
+	if ((hi & 0x1FF) == 0x1FF) {
+		uint64_t lo2 = 0;
+		uint64_t hi2 = number_mul128(w, plo, &lo2);
+
+		lo += hi2;
+		if (hi2 > lo)
+			hi++;
+
+		if (lo == UINT64_MAX && (q < -27 || q > 55))
+			return false;
+	}
+
+	uint64_t upper = hi >> 63;
+	uint64_t mantissa = hi >> (upper + 9);
+	lz += (int32_t) (1 ^ upper);
+
+	int64_t exponent = ((152170 + 65536) * q >> 16) + 1024 + 63 - lz;
+
+	// Subnormal
+	if (exponent <= 0) {
+		if (-exponent + 1 >= 64) {
+			*value = number_from_bits(sign);
+			return true;
+		}
+
+		mantissa >>= -exponent + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+
+		exponent = mantissa < NUMBER_C_MIN ? 0 : 1;
+		*value = number_from_bits(sign | (uint64_t) exponent << 52 | (mantissa & (NUMBER_C_MIN - 1)));
+
+		return true;
+	}
+
+	// Exactly halfway between two doubles is only possible for small powers, and rounds
+	// to even
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && mantissa << (upper + 9) == hi)
+		mantissa &= ~1ull;
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+
+	if (mantissa >= NUMBER_C_MIN << 1) {
+		mantissa = NUMBER_C_MIN;
+		exponent++;
+	}
+
+	if (exponent >= 0x7FF) {
+		*value = number_from_bits(sign | 0x7FF0000000000000ull);
+		return true;
+	}
+
+	*value = number_from_bits(sign | (uint64_t) exponent << 52 | (mantissa & (NUMBER_C_MIN - 1)));
+
+	return true;
+}
+
+static double number_fallback(const char *str, size_t len)
+{
+	// strtod is correctly rounded, but uses the decimal point of the current locale
+	char buf[64];
+	char *tmp = len < sizeof(buf) ? buf : MTY_Alloc(len + 1, 1);
+
+	memcpy(tmp, str, len);
+	tmp[len] = '\0';
+
+	char *point = memchr(tmp, '.', len);
+	if (point)
+		*point = localeconv()->decimal_point[0];
+
+	double value = strtod(tmp, NULL);
+
+	if (tmp != buf)
+		MTY_Free(tmp);
+
+	return value;
+}
+
+static bool number_is_digit(char c)
+{
+	return (uint8_t) (c - '0') < 10;
+}
+
+static bool number_eight_digits(const char *str, uint64_t *value)
+{
+	uint64_t v = 0;
+	memcpy(&v, str, sizeof(uint64_t));
+
+	// Every byte is in '0'-'9' (little endian)
+	if (((v + 0x4646464646464646ull) | (v - 0x3030303030303030ull)) & 0x8080808080808080ull)
+		return false;
+
+	v = (v & 0x0F0F0F0F0F0F0F0Full) * 2561 >> 8;
+	v = (v & 0x00FF00FF00FF00FFull) * 6553601 >> 16;
+	*value = (v & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32;
+
+	return true;
+}
+
+static const char *number_digits(const char *p, const char *end, uint64_t *w)
+{
+	// Long runs are converted eight digits at a time. Digits past what fits in w wrap
+	// around, the caller converts those numbers again from their leading digits
+	for (uint64_t eight = 0; end - p >= 8 && number_eight_digits(p, &eight); p += 8)
+		*w = *w * 100000000 + eight;
+
+	for (; p < end && number_is_digit(*p); p++)
+		*w = *w * 10 + (*p - '0');
+
+	return p;
+}
+
+size_t mty_number_parse(const char *str, size_t len, double *value, bool *integer)
+{
+	const char *p = str;
+	const char *end = str + len;
+
+	bool neg = p < end && *p == '-';
+	p += neg;
+
+	// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+	const char *int_start = p;
+	uint64_t w = 0;
+
+	if (p < end && *p == '0') {
+		p++;
+
+	} else {
+		p = number_digits(p, end, &w);
+
+		if (p == int_start)
+			return 0;
+	}
+
+	const char *int_end = p;
+	bool point = false;
+	int64_t exp10 = 0;
+
+	if (p < end && *p == '.') {
+		const char *frac_start = ++p;
+		p = number_digits(p, end, &w);
+
+		if (p == frac_start)
+			return 0;
+
+		point = true;
+		exp10 = frac_start - p;
+	}
+
+	const char *digits_end = p;
+	int64_t exp_part = 0;
+	bool exp = false;
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+
+		bool exp_neg = p < end && *p == '-';
+		if (p < end && (*p == '-' || *p == '+'))
+			p++;
+
+		const char *exp_start = p;
+
+		for (; p < end && number_is_digit(*p); p++)
+			if (exp_part < 0x10000000)
+				exp_part = exp_part * 10 + (*p - '0');
+
+		if (p == exp_start)
+			return 0;
+
+		exp = true;
+		exp_part = exp_neg ? -exp_part : exp_part;
+		exp10 += exp_part;
+	}
+
+	// More than 19 significant digits do not fit in w, so the value is bracketed by
+	// the first 19 digits and the next number up
+	bool truncated = false;
+
+	if ((size_t) (digits_end - int_start) - point > NUMBER_MAX_DIGITS) {
+		const char *s = int_start;
+
+		while (s < digits_end && (*s == '0' || *s == '.'))
+			s++;
+
+		size_t sig = (size_t) (digits_end - s) - (point && s < int_end);
+
+		if (sig > NUMBER_MAX_DIGITS) {
+			int64_t place = s < int_end ? int_end - s : -(s - int_end - 1);
+
+			w = 0;
+
+			for (uint32_t n = 0; n < NUMBER_MAX_DIGITS; s++) {
+				if (*s != '.') {
+					w = w * 10 + (*s - '0');
+					n++;
+				}
+			}
+
+			truncated = true;
+			exp10 = place - NUMBER_MAX_DIGITS + exp_part;
+		}
+	}
+
+	*integer = !point && !exp;
+
+	if (*integer && !truncated) {
+		// Integer to floating point conversion is correctly rounded
+		*value = neg ? -(double) w : (double) w;
+
+	} else {
+		double v = 0;
+		double v1 = 0;
+
+		bool ok = number_eisel_lemire(w, exp10, neg, &v);
+
+		if (ok && truncated)
+			ok = number_eisel_lemire(w + 1, exp10, neg, &v1) && v1 == v;
+
+		*value = ok ? v : number_fallback(str, p - str);
+	}
+
+	return p - str;
+}
+
+
+// Format
+
+// Schubfach: the shortest decimal that rounds back to the same double is found directly
+// from the rounding interval of the double, scaled by the same truncated powers of 10
+// the parser uses.
+
+static int64_t number_flog10_pow2(int64_t e)
+{
+	return e * 661971961083 >> 41;
+}
+
+static int64_t number_flog10_three_quarters_pow2(int64_t e)
+{
+	return (e * 661971961083 - 274743187321) >> 41;
+}
+
+static int64_t number_flog2_pow10(int64_t e)
+{
+	return e * 913124641741 >> 38;
+}
+
+static uint64_t number_rop(uint64_t g1, uint64_t g0, uint64_t cp)
+{
+	uint64_t lo = 0;
+	uint64_t x1 = number_mul128(g0, cp, &lo);
+	uint64_t y0 = g1 * cp;
+	uint64_t y1 = number_mul128(g1, cp, &lo);
+
+	uint64_t z = (y0 >> 1) + x1;
+	uint64_t vbp = y1 + (z >> 63);
+
+	return vbp | ((z & NUMBER_MASK_63) + NUMBER_MASK_63) >> 63;
+}
+
+static void number_shortest(int64_t q, uint64_t c, uint64_t *f, int64_t *e)
+{
+	uint64_t out = c & 1;
+	uint64_t cb = c << 2;
+	uint64_t cbr = cb + 2;
+	uint64_t cbl = 0;
+	int64_t k = 0;
+
+	// Powers of 2 have a closer neighbor below
+	if (c != NUMBER_C_MIN || q == NUMBER_Q_MIN) {
+		cbl = cb - 2;
+		k = number_flog10_pow2(q);
+
+	} else {
+		cbl = cb - 1;
+		k = number_flog10_three_quarters_pow2(q);
+	}
+
+	int64_t h = q + number_flog2_pow10(-k) + 2;
+
+	// g = g1 2^63 + g0 is 10^-k truncated to 126 bits, plus one
+	const uint64_t *pow10 = NUMBER_POW10_128[-k - NUMBER_POW10_MIN];
+	uint64_t ghi = pow10[0] >> 2;
+	uint64_t glo = pow10[0] << 62 | pow10[1] >> 2;
+
+	if (++glo == 0)
+		ghi++;
+
+	uint64_t g1 = ghi << 1 | glo >> 63;
+	uint64_t g0 = glo & NUMBER_MASK_63;
+
+	uint64_t vb = number_rop(g1, g0, cb << h);
+	uint64_t vbl = number_rop(g1, g0, cbl << h);
+	uint64_t vbr = number_rop(g1, g0, cbr << h);
+
+	uint64_t s = vb >> 2;
+
+	// Try one digit less first
+	if (s >= 100) {
+		uint64_t lo = 0;
+		uint64_t sp10 = 10 * number_mul128(s, 115292150460684698ull << 4, &lo);
+		uint64_t tp10 = sp10 + 10;
+
+		bool upin = vbl + out <= sp10 << 2;
+		bool wpin = (tp10 << 2) + out <= vbr;
+
+		if (upin != wpin) {
+			*f = upin ? sp10 : tp10;
+			*e = k;
+			return;
+		}
+	}
+
+	uint64_t t = s + 1;
+
+	bool uin = vbl + out <= s << 2;
+	bool win = (t << 2) + out <= vbr;
+
+	if (uin != win) {
+		*f = uin ? s : t;
+		*e = k;
+		return;
+	}
+
+	// Both are in the interval, take the closer one
+	int64_t cmp = (int64_t) (vb - ((s + t) << 1));
+
+	*f = cmp < 0 || (cmp == 0 && (s & 1) == 0) ? s : t;
+	*e = k;
+}
+
+static size_t number_write(uint64_t f, int64_t e, char *str)
+{
+	if (f == 0) {
+		str[0] = '0';
+		return 1;
+	}
+
+	for (; f % 10 == 0; f /= 10)
+		e++;
+
+	char digits[20];
+	int64_t n = 0;
+
+	for (char *d = digits + sizeof(digits); f > 0; f /= 10, n++)
+		*--d = (char) ('0' + f % 10);
+
+	const char *d = digits + sizeof(digits) - n;
+
+	// The value is 0.digits * 10^point, written the same way as JavaScript
+	int64_t point = n + e;
+	char *p = str;
+
+	if (point >= n && point <= 21) {
+		memcpy(p, d, n);
+		p += n;
+
+		for (int64_t x = n; x < point; x++)
+			*p++ = '0';
+
+	} else if (point > 0 && point <= 21) {
+		memcpy(p, d, point);
+		p += point;
+		*p++ = '.';
+		memcpy(p, d + point, n - point);
+		p += n - point;
+
+	} else if (point > -6 && point <= 0) {
+		*p++ = '0';
+		*p++ = '.';
+
+		for (int64_t x = point; x < 0; x++)
+			*p++ = '0';
+
+		memcpy(p, d, n);
+		p += n;
+
+	} else {
+		*p++ = d[0];
+
+		if (n > 1) {
+			*p++ = '.';
+			memcpy(p, d + 1, n - 1);
+			p += n - 1;
+		}
+
+		int64_t exp10 = point - 1;
+
+		*p++ = 'e';
+		*p++ = exp10 < 0 ? '-' : '+';
+
+		if (exp10 < 0)
+			exp10 = -exp10;
+
+		if (exp10 >= 100)
+			*p++ = (char) ('0' + exp10 / 100);
+
+		if (exp10 >= 10)
+			*p++ = (char) ('0' + exp10 / 10 % 10);
+
+		*p++ = (char) ('0' + exp10 % 10);
+	}
+
+	return p - str;
+}
+
+size_t mty_number_format(double value, char *str)
+{
+	uint64_t bits = number_to_bits(value);
+	uint64_t t = bits & (NUMBER_C_MIN - 1);
+	int64_t bq = bits >> 52 & 0x7FF;
+
+	char *p = str;
+
+	if (bits >> 63)
+		*p++ = '-';
+
+	uint64_t f = 0;
+	int64_t e = 0;
+
+	if (bq == 0x7FF) {
+		const char *special = t != 0 ? "nan" : "inf";
+
+		// NaN is written without a sign
+		if (t != 0)
+			p = str;
+
+		memcpy(p, special, 3);
+		p += 3;
+
+	} else {
+		if (bq != 0) {
+			int64_t mq = -NUMBER_Q_MIN + 1 - bq;
+			uint64_t c = NUMBER_C_MIN | t;
+
+			// Integers below 2^53 are already exact
+			if (mq > 0 && mq < 53 && c >> mq << mq == c) {
+				f = c >> mq;
+
+			} else {
+				number_shortest(-mq, c, &f, &e);
+			}
+
+		} else if (t != 0) {
+			// The two smallest subnormals are too narrow for the algorithm's precision,
+			// their shortest forms are 5e-324 and 1e-323
+			if (t < NUMBER_C_TINY) {
+				f = t == 1 ? 5 : 1;
+				e = t == 1 ? -324 : -323;
+
+			} else {
+				number_shortest(NUMBER_Q_MIN, t, &f, &e);
+			}
+		}
+
+		p += number_write(f, e, p);
+	}
+
+	*p = '\0';
+
+	return p - str;
+}
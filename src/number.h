@@ -0,0 +1,10 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#define NUMBER_FORMAT_MAX 32
+
+size_t mty_number_parse(const char *str, size_t len, double *value, bool *integer);
+size_t mty_number_format(double value, char *str);
@@ -0,0 +1,522 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+#define PARALLEL_MAX_WORKERS 64
+#define PARALLEL_CHUNKS_PER_THREAD 4
+
+
+// Workers
+
+struct parallel_task {
+	MTY_AnonFunc func;
+	void *opaque;
+};
+
+static struct parallel {
+	MTY_Mutex *mutex;
+	MTY_Cond *work;
+	MTY_Cond *done;
+
+	struct parallel_task *tasks;
+	uint32_t size;
+	uint32_t head;
+	uint32_t count;
+
+	uint32_t num_workers;
+	MTY_Thread *workers[PARALLEL_MAX_WORKERS];
+} PARALLEL;
+
+static MTY_Atomic32 PARALLEL_GLOCK;
+static MTY_Atomic32 PARALLEL_INIT;
+
+static void *parallel_worker(void *opaque)
+{
+	struct parallel *ctx = opaque;
+
+	while (true) {
+		MTY_MutexLock(ctx->mutex);
+
+		while (ctx->count == 0)
+			MTY_CondWait(ctx->work, ctx->mutex, -1);
+
+		struct parallel_task task = ctx->tasks[ctx->head];
+		ctx->head = (ctx->head + 1) % ctx->size;
+		ctx->count--;
+
+		MTY_MutexUnlock(ctx->mutex);
+
+		task.func(task.opaque);
+	}
+
+	return NULL;
+}
+
+static struct parallel *parallel_get(void)
+{
+	struct parallel *ctx = &PARALLEL;
+
+	if (MTY_Atomic32Load(&PARALLEL_INIT, MTY_ATOMIC_ACQUIRE))
+		return ctx;
+
+	MTY_GlobalLock(&PARALLEL_GLOCK);
+
+	if (!MTY_Atomic32Load(&PARALLEL_INIT, MTY_ATOMIC_RELAXED)) {
+		ctx->mutex = MTY_MutexCreate();
+		ctx->work = MTY_CondCreate();
+		ctx->done = MTY_CondCreate();
+
+		ctx->size = 64;
+		ctx->tasks = MTY_Alloc(ctx->size, sizeof(struct parallel_task));
+
+		// The calling thread always participates, so leave one core for it
+		uint32_t cpus = MTY_GetCPUCount();
+		ctx->num_workers = cpus > 1 ? cpus - 1 : 0;
+
+		if (ctx->num_workers > PARALLEL_MAX_WORKERS)
+			ctx->num_workers = PARALLEL_MAX_WORKERS;
+
+		for (uint32_t x = 0; x < ctx->num_workers; x++)
+			ctx->workers[x] = MTY_ThreadCreate(parallel_worker, ctx);
+
+		MTY_Atomic32Store(&PARALLEL_INIT, 1, MTY_ATOMIC_RELEASE);
+	}
+
+	MTY_GlobalUnlock(&PARALLEL_GLOCK);
+
+	return ctx;
+}
+
+static void parallel_submit(MTY_AnonFunc func, void *opaque)
+{
+	struct parallel *ctx = parallel_get();
+
+	if (ctx->num_workers == 0) {
+		func(opaque);
+		return;
+	}
+
+	MTY_MutexLock(ctx->mutex);
+
+	if (ctx->count == ctx->size) {
+		struct parallel_task *tasks = MTY_Alloc(ctx->size * 2, sizeof(struct parallel_task));
+
+		for (uint32_t x = 0; x < ctx->count; x++)
+			tasks[x] = ctx->tasks[(ctx->head + x) % ctx->size];
+
+		MTY_Free(ctx->tasks);
+		ctx->tasks = tasks;
+		ctx->head = 0;
+		ctx->size *= 2;
+	}
+
+	struct parallel_task *task = &ctx->tasks[(ctx->head + ctx->count) % ctx->size];
+	task->func = func;
+	task->opaque = opaque;
+	ctx->count++;
+
+	MTY_CondSignal(ctx->work);
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+
+// ParallelFor
+
+struct parallel_job {
+	MTY_RangeFunc func;
+	void *opaque;
+
+	int64_t begin;
+	int64_t end;
+	int64_t grain;
+	int64_t chunks;
+
+	MTY_Atomic64 next;
+	MTY_Atomic64 finished;
+	MTY_Atomic32 refs;
+};
+
+static void parallel_job_unref(struct parallel_job *job)
+{
+	if (MTY_Atomic32FetchAdd(&job->refs, -1, MTY_ATOMIC_ACQ_REL) == 1)
+		MTY_Free(job);
+}
+
+static void parallel_job_run(struct parallel_job *job)
+{
+	struct parallel *ctx = &PARALLEL;
+
+	for (int64_t c = MTY_Atomic64FetchAdd(&job->next, 1, MTY_ATOMIC_RELAXED); c < job->chunks;
+		c = MTY_Atomic64FetchAdd(&job->next, 1, MTY_ATOMIC_RELAXED))
+	{
+		int64_t begin = job->begin + c * job->grain;
+		int64_t end = begin + job->grain;
+
+		job->func(begin, end < job->end ? end : job->end, job->opaque);
+
+		if (MTY_Atomic64FetchAdd(&job->finished, 1, MTY_ATOMIC_ACQ_REL) + 1 == job->chunks) {
+			MTY_MutexLock(ctx->mutex);
+			MTY_CondSignalAll(ctx->done);
+			MTY_MutexUnlock(ctx->mutex);
+		}
+	}
+}
+
+static void parallel_job_helper(void *opaque)
+{
+	struct parallel_job *job = opaque;
+
+	parallel_job_run(job);
+	parallel_job_unref(job);
+}
+
+void MTY_ParallelFor(int64_t begin, int64_t end, int64_t grain, MTY_RangeFunc func, void *opaque)
+{
+	if (end <= begin)
+		return;
+
+	struct parallel *ctx = parallel_get();
+	int64_t range = end - begin;
+
+	if (grain <= 0) {
+		int64_t chunks = (int64_t) (ctx->num_workers + 1) * PARALLEL_CHUNKS_PER_THREAD;
+		grain = (range + chunks - 1) / chunks;
+	}
+
+	int64_t chunks = (range + grain - 1) / grain;
+
+	if (chunks == 1 || ctx->num_workers == 0) {
+		func(begin, end, opaque);
+		return;
+	}
+
+	struct parallel_job *job = MTY_Alloc(1, sizeof(struct parallel_job));
+	job->func = func;
+	job->opaque = opaque;
+	job->begin = begin;
+	job->end = end;
+	job->grain = grain;
+	job->chunks = chunks;
+
+	// The calling thread takes chunks too, so at most chunks - 1 helpers are useful
+	uint32_t helpers = chunks - 1 < ctx->num_workers ? (uint32_t) chunks - 1 : ctx->num_workers;
+	MTY_Atomic32Store(&job->refs, helpers + 1, MTY_ATOMIC_RELAXED);
+
+	for (uint32_t x = 0; x < helpers; x++)
+		parallel_submit(parallel_job_helper, job);
+
+	parallel_job_run(job);
+
+	if (MTY_Atomic64Load(&job->finished, MTY_ATOMIC_ACQUIRE) < chunks) {
+		MTY_MutexLock(ctx->mutex);
+
+		while (MTY_Atomic64Load(&job->finished, MTY_ATOMIC_ACQUIRE) < chunks)
+			MTY_CondWait(ctx->done, ctx->mutex, -1);
+
+		MTY_MutexUnlock(ctx->mutex);
+	}
+
+	parallel_job_unref(job);
+}
+
+
+// ParallelReduce
+
+struct parallel_reduce {
+	int64_t begin;
+	int64_t end;
+	int64_t grain;
+	int64_t chunks;
+	int64_t slots;
+	uint8_t *partials;
+	size_t size;
+	MTY_ReduceFunc func;
+	void *opaque;
+};
+
+static void parallel_reduce_range(int64_t begin, int64_t end, void *opaque)
+{
+	struct parallel_reduce *r = opaque;
+
+	// Each slot reduces a contiguous run of chunks in order into its own partial
+	int64_t per = r->chunks / r->slots;
+	int64_t extra = r->chunks % r->slots;
+
+	for (int64_t s = begin; s < end; s++) {
+		int64_t first = s * per + (s < extra ? s : extra);
+		int64_t last = first + per + (s < extra ? 1 : 0);
+
+		for (int64_t c = first; c < last; c++) {
+			int64_t rbegin = r->begin + c * r->grain;
+			int64_t rend = rbegin + r->grain;
+
+			r->func(rbegin, rend < r->end ? rend : r->end, r->partials + s * r->size, r->opaque);
+		}
+	}
+}
+
+void MTY_ParallelReduce(int64_t begin, int64_t end, int64_t grain, void *result, size_t size,
+	MTY_ReduceFunc reduce, MTY_CombineFunc combine, void *opaque)
+{
+	if (end <= begin)
+		return;
+
+	struct parallel *ctx = parallel_get();
+	int64_t range = end - begin;
+
+	if (grain <= 0) {
+		int64_t chunks = (int64_t) (ctx->num_workers + 1) * PARALLEL_CHUNKS_PER_THREAD;
+		grain = (range + chunks - 1) / chunks;
+	}
+
+	int64_t chunks = (range + grain - 1) / grain;
+	int64_t threads = (int64_t) ctx->num_workers + 1;
+
+	struct parallel_reduce r = {0};
+	r.begin = begin;
+	r.end = end;
+	r.grain = grain;
+	r.chunks = chunks;
+	r.slots = chunks < threads ? chunks : threads;
+	r.size = size;
+	r.func = reduce;
+	r.opaque = opaque;
+	r.partials = MTY_Alloc((size_t) r.slots, size);
+
+	// Every partial starts from the identity value held in result
+	for (int64_t x = 0; x < r.slots; x++)
+		memcpy(r.partials + x * size, result, size);
+
+	MTY_ParallelFor(0, r.slots, 1, parallel_reduce_range, &r);
+
+	// Combine in order so non-commutative reductions are deterministic
+	for (int64_t x = 0; x < r.slots; x++)
+		combine(result, r.partials + x * size, opaque);
+
+	MTY_Free(r.partials);
+}
+
+
+// TaskGraph
+
+struct task_node {
+	MTY_AnonFunc func;
+	void *opaque;
+	uint32_t pending;
+	bool done;
+
+	uint32_t *dependents;
+	uint32_t num_dependents;
+	uint32_t size_dependents;
+};
+
+struct MTY_TaskGraph {
+	MTY_Mutex *mutex;
+	MTY_Cond *cond;
+
+	struct task_node *tasks;
+	uint32_t num_tasks;
+	uint32_t size_tasks;
+	uint32_t finished;
+	uint32_t runners;
+
+	uint32_t *ready;
+	uint32_t ready_head;
+	uint32_t ready_count;
+	uint32_t ready_size;
+};
+
+MTY_TaskGraph *MTY_TaskGraphCreate(void)
+{
+	MTY_TaskGraph *ctx = MTY_Alloc(1, sizeof(MTY_TaskGraph));
+
+	ctx->mutex = MTY_MutexCreate();
+	ctx->cond = MTY_CondCreate();
+
+	return ctx;
+}
+
+static void task_graph_reset(MTY_TaskGraph *ctx)
+{
+	for (uint32_t x = 0; x < ctx->num_tasks; x++)
+		MTY_Free(ctx->tasks[x].dependents);
+
+	ctx->num_tasks = 0;
+	ctx->finished = 0;
+}
+
+void MTY_TaskGraphDestroy(MTY_TaskGraph **graph)
+{
+	if (!graph || !*graph)
+		return;
+
+	MTY_TaskGraph *ctx = *graph;
+
+	MTY_TaskGraphWait(ctx, -1);
+
+	task_graph_reset(ctx);
+
+	MTY_CondDestroy(&ctx->cond);
+	MTY_MutexDestroy(&ctx->mutex);
+
+	MTY_Free(ctx->ready);
+	MTY_Free(ctx->tasks);
+	MTY_Free(ctx);
+	*graph = NULL;
+}
+
+static void task_graph_push_ready(MTY_TaskGraph *ctx, uint32_t index)
+{
+	if (ctx->ready_count == ctx->ready_size) {
+		uint32_t size = ctx->ready_size > 0 ? ctx->ready_size * 2 : 16;
+		uint32_t *ready = MTY_Alloc(size, sizeof(uint32_t));
+
+		for (uint32_t x = 0; x < ctx->ready_count; x++)
+			ready[x] = ctx->ready[(ctx->ready_head + x) % ctx->ready_size];
+
+		MTY_Free(ctx->ready);
+		ctx->ready = ready;
+		ctx->ready_head = 0;
+		ctx->ready_size = size;
+	}
+
+	ctx->ready[(ctx->ready_head + ctx->ready_count) % ctx->ready_size] = index;
+	ctx->ready_count++;
+}
+
+static void task_graph_runner(void *opaque)
+{
+	MTY_TaskGraph *ctx = opaque;
+
+	MTY_MutexLock(ctx->mutex);
+
+	while (ctx->ready_count > 0) {
+		uint32_t index = ctx->ready[ctx->ready_head];
+		ctx->ready_head = (ctx->ready_head + 1) % ctx->ready_size;
+		ctx->ready_count--;
+
+		struct task_node task = ctx->tasks[index];
+
+		MTY_MutexUnlock(ctx->mutex);
+		task.func(task.opaque);
+		MTY_MutexLock(ctx->mutex);
+
+		// Continuations become ready as soon as their last predecessor finishes. This
+		// runner keeps going with one of them, the rest are handed to other workers
+		struct task_node *node = &ctx->tasks[index];
+		node->done = true;
+
+		uint32_t ready = 0;
+
+		for (uint32_t x = 0; x < node->num_dependents; x++) {
+			struct task_node *dep = &ctx->tasks[node->dependents[x]];
+
+			if (--dep->pending == 0) {
+				task_graph_push_ready(ctx, node->dependents[x]);
+				ready++;
+			}
+		}
+
+		ctx->runners += ready > 1 ? ready - 1 : 0;
+		ctx->finished++;
+
+		if (ready > 1) {
+			MTY_MutexUnlock(ctx->mutex);
+
+			for (uint32_t x = 0; x < ready - 1; x++)
+				parallel_submit(task_graph_runner, ctx);
+
+			MTY_MutexLock(ctx->mutex);
+		}
+	}
+
+	if (--ctx->runners == 0)
+		MTY_CondSignalAll(ctx->cond);
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+uint32_t MTY_TaskGraphAdd(MTY_TaskGraph *ctx, MTY_AnonFunc func, void *opaque,
+	const uint32_t *deps, uint32_t numDeps)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	if (ctx->num_tasks == ctx->size_tasks) {
+		ctx->size_tasks = ctx->size_tasks > 0 ? ctx->size_tasks * 2 : 16;
+		ctx->tasks = MTY_Realloc(ctx->tasks, ctx->size_tasks, sizeof(struct task_node));
+	}
+
+	uint32_t index = ctx->num_tasks++;
+
+	struct task_node *node = &ctx->tasks[index];
+	memset(node, 0, sizeof(struct task_node));
+	node->func = func;
+	node->opaque = opaque;
+
+	for (uint32_t x = 0; x < numDeps; x++) {
+		if (deps[x] == 0 || deps[x] > index) {
+			MTY_Log("Dependency %u is not a valid task id", deps[x]);
+			continue;
+		}
+
+		struct task_node *pred = &ctx->tasks[deps[x] - 1];
+
+		if (pred->done)
+			continue;
+
+		if (pred->num_dependents == pred->size_dependents) {
+			pred->size_dependents = pred->size_dependents > 0 ? pred->size_dependents * 2 : 4;
+			pred->dependents = MTY_Realloc(pred->dependents, pred->size_dependents, sizeof(uint32_t));
+		}
+
+		pred->dependents[pred->num_dependents++] = index;
+		node->pending++;
+	}
+
+	bool ready = node->pending == 0;
+
+	if (ready) {
+		task_graph_push_ready(ctx, index);
+		ctx->runners++;
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	if (ready)
+		parallel_submit(task_graph_runner, ctx);
+
+	return index + 1;
+}
+
+bool MTY_TaskGraphWait(MTY_TaskGraph *ctx, int32_t timeout)
+{
+	MTY_Time start = MTY_GetTime();
+
+	MTY_MutexLock(ctx->mutex);
+
+	while (ctx->finished < ctx->num_tasks || ctx->runners > 0) {
+		int32_t remaining = -1;
+
+		if (timeout >= 0) {
+			remaining = timeout - (int32_t) MTY_TimeDiff(start, MTY_GetTime());
+
+			if (remaining <= 0)
+				break;
+		}
+
+		MTY_CondWait(ctx->cond, ctx->mutex, remaining);
+	}
+
+	bool r = ctx->finished == ctx->num_tasks && ctx->runners == 0;
+
+	if (r)
+		task_graph_reset(ctx);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return r;
+}
@@ -3,6 +3,7 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "metrics.h"
 
 #include <string.h>
 
@@ -83,7 +84,7 @@ void *MTY_QueueGetInputBuffer(MTY_Queue *ctx)
 {
 	MTY_MutexLock(ctx->push_mutex);
 
-	int32_t state = MTY_Atomic32Get(&ctx->slots[ctx->push_pos].state);
+	int32_t state = MTY_Atomic32Load(&ctx->slots[ctx->push_pos].state, MTY_ATOMIC_ACQUIRE);
 
 	if (state == QUEUE_EMPTY) {
 		return ctx->slots[ctx->push_pos].data;
@@ -112,7 +113,7 @@ static void queue_push(MTY_Queue *ctx, size_t size, bool ptr)
 		ctx->push_pos = queue_next_pos(ctx, ctx->push_pos);
 
 		ctx->slots[lock_pos].ptr = ptr;
-		MTY_Atomic32Set(&ctx->slots[lock_pos].state, QUEUE_FULL);
+		MTY_Atomic32Store(&ctx->slots[lock_pos].state, QUEUE_FULL, MTY_ATOMIC_RELEASE);
 
 		MTY_WaitableSignal(ctx->pop_sync);
 	}
@@ -127,9 +128,11 @@ void MTY_QueuePush(MTY_Queue *ctx, size_t size)
 
 static bool queue_pop(MTY_Queue *ctx, int32_t timeout, bool last, void **buffer, size_t *size)
 {
+	uint64_t wait = 0;
+
 	begin:
 
-	if (MTY_Atomic32Get(&ctx->slots[ctx->pop_pos].state) == QUEUE_FULL) {
+	if (MTY_Atomic32Load(&ctx->slots[ctx->pop_pos].state, MTY_ATOMIC_ACQUIRE) == QUEUE_FULL) {
 		*buffer = ctx->slots[ctx->pop_pos].data;
 
 		if (size)
@@ -138,15 +141,21 @@ static bool queue_pop(MTY_Queue *ctx, int32_t timeout, bool last, void **buffer,
 		if (last) {
 			uint32_t next_pos = queue_next_pos(ctx, ctx->pop_pos);
 
-			if (MTY_Atomic32Get(&ctx->slots[next_pos].state) == QUEUE_FULL) {
+			if (MTY_Atomic32Load(&ctx->slots[next_pos].state, MTY_ATOMIC_ACQUIRE) == QUEUE_FULL) {
 				MTY_QueuePop(ctx);
 				goto begin;
 			}
 		}
 
+		if (wait != 0)
+			mty_metrics_record("mty.queue.wait_us", MTY_TicksToNS(MTY_GetTicks() - wait) / 1000);
+
 		return true;
 
 	} else if (timeout != 0) {
+		if (wait == 0)
+			wait = MTY_GetTicks();
+
 		// Because of the lock free check, this may already be signaled when
 		// there is no data. Worst case the loop spins one extra time
 		if (MTY_WaitableWait(ctx->pop_sync, timeout))
@@ -172,7 +181,7 @@ void MTY_QueuePop(MTY_Queue *ctx)
 
 	ctx->pop_pos = queue_next_pos(ctx, ctx->pop_pos);
 
-	MTY_Atomic32Set(&ctx->slots[lock_pos].state, QUEUE_EMPTY);
+	MTY_Atomic32Store(&ctx->slots[lock_pos].state, QUEUE_EMPTY, MTY_ATOMIC_RELEASE);
 }
 
 bool MTY_QueuePushPtr(MTY_Queue *ctx, void *opaque, size_t size)
@@ -0,0 +1,570 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+#define SORT_STACK     4096
+#define SORT_MIN_MERGE 32
+#define SORT_MAX_RUNS  96
+
+#define SORT_AT(s, i) ((s)->buf + (i) * (s)->size)
+
+// Scratch space on the stack, aligned for any element type
+union sort_scratch {
+	uint8_t b[SORT_STACK];
+	uint64_t u;
+	double d;
+	void *p;
+};
+
+struct sort_run {
+	size_t base;
+	size_t len;
+};
+
+struct sort {
+	uint8_t *buf;
+	uint8_t *tmp;
+	size_t size;
+	MTY_CompareFunc func;
+
+	struct sort_run runs[SORT_MAX_RUNS];
+	uint32_t n;
+};
+
+static void sort_copy(void *dst, const void *src, size_t size)
+{
+	// Constant sizes let the compiler inline the copy for common element types
+	switch (size) {
+		case 4:  memcpy(dst, src, 4);    break;
+		case 8:  memcpy(dst, src, 8);    break;
+		case 16: memcpy(dst, src, 16);   break;
+		default: memcpy(dst, src, size); break;
+	}
+}
+
+
+// Runs
+
+static void sort_reverse(struct sort *s, size_t lo, size_t hi)
+{
+	for (hi--; lo < hi; lo++, hi--) {
+		sort_copy(s->tmp, SORT_AT(s, lo), s->size);
+		sort_copy(SORT_AT(s, lo), SORT_AT(s, hi), s->size);
+		sort_copy(SORT_AT(s, hi), s->tmp, s->size);
+	}
+}
+
+static size_t sort_count_run(struct sort *s, size_t lo, size_t hi)
+{
+	size_t x = lo + 1;
+
+	if (x == hi)
+		return 1;
+
+	// Descending runs must be strictly descending so reversing them keeps the sort stable
+	if (s->func(SORT_AT(s, x), SORT_AT(s, lo)) < 0) {
+		for (x++; x < hi && s->func(SORT_AT(s, x), SORT_AT(s, x - 1)) < 0; x++);
+
+		sort_reverse(s, lo, x);
+
+	} else {
+		for (x++; x < hi && s->func(SORT_AT(s, x), SORT_AT(s, x - 1)) >= 0; x++);
+	}
+
+	return x - lo;
+}
+
+static size_t sort_upper_bound(struct sort *s, size_t base, size_t len, const void *key)
+{
+	// First element in [base, base + len) that goes after key
+	while (len > 0) {
+		size_t half = len / 2;
+
+		if (s->func(key, SORT_AT(s, base + half)) < 0) {
+			len = half;
+
+		} else {
+			base += half + 1;
+			len -= half + 1;
+		}
+	}
+
+	return base;
+}
+
+static size_t sort_lower_bound(struct sort *s, size_t base, size_t len, const void *key)
+{
+	// First element in [base, base + len) that does not go before key
+	while (len > 0) {
+		size_t half = len / 2;
+
+		if (s->func(SORT_AT(s, base + half), key) < 0) {
+			base += half + 1;
+			len -= half + 1;
+
+		} else {
+			len = half;
+		}
+	}
+
+	return base;
+}
+
+static void sort_binary_insertion(struct sort *s, size_t lo, size_t hi, size_t start)
+{
+	for (size_t x = start; x < hi; x++) {
+		sort_copy(s->tmp, SORT_AT(s, x), s->size);
+
+		size_t pos = sort_upper_bound(s, lo, x - lo, s->tmp);
+
+		if (pos < x) {
+			memmove(SORT_AT(s, pos + 1), SORT_AT(s, pos), (x - pos) * s->size);
+			sort_copy(SORT_AT(s, pos), s->tmp, s->size);
+		}
+	}
+}
+
+static size_t sort_min_run(size_t len)
+{
+	// Keeps len / minrun at or just below a power of two so the final merges are balanced
+	size_t r = 0;
+
+	while (len >= SORT_MIN_MERGE) {
+		r |= len & 1;
+		len >>= 1;
+	}
+
+	return len + r;
+}
+
+
+// Merging
+
+static void sort_merge_lo(struct sort *s, size_t a, size_t la, size_t b, size_t lb)
+{
+	// The left run is the shorter one, move it out of the way and merge forwards
+	memcpy(s->tmp, SORT_AT(s, a), la * s->size);
+
+	uint8_t *dst = SORT_AT(s, a);
+	uint8_t *pa = s->tmp;
+	uint8_t *pa_end = s->tmp + la * s->size;
+	uint8_t *pb = SORT_AT(s, b);
+	uint8_t *pb_end = SORT_AT(s, b + lb);
+
+	while (pa < pa_end && pb < pb_end) {
+		if (s->func(pb, pa) < 0) {
+			sort_copy(dst, pb, s->size);
+			pb += s->size;
+
+		} else {
+			sort_copy(dst, pa, s->size);
+			pa += s->size;
+		}
+
+		dst += s->size;
+	}
+
+	// Whatever is left of the right run is already in place
+	memcpy(dst, pa, pa_end - pa);
+}
+
+static void sort_merge_hi(struct sort *s, size_t a, size_t la, size_t b, size_t lb)
+{
+	// The right run is the shorter one, move it out of the way and merge backwards
+	memcpy(s->tmp, SORT_AT(s, b), lb * s->size);
+
+	uint8_t *dst = SORT_AT(s, b + lb);
+	uint8_t *pa = SORT_AT(s, a + la);
+	uint8_t *pa_begin = SORT_AT(s, a);
+	uint8_t *pb = s->tmp + lb * s->size;
+
+	while (pa > pa_begin && pb > s->tmp) {
+		dst -= s->size;
+
+		if (s->func(pb - s->size, pa - s->size) < 0) {
+			pa -= s->size;
+			sort_copy(dst, pa, s->size);
+
+		} else {
+			pb -= s->size;
+			sort_copy(dst, pb, s->size);
+		}
+	}
+
+	// Whatever is left of the left run is already in place
+	memcpy(dst - (pb - s->tmp), s->tmp, pb - s->tmp);
+}
+
+static void sort_merge(struct sort *s, size_t a, size_t la, size_t b, size_t lb)
+{
+	// Elements of the left run that already go before the whole right run stay put
+	size_t k = sort_upper_bound(s, a, la, SORT_AT(s, b));
+	la -= k - a;
+	a = k;
+
+	if (la == 0)
+		return;
+
+	// Elements of the right run that already go after the whole left run stay put
+	lb = sort_lower_bound(s, b, lb, SORT_AT(s, a + la - 1)) - b;
+
+	if (lb == 0)
+		return;
+
+	if (la <= lb) {
+		sort_merge_lo(s, a, la, b, lb);
+
+	} else {
+		sort_merge_hi(s, a, la, b, lb);
+	}
+}
+
+static void sort_merge_at(struct sort *s, uint32_t i)
+{
+	struct sort_run *r = s->runs;
+
+	sort_merge(s, r[i].base, r[i].len, r[i + 1].base, r[i + 1].len);
+
+	r[i].len += r[i + 1].len;
+
+	if (i == s->n - 3)
+		r[i + 1] = r[i + 2];
+
+	s->n--;
+}
+
+static void sort_merge_collapse(struct sort *s)
+{
+	struct sort_run *r = s->runs;
+
+	// Keep run lengths growing at least as fast as the Fibonacci sequence down the stack,
+	// which bounds the stack depth and keeps merges balanced
+	while (s->n > 1) {
+		uint32_t k = s->n - 2;
+
+		if ((k > 0 && r[k - 1].len <= r[k].len + r[k + 1].len) ||
+			(k > 1 && r[k - 2].len <= r[k - 1].len + r[k].len))
+		{
+			if (r[k - 1].len < r[k + 1].len)
+				k--;
+
+		} else if (r[k].len > r[k + 1].len) {
+			break;
+		}
+
+		sort_merge_at(s, k);
+	}
+}
+
+static void sort_merge_force_collapse(struct sort *s)
+{
+	struct sort_run *r = s->runs;
+
+	while (s->n > 1) {
+		uint32_t k = s->n - 2;
+
+		if (k > 0 && r[k - 1].len < r[k + 1].len)
+			k--;
+
+		sort_merge_at(s, k);
+	}
+}
+
+
+// Stable sort
+
+void MTY_Sort(void *buf, size_t len, size_t size, MTY_CompareFunc func)
+{
+	if (len < 2 || size == 0)
+		return;
+
+	union sort_scratch scratch;
+
+	struct sort s = {0};
+	s.buf = buf;
+	s.size = size;
+	s.func = func;
+
+	// A merge never needs more scratch than the shorter of its two runs
+	size_t tmp_len = len / 2;
+	s.tmp = tmp_len * size <= SORT_STACK ? scratch.b : MTY_Alloc(tmp_len, size);
+
+	if (len < SORT_MIN_MERGE) {
+		size_t run = sort_count_run(&s, 0, len);
+		sort_binary_insertion(&s, 0, len, run);
+
+	} else {
+		size_t min_run = sort_min_run(len);
+
+		for (size_t lo = 0; lo < len;) {
+			size_t run = sort_count_run(&s, lo, len);
+
+			// Short runs are extended with insertion sort, which is fast on small ranges
+			if (run < min_run) {
+				size_t force = MTY_MIN(len - lo, min_run);
+				sort_binary_insertion(&s, lo, lo + force, lo + run);
+				run = force;
+			}
+
+			s.runs[s.n].base = lo;
+			s.runs[s.n].len = run;
+			s.n++;
+
+			sort_merge_collapse(&s);
+
+			lo += run;
+		}
+
+		sort_merge_force_collapse(&s);
+	}
+
+	if (s.tmp != scratch.b)
+		MTY_Free(s.tmp);
+}
+
+
+// Radix sort
+
+static uint64_t sort_radix_key(const uint8_t *elem, MTY_SortKey key)
+{
+	uint32_t u32 = 0;
+	uint64_t u64 = 0;
+
+	// Keys are mapped to unsigned integers that order the same way
+	switch (key) {
+		case MTY_SORT_KEY_UINT32:
+			memcpy(&u32, elem, 4);
+			return u32;
+		case MTY_SORT_KEY_INT32:
+			memcpy(&u32, elem, 4);
+			return u32 ^ 0x80000000;
+		case MTY_SORT_KEY_FLOAT:
+			memcpy(&u32, elem, 4);
+			return u32 & 0x80000000 ? ~u32 : u32 | 0x80000000;
+		case MTY_SORT_KEY_UINT64:
+			memcpy(&u64, elem, 8);
+			return u64;
+		case MTY_SORT_KEY_INT64:
+			memcpy(&u64, elem, 8);
+			return u64 ^ 0x8000000000000000;
+		case MTY_SORT_KEY_DOUBLE:
+			memcpy(&u64, elem, 8);
+			return u64 & 0x8000000000000000 ? ~u64 : u64 | 0x8000000000000000;
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+void MTY_RadixSort(void *buf, size_t len, size_t size, size_t offset, MTY_SortKey key)
+{
+	if (len < 2 || size == 0)
+		return;
+
+	bool wide = key == MTY_SORT_KEY_UINT64 || key == MTY_SORT_KEY_INT64 ||
+		key == MTY_SORT_KEY_DOUBLE;
+
+	uint32_t passes = wide ? 8 : 4;
+
+	// Count every digit of every key in a single pass over the data
+	size_t counts[8][256] = {0};
+
+	uint8_t *src = buf;
+
+	for (size_t x = 0; x < len; x++) {
+		uint64_t k = sort_radix_key(src + x * size + offset, key);
+
+		for (uint32_t y = 0; y < passes; y++)
+			counts[y][(k >> (y * 8)) & 0xFF]++;
+	}
+
+	union sort_scratch scratch;
+	uint8_t *tmp = len * size <= SORT_STACK ? scratch.b : MTY_Alloc(len, size);
+	uint8_t *dst = tmp;
+
+	for (uint32_t y = 0; y < passes; y++) {
+		size_t *count = counts[y];
+
+		// Digits shared by every key do not change the order
+		if (count[(sort_radix_key(src + offset, key) >> (y * 8)) & 0xFF] == len)
+			continue;
+
+		size_t pos = 0;
+
+		for (uint32_t z = 0; z < 256; z++) {
+			size_t n = count[z];
+			count[z] = pos;
+			pos += n;
+		}
+
+		// Scattering in order keeps equal keys in their original order
+		for (size_t x = 0; x < len; x++) {
+			uint8_t *elem = src + x * size;
+			uint64_t k = sort_radix_key(elem + offset, key);
+
+			sort_copy(dst + count[(k >> (y * 8)) & 0xFF]++ * size, elem, size);
+		}
+
+		uint8_t *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != buf)
+		memcpy(buf, src, len * size);
+
+	if (tmp != scratch.b)
+		MTY_Free(tmp);
+}
+
+
+// Parallel sort
+
+#define SORT_PARALLEL_MIN   (64 * 1024)
+#define SORT_PARALLEL_BLOCK (16 * 1024)
+
+struct sort_parallel {
+	uint8_t *src;
+	uint8_t *dst;
+	size_t len;
+	size_t size;
+	MTY_CompareFunc func;
+
+	size_t run_len;
+	int64_t segments;
+};
+
+static void sort_parallel_blocks(int64_t begin, int64_t end, void *opaque)
+{
+	struct sort_parallel *ctx = opaque;
+
+	for (int64_t x = begin; x < end; x++) {
+		size_t lo = (size_t) x * ctx->run_len;
+		size_t n = MTY_MIN(ctx->run_len, ctx->len - lo);
+
+		MTY_Sort(ctx->src + lo * ctx->size, n, ctx->size, ctx->func);
+	}
+}
+
+static size_t sort_parallel_co_rank(struct sort_parallel *ctx, const uint8_t *a, size_t la,
+	const uint8_t *b, size_t lb, size_t k)
+{
+	// Number of elements taken from a among the first k of the merged output. Ties are
+	// taken from a first, which keeps the merge stable
+	size_t lo = k > lb ? k - lb : 0;
+	size_t hi = MTY_MIN(k, la);
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ctx->func(b + (k - mid - 1) * ctx->size, a + mid * ctx->size) >= 0) {
+			lo = mid + 1;
+
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static void sort_parallel_merge(int64_t begin, int64_t end, void *opaque)
+{
+	struct sort_parallel *ctx = opaque;
+	size_t size = ctx->size;
+
+	for (int64_t x = begin; x < end; x++) {
+		// Each pair of adjacent runs is split into equal segments of merged output
+		size_t pair = (size_t) (x / ctx->segments);
+		size_t seg = (size_t) (x % ctx->segments);
+
+		size_t base = pair * 2 * ctx->run_len;
+		if (base >= ctx->len)
+			continue;
+
+		size_t la = MTY_MIN(ctx->run_len, ctx->len - base);
+		size_t lb = MTY_MIN(ctx->run_len, ctx->len - base - la);
+		size_t total = la + lb;
+
+		size_t k0 = total * seg / ctx->segments;
+		size_t k1 = total * (seg + 1) / ctx->segments;
+
+		const uint8_t *a = ctx->src + base * size;
+		const uint8_t *b = a + la * size;
+
+		// Merge path: the split points in both runs are found independently by each
+		// segment, so segments merge without coordinating with each other
+		size_t i = sort_parallel_co_rank(ctx, a, la, b, lb, k0);
+		size_t i_end = sort_parallel_co_rank(ctx, a, la, b, lb, k1);
+		size_t j = k0 - i;
+		size_t j_end = k1 - i_end;
+
+		uint8_t *dst = ctx->dst + (base + k0) * size;
+
+		while (i < i_end && j < j_end) {
+			if (ctx->func(b + j * size, a + i * size) < 0) {
+				sort_copy(dst, b + j * size, size);
+				j++;
+
+			} else {
+				sort_copy(dst, a + i * size, size);
+				i++;
+			}
+
+			dst += size;
+		}
+
+		memcpy(dst, a + i * size, (i_end - i) * size);
+		dst += (i_end - i) * size;
+
+		memcpy(dst, b + j * size, (j_end - j) * size);
+	}
+}
+
+void MTY_SortParallel(void *buf, size_t len, size_t size, MTY_CompareFunc func)
+{
+	uint32_t cpus = MTY_GetCPUCount();
+
+	if (len < SORT_PARALLEL_MIN || cpus < 2 || size == 0) {
+		MTY_Sort(buf, len, size, func);
+		return;
+	}
+
+	struct sort_parallel ctx = {0};
+	ctx.src = buf;
+	ctx.dst = MTY_Alloc(len, size);
+	ctx.len = len;
+	ctx.size = size;
+	ctx.func = func;
+
+	// One block per thread unless that would make the blocks too small
+	size_t blocks = MTY_MIN(cpus, len / SORT_PARALLEL_BLOCK);
+	ctx.run_len = (len + blocks - 1) / blocks;
+
+	MTY_ParallelFor(0, blocks, 1, sort_parallel_blocks, &ctx);
+
+	uint8_t *scratch = ctx.dst;
+
+	// Each round merges pairs of adjacent runs, alternating between the two buffers.
+	// Later rounds have fewer pairs, so each pair is split across more threads
+	for (; ctx.run_len < len; ctx.run_len *= 2) {
+		size_t pairs = (len + 2 * ctx.run_len - 1) / (2 * ctx.run_len);
+		ctx.segments = (cpus + pairs - 1) / pairs;
+
+		MTY_ParallelFor(0, pairs * ctx.segments, 1, sort_parallel_merge, &ctx);
+
+		uint8_t *swap = ctx.src;
+		ctx.src = ctx.dst;
+		ctx.dst = swap;
+	}
+
+	if (ctx.src != buf)
+		memcpy(buf, ctx.src, len * size);
+
+	MTY_Free(scratch);
+}
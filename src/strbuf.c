@@ -0,0 +1,177 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+#include "number.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define STRBUF_MIN_SIZE 64
+
+static void strbuf_reset(MTY_StrBuf *sb)
+{
+	// An empty builder still has a readable null terminated string
+	sb->str = (char *) "";
+	sb->len = 0;
+	sb->size = 0;
+	sb->heap = false;
+}
+
+void MTY_StrBufInit(MTY_StrBuf *sb, char *buf, size_t size)
+{
+	strbuf_reset(sb);
+
+	if (buf && size > 0) {
+		sb->str = buf;
+		sb->str[0] = '\0';
+		sb->size = size;
+	}
+}
+
+void MTY_StrBufFree(MTY_StrBuf *sb)
+{
+	if (!sb)
+		return;
+
+	if (sb->heap)
+		MTY_Free(sb->str);
+
+	strbuf_reset(sb);
+}
+
+void MTY_StrBufReserve(MTY_StrBuf *sb, size_t len)
+{
+	size_t needed = sb->len + len + 1;
+
+	if (needed <= sb->size)
+		return;
+
+	// Doubling keeps the total cost of copies during growth linear in the final length
+	size_t size = sb->size > STRBUF_MIN_SIZE ? sb->size : STRBUF_MIN_SIZE;
+
+	while (size < needed)
+		size = size > SIZE_MAX / 2 ? needed : size * 2;
+
+	// A caller supplied buffer is never freed, the contents are copied out of it to the heap
+	if (sb->heap) {
+		sb->str = MTY_Realloc(sb->str, size, 1);
+
+	} else {
+		char *str = MTY_Alloc(size, 1);
+		memcpy(str, sb->str, sb->len + 1);
+
+		sb->str = str;
+		sb->heap = true;
+	}
+
+	sb->size = size;
+}
+
+void MTY_StrBufClear(MTY_StrBuf *sb)
+{
+	sb->len = 0;
+
+	if (sb->size > 0)
+		sb->str[0] = '\0';
+}
+
+void MTY_StrBufAppendLen(MTY_StrBuf *sb, const char *str, size_t len)
+{
+	MTY_StrBufReserve(sb, len);
+
+	memcpy(sb->str + sb->len, str, len);
+	sb->len += len;
+	sb->str[sb->len] = '\0';
+}
+
+void MTY_StrBufAppend(MTY_StrBuf *sb, const char *str)
+{
+	MTY_StrBufAppendLen(sb, str, strlen(str));
+}
+
+void MTY_StrBufAppendChar(MTY_StrBuf *sb, char c)
+{
+	if (sb->len + 1 >= sb->size)
+		MTY_StrBufReserve(sb, 1);
+
+	sb->str[sb->len++] = c;
+	sb->str[sb->len] = '\0';
+}
+
+void MTY_StrBufVprintf(MTY_StrBuf *sb, const char *fmt, va_list args)
+{
+	// Format straight into the spare capacity, only formatting a second time when the
+	// result did not fit
+	size_t avail = sb->size - sb->len;
+
+	va_list args_copy;
+	va_copy(args_copy, args);
+
+	int32_t n = vsnprintf(sb->str + sb->len, avail, fmt, args_copy);
+
+	va_end(args_copy);
+
+	if (n < 0) {
+		MTY_Log("'vsnprintf' failed");
+
+		if (sb->size > 0)
+			sb->str[sb->len] = '\0';
+
+		return;
+	}
+
+	if ((size_t) n >= avail) {
+		MTY_StrBufReserve(sb, n);
+		vsnprintf(sb->str + sb->len, sb->size - sb->len, fmt, args);
+	}
+
+	sb->len += n;
+}
+
+void MTY_StrBufPrintf(MTY_StrBuf *sb, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+
+	MTY_StrBufVprintf(sb, fmt, args);
+
+	va_end(args);
+}
+
+void MTY_StrBufAppendInt(MTY_StrBuf *sb, int64_t value)
+{
+	char tmp[24];
+	char *end = tmp + sizeof(tmp);
+	char *p = end;
+
+	uint64_t u = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+
+	do {
+		*--p = (char) ('0' + u % 10);
+		u /= 10;
+	} while (u > 0);
+
+	if (value < 0)
+		*--p = '-';
+
+	MTY_StrBufAppendLen(sb, p, end - p);
+}
+
+void MTY_StrBufAppendFloat(MTY_StrBuf *sb, double value)
+{
+	char tmp[NUMBER_FORMAT_MAX];
+	size_t len = mty_number_format(value, tmp);
+
+	MTY_StrBufAppendLen(sb, tmp, len);
+}
+
+char *MTY_StrBufMove(MTY_StrBuf *sb)
+{
+	char *str = sb->heap ? sb->str : MTY_Dup(sb->str, sb->len + 1);
+
+	strbuf_reset(sb);
+
+	return str;
+}
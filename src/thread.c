@@ -31,7 +31,7 @@ static MTY_Atomic32 RWLOCK_INIT[UINT8_MAX];
 static uint8_t thread_rwlock_index(void)
 {
 	for (uint8_t x = 0; x < UINT8_MAX; x++)
-		if (MTY_Atomic32CAS(&RWLOCK_INIT[x], 0, 1))
+		if (MTY_Atomic32CompareExchange(&RWLOCK_INIT[x], 0, 1, MTY_ATOMIC_ACQUIRE))
 			return x;
 
 	MTY_LogFatal("Could not find a free rwlock slot, maximum is %u", UINT8_MAX);
@@ -42,7 +42,7 @@ static uint8_t thread_rwlock_index(void)
 static void thread_rwlock_yield(MTY_RWLock *ctx)
 {
 	// Ensure that readers will yield to writers in a tight loop
-	while (MTY_Atomic32Get(&ctx->yield) > 0)
+	while (MTY_Atomic32Load(&ctx->yield, MTY_ATOMIC_RELAXED) > 0)
 		MTY_Sleep(0);
 }
 
@@ -65,7 +65,7 @@ void MTY_RWLockDestroy(MTY_RWLock **rwlock)
 
 	mty_rwlock_destroy(&ctx->rwlock);
 	memset(&RWLOCK_STATE[ctx->index], 0, sizeof(struct thread_rwlock));
-	MTY_Atomic32Set(&RWLOCK_INIT[ctx->index], 0);
+	MTY_Atomic32Store(&RWLOCK_INIT[ctx->index], 0, MTY_ATOMIC_RELEASE);
 
 	MTY_Free(ctx);
 	*rwlock = NULL;
@@ -114,9 +114,9 @@ void MTY_RWLockWriter(MTY_RWLock *ctx)
 	}
 
 	if (rw->taken == 0 || relock) {
-		MTY_Atomic32Add(&ctx->yield, 1);
+		MTY_Atomic32FetchAdd(&ctx->yield, 1, MTY_ATOMIC_RELAXED);
 		mty_rwlock_writer(&ctx->rwlock);
-		MTY_Atomic32Add(&ctx->yield, -1);
+		MTY_Atomic32FetchAdd(&ctx->yield, -1, MTY_ATOMIC_RELAXED);
 		rw->write = true;
 	}
 
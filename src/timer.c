@@ -0,0 +1,538 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+#include <math.h>
+
+// Four levels of 256 slots each, like the classic Linux kernel timer wheel. Level 0
+// holds timers due within 256 ticks, each higher level covers 256 times the range of
+// the one below it and is cascaded down as the wheel turns
+
+#define TIMER_BITS   8
+#define TIMER_SLOTS  (1 << TIMER_BITS)
+#define TIMER_MASK   (TIMER_SLOTS - 1)
+#define TIMER_LEVELS 4
+#define TIMER_RANGE  ((INT64_C(1) << (TIMER_BITS * TIMER_LEVELS)) - 1)
+#define TIMER_NONE   UINT32_MAX
+
+struct timer_node {
+	int64_t expiry;
+	int64_t period;
+	MTY_TimerFunc func;
+	void *opaque;
+
+	uint32_t generation;
+	uint32_t prev;
+	uint32_t next;
+	uint16_t slot;
+	bool active;
+};
+
+struct MTY_TimerWheel {
+	MTY_Mutex *mutex;
+	MTY_Cond *cond;
+	MTY_Thread *thread;
+	bool running;
+
+	MTY_Time start;
+	double resolution;
+	int64_t tick;
+
+	struct timer_node *nodes;
+	uint32_t num_nodes;
+	uint32_t free_head;
+	uint32_t count;
+
+	uint32_t heads[TIMER_LEVELS * TIMER_SLOTS];
+	uint64_t occupied[TIMER_LEVELS][TIMER_SLOTS / 64];
+};
+
+MTY_TimerWheel *MTY_TimerWheelCreate(double resolution)
+{
+	MTY_TimerWheel *ctx = MTY_Alloc(1, sizeof(MTY_TimerWheel));
+
+	// MTY_GetTime has microsecond precision
+	ctx->resolution = resolution < 0.001 ? 0.001 : resolution;
+	ctx->start = MTY_GetTime();
+	ctx->free_head = TIMER_NONE;
+
+	ctx->mutex = MTY_MutexCreate();
+	ctx->cond = MTY_CondCreate();
+
+	for (uint32_t x = 0; x < TIMER_LEVELS * TIMER_SLOTS; x++)
+		ctx->heads[x] = TIMER_NONE;
+
+	return ctx;
+}
+
+void MTY_TimerWheelDestroy(MTY_TimerWheel **wheel)
+{
+	if (!wheel || !*wheel)
+		return;
+
+	MTY_TimerWheel *ctx = *wheel;
+
+	if (ctx->thread) {
+		MTY_MutexLock(ctx->mutex);
+		ctx->running = false;
+		MTY_CondSignal(ctx->cond);
+		MTY_MutexUnlock(ctx->mutex);
+
+		MTY_ThreadDestroy(&ctx->thread);
+	}
+
+	MTY_CondDestroy(&ctx->cond);
+	MTY_MutexDestroy(&ctx->mutex);
+
+	MTY_Free(ctx->nodes);
+	MTY_Free(ctx);
+	*wheel = NULL;
+}
+
+
+// Slots
+
+static int64_t timer_now(MTY_TimerWheel *ctx)
+{
+	return (int64_t) (MTY_TimeDiff(ctx->start, MTY_GetTime()) / ctx->resolution);
+}
+
+static double timer_get_timeout(MTY_TimerWheel *ctx)
+{
+	if (ctx->count == 0)
+		return -1.0;
+
+	int64_t next = INT64_MAX;
+
+	// Level 0 gives exact expiries, higher levels give the tick at which their next
+	// occupied slot is cascaded down, which is never later than the timers in it. The
+	// current slot of a higher level is only still pending if the wheel is sitting
+	// exactly on its boundary
+	for (uint32_t level = 0; level < TIMER_LEVELS; level++) {
+		uint32_t shift = TIMER_BITS * level;
+		uint32_t cur = (ctx->tick >> shift) & TIMER_MASK;
+		bool aligned = (ctx->tick & ((INT64_C(1) << shift) - 1)) == 0;
+
+		for (uint32_t x = aligned ? 0 : 1; x <= TIMER_SLOTS; x++) {
+			uint32_t slot = (cur + x) & TIMER_MASK;
+
+			if (ctx->occupied[level][slot / 64] & (UINT64_C(1) << (slot % 64))) {
+				int64_t tick = level > 0 ? ((ctx->tick >> shift) + x) << shift : ctx->tick + x;
+
+				if (tick < next)
+					next = tick;
+
+				break;
+			}
+		}
+	}
+
+	double r = (double) next * ctx->resolution - MTY_TimeDiff(ctx->start, MTY_GetTime());
+
+	return r > 0.0 ? r : 0.0;
+}
+
+static void timer_link(MTY_TimerWheel *ctx, uint32_t index)
+{
+	struct timer_node *node = &ctx->nodes[index];
+
+	int64_t delta = node->expiry - ctx->tick;
+	int64_t at = node->expiry;
+
+	if (delta < 0) {
+		node->expiry = at = ctx->tick;
+		delta = 0;
+
+	} else if (delta > TIMER_RANGE) {
+		// Timers beyond the range of the wheel are parked at its far end and linked
+		// again with their real expiry when that slot is cascaded
+		at = ctx->tick + TIMER_RANGE;
+		delta = TIMER_RANGE;
+	}
+
+	uint32_t level = 0;
+	while (level < TIMER_LEVELS - 1 && delta >= INT64_C(1) << (TIMER_BITS * (level + 1)))
+		level++;
+
+	uint32_t slot = (at >> (TIMER_BITS * level)) & TIMER_MASK;
+
+	node->slot = (uint16_t) (level * TIMER_SLOTS + slot);
+	node->prev = TIMER_NONE;
+	node->next = ctx->heads[node->slot];
+
+	if (node->next != TIMER_NONE)
+		ctx->nodes[node->next].prev = index;
+
+	ctx->heads[node->slot] = index;
+	ctx->occupied[level][slot / 64] |= UINT64_C(1) << (slot % 64);
+}
+
+static void timer_unlink(MTY_TimerWheel *ctx, uint32_t index)
+{
+	struct timer_node *node = &ctx->nodes[index];
+
+	if (node->prev != TIMER_NONE) {
+		ctx->nodes[node->prev].next = node->next;
+
+	} else {
+		ctx->heads[node->slot] = node->next;
+	}
+
+	if (node->next != TIMER_NONE)
+		ctx->nodes[node->next].prev = node->prev;
+
+	if (ctx->heads[node->slot] == TIMER_NONE) {
+		uint32_t level = node->slot / TIMER_SLOTS;
+		uint32_t slot = node->slot % TIMER_SLOTS;
+
+		ctx->occupied[level][slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+	}
+}
+
+static void timer_free(MTY_TimerWheel *ctx, uint32_t index)
+{
+	struct timer_node *node = &ctx->nodes[index];
+
+	node->active = false;
+	node->generation++;
+	node->next = ctx->free_head;
+
+	ctx->free_head = index;
+	ctx->count--;
+}
+
+static uint32_t timer_cascade(MTY_TimerWheel *ctx, uint32_t level)
+{
+	uint32_t slot = (ctx->tick >> (TIMER_BITS * level)) & TIMER_MASK;
+	uint32_t *head = &ctx->heads[level * TIMER_SLOTS + slot];
+
+	while (*head != TIMER_NONE) {
+		uint32_t index = *head;
+
+		timer_unlink(ctx, index);
+		timer_link(ctx, index);
+	}
+
+	return slot;
+}
+
+static bool timer_slot_range_empty(const uint64_t *bits, uint32_t begin)
+{
+	for (uint32_t x = begin / 64; x < TIMER_SLOTS / 64; x++) {
+		uint64_t mask = x == begin / 64 ? ~UINT64_C(0) << (begin % 64) : ~UINT64_C(0);
+
+		if (bits[x] & mask)
+			return false;
+	}
+
+	return true;
+}
+
+static int64_t timer_ticks(MTY_TimerWheel *ctx, double ms)
+{
+	double ticks = ceil(ms / ctx->resolution);
+
+	return ticks < (double) (INT64_MAX / 2) ? (int64_t) ticks : INT64_MAX / 2;
+}
+
+
+// Public
+
+uint64_t MTY_TimerWheelAdd(MTY_TimerWheel *ctx, double delay, double period,
+	MTY_TimerFunc func, void *opaque)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	if (ctx->free_head == TIMER_NONE) {
+		uint32_t num = ctx->num_nodes > 0 ? ctx->num_nodes * 2 : 64;
+		ctx->nodes = MTY_Realloc(ctx->nodes, num, sizeof(struct timer_node));
+
+		for (uint32_t x = num; x > ctx->num_nodes; x--) {
+			memset(&ctx->nodes[x - 1], 0, sizeof(struct timer_node));
+			ctx->nodes[x - 1].next = ctx->free_head;
+			ctx->free_head = x - 1;
+		}
+
+		ctx->num_nodes = num;
+	}
+
+	uint32_t index = ctx->free_head;
+	struct timer_node *node = &ctx->nodes[index];
+	ctx->free_head = node->next;
+	ctx->count++;
+
+	// Round the deadline up to a whole tick so a timer never fires early
+	double deadline = MTY_TimeDiff(ctx->start, MTY_GetTime()) + (delay > 0.0 ? delay : 0.0);
+
+	node->expiry = timer_ticks(ctx, deadline);
+	node->period = period > 0.0 ? timer_ticks(ctx, period) : 0;
+	node->func = func;
+	node->opaque = opaque;
+	node->active = true;
+
+	timer_link(ctx, index);
+
+	uint64_t id = (uint64_t) node->generation << 32 | (index + 1);
+
+	if (ctx->thread)
+		MTY_CondSignal(ctx->cond);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return id;
+}
+
+bool MTY_TimerWheelCancel(MTY_TimerWheel *ctx, uint64_t id)
+{
+	uint32_t index = (uint32_t) (id & UINT32_MAX) - 1;
+	uint32_t generation = (uint32_t) (id >> 32);
+
+	bool r = false;
+
+	MTY_MutexLock(ctx->mutex);
+
+	if (index < ctx->num_nodes) {
+		struct timer_node *node = &ctx->nodes[index];
+
+		if (node->active && node->generation == generation) {
+			timer_unlink(ctx, index);
+			timer_free(ctx, index);
+			r = true;
+		}
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return r;
+}
+
+uint32_t MTY_TimerWheelAdvance(MTY_TimerWheel *ctx)
+{
+	uint32_t fired = 0;
+
+	MTY_MutexLock(ctx->mutex);
+
+	for (int64_t target = timer_now(ctx); ctx->tick <= target;) {
+		if (ctx->count == 0) {
+			ctx->tick = target + 1;
+			break;
+		}
+
+		uint32_t index = ctx->tick & TIMER_MASK;
+
+		// Pull the next range of timers down from the higher levels at each boundary
+		if (index == 0)
+			for (uint32_t x = 1; x < TIMER_LEVELS && timer_cascade(ctx, x) == 0; x++);
+
+		uint32_t *head = &ctx->heads[index];
+
+		while (*head != TIMER_NONE) {
+			uint32_t n = *head;
+			struct timer_node *node = &ctx->nodes[n];
+
+			MTY_TimerFunc func = node->func;
+			void *opaque = node->opaque;
+			uint64_t id = (uint64_t) node->generation << 32 | (n + 1);
+
+			timer_unlink(ctx, n);
+
+			// Periodic timers stay on their original schedule, but periods missed
+			// while the wheel was not advanced are coalesced into this single call
+			if (node->period > 0) {
+				node->expiry += node->period;
+
+				if (node->expiry <= target)
+					node->expiry += ((target - node->expiry) / node->period + 1) * node->period;
+
+				timer_link(ctx, n);
+
+			} else {
+				timer_free(ctx, n);
+			}
+
+			fired++;
+
+			MTY_MutexUnlock(ctx->mutex);
+			func(id, opaque);
+			MTY_MutexLock(ctx->mutex);
+		}
+
+		// Skip straight to the next level 0 boundary if nothing else is due before it
+		if (timer_slot_range_empty(ctx->occupied[0], index + 1)) {
+			int64_t next = (ctx->tick | TIMER_MASK) + 1;
+			ctx->tick = next <= target ? next : target + 1;
+
+		} else {
+			ctx->tick++;
+		}
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return fired;
+}
+
+double MTY_TimerWheelGetTimeout(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	double r = timer_get_timeout(ctx);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return r;
+}
+
+
+// Dedicated thread
+
+static void *timer_thread(void *opaque)
+{
+	MTY_TimerWheel *ctx = opaque;
+
+	while (true) {
+		MTY_TimerWheelAdvance(ctx);
+
+		MTY_MutexLock(ctx->mutex);
+
+		if (!ctx->running) {
+			MTY_MutexUnlock(ctx->mutex);
+			break;
+		}
+
+		double timeout = timer_get_timeout(ctx);
+
+		// Sub-millisecond timeouts can't be waited on, yield instead
+		if (timeout < 0.0 || timeout >= 1.0) {
+			MTY_CondWait(ctx->cond, ctx->mutex, timeout < 0.0 ? -1 : (int32_t) timeout);
+			MTY_MutexUnlock(ctx->mutex);
+
+		} else {
+			MTY_MutexUnlock(ctx->mutex);
+			MTY_Sleep(0);
+		}
+	}
+
+	return NULL;
+}
+
+void MTY_TimerWheelStart(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	if (!ctx->thread) {
+		ctx->running = true;
+		ctx->thread = MTY_ThreadCreate(timer_thread, ctx);
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+
+// FramePacer
+
+struct MTY_FramePacer {
+	double interval;
+	double spin;
+
+	MTY_Time origin;
+	uint64_t frame;
+	bool started;
+
+	MTY_Time prev;
+	double interval_mean;
+	double interval_m2;
+	uint64_t intervals;
+
+	MTY_FramePacerStats stats;
+};
+
+MTY_FramePacer *MTY_FramePacerCreate(double interval, double spin)
+{
+	MTY_FramePacer *ctx = MTY_Alloc(1, sizeof(MTY_FramePacer));
+	ctx->interval = interval;
+	ctx->spin = spin;
+
+	return ctx;
+}
+
+void MTY_FramePacerDestroy(MTY_FramePacer **pacer)
+{
+	if (!pacer || !*pacer)
+		return;
+
+	MTY_FramePacer *ctx = *pacer;
+
+	MTY_Free(ctx);
+	*pacer = NULL;
+}
+
+double MTY_FramePacerWait(MTY_FramePacer *ctx)
+{
+	if (!ctx->started) {
+		ctx->origin = MTY_GetTime();
+		ctx->prev = ctx->origin;
+		ctx->started = true;
+	}
+
+	// Deadlines are always computed from the origin so errors never accumulate
+	ctx->frame++;
+	double deadline = ctx->frame * ctx->interval;
+	double elapsed = MTY_TimeDiff(ctx->origin, MTY_GetTime());
+
+	// If one or more deadlines have already passed, drop them instead of rushing
+	// through a burst of frames to catch up
+	if (elapsed >= deadline) {
+		uint64_t frame = (uint64_t) (elapsed / ctx->interval) + 1;
+
+		ctx->stats.missed += frame - ctx->frame;
+		ctx->frame = frame;
+		deadline = ctx->frame * ctx->interval;
+	}
+
+	MTY_SleepUntil(ctx->origin, deadline, ctx->spin);
+
+	MTY_Time now = MTY_GetTime();
+	double overshoot = MTY_TimeDiff(ctx->origin, now) - deadline;
+
+	ctx->stats.frames++;
+	ctx->stats.overshootAvg += (overshoot - ctx->stats.overshootAvg) / ctx->stats.frames;
+
+	if (overshoot > ctx->stats.overshootMax)
+		ctx->stats.overshootMax = overshoot;
+
+	// Welford's running variance of the time between consecutive frames
+	double delta = MTY_TimeDiff(ctx->prev, now);
+	ctx->prev = now;
+	ctx->intervals++;
+
+	double d = delta - ctx->interval_mean;
+	ctx->interval_mean += d / ctx->intervals;
+	ctx->interval_m2 += d * (delta - ctx->interval_mean);
+
+	ctx->stats.jitter = ctx->intervals > 1 ? sqrt(ctx->interval_m2 / (ctx->intervals - 1)) : 0.0;
+
+	return overshoot;
+}
+
+void MTY_FramePacerReset(MTY_FramePacer *ctx, double interval)
+{
+	if (interval > 0.0)
+		ctx->interval = interval;
+
+	ctx->started = false;
+	ctx->frame = 0;
+	ctx->interval_mean = 0.0;
+	ctx->interval_m2 = 0.0;
+	ctx->intervals = 0;
+
+	memset(&ctx->stats, 0, sizeof(MTY_FramePacerStats));
+}
+
+void MTY_FramePacerGetStats(MTY_FramePacer *ctx, MTY_FramePacerStats *stats)
+{
+	*stats = ctx->stats;
+}
@@ -8,65 +8,303 @@
 #include <string.h>
 #include <stdio.h>
 
-#define TLOCAL_MAX (8 * 1024)
+#define TLOCAL_MAX   (8 * 1024)
+#define TLOCAL_PAGE  (4 * 1024)
+#define TLOCAL_ALIGN 16
 
-static TLOCAL uint8_t *TLOCAL_MEM;
-static TLOCAL size_t *TLOCAL_OFFSET;
-static TLOCAL size_t TLOCAL_SIZE;
+#define TLOCAL_ALIGN_UP(n, a) (((n) + ((a) - 1)) & ~((size_t) (a) - 1))
 
-static TLOCAL uint8_t TLOCAL_MEM_INTERNAL[TLOCAL_MAX];
-static TLOCAL size_t TLOCAL_OFFSET_INTERNAL;
-static TLOCAL size_t TLOCAL_OFFSET_EXTERNAL;
+#if defined(__has_feature)
+	#if __has_feature(address_sanitizer)
+		#define TLOCAL_ASAN
+	#endif
+#endif
+
+#if defined(__SANITIZE_ADDRESS__) && !defined(TLOCAL_ASAN)
+	#define TLOCAL_ASAN
+#endif
+
+#if defined(TLOCAL_ASAN)
+	#include <sanitizer/asan_interface.h>
+	#define TLOCAL_ASAN_POISON(ptr, size)   ASAN_POISON_MEMORY_REGION(ptr, size)
+	#define TLOCAL_ASAN_UNPOISON(ptr, size) ASAN_UNPOISON_MEMORY_REGION(ptr, size)
+#else
+	#define TLOCAL_ASAN_POISON(ptr, size)   ((void) 0)
+	#define TLOCAL_ASAN_UNPOISON(ptr, size) ((void) 0)
+#endif
+
+// The arena is a ring of chunks. The first chunk lives in static thread local storage
+// so threads that never need more do not touch the heap. Larger allocations and scopes
+// that outgrow the ring add heap chunks, which are kept for reuse.
+
+// Outside of a scope, allocations wrap around the ring and evict the oldest data like a
+// ring buffer. Inside a scope nothing wraps: the scope grows the ring instead, and
+// releasing the scope returns the position to where it was marked.
+
+struct tlocal_chunk {
+	uint8_t *mem;
+	size_t size;
+	size_t top;
+	bool heap;
+	struct tlocal_chunk *next;
+};
+
+static TLOCAL uint8_t TLOCAL_MEM[TLOCAL_MAX];
+static TLOCAL struct tlocal_chunk TLOCAL_BASE;
+static TLOCAL struct tlocal_chunk *TLOCAL_CUR;
+static TLOCAL size_t TLOCAL_OFFSET;
+static TLOCAL uint32_t TLOCAL_DEPTH;
 
 static void tlocal_check_mem(void)
 {
-	if (!TLOCAL_MEM) {
-		TLOCAL_MEM = TLOCAL_MEM_INTERNAL;
-		TLOCAL_OFFSET = &TLOCAL_OFFSET_INTERNAL;
-		TLOCAL_SIZE = TLOCAL_MAX;
+	if (!TLOCAL_CUR) {
+		TLOCAL_BASE.mem = TLOCAL_MEM;
+		TLOCAL_BASE.size = TLOCAL_MAX;
+		TLOCAL_CUR = &TLOCAL_BASE;
 	}
 }
 
-void *mty_tlocal(size_t size)
+static void tlocal_poison(struct tlocal_chunk *chunk, size_t offset, size_t size)
+{
+	if (size == 0)
+		return;
+
+	#if defined(MTY_TLOCAL_DEBUG)
+		if (chunk->heap)
+			TLOCAL_ASAN_UNPOISON(chunk->mem + offset, size);
+
+		memset(chunk->mem + offset, 0xDD, size);
+	#endif
+
+	// Static thread local storage may be reused by the next thread, so only heap chunks
+	// are poisoned for the address sanitizer
+	if (chunk->heap)
+		TLOCAL_ASAN_POISON(chunk->mem + offset, size);
+}
+
+static void tlocal_enter(struct tlocal_chunk *chunk)
+{
+	// Everything left in the chunk from its last use is being evicted
+	tlocal_poison(chunk, 0, chunk->top);
+
+	chunk->top = 0;
+
+	TLOCAL_CUR = chunk;
+	TLOCAL_OFFSET = 0;
+}
+
+static struct tlocal_chunk *tlocal_find(struct tlocal_chunk *begin, struct tlocal_chunk *end,
+	size_t size)
+{
+	for (struct tlocal_chunk *chunk = begin; chunk != end; chunk = chunk->next)
+		if (chunk->size >= size)
+			return chunk;
+
+	return NULL;
+}
+
+static struct tlocal_chunk *tlocal_grow(size_t size)
+{
+	size_t csize = TLOCAL_ALIGN_UP(size, TLOCAL_PAGE);
+	if (csize < TLOCAL_MAX)
+		csize = TLOCAL_MAX;
+
+	struct tlocal_chunk *chunk = MTY_Alloc(1, sizeof(struct tlocal_chunk) + csize);
+	chunk->mem = (uint8_t *) (chunk + 1);
+	chunk->size = csize;
+	chunk->heap = true;
+
+	// New chunks go right after the current one so they are next in the ring
+	chunk->next = TLOCAL_CUR->next;
+	TLOCAL_CUR->next = chunk;
+
+	TLOCAL_ASAN_POISON(chunk->mem, csize);
+
+	return chunk;
+}
+
+static void *tlocal_alloc(size_t size)
 {
 	tlocal_check_mem();
 
-	if (size > TLOCAL_SIZE)
-		MTY_LogFatal("Thread local storage heap overflow");
+	size_t asize = TLOCAL_ALIGN_UP(size > 0 ? size : 1, TLOCAL_ALIGN);
 
-	if (*TLOCAL_OFFSET + size > TLOCAL_SIZE)
-		*TLOCAL_OFFSET = 0;
+	if (TLOCAL_OFFSET + asize > TLOCAL_CUR->size) {
+		// Move forward to the next chunk with enough space. Outside of a scope this may
+		// wrap around to the start of the ring, inside a scope the ring grows instead
+		struct tlocal_chunk *chunk = tlocal_find(TLOCAL_CUR->next, NULL, asize);
 
-	void *ptr = TLOCAL_MEM + *TLOCAL_OFFSET;
-	memset(ptr, 0, size);
+		if (!chunk && TLOCAL_DEPTH == 0)
+			chunk = tlocal_find(&TLOCAL_BASE, TLOCAL_CUR->next, asize);
 
-	*TLOCAL_OFFSET += size;
+		if (!chunk)
+			chunk = tlocal_grow(asize);
+
+		tlocal_enter(chunk);
+	}
+
+	void *ptr = TLOCAL_CUR->mem + TLOCAL_OFFSET;
+	TLOCAL_ASAN_UNPOISON(ptr, size);
+
+	TLOCAL_OFFSET += asize;
+
+	if (TLOCAL_OFFSET > TLOCAL_CUR->top)
+		TLOCAL_CUR->top = TLOCAL_OFFSET;
 
 	return ptr;
 }
 
+void *mty_tlocal(size_t size)
+{
+	void *ptr = tlocal_alloc(size);
+	memset(ptr, 0, size);
+
+	return ptr;
+}
+
+static bool tlocal_fits(size_t size)
+{
+	return TLOCAL_OFFSET + TLOCAL_ALIGN_UP(size > 0 ? size : 1, TLOCAL_ALIGN) <= TLOCAL_CUR->size;
+}
+
 char *mty_tlocal_strcpy(const char *str)
 {
 	tlocal_check_mem();
 
-	size_t len = strlen(str) + 1;
+	size_t size = strlen(str) + 1;
+	char *local = NULL;
+
+	// An allocation that does not fit in the current chunk may move into a chunk that
+	// still holds the source and evict it, so the source is moved to the heap first
+	if (tlocal_fits(size)) {
+		local = tlocal_alloc(size);
+		memcpy(local, str, size);
+
+	} else {
+		char *tmp = MTY_Alloc(size, 1);
+		memcpy(tmp, str, size);
+
+		local = tlocal_alloc(size);
+		memcpy(local, tmp, size);
+
+		MTY_Free(tmp);
+	}
+
+	return local;
+}
+
+char *mty_tlocal_vsprintf(const char *fmt, va_list args)
+{
+	tlocal_check_mem();
+
+	// Format straight into the space left in the current chunk, which is free. When the
+	// string does not fit, the arguments may point into the chunk the allocation moves
+	// to, so the string is formatted a second time on the heap and then copied
+	size_t avail = TLOCAL_CUR->size - TLOCAL_OFFSET;
+	char *ptr = (char *) TLOCAL_CUR->mem + TLOCAL_OFFSET;
+
+	if (TLOCAL_CUR->heap)
+		TLOCAL_ASAN_UNPOISON(ptr, avail);
+
+	va_list args_copy;
+	va_copy(args_copy, args);
 
-	if (len > TLOCAL_SIZE)
-		len = TLOCAL_SIZE;
+	size_t size = vsnprintf(ptr, avail, fmt, args_copy) + 1;
 
-	char *local = mty_tlocal(len);
-	snprintf(local, len, "%s", str);
+	va_end(args_copy);
+
+	if (TLOCAL_CUR->heap)
+		TLOCAL_ASAN_POISON(ptr, avail);
+
+	if (tlocal_fits(size))
+		return tlocal_alloc(size);
+
+	char *tmp = MTY_Alloc(size, 1);
+	vsnprintf(tmp, size, fmt, args);
+
+	char *local = tlocal_alloc(size);
+	memcpy(local, tmp, size);
+
+	MTY_Free(tmp);
 
 	return local;
 }
 
-void mty_tlocal_set_mem(void *buf, size_t size)
+char *mty_tlocal_sprintf(const char *fmt, ...)
 {
-	TLOCAL_MEM = buf;
-	TLOCAL_SIZE = size;
+	va_list args;
+	va_start(args, fmt);
+
+	char *local = mty_tlocal_vsprintf(fmt, args);
 
-	if (buf) {
-		TLOCAL_OFFSET = &TLOCAL_OFFSET_EXTERNAL;
-		*TLOCAL_OFFSET = 0;
+	va_end(args);
+
+	return local;
+}
+
+struct tlocal_mark mty_tlocal_mark(void)
+{
+	tlocal_check_mem();
+
+	struct tlocal_mark mark = {0};
+	mark.chunk = TLOCAL_CUR;
+	mark.offset = TLOCAL_OFFSET;
+
+	TLOCAL_DEPTH++;
+
+	return mark;
+}
+
+void mty_tlocal_release(struct tlocal_mark mark)
+{
+	struct tlocal_chunk *chunk = mark.chunk;
+
+	if (TLOCAL_DEPTH == 0 || !chunk)
+		MTY_LogFatal("Thread local storage scope released without a mark");
+
+	TLOCAL_DEPTH--;
+
+	// Poison everything allocated since the mark. Chunks after the marked one were
+	// entered by the scope, so all of their used space belongs to it
+	if (chunk == TLOCAL_CUR) {
+		tlocal_poison(chunk, mark.offset, TLOCAL_OFFSET - mark.offset);
+
+	} else {
+		tlocal_poison(chunk, mark.offset, chunk->top - mark.offset);
+
+		for (struct tlocal_chunk *c = chunk->next; c; c = c->next) {
+			bool cur = c == TLOCAL_CUR;
+
+			tlocal_poison(c, 0, cur ? TLOCAL_OFFSET : c->top);
+			c->top = 0;
+
+			if (cur)
+				break;
+		}
 	}
+
+	chunk->top = mark.offset;
+
+	TLOCAL_CUR = chunk;
+	TLOCAL_OFFSET = mark.offset;
+}
+
+void mty_tlocal_thread_exit(void)
+{
+	if (!TLOCAL_CUR)
+		return;
+
+	for (struct tlocal_chunk *chunk = TLOCAL_BASE.next; chunk;) {
+		struct tlocal_chunk *next = chunk->next;
+
+		TLOCAL_ASAN_UNPOISON(chunk->mem, chunk->size);
+		MTY_Free(chunk);
+
+		chunk = next;
+	}
+
+	TLOCAL_BASE.next = NULL;
+	TLOCAL_CUR = NULL;
+	TLOCAL_OFFSET = 0;
+	TLOCAL_DEPTH = 0;
 }
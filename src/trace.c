@@ -0,0 +1,354 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+#include "trace.h"
+#include "tlocal.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define TRACE_EVENTS (16 * 1024)
+
+enum trace_type {
+	TRACE_BEGIN,
+	TRACE_END,
+	TRACE_COUNTER,
+	TRACE_FLOW_BEGIN,
+	TRACE_FLOW_STEP,
+	TRACE_FLOW_END,
+};
+
+struct trace_event {
+	uint64_t ts;
+	const char *name;
+
+	union {
+		double value;
+		uint64_t id;
+	};
+
+	uint32_t tid;
+	uint32_t type;
+};
+
+// Each buffer is written by exactly one thread at a time and read by the exporter
+// without locking. The exporter validates what it copied against the count afterwards,
+// discarding anything the writer may have overwritten in the meantime
+
+struct trace_buffer {
+	struct trace_event events[TRACE_EVENTS];
+	MTY_Atomic64 count;
+	MTY_Atomic32 session;
+	MTY_Atomic32 owned;
+	struct trace_buffer *next;
+};
+
+static MTY_Atomic32 TRACE_GLOCK;
+static MTY_Atomic32 TRACE_ENABLED;
+static MTY_Atomic32 TRACE_SESSION;
+static MTY_Atomic32 TRACE_TIDS;
+static struct trace_buffer *TRACE_BUFFERS;
+static MTY_Hash *TRACE_NAMES;
+static uint64_t TRACE_ORIGIN;
+
+static TLOCAL struct trace_buffer *TRACE_BUF;
+static TLOCAL uint32_t TRACE_TID;
+
+
+// Recording
+
+static uint32_t trace_get_tid(void)
+{
+	if (TRACE_TID == 0)
+		TRACE_TID = MTY_Atomic32FetchAdd(&TRACE_TIDS, 1, MTY_ATOMIC_RELAXED) + 1;
+
+	return TRACE_TID;
+}
+
+static struct trace_buffer *trace_get_buffer(void)
+{
+	if (TRACE_BUF)
+		return TRACE_BUF;
+
+	MTY_GlobalLock(&TRACE_GLOCK);
+
+	// Buffers are never freed, a buffer released by an exited thread is reused as is
+	// so its events remain available until they are overwritten
+	for (struct trace_buffer *buf = TRACE_BUFFERS; buf && !TRACE_BUF; buf = buf->next)
+		if (!MTY_Atomic32Load(&buf->owned, MTY_ATOMIC_ACQUIRE))
+			TRACE_BUF = buf;
+
+	if (!TRACE_BUF) {
+		TRACE_BUF = MTY_Alloc(1, sizeof(struct trace_buffer));
+		TRACE_BUF->next = TRACE_BUFFERS;
+		TRACE_BUFFERS = TRACE_BUF;
+	}
+
+	MTY_Atomic32Store(&TRACE_BUF->owned, 1, MTY_ATOMIC_RELAXED);
+
+	MTY_GlobalUnlock(&TRACE_GLOCK);
+
+	return TRACE_BUF;
+}
+
+static void trace_push(uint32_t type, const char *name, double value, uint64_t id)
+{
+	if (!MTY_Atomic32Load(&TRACE_ENABLED, MTY_ATOMIC_RELAXED))
+		return;
+
+	uint64_t ts = MTY_GetTicks();
+	uint32_t tid = trace_get_tid();
+	struct trace_buffer *buf = trace_get_buffer();
+
+	int32_t session = MTY_Atomic32Load(&TRACE_SESSION, MTY_ATOMIC_ACQUIRE);
+
+	if (MTY_Atomic32Load(&buf->session, MTY_ATOMIC_RELAXED) != session) {
+		MTY_Atomic64Store(&buf->count, 0, MTY_ATOMIC_RELAXED);
+		MTY_Atomic32Store(&buf->session, session, MTY_ATOMIC_RELEASE);
+	}
+
+	int64_t n = MTY_Atomic64Load(&buf->count, MTY_ATOMIC_RELAXED);
+
+	struct trace_event *evt = &buf->events[n & (TRACE_EVENTS - 1)];
+	evt->ts = ts;
+	evt->name = name;
+	evt->tid = tid;
+	evt->type = type;
+
+	if (type == TRACE_COUNTER) {
+		evt->value = value;
+
+	} else {
+		evt->id = id;
+	}
+
+	MTY_Atomic64Store(&buf->count, n + 1, MTY_ATOMIC_RELEASE);
+}
+
+void mty_trace_thread_exit(void)
+{
+	if (TRACE_BUF) {
+		MTY_Atomic32Store(&TRACE_BUF->owned, 0, MTY_ATOMIC_RELEASE);
+		TRACE_BUF = NULL;
+	}
+}
+
+void MTY_TraceStart(void)
+{
+	MTY_GlobalLock(&TRACE_GLOCK);
+
+	TRACE_ORIGIN = MTY_GetTicks();
+	MTY_Atomic32FetchAdd(&TRACE_SESSION, 1, MTY_ATOMIC_RELEASE);
+	MTY_Atomic32Store(&TRACE_ENABLED, 1, MTY_ATOMIC_RELEASE);
+
+	MTY_GlobalUnlock(&TRACE_GLOCK);
+}
+
+void MTY_TraceStop(void)
+{
+	MTY_Atomic32Store(&TRACE_ENABLED, 0, MTY_ATOMIC_RELEASE);
+}
+
+bool MTY_TraceIsActive(void)
+{
+	return MTY_Atomic32Load(&TRACE_ENABLED, MTY_ATOMIC_RELAXED);
+}
+
+void MTY_TraceBegin(const char *name)
+{
+	trace_push(TRACE_BEGIN, name, 0, 0);
+}
+
+void MTY_TraceEnd(void)
+{
+	trace_push(TRACE_END, NULL, 0, 0);
+}
+
+void MTY_TraceCounter(const char *name, double value)
+{
+	trace_push(TRACE_COUNTER, name, value, 0);
+}
+
+void MTY_TraceFlowBegin(const char *name, uint64_t id)
+{
+	trace_push(TRACE_FLOW_BEGIN, name, 0, id);
+}
+
+void MTY_TraceFlowStep(const char *name, uint64_t id)
+{
+	trace_push(TRACE_FLOW_STEP, name, 0, id);
+}
+
+void MTY_TraceFlowEnd(const char *name, uint64_t id)
+{
+	trace_push(TRACE_FLOW_END, name, 0, id);
+}
+
+void MTY_TraceSetThreadName(const char *name)
+{
+	uint32_t tid = trace_get_tid();
+
+	MTY_GlobalLock(&TRACE_GLOCK);
+
+	if (!TRACE_NAMES)
+		TRACE_NAMES = MTY_HashCreate(0);
+
+	MTY_Free(MTY_HashSetInt(TRACE_NAMES, tid, MTY_Strdup(name)));
+
+	MTY_GlobalUnlock(&TRACE_GLOCK);
+}
+
+
+// Export
+
+static size_t trace_copy_buffer(struct trace_buffer *buf, int32_t session,
+	struct trace_event **events, size_t *size, size_t n)
+{
+	if (MTY_Atomic32Load(&buf->session, MTY_ATOMIC_ACQUIRE) != session)
+		return n;
+
+	int64_t end = MTY_Atomic64Load(&buf->count, MTY_ATOMIC_ACQUIRE);
+	int64_t begin = end > TRACE_EVENTS ? end - TRACE_EVENTS : 0;
+
+	if (n + (size_t) (end - begin) > *size) {
+		*size = n + (size_t) (end - begin);
+		*events = MTY_Realloc(*events, *size, sizeof(struct trace_event));
+	}
+
+	for (int64_t x = begin; x < end; x++)
+		(*events)[n + (size_t) (x - begin)] = buf->events[x & (TRACE_EVENTS - 1)];
+
+	// A read-modify-write with release semantics keeps the copies above from being
+	// reordered after the count is checked again
+	int64_t check = MTY_Atomic64FetchAdd(&buf->count, 0, MTY_ATOMIC_ACQ_REL);
+
+	if (check < end || MTY_Atomic32Load(&buf->session, MTY_ATOMIC_ACQUIRE) != session)
+		return n;
+
+	// The writer may have been in the middle of event `check` when the copy was made
+	int64_t valid = check + 1 - TRACE_EVENTS;
+
+	if (valid > begin) {
+		if (valid >= end)
+			return n;
+
+		memmove(*events + n, *events + n + (size_t) (valid - begin),
+			(size_t) (end - valid) * sizeof(struct trace_event));
+
+		begin = valid;
+	}
+
+	return n + (size_t) (end - begin);
+}
+
+static double trace_us(uint64_t ts)
+{
+	if (ts >= TRACE_ORIGIN)
+		return (double) MTY_TicksToNS(ts - TRACE_ORIGIN) / 1000.0;
+
+	return -((double) MTY_TicksToNS(TRACE_ORIGIN - ts) / 1000.0);
+}
+
+static MTY_JSON *trace_event_json(const struct trace_event *evt)
+{
+	static const char *PH[] = {
+		[TRACE_BEGIN]      = "B",
+		[TRACE_END]        = "E",
+		[TRACE_COUNTER]    = "C",
+		[TRACE_FLOW_BEGIN] = "s",
+		[TRACE_FLOW_STEP]  = "t",
+		[TRACE_FLOW_END]   = "f",
+	};
+
+	MTY_JSON *j = MTY_JSONObjCreate();
+
+	if (evt->name)
+		MTY_JSONObjSetString(j, "name", evt->name);
+
+	MTY_JSONObjSetString(j, "ph", PH[evt->type]);
+	MTY_JSONObjSetNumber(j, "ts", trace_us(evt->ts));
+	MTY_JSONObjSetInt(j, "pid", 1);
+	MTY_JSONObjSetNumber(j, "tid", evt->tid);
+
+	switch (evt->type) {
+		case TRACE_COUNTER: {
+			MTY_JSON *args = MTY_JSONObjCreate();
+			MTY_JSONObjSetNumber(args, "value", evt->value);
+			MTY_JSONObjSetItem(j, "args", args);
+			break;
+		}
+		case TRACE_FLOW_END:
+			MTY_JSONObjSetString(j, "bp", "e");
+			// fall through
+		case TRACE_FLOW_BEGIN:
+		case TRACE_FLOW_STEP: {
+			char id[32];
+			snprintf(id, 32, "0x%" PRIx64, evt->id);
+
+			MTY_JSONObjSetString(j, "cat", "flow");
+			MTY_JSONObjSetString(j, "id", id);
+			break;
+		}
+	}
+
+	return j;
+}
+
+static MTY_JSON *trace_name_json(int64_t tid, const char *name)
+{
+	MTY_JSON *j = MTY_JSONObjCreate();
+	MTY_JSONObjSetString(j, "name", "thread_name");
+	MTY_JSONObjSetString(j, "ph", "M");
+	MTY_JSONObjSetInt(j, "pid", 1);
+	MTY_JSONObjSetNumber(j, "tid", (double) tid);
+
+	MTY_JSON *args = MTY_JSONObjCreate();
+	MTY_JSONObjSetString(args, "name", name);
+	MTY_JSONObjSetItem(j, "args", args);
+
+	return j;
+}
+
+MTY_JSON *MTY_TraceExport(void)
+{
+	MTY_GlobalLock(&TRACE_GLOCK);
+
+	int32_t session = MTY_Atomic32Load(&TRACE_SESSION, MTY_ATOMIC_ACQUIRE);
+
+	struct trace_event *events = NULL;
+	size_t size = 0;
+	size_t n = 0;
+
+	for (struct trace_buffer *buf = TRACE_BUFFERS; buf; buf = buf->next)
+		n = trace_copy_buffer(buf, session, &events, &size, n);
+
+	uint32_t num_names = 0;
+	uint64_t iter = 0;
+	int64_t tid = 0;
+
+	while (TRACE_NAMES && MTY_HashGetNextKeyInt(TRACE_NAMES, &iter, &tid))
+		num_names++;
+
+	MTY_JSON *list = MTY_JSONArrayCreate(num_names + (uint32_t) n);
+
+	iter = 0;
+
+	for (uint32_t x = 0; x < num_names && MTY_HashGetNextKeyInt(TRACE_NAMES, &iter, &tid); x++)
+		MTY_JSONArraySetItem(list, x, trace_name_json(tid, MTY_HashGetInt(TRACE_NAMES, tid)));
+
+	for (size_t x = 0; x < n; x++)
+		MTY_JSONArraySetItem(list, num_names + (uint32_t) x, trace_event_json(&events[x]));
+
+	MTY_GlobalUnlock(&TRACE_GLOCK);
+
+	MTY_Free(events);
+
+	MTY_JSON *root = MTY_JSONObjCreate();
+	MTY_JSONObjSetItem(root, "traceEvents", list);
+	MTY_JSONObjSetString(root, "displayTimeUnit", "ms");
+
+	return root;
+}
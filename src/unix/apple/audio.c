@@ -3,6 +3,7 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "metrics.h"
 
 #include <AudioToolbox/AudioToolbox.h>
 
@@ -132,8 +133,12 @@ uint32_t MTY_AudioGetQueued(MTY_Audio *ctx)
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 {
+	MTY_TRACE_BEGIN("MTY_AudioQueue");
+
 	size_t size = count * ctx->channels * AUDIO_SAMPLE_SIZE;
 	uint32_t queued = audio_get_queued_frames(ctx);
+	MTY_TRACE_COUNTER("Audio Queued Frames", queued);
+	mty_metrics_record("mty.audio.queued_ms", (uint64_t) queued * 1000 / ctx->sample_rate);
 
 	// Stop playing and flush if we've exceeded the maximum buffer or underrun
 	if (ctx->playing && (queued > ctx->max_buffer || queued == 0))
@@ -163,4 +168,6 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 		if (!ctx->playing && queued + count >= ctx->min_buffer)
 			audio_play(ctx);
 	}
+
+	MTY_TRACE_END();
 }
@@ -48,10 +48,14 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 		dispatch_semaphore_signal(semaphore);
 	}];
 
+	MTY_TRACE_BEGIN("MTY_HttpRequest");
+
 	[task resume];
 
 	dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, timeout * NSEC_PER_MSEC));
 
+	MTY_TRACE_END();
+
 	[session invalidateAndCancel];
 
 	return r;
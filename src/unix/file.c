@@ -203,12 +203,14 @@ static int32_t file_compare(const void *p1, const void *p2)
 
 MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 {
-	void *tmp = MTY_Alloc(0x1000, 1);
-	mty_tlocal_set_mem(tmp, 0x1000);
+	struct tlocal_mark mark = mty_tlocal_mark();
 
 	MTY_FileList *fl = MTY_Alloc(1, sizeof(MTY_FileList));
 	char *pathd = MTY_Strdup(path);
 
+	MTY_Vec files;
+	MTY_VecInit(&files, sizeof(MTY_FileDesc));
+
 	bool ok = false;
 
 	struct dirent *ent = NULL;
@@ -224,19 +226,17 @@ MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 			(ent->d_type == DT_UNKNOWN && (!strcmp(name, "..") || !strcmp(name, ".")));
 
 		if (is_dir || MTY_StrSearch(name, filter ? filter : "", "|")) {
-			fl->files = MTY_Realloc(fl->files, fl->len + 1, sizeof(MTY_FileDesc));
+			MTY_FileDesc *desc = MTY_VecPush(&files);
 
 			char *jpath = MTY_Strdup(MTY_JoinPath(pathd, name));
 
-			fl->files[fl->len].dir = is_dir;
-			fl->files[fl->len].name = MTY_Strdup(name);
-			fl->files[fl->len].path = jpath;
+			desc->dir = is_dir;
+			desc->name = MTY_Strdup(name);
+			desc->path = jpath;
 
 			struct stat st;
 			if (!is_dir && stat(jpath, &st) == 0)
-				fl->files[fl->len].size = st.st_size;
-
-			fl->len++;
+				desc->size = st.st_size;
 		}
 
 		ent = readdir(dir);
@@ -248,11 +248,16 @@ MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 
 	MTY_Free(pathd);
 
+	MTY_VecShrink(&files);
+
+	size_t len = 0;
+	fl->files = MTY_VecMove(&files, &len);
+	fl->len = (uint32_t) len;
+
 	if (fl->len > 0)
 		MTY_Sort(fl->files, fl->len, sizeof(MTY_FileDesc), file_compare);
 
-	mty_tlocal_set_mem(NULL, 0);
-	MTY_Free(tmp);
+	mty_tlocal_release(mark);
 
 	return fl;
 }
@@ -12,7 +12,7 @@
 
 #define FSUTIL_DELIM '/'
 
-static FILE *fsutil_open(const char *path, const char *mode)
+static inline FILE *fsutil_open(const char *path, const char *mode)
 {
 	FILE *f = fopen(path, mode);
 	if (!f) {
@@ -23,7 +23,7 @@ static FILE *fsutil_open(const char *path, const char *mode)
 	return f;
 }
 
-static size_t fsutil_size(const char *path)
+static inline size_t fsutil_size(const char *path)
 {
 	struct stat st;
 	int32_t e = stat(path, &st);
@@ -10,6 +10,8 @@
 
 #include <aaudio/AAudio.h>
 
+#include "metrics.h"
+
 #define AUDIO_SAMPLE_SIZE sizeof(int16_t)
 
 #define AUDIO_BUF_SIZE(ctx) \
@@ -140,6 +142,8 @@ static void audio_start(MTY_Audio *ctx)
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 {
+	MTY_TRACE_BEGIN("MTY_AudioQueue");
+
 	size_t data_size = count * ctx->channels * AUDIO_SAMPLE_SIZE;
 
 	audio_start(ctx);
@@ -162,5 +166,12 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 	if (ctx->size >= ctx->min_buffer)
 		ctx->playing = true;
 
+	uint32_t queued = (uint32_t) (ctx->size / (ctx->channels * AUDIO_SAMPLE_SIZE));
+
 	MTY_MutexUnlock(ctx->mutex);
+
+	MTY_TRACE_COUNTER("Audio Queued Frames", queued);
+	mty_metrics_record("mty.audio.queued_ms", (uint64_t) queued * 1000 / ctx->sample_rate);
+
+	MTY_TRACE_END();
 }
@@ -0,0 +1,148 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _DEFAULT_SOURCE // syscall
+
+#include "matoya.h"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PERF_MAX 4
+
+static const struct {
+	MTY_PerfCounter counter;
+	uint64_t config;
+} PERF_EVENTS[PERF_MAX] = {
+	{MTY_PERF_COUNTER_CYCLES,        PERF_COUNT_HW_CPU_CYCLES},
+	{MTY_PERF_COUNTER_INSTRUCTIONS,  PERF_COUNT_HW_INSTRUCTIONS},
+	{MTY_PERF_COUNTER_CACHE_MISSES,  PERF_COUNT_HW_CACHE_MISSES},
+	{MTY_PERF_COUNTER_BRANCH_MISSES, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+struct MTY_PerfCounters {
+	int32_t fds[PERF_MAX];
+	MTY_PerfCounter counters[PERF_MAX];
+	uint32_t num;
+	uint32_t available;
+};
+
+static int32_t perf_open(uint64_t config, int32_t group)
+{
+	struct perf_event_attr attr = {0};
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(struct perf_event_attr);
+	attr.config = config;
+	attr.disabled = group == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+		PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+MTY_PerfCounters *MTY_PerfCountersCreate(void)
+{
+	MTY_PerfCounters *ctx = MTY_Alloc(1, sizeof(MTY_PerfCounters));
+
+	int32_t error = 0;
+
+	// All counters are opened as one group led by the first that succeeds so they are
+	// scheduled onto the PMU together and cover exactly the same instructions
+	for (uint32_t x = 0; x < PERF_MAX; x++) {
+		int32_t fd = perf_open(PERF_EVENTS[x].config, ctx->num > 0 ? ctx->fds[0] : -1);
+
+		if (fd == -1) {
+			error = errno;
+			continue;
+		}
+
+		ctx->fds[ctx->num] = fd;
+		ctx->counters[ctx->num] = PERF_EVENTS[x].counter;
+		ctx->available |= PERF_EVENTS[x].counter;
+		ctx->num++;
+	}
+
+	if (ctx->num == 0)
+		MTY_Log("'perf_event_open' failed with errno %d", error);
+
+	return ctx;
+}
+
+void MTY_PerfCountersDestroy(MTY_PerfCounters **counters)
+{
+	if (!counters || !*counters)
+		return;
+
+	MTY_PerfCounters *ctx = *counters;
+
+	for (uint32_t x = 0; x < ctx->num; x++)
+		close(ctx->fds[x]);
+
+	MTY_Free(ctx);
+	*counters = NULL;
+}
+
+uint32_t MTY_PerfCountersGetAvailable(MTY_PerfCounters *ctx)
+{
+	return ctx->available;
+}
+
+void MTY_PerfCountersBegin(MTY_PerfCounters *ctx)
+{
+	if (ctx->num == 0)
+		return;
+
+	ioctl(ctx->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(ctx->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void MTY_PerfCountersEnd(MTY_PerfCounters *ctx, MTY_PerfCounterValues *values)
+{
+	memset(values, 0, sizeof(MTY_PerfCounterValues));
+
+	if (ctx->num == 0)
+		return;
+
+	ioctl(ctx->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+	// nr, time_enabled, time_running, then one value per counter in the group
+	uint64_t buf[3 + PERF_MAX] = {0};
+
+	ssize_t n = read(ctx->fds[0], buf, sizeof(buf));
+	if (n < (ssize_t) (3 * sizeof(uint64_t)) || buf[0] != ctx->num) {
+		MTY_Log("'read' failed with errno %d", errno);
+		return;
+	}
+
+	double scale = buf[2] > 0 && buf[2] < buf[1] ? (double) buf[1] / (double) buf[2] : 1.0;
+
+	for (uint32_t x = 0; x < ctx->num; x++) {
+		uint64_t value = scale == 1.0 ? buf[3 + x] : (uint64_t) ((double) buf[3 + x] * scale);
+
+		switch (ctx->counters[x]) {
+			case MTY_PERF_COUNTER_CYCLES:
+				values->cycles = value;
+				break;
+			case MTY_PERF_COUNTER_INSTRUCTIONS:
+				values->instructions = value;
+				break;
+			case MTY_PERF_COUNTER_CACHE_MISSES:
+				values->cacheMisses = value;
+				break;
+			case MTY_PERF_COUNTER_BRANCH_MISSES:
+				values->branchMisses = value;
+				break;
+		}
+	}
+
+	// A group that was never scheduled counted nothing
+	if (buf[2] > 0)
+		values->available = ctx->available;
+}
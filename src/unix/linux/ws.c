@@ -47,8 +47,7 @@ struct http_pair {
 
 struct http_header {
 	char *first_line;
-	struct http_pair *pairs;
-	uint32_t npairs;
+	MTY_Vec pairs;
 };
 
 #define HTTP_HEADER_MAX (16 * 1024)
@@ -56,6 +55,8 @@ struct http_header {
 static struct http_header *http_parse_header(const char *header)
 {
 	struct http_header *h = MTY_Alloc(1, sizeof(struct http_header));
+	MTY_VecInit(&h->pairs, sizeof(struct http_pair));
+
 	char *dup = MTY_Strdup(header);
 
 	// HTTP header lines are delimited by "\r\n"
@@ -73,23 +74,22 @@ static struct http_header *http_parse_header(const char *header)
 			char *delim = strpbrk(line, ": ");
 
 			if (delim) {
-				h->pairs = MTY_Realloc(h->pairs, h->npairs + 1, sizeof(struct http_pair));
+				struct http_pair *pair = MTY_VecPush(&h->pairs);
 
 				// Place a null character to separate the line
 				char save = delim[0];
 				delim[0] = '\0';
 
 				// Save the key and remove the null character
-				h->pairs[h->npairs].key = MTY_Strdup(line);
+				pair->key = MTY_Strdup(line);
 				delim[0] = save;
 
 				// Advance the val past whitespace or the : character
 				while (*delim && (*delim == ':' || *delim == ' '))
 					delim++;
 
-				// Store the val and increment npairs
-				h->pairs[h->npairs].val = MTY_Strdup(delim);
-				h->npairs++;
+				// Store the val
+				pair->val = MTY_Strdup(delim);
 			}
 		}
 
@@ -108,13 +108,15 @@ static void http_header_destroy(struct http_header **header)
 
 	struct http_header *h = *header;
 
-	for (uint32_t x = 0; x < h->npairs; x++) {
-		MTY_Free(h->pairs[x].key);
-		MTY_Free(h->pairs[x].val);
+	struct http_pair *pairs = h->pairs.data;
+
+	for (size_t x = 0; x < h->pairs.len; x++) {
+		MTY_Free(pairs[x].key);
+		MTY_Free(pairs[x].val);
 	}
 
 	MTY_Free(h->first_line);
-	MTY_Free(h->pairs);
+	MTY_VecFree(&h->pairs);
 
 	MTY_Free(h);
 	*header = NULL;
@@ -149,9 +151,11 @@ static bool http_get_status_code(struct http_header *h, uint16_t *status_code)
 
 static bool http_get_header_str(struct http_header *h, const char *key, const char **val)
 {
-	for (uint32_t x = 0; x < h->npairs; x++) {
-		if (!MTY_Strcasecmp(key, h->pairs[x].key)) {
-			*val = h->pairs[x].val;
+	struct http_pair *pairs = h->pairs.data;
+
+	for (size_t x = 0; x < h->pairs.len; x++) {
+		if (!MTY_Strcasecmp(key, pairs[x].key)) {
+			*val = pairs[x].val;
 			return true;
 		}
 	}
@@ -159,13 +163,9 @@ static bool http_get_header_str(struct http_header *h, const char *key, const ch
 	return false;
 }
 
-static void http_set_header_str(char **header, const char *name, const char *val)
+static void http_set_header_str(MTY_StrBuf *header, const char *name, const char *val)
 {
-	size_t len = *header ? strlen(*header) : 0;
-	size_t new_len = len + strlen(name) + strlen(val) + 32;
-
-	*header = MTY_Realloc(*header, new_len, 1);
-	snprintf(*header + len, new_len, "%s: %s\r\n", name, val);
+	MTY_StrBufPrintf(header, "%s: %s\r\n", name, val);
 }
 
 static struct http_header *http_read_header(struct net *net, uint32_t timeout)
@@ -240,10 +240,14 @@ static bool http_write_request_header(struct net *net, const char *url, const ch
 	if (!headers)
 		headers = "";
 
-	char *hstr = MTY_SprintfD("%s /%s HTTP/1.1\r\nHost: %s\r\n%s\r\n", method, path, host, headers);
-	bool r = mty_net_write(net, hstr, strlen(hstr));
+	char stack[1024];
+	MTY_StrBuf hstr;
+	MTY_StrBufInit(&hstr, stack, sizeof(stack));
+	MTY_StrBufPrintf(&hstr, "%s /%s HTTP/1.1\r\nHost: %s\r\n%s\r\n", method, path, host, headers);
 
-	MTY_Free(hstr);
+	bool r = mty_net_write(net, hstr.str, hstr.len);
+
+	MTY_StrBufFree(&hstr);
 	MTY_Free(path);
 	MTY_Free(host);
 
@@ -275,13 +279,16 @@ static void ws_mask(const uint8_t *in, size_t size, const uint8_t *mask, uint8_t
 
 static void ws_parse_headers(const char *key, const char *val, void *opaque)
 {
-	http_set_header_str((char **) opaque, key, val);
+	http_set_header_str(opaque, key, val);
 }
 
 static bool ws_connect(MTY_WebSocket *ctx, const char *url, const char *headers,
 	uint32_t timeout, uint16_t *upgrade_status)
 {
-	char *req = NULL;
+	char stack[512];
+	MTY_StrBuf req;
+	MTY_StrBufInit(&req, stack, sizeof(stack));
+
 	struct http_header *hdr = NULL;
 
 	// Generate the random base64 key
@@ -302,7 +309,7 @@ static bool ws_connect(MTY_WebSocket *ctx, const char *url, const char *headers,
 		mty_http_parse_headers(headers, ws_parse_headers, &req);
 
 	// Write http the header
-	bool r = http_write_request_header(ctx->net, url, "GET", req);
+	bool r = http_write_request_header(ctx->net, url, "GET", req.str);
 	if (!r)
 		goto except;
 
@@ -339,7 +346,7 @@ static bool ws_connect(MTY_WebSocket *ctx, const char *url, const char *headers,
 	except:
 
 	http_header_destroy(&hdr);
-	MTY_Free(req);
+	MTY_StrBufFree(&req);
 
 	return r;
 }
@@ -507,8 +514,14 @@ MTY_Async MTY_WebSocketRead(MTY_WebSocket *ctx, uint32_t timeout, char *msg, siz
 		uint8_t opcode = WS_OPCODE_CONTINUE;
 		memset(msg, 0, size);
 
+		MTY_TRACE_BEGIN("MTY_WebSocketRead");
+
 		size_t read = 0;
-		if (!ws_read(ctx, msg, size - 1, &opcode, 1000, &read))
+		bool ok = ws_read(ctx, msg, size - 1, &opcode, 1000, &read);
+
+		MTY_TRACE_END();
+
+		if (!ok)
 			return MTY_ASYNC_ERROR;
 
 		switch (opcode) {
@@ -544,7 +557,13 @@ MTY_Async MTY_WebSocketRead(MTY_WebSocket *ctx, uint32_t timeout, char *msg, siz
 
 bool MTY_WebSocketWrite(MTY_WebSocket *ctx, const char *msg)
 {
-	return ws_write(ctx, msg, strlen(msg), WS_OPCODE_TEXT);
+	MTY_TRACE_BEGIN("MTY_WebSocketWrite");
+
+	bool r = ws_write(ctx, msg, strlen(msg), WS_OPCODE_TEXT);
+
+	MTY_TRACE_END();
+
+	return r;
 }
 
 uint16_t MTY_WebSocketGetCloseCode(MTY_WebSocket *ctx)
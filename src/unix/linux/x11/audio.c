@@ -8,6 +8,7 @@
 #include <math.h>
 
 #include "dl/libasound.h"
+#include "metrics.h"
 
 #define AUDIO_SAMPLE_SIZE sizeof(int16_t)
 
@@ -126,9 +127,13 @@ uint32_t MTY_AudioGetQueued(MTY_Audio *ctx)
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 {
+	MTY_TRACE_BEGIN("MTY_AudioQueue");
+
 	size_t size = count * ctx->channels * AUDIO_SAMPLE_SIZE;
 
 	uint32_t queued = audio_get_queued_frames(ctx);
+	MTY_TRACE_COUNTER("Audio Queued Frames", queued);
+	mty_metrics_record("mty.audio.queued_ms", (uint64_t) queued * 1000 / ctx->sample_rate);
 
 	// Stop playing and flush if we've exceeded the maximum buffer or underrun
 	if (ctx->playing && (queued > ctx->max_buffer || queued == 0))
@@ -153,4 +158,6 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 			MTY_AudioReset(ctx);
 		}
 	}
+
+	MTY_TRACE_END();
 }
@@ -21,6 +21,7 @@
 
 #define CURLINFO_LONG   0x200000
 #define CURLINFO_SOCKET 0x500000
+#define CURLINFO_OFF_T  0x600000
 
 #define CURL_GLOBAL_SSL   0x1
 #define CURL_GLOBAL_WIN32 0x2
@@ -53,6 +54,7 @@ typedef enum {
 typedef enum {
 	CURLINFO_RESPONSE_CODE = CURLINFO_LONG + 2,
 	CURLINFO_ACTIVESOCKET  = CURLINFO_SOCKET + 44,
+	CURLINFO_STARTTRANSFER_TIME_T = CURLINFO_OFF_T + 54,
 } CURLINFO;
 
 enum {
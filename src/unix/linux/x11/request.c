@@ -8,6 +8,7 @@
 
 #include "net.h"
 #include "http.h"
+#include "metrics.h"
 #include "net-common.h"
 
 struct request_parse_args {
@@ -15,11 +16,6 @@ struct request_parse_args {
 	bool ua_found;
 };
 
-struct request_response {
-	uint8_t *data;
-	size_t size;
-};
-
 static void request_parse_headers(const char *key, const char *val, void *opaque)
 {
 	struct request_parse_args *pargs = opaque;
@@ -33,13 +29,8 @@ static void request_parse_headers(const char *key, const char *val, void *opaque
 static size_t request_write_func(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
 	size_t realsize = size * nmemb;
-	struct request_response *res = userdata;
-
-	res->data = MTY_Realloc(res->data, res->size + realsize + 1, 1);
 
-	memcpy(res->data + res->size, ptr, realsize);
-	res->size += realsize;
-	res->data[res->size] = 0;
+	MTY_VecAppend(userdata, ptr, realsize);
 
 	return realsize;
 }
@@ -62,7 +53,9 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 
 	bool r = true;
 	struct curl_slist *slist = NULL;
-	struct request_response res = {0};
+
+	MTY_Vec res;
+	MTY_VecInit(&res, 1);
 
 	// No signals
 	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
@@ -110,7 +103,12 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, request_write_func);
 	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &res);
 
+	MTY_TRACE_BEGIN("MTY_HttpRequest");
+
 	CURLcode e = curl_easy_perform(curl);
+
+	MTY_TRACE_END();
+
 	if (e != CURLE_OK) {
 		MTY_Log("'curl_easy_perform' failed with error %d", e);
 		r = false;
@@ -128,9 +126,18 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 
 	*status = code;
 
-	if (res.size > 0) {
-		*responseSize = res.size;
-		*response = res.data;
+	// Time to first byte in microseconds
+	int64_t ttfb = 0;
+	if (curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &ttfb) == CURLE_OK)
+		mty_metrics_record("mty.http.ttfb_us", ttfb);
+
+	if (res.len > 0) {
+		// Keep null character at the end of the buffer for protection
+		*responseSize = res.len;
+		MTY_VecPush(&res);
+		MTY_VecShrink(&res);
+
+		*response = MTY_VecMove(&res, NULL);
 	}
 
 	except:
@@ -138,8 +145,7 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 	if (slist)
 		curl_slist_free_all(slist);
 
-	if (!r)
-		MTY_Free(res.data);
+	MTY_VecFree(&res);
 
 	curl_easy_cleanup(curl);
 
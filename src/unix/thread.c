@@ -5,11 +5,14 @@
 #define _DEFAULT_SOURCE // clock_gettime
 
 #include "matoya.h"
+#include "trace.h"
+#include "tlocal.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
 
 #include <pthread.h>
 
@@ -30,6 +33,9 @@ static void *thread_func(void *opaque)
 
 	ctx->ret = ctx->func(ctx->opaque);
 
+	mty_trace_thread_exit();
+	mty_tlocal_thread_exit();
+
 	if (ctx->detach)
 		MTY_Free(ctx);
 
@@ -99,6 +105,17 @@ int64_t MTY_ThreadGetID(MTY_Thread *ctx)
 	return (int64_t) (ctx ? ctx->thread : pthread_self());
 }
 
+uint32_t MTY_GetCPUCount(void)
+{
+	#if defined(_SC_NPROCESSORS_ONLN)
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		return n > 0 ? (uint32_t) n : 1;
+	#else
+		return 1;
+	#endif
+}
+
 
 // Mutex
 
@@ -289,3 +306,131 @@ bool MTY_Atomic64CAS(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue)
 	return __atomic_compare_exchange_n(&atomic->value, &oldValue, newValue, false,
 		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
 }
+
+// Atomics with explicit ordering, the GCC builtins require the order to be a
+// constant to avoid falling back to a full barrier
+
+#define ATOMIC_LOAD(ptr, order) \
+	((order) == MTY_ATOMIC_RELAXED ? __atomic_load_n(ptr, __ATOMIC_RELAXED) : \
+	((order) == MTY_ATOMIC_ACQUIRE || (order) == MTY_ATOMIC_ACQ_REL) ? __atomic_load_n(ptr, __ATOMIC_ACQUIRE) : \
+	__atomic_load_n(ptr, __ATOMIC_SEQ_CST))
+
+#define ATOMIC_STORE(ptr, value, order) \
+	if ((order) == MTY_ATOMIC_RELAXED) { \
+		__atomic_store_n(ptr, value, __ATOMIC_RELAXED); \
+	} else if ((order) == MTY_ATOMIC_RELEASE || (order) == MTY_ATOMIC_ACQ_REL) { \
+		__atomic_store_n(ptr, value, __ATOMIC_RELEASE); \
+	} else { \
+		__atomic_store_n(ptr, value, __ATOMIC_SEQ_CST); \
+	}
+
+#define ATOMIC_RMW(func, ptr, value, order) \
+	((order) == MTY_ATOMIC_RELAXED ? func(ptr, value, __ATOMIC_RELAXED) : \
+	(order) == MTY_ATOMIC_ACQUIRE ? func(ptr, value, __ATOMIC_ACQUIRE) : \
+	(order) == MTY_ATOMIC_RELEASE ? func(ptr, value, __ATOMIC_RELEASE) : \
+	(order) == MTY_ATOMIC_ACQ_REL ? func(ptr, value, __ATOMIC_ACQ_REL) : \
+	func(ptr, value, __ATOMIC_SEQ_CST))
+
+#define ATOMIC_CAS(ptr, expected, value, order) \
+	((order) == MTY_ATOMIC_RELAXED ? \
+		__atomic_compare_exchange_n(ptr, expected, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) : \
+	(order) == MTY_ATOMIC_ACQUIRE ? \
+		__atomic_compare_exchange_n(ptr, expected, value, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE) : \
+	(order) == MTY_ATOMIC_RELEASE ? \
+		__atomic_compare_exchange_n(ptr, expected, value, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED) : \
+	(order) == MTY_ATOMIC_ACQ_REL ? \
+		__atomic_compare_exchange_n(ptr, expected, value, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) : \
+	__atomic_compare_exchange_n(ptr, expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+
+int32_t MTY_Atomic32Load(MTY_Atomic32 *atomic, MTY_AtomicOrder order)
+{
+	return ATOMIC_LOAD(&atomic->value, order);
+}
+
+int64_t MTY_Atomic64Load(MTY_Atomic64 *atomic, MTY_AtomicOrder order)
+{
+	return ATOMIC_LOAD(&atomic->value, order);
+}
+
+void MTY_Atomic32Store(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	ATOMIC_STORE(&atomic->value, value, order);
+}
+
+void MTY_Atomic64Store(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	ATOMIC_STORE(&atomic->value, value, order);
+}
+
+int32_t MTY_Atomic32FetchAdd(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_fetch_add, &atomic->value, value, order);
+}
+
+int64_t MTY_Atomic64FetchAdd(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_fetch_add, &atomic->value, value, order);
+}
+
+int32_t MTY_Atomic32FetchOr(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_fetch_or, &atomic->value, value, order);
+}
+
+int64_t MTY_Atomic64FetchOr(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_fetch_or, &atomic->value, value, order);
+}
+
+int32_t MTY_Atomic32FetchAnd(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_fetch_and, &atomic->value, value, order);
+}
+
+int64_t MTY_Atomic64FetchAnd(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_fetch_and, &atomic->value, value, order);
+}
+
+int32_t MTY_Atomic32Exchange(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_exchange_n, &atomic->value, value, order);
+}
+
+int64_t MTY_Atomic64Exchange(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_exchange_n, &atomic->value, value, order);
+}
+
+bool MTY_Atomic32CompareExchange(MTY_Atomic32 *atomic, int32_t oldValue, int32_t newValue,
+	MTY_AtomicOrder order)
+{
+	return ATOMIC_CAS(&atomic->value, &oldValue, newValue, order);
+}
+
+bool MTY_Atomic64CompareExchange(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue,
+	MTY_AtomicOrder order)
+{
+	return ATOMIC_CAS(&atomic->value, &oldValue, newValue, order);
+}
+
+void *MTY_AtomicPtrLoad(MTY_AtomicPtr *atomic, MTY_AtomicOrder order)
+{
+	return ATOMIC_LOAD(&atomic->value, order);
+}
+
+void MTY_AtomicPtrStore(MTY_AtomicPtr *atomic, void *value, MTY_AtomicOrder order)
+{
+	ATOMIC_STORE(&atomic->value, value, order);
+}
+
+void *MTY_AtomicPtrExchange(MTY_AtomicPtr *atomic, void *value, MTY_AtomicOrder order)
+{
+	return ATOMIC_RMW(__atomic_exchange_n, &atomic->value, value, order);
+}
+
+bool MTY_AtomicPtrCompareExchange(MTY_AtomicPtr *atomic, void *oldValue, void *newValue,
+	MTY_AtomicOrder order)
+{
+	return ATOMIC_CAS(&atomic->value, &oldValue, newValue, order);
+}
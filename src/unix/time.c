@@ -2,17 +2,37 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
-#define _DEFAULT_SOURCE  // CLOCK_MONOTONIC_RAW, clock_gettime, struct timespec, nanosleep
+#define _DEFAULT_SOURCE  // CLOCK_MONOTONIC_RAW, clock_gettime, clock_nanosleep, struct timespec, nanosleep
 
 #include "matoya.h"
 
 #include <time.h>
 #include <errno.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+	#include <cpuid.h>
+	#include <x86intrin.h>
+#endif
+
+#include "tlocal.h"
+
+// Running estimate of how late the OS wakes a thread up after a sleep, and of its
+// variation, used to decide how early to wake up and spin for the remainder
+static TLOCAL double TIME_WAKE_LATENCY = 0.1;
+static TLOCAL double TIME_WAKE_DEVIATION = 0.05;
+
+// clock_nanosleep only accepts CLOCK_MONOTONIC deadlines, so MTY_Time must come from
+// the same clock for MTY_SleepUntil to hand it an absolute deadline directly
+#if defined(__APPLE__)
+	#define TIME_CLOCK CLOCK_MONOTONIC_RAW
+#else
+	#define TIME_CLOCK CLOCK_MONOTONIC
+#endif
+
 MTY_Time MTY_GetTime(void)
 {
 	struct timespec ts = {0};
-	if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0)
+	if (clock_gettime(TIME_CLOCK, &ts) != 0)
 		MTY_Log("'clock_gettime' failed with errno %d", errno);
 
 	// XXX time_t can be 32 bits and multiplying it by 1000000
@@ -28,6 +48,125 @@ double MTY_TimeDiff(MTY_Time begin, MTY_Time end)
 	return (end - begin) / 1000.0;
 }
 
+
+// Ticks
+
+static MTY_Atomic32 TIME_GLOCK;
+static MTY_Atomic32 TIME_TICKS_INIT;
+static bool TIME_COUNTER;
+static uint64_t TIME_NS_MULT;
+
+static uint64_t time_monotonic_ns(void)
+{
+	struct timespec ts = {0};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+static uint64_t time_read_counter(void)
+{
+	if (TIME_COUNTER) {
+		#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+		#elif defined(__aarch64__)
+			uint64_t cnt = 0;
+			__asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (cnt));
+
+			return cnt;
+		#endif
+	}
+
+	return time_monotonic_ns();
+}
+
+static uint64_t time_counter_frequency(void)
+{
+	#if defined(__x86_64__) || defined(__i386__)
+		uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+
+		// An invariant TSC runs at a constant rate across P/C-states and is synchronized
+		// across cores, otherwise it can't be used as a clock. Hypervisors often hide it
+		if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8)))
+			return 0;
+
+		// The nominal TSC frequency is reported directly by newer processors
+		if (__get_cpuid_max(0, NULL) >= 0x15) {
+			__cpuid(0x15, eax, ebx, ecx, edx);
+
+			if (eax != 0 && ebx != 0 && ecx != 0)
+				return (uint64_t) ecx * ebx / eax;
+		}
+
+		// Otherwise calibrate against CLOCK_MONOTONIC
+		uint64_t ns0 = time_monotonic_ns();
+		uint64_t tsc0 = __rdtsc();
+
+		MTY_Sleep(10);
+
+		uint64_t ns1 = time_monotonic_ns();
+		uint64_t tsc1 = __rdtsc();
+
+		return (uint64_t) ((double) (tsc1 - tsc0) * 1e9 / (double) (ns1 - ns0));
+
+	#elif defined(__aarch64__)
+		uint64_t freq = 0;
+		__asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (freq));
+
+		return freq;
+
+	#else
+		return 0;
+	#endif
+}
+
+static void time_ticks_init(void)
+{
+	MTY_GlobalLock(&TIME_GLOCK);
+
+	if (!MTY_Atomic32Load(&TIME_TICKS_INIT, MTY_ATOMIC_RELAXED)) {
+		uint64_t freq = time_counter_frequency();
+		TIME_COUNTER = freq > 0;
+
+		// Fall back to CLOCK_MONOTONIC which is served by the vDSO, ticks are nanoseconds
+		if (!TIME_COUNTER)
+			freq = 1000 * 1000 * 1000;
+
+		// Nanoseconds per tick as 32.32 fixed point
+		TIME_NS_MULT = (UINT64_C(1000000000) << 32) / freq;
+
+		MTY_Atomic32Store(&TIME_TICKS_INIT, 1, MTY_ATOMIC_RELEASE);
+	}
+
+	MTY_GlobalUnlock(&TIME_GLOCK);
+}
+
+uint64_t MTY_GetTicks(void)
+{
+	if (!MTY_Atomic32Load(&TIME_TICKS_INIT, MTY_ATOMIC_ACQUIRE))
+		time_ticks_init();
+
+	return time_read_counter();
+}
+
+uint64_t MTY_TicksToNS(uint64_t ticks)
+{
+	if (!MTY_Atomic32Load(&TIME_TICKS_INIT, MTY_ATOMIC_ACQUIRE))
+		time_ticks_init();
+
+	// (ticks * mult) >> 32 without a 128-bit type, this can't overflow as long as the
+	// result fits in 64 bits
+	uint64_t t0 = ticks & UINT32_MAX, t1 = ticks >> 32;
+	uint64_t m0 = TIME_NS_MULT & UINT32_MAX, m1 = TIME_NS_MULT >> 32;
+
+	return ((t1 * m1) << 32) + t1 * m0 + t0 * m1 + ((t0 * m0) >> 32);
+}
+
+uint64_t MTY_GetTimeNS(void)
+{
+	return MTY_TicksToNS(MTY_GetTicks());
+}
+
 void MTY_Sleep(uint32_t timeout)
 {
 	struct timespec ts = {0};
@@ -38,16 +177,58 @@ void MTY_Sleep(uint32_t timeout)
 		MTY_Log("'nanosleep' failed with errno %d", errno);
 }
 
-void MTY_PreciseSleep(double timeout, double spin)
+static void time_sleep_abs(MTY_Time deadline)
+{
+	#if defined(__APPLE__)
+		MTY_Time now = MTY_GetTime();
+
+		if (deadline > now) {
+			struct timespec ts = {0};
+			ts.tv_sec = (deadline - now) / (1000 * 1000);
+			ts.tv_nsec = (deadline - now) % (1000 * 1000) * 1000;
+
+			while (nanosleep(&ts, &ts) != 0 && errno == EINTR);
+		}
+	#else
+		struct timespec wake = {0};
+		wake.tv_sec = deadline / (1000 * 1000);
+		wake.tv_nsec = deadline % (1000 * 1000) * 1000;
+
+		int32_t e = 0;
+		while ((e = clock_nanosleep(TIME_CLOCK, TIMER_ABSTIME, &wake, NULL)) == EINTR);
+
+		if (e != 0)
+			MTY_Log("'clock_nanosleep' failed with error %d", e);
+	#endif
+
+	double late = MTY_TimeDiff(deadline, MTY_GetTime());
+	if (late < 0.0)
+		late = 0.0;
+
+	double err = late - TIME_WAKE_LATENCY;
+	TIME_WAKE_LATENCY += err / 8.0;
+	TIME_WAKE_DEVIATION += ((err < 0.0 ? -err : err) - TIME_WAKE_DEVIATION) / 4.0;
+}
+
+void MTY_SleepUntil(MTY_Time base, double offset, double spin)
 {
-	// Inspired by https://blog.bearcats.nl/accurate-sleep-function/
+	double remaining = offset - MTY_TimeDiff(base, MTY_GetTime());
 
-	MTY_Time start = MTY_GetTime();
+	// Wake up early enough to cover the expected scheduling delay, bounded by how
+	// much spinning the caller is willing to pay for
+	double margin = TIME_WAKE_LATENCY + 4.0 * TIME_WAKE_DEVIATION;
+	if (margin > spin)
+		margin = spin;
 
-	for (double ep = 0.0; ep < timeout - spin; ep = MTY_TimeDiff(start, MTY_GetTime()))
-		MTY_Sleep(1);
+	if (remaining > margin)
+		time_sleep_abs(base + (MTY_Time) ((offset - margin) * 1000.0));
 
-	while (MTY_TimeDiff(start, MTY_GetTime()) < timeout);
+	while (MTY_TimeDiff(base, MTY_GetTime()) < offset);
+}
+
+void MTY_PreciseSleep(double timeout, double spin)
+{
+	MTY_SleepUntil(MTY_GetTime(), timeout, spin);
 }
 
 void MTY_SetTimerResolution(uint32_t res)
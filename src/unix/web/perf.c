@@ -0,0 +1,37 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+// No hardware counters are exposed to user mode, MTY_PerfCounters is an empty handle
+
+MTY_PerfCounters *MTY_PerfCountersCreate(void)
+{
+	return MTY_Alloc(1, 1);
+}
+
+void MTY_PerfCountersDestroy(MTY_PerfCounters **counters)
+{
+	if (!counters || !*counters)
+		return;
+
+	MTY_Free(*counters);
+	*counters = NULL;
+}
+
+uint32_t MTY_PerfCountersGetAvailable(MTY_PerfCounters *ctx)
+{
+	return 0;
+}
+
+void MTY_PerfCountersBegin(MTY_PerfCounters *ctx)
+{
+}
+
+void MTY_PerfCountersEnd(MTY_PerfCounters *ctx, MTY_PerfCounterValues *values)
+{
+	memset(values, 0, sizeof(MTY_PerfCounterValues));
+}
@@ -0,0 +1,123 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+#define VEC_MIN_CAPACITY 4
+
+static void vec_set_capacity(MTY_Vec *vec, size_t capacity)
+{
+	if (vec->size > 0 && capacity > SIZE_MAX / vec->size)
+		MTY_LogFatal("Capacity of %zu elements of size %zu overflows", capacity, vec->size);
+
+	vec->data = MTY_Realloc(vec->data, capacity, vec->size);
+	vec->capacity = capacity;
+}
+
+static void vec_grow(MTY_Vec *vec, size_t len)
+{
+	if (len <= vec->capacity)
+		return;
+
+	// Doubling keeps the total cost of copies during growth linear in the final length
+	size_t capacity = vec->capacity > 0 ? vec->capacity : VEC_MIN_CAPACITY;
+
+	while (capacity < len)
+		capacity = capacity > SIZE_MAX / 2 ? len : capacity * 2;
+
+	vec_set_capacity(vec, capacity);
+}
+
+void MTY_VecInit(MTY_Vec *vec, size_t size)
+{
+	memset(vec, 0, sizeof(MTY_Vec));
+	vec->size = size;
+}
+
+void MTY_VecFree(MTY_Vec *vec)
+{
+	if (!vec)
+		return;
+
+	MTY_Free(vec->data);
+
+	vec->data = NULL;
+	vec->len = 0;
+	vec->capacity = 0;
+}
+
+void MTY_VecReserve(MTY_Vec *vec, size_t capacity)
+{
+	if (capacity > vec->capacity)
+		vec_set_capacity(vec, capacity);
+}
+
+void MTY_VecShrink(MTY_Vec *vec)
+{
+	if (vec->len == vec->capacity)
+		return;
+
+	if (vec->len == 0) {
+		MTY_VecFree(vec);
+
+	} else {
+		vec_set_capacity(vec, vec->len);
+	}
+}
+
+void MTY_VecResize(MTY_Vec *vec, size_t len)
+{
+	vec_grow(vec, len);
+
+	if (len > vec->len)
+		memset((uint8_t *) vec->data + vec->len * vec->size, 0, (len - vec->len) * vec->size);
+
+	vec->len = len;
+}
+
+void *MTY_VecPush(MTY_Vec *vec)
+{
+	vec_grow(vec, vec->len + 1);
+
+	void *element = (uint8_t *) vec->data + vec->len * vec->size;
+	memset(element, 0, vec->size);
+
+	vec->len++;
+
+	return element;
+}
+
+void *MTY_VecAppend(MTY_Vec *vec, const void *elements, size_t len)
+{
+	vec_grow(vec, vec->len + len);
+
+	void *dst = (uint8_t *) vec->data + vec->len * vec->size;
+
+	if (elements) {
+		memcpy(dst, elements, len * vec->size);
+
+	} else {
+		memset(dst, 0, len * vec->size);
+	}
+
+	vec->len += len;
+
+	return dst;
+}
+
+void *MTY_VecMove(MTY_Vec *vec, size_t *len)
+{
+	void *data = vec->data;
+
+	if (len)
+		*len = vec->len;
+
+	vec->data = NULL;
+	vec->len = 0;
+	vec->capacity = 0;
+
+	return data;
+}
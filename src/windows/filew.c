@@ -234,12 +234,14 @@ static int32_t file_compare(const void *p1, const void *p2)
 
 MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 {
-	void *tmp = MTY_Alloc(0x1000, 1);
-	mty_tlocal_set_mem(tmp, 0x1000);
+	struct tlocal_mark mark = mty_tlocal_mark();
 
 	MTY_FileList *fl = MTY_Alloc(1, sizeof(MTY_FileList));
 	char *pathd = MTY_Strdup(path);
 
+	MTY_Vec files;
+	MTY_VecInit(&files, sizeof(MTY_FileDesc));
+
 	WIN32_FIND_DATA ent;
 	const wchar_t *pathw = MTY_MultiToWideDL(MTY_JoinPath(pathd, "*"));
 
@@ -253,13 +255,12 @@ MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 		bool is_dir = ent.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
 
 		if (is_dir || MTY_StrSearch(name, filter ? filter : "", "|")) {
-			fl->files = MTY_Realloc(fl->files, fl->len + 1, sizeof(MTY_FileDesc));
+			MTY_FileDesc *desc = MTY_VecPush(&files);
 
-			fl->files[fl->len].name = name;
-			fl->files[fl->len].path = MTY_Strdup(MTY_JoinPath(pathd, name));
-			fl->files[fl->len].dir = is_dir;
-			fl->files[fl->len].size = (uint64_t) ent.nFileSizeHigh << 32 | ent.nFileSizeLow;
-			fl->len++;
+			desc->name = name;
+			desc->path = MTY_Strdup(MTY_JoinPath(pathd, name));
+			desc->dir = is_dir;
+			desc->size = (uint64_t) ent.nFileSizeHigh << 32 | ent.nFileSizeLow;
 
 		} else {
 			MTY_Free(name);
@@ -273,11 +274,16 @@ MTY_FileList *MTY_GetFileList(const char *path, const char *filter)
 
 	MTY_Free(pathd);
 
+	MTY_VecShrink(&files);
+
+	size_t len = 0;
+	fl->files = MTY_VecMove(&files, &len);
+	fl->len = (uint32_t) len;
+
 	if (fl->len > 0)
 		MTY_Sort(fl->files, fl->len, sizeof(MTY_FileDesc), file_compare);
 
-	mty_tlocal_set_mem(NULL, 0);
-	MTY_Free(tmp);
+	mty_tlocal_release(mark);
 
 	return fl;
 }
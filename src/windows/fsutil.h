@@ -11,7 +11,7 @@
 
 #define FSUTIL_DELIM '\\'
 
-static FILE *fsutil_open(const char *path, const char *mode)
+static inline FILE *fsutil_open(const char *path, const char *mode)
 {
 	wchar_t *wpath = MTY_MultiToWideD(path);
 	wchar_t *wmode = MTY_MultiToWideD(mode);
@@ -30,7 +30,7 @@ static FILE *fsutil_open(const char *path, const char *mode)
 	return f;
 }
 
-static size_t fsutil_size(const char *path)
+static inline size_t fsutil_size(const char *path)
 {
 	wchar_t *wpath = MTY_MultiToWideD(path);
 
@@ -0,0 +1,56 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+#include <windows.h>
+
+// Hardware counters other than cycles require a kernel driver on Windows, the thread
+// cycle time is maintained by the scheduler from the TSC
+
+struct MTY_PerfCounters {
+	HANDLE thread;
+	ULONG64 cycles;
+};
+
+MTY_PerfCounters *MTY_PerfCountersCreate(void)
+{
+	MTY_PerfCounters *ctx = MTY_Alloc(1, sizeof(MTY_PerfCounters));
+	ctx->thread = GetCurrentThread();
+
+	return ctx;
+}
+
+void MTY_PerfCountersDestroy(MTY_PerfCounters **counters)
+{
+	if (!counters || !*counters)
+		return;
+
+	MTY_PerfCounters *ctx = *counters;
+
+	MTY_Free(ctx);
+	*counters = NULL;
+}
+
+uint32_t MTY_PerfCountersGetAvailable(MTY_PerfCounters *ctx)
+{
+	return MTY_PERF_COUNTER_CYCLES;
+}
+
+void MTY_PerfCountersBegin(MTY_PerfCounters *ctx)
+{
+	QueryThreadCycleTime(ctx->thread, &ctx->cycles);
+}
+
+void MTY_PerfCountersEnd(MTY_PerfCounters *ctx, MTY_PerfCounterValues *values)
+{
+	ULONG64 cycles = 0;
+	QueryThreadCycleTime(ctx->thread, &cycles);
+
+	memset(values, 0, sizeof(MTY_PerfCounterValues));
+	values->available = MTY_PERF_COUNTER_CYCLES;
+	values->cycles = cycles - ctx->cycles;
+}
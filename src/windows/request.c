@@ -8,6 +8,7 @@
 #include <stdio.h>
 
 #include "net-common.h"
+#include "metrics.h"
 
 bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 	const void *body, size_t bodySize, const char *proxy, uint32_t timeout,
@@ -20,6 +21,13 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 	HINTERNET connect = NULL;
 	HINTERNET request = NULL;
 
+	MTY_Vec res;
+	MTY_VecInit(&res, 1);
+
+	MTY_TRACE_BEGIN("MTY_HttpRequest");
+
+	uint64_t ts = MTY_GetTicks();
+
 	// Parse URL
 	bool r = net_connect(url, method, headers, body, bodySize, NULL, proxy, timeout, NULL, false,
 		&session, &connect, &request);
@@ -33,6 +41,8 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 	if (!r)
 		goto except;
 
+	mty_metrics_record("mty.http.ttfb_us", MTY_TicksToNS(MTY_GetTicks() - ts) / 1000);
+
 	// Status code query
 	r = net_get_status_code(request, status);
 	if (!r)
@@ -49,26 +59,34 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 			break;
 
 		// Overflow protection
-		if (available > MTY_RES_MAX || *responseSize + available > MTY_RES_MAX) {
+		if (available > MTY_RES_MAX || res.len + available > MTY_RES_MAX) {
 			r = false;
 			goto except;
 		}
 
-		*response = MTY_Realloc(*response, *responseSize + available + 1, 1);
+		uint8_t *dst = MTY_VecAppend(&res, NULL, available);
 
 		DWORD read = 0;
-		r = WinHttpReadData(request, (uint8_t *) *response + *responseSize, available, &read);
+		r = WinHttpReadData(request, dst, available, &read);
 		if (!r)
 			goto except;
 
-		*responseSize += read;
+		MTY_VecResize(&res, res.len - available + read);
+	}
 
+	if (res.len > 0) {
 		// Keep null character at the end of the buffer for protection
-		memset((uint8_t *) *response + *responseSize, 0, 1);
+		*responseSize = res.len;
+		MTY_VecPush(&res);
+		MTY_VecShrink(&res);
+
+		*response = MTY_VecMove(&res, NULL);
 	}
 
 	except:
 
+	MTY_TRACE_END();
+
 	if (request)
 		WinHttpCloseHandle(request);
 
@@ -78,6 +96,8 @@ bool MTY_HttpRequest(const char *url, const char *method, const char *headers,
 	if (session)
 		WinHttpCloseHandle(session);
 
+	MTY_VecFree(&res);
+
 	if (!r) {
 		MTY_Free(*response);
 		*responseSize = 0;
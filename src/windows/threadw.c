@@ -3,6 +3,8 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "trace.h"
+#include "tlocal.h"
 
 #include <stdlib.h>
 
@@ -25,6 +27,9 @@ static DWORD WINAPI thread_func(LPVOID *lpParameter)
 
 	ctx->ret = ctx->func(ctx->opaque);
 
+	mty_trace_thread_exit();
+	mty_tlocal_thread_exit();
+
 	if (ctx->detach)
 		MTY_Free(ctx);
 
@@ -94,6 +99,13 @@ int64_t MTY_ThreadGetID(MTY_Thread *ctx)
 	return ctx ? GetThreadId(ctx->thread) : GetCurrentThreadId();
 }
 
+uint32_t MTY_GetCPUCount(void)
+{
+	DWORD n = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+
+	return n > 0 ? n : 1;
+}
+
 
 // Mutex
 
@@ -238,3 +250,138 @@ bool MTY_Atomic64CAS(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue)
 {
 	return InterlockedCompareExchange64(&atomic->value, newValue, oldValue) == oldValue;
 }
+
+// Atomics with explicit ordering, Interlocked read-modify-write operations are
+// always full barriers which is free on x86/x64
+
+int32_t MTY_Atomic32Load(MTY_Atomic32 *atomic, MTY_AtomicOrder order)
+{
+	switch (order) {
+		case MTY_ATOMIC_RELAXED: return ReadNoFence((volatile LONG *) &atomic->value);
+		case MTY_ATOMIC_ACQUIRE:
+		case MTY_ATOMIC_ACQ_REL: return ReadAcquire((volatile LONG *) &atomic->value);
+		default:
+			return MTY_Atomic32Get(atomic);
+	}
+}
+
+int64_t MTY_Atomic64Load(MTY_Atomic64 *atomic, MTY_AtomicOrder order)
+{
+	switch (order) {
+		case MTY_ATOMIC_RELAXED: return ReadNoFence64(&atomic->value);
+		case MTY_ATOMIC_ACQUIRE:
+		case MTY_ATOMIC_ACQ_REL: return ReadAcquire64(&atomic->value);
+		default:
+			return MTY_Atomic64Get(atomic);
+	}
+}
+
+void MTY_Atomic32Store(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	switch (order) {
+		case MTY_ATOMIC_RELAXED: WriteNoFence((volatile LONG *) &atomic->value, value); break;
+		case MTY_ATOMIC_RELEASE:
+		case MTY_ATOMIC_ACQ_REL: WriteRelease((volatile LONG *) &atomic->value, value); break;
+		default:
+			MTY_Atomic32Set(atomic, value);
+			break;
+	}
+}
+
+void MTY_Atomic64Store(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	switch (order) {
+		case MTY_ATOMIC_RELAXED: WriteNoFence64(&atomic->value, value); break;
+		case MTY_ATOMIC_RELEASE:
+		case MTY_ATOMIC_ACQ_REL: WriteRelease64(&atomic->value, value); break;
+		default:
+			MTY_Atomic64Set(atomic, value);
+			break;
+	}
+}
+
+int32_t MTY_Atomic32FetchAdd(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return InterlockedExchangeAdd((volatile LONG *) &atomic->value, value);
+}
+
+int64_t MTY_Atomic64FetchAdd(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return InterlockedExchangeAdd64(&atomic->value, value);
+}
+
+int32_t MTY_Atomic32FetchOr(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return InterlockedOr((volatile LONG *) &atomic->value, value);
+}
+
+int64_t MTY_Atomic64FetchOr(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return InterlockedOr64(&atomic->value, value);
+}
+
+int32_t MTY_Atomic32FetchAnd(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return InterlockedAnd((volatile LONG *) &atomic->value, value);
+}
+
+int64_t MTY_Atomic64FetchAnd(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return InterlockedAnd64(&atomic->value, value);
+}
+
+int32_t MTY_Atomic32Exchange(MTY_Atomic32 *atomic, int32_t value, MTY_AtomicOrder order)
+{
+	return InterlockedExchange((volatile LONG *) &atomic->value, value);
+}
+
+int64_t MTY_Atomic64Exchange(MTY_Atomic64 *atomic, int64_t value, MTY_AtomicOrder order)
+{
+	return InterlockedExchange64(&atomic->value, value);
+}
+
+bool MTY_Atomic32CompareExchange(MTY_Atomic32 *atomic, int32_t oldValue, int32_t newValue,
+	MTY_AtomicOrder order)
+{
+	return MTY_Atomic32CAS(atomic, oldValue, newValue);
+}
+
+bool MTY_Atomic64CompareExchange(MTY_Atomic64 *atomic, int64_t oldValue, int64_t newValue,
+	MTY_AtomicOrder order)
+{
+	return MTY_Atomic64CAS(atomic, oldValue, newValue);
+}
+
+void *MTY_AtomicPtrLoad(MTY_AtomicPtr *atomic, MTY_AtomicOrder order)
+{
+	switch (order) {
+		case MTY_ATOMIC_RELAXED: return ReadPointerNoFence((PVOID volatile *) &atomic->value);
+		case MTY_ATOMIC_ACQUIRE:
+		case MTY_ATOMIC_ACQ_REL: return ReadPointerAcquire((PVOID volatile *) &atomic->value);
+		default:
+			return InterlockedCompareExchangePointer((PVOID volatile *) &atomic->value, NULL, NULL);
+	}
+}
+
+void MTY_AtomicPtrStore(MTY_AtomicPtr *atomic, void *value, MTY_AtomicOrder order)
+{
+	switch (order) {
+		case MTY_ATOMIC_RELAXED: WritePointerNoFence((PVOID volatile *) &atomic->value, value); break;
+		case MTY_ATOMIC_RELEASE:
+		case MTY_ATOMIC_ACQ_REL: WritePointerRelease((PVOID volatile *) &atomic->value, value); break;
+		default:
+			InterlockedExchangePointer((PVOID volatile *) &atomic->value, value);
+			break;
+	}
+}
+
+void *MTY_AtomicPtrExchange(MTY_AtomicPtr *atomic, void *value, MTY_AtomicOrder order)
+{
+	return InterlockedExchangePointer((PVOID volatile *) &atomic->value, value);
+}
+
+bool MTY_AtomicPtrCompareExchange(MTY_AtomicPtr *atomic, void *oldValue, void *newValue,
+	MTY_AtomicOrder order)
+{
+	return InterlockedCompareExchangePointer((PVOID volatile *) &atomic->value, newValue, oldValue) == oldValue;
+}
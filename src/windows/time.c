@@ -9,9 +9,18 @@
 
 #include "tlocal.h"
 
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+	#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 static TLOCAL bool TIME_FREQ_INIT;
 static TLOCAL double TIME_FREQUENCY;
 
+// Running estimate of how late the OS wakes a thread up after a sleep, and of its
+// variation, used to decide how early to wake up and spin for the remainder
+static TLOCAL double TIME_WAKE_LATENCY = 0.5;
+static TLOCAL double TIME_WAKE_DEVIATION = 0.25;
+
 MTY_Time MTY_GetTime(void)
 {
 	LARGE_INTEGER ts;
@@ -32,6 +41,49 @@ double MTY_TimeDiff(MTY_Time begin, MTY_Time end)
 	return (end - begin) / TIME_FREQUENCY;
 }
 
+
+
+// Ticks
+
+static MTY_Atomic32 TIME_TICKS_INIT;
+static uint64_t TIME_NS_MULT;
+
+uint64_t MTY_GetTicks(void)
+{
+	LARGE_INTEGER ts;
+	QueryPerformanceCounter(&ts);
+
+	return ts.QuadPart;
+}
+
+uint64_t MTY_TicksToNS(uint64_t ticks)
+{
+	// Racing threads all compute the same value
+	if (!MTY_Atomic32Load(&TIME_TICKS_INIT, MTY_ATOMIC_ACQUIRE)) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+
+		// Nanoseconds per tick as 32.32 fixed point
+		TIME_NS_MULT = (UINT64_C(1000000000) << 32) / frequency.QuadPart;
+		MTY_Atomic32Store(&TIME_TICKS_INIT, 1, MTY_ATOMIC_RELEASE);
+	}
+
+	// (ticks * mult) >> 32 without a 128-bit type, this can't overflow as long as the
+	// result fits in 64 bits
+	uint64_t t0 = ticks & UINT32_MAX, t1 = ticks >> 32;
+	uint64_t m0 = TIME_NS_MULT & UINT32_MAX, m1 = TIME_NS_MULT >> 32;
+
+	return ((t1 * m1) << 32) + t1 * m0 + t0 * m1 + ((t0 * m0) >> 32);
+}
+
+uint64_t MTY_GetTimeNS(void)
+{
+	return MTY_TicksToNS(MTY_GetTicks());
+}
+
+
+// Sleep
+
 static HANDLE time_create_timer(BOOL manual)
 {
 	HANDLE timer = CreateWaitableTimer(NULL, manual, NULL);
@@ -73,23 +125,59 @@ void MTY_Sleep(uint32_t timeout)
 	CloseHandle(timer);
 }
 
-void MTY_PreciseSleep(double timeout, double spin)
+static void time_sleep_precise(double ms)
 {
-	// Inspired by https://blog.bearcats.nl/accurate-sleep-function/
+	// High resolution timers are available starting with Windows 10 1803
+	HANDLE timer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
 
-	MTY_Time start = MTY_GetTime();
+	if (!timer)
+		timer = time_create_timer(FALSE);
 
-	HANDLE timer = time_create_timer(FALSE);
 	if (!timer)
 		return;
 
-	for (double ep = 0.0; ep < timeout - spin; ep = MTY_TimeDiff(start, MTY_GetTime()))
-		if (!time_wait(timer, 1))
-			break;
+	MTY_Time start = MTY_GetTime();
+	LARGE_INTEGER ft = {.QuadPart = -(LONGLONG) (ms * 10000.0)};
+
+	if (SetWaitableTimerEx(timer, &ft, 0, NULL, NULL, NULL, 0)) {
+		DWORD e = WaitForSingleObject(timer, INFINITE);
+		if (e != WAIT_OBJECT_0)
+			MTY_Log("'WaitForSingleObject' returned %d", e);
+
+	} else {
+		MTY_Log("'SetWaitableTimer' failed with error 0x%X", GetLastError());
+	}
 
 	CloseHandle(timer);
 
-	while (MTY_TimeDiff(start, MTY_GetTime()) < timeout);
+	double late = MTY_TimeDiff(start, MTY_GetTime()) - ms;
+	if (late < 0.0)
+		late = 0.0;
+
+	double err = late - TIME_WAKE_LATENCY;
+	TIME_WAKE_LATENCY += err / 8.0;
+	TIME_WAKE_DEVIATION += ((err < 0.0 ? -err : err) - TIME_WAKE_DEVIATION) / 4.0;
+}
+
+void MTY_SleepUntil(MTY_Time base, double offset, double spin)
+{
+	double remaining = offset - MTY_TimeDiff(base, MTY_GetTime());
+
+	// Wake up early enough to cover the expected scheduling delay, bounded by how
+	// much spinning the caller is willing to pay for
+	double margin = TIME_WAKE_LATENCY + 4.0 * TIME_WAKE_DEVIATION;
+	if (margin > spin)
+		margin = spin;
+
+	if (remaining > margin)
+		time_sleep_precise(remaining - margin);
+
+	while (MTY_TimeDiff(base, MTY_GetTime()) < offset);
+}
+
+void MTY_PreciseSleep(double timeout, double spin)
+{
+	MTY_SleepUntil(MTY_GetTime(), timeout, spin);
 }
 
 void MTY_SetTimerResolution(uint32_t res)
@@ -6,6 +6,15 @@
 
 #define TLOCAL __declspec(thread)
 
+struct tlocal_mark {
+	void *chunk;
+	size_t offset;
+};
+
 void *mty_tlocal(size_t size);
 char *mty_tlocal_strcpy(const char *str);
-void mty_tlocal_set_mem(void *buf, size_t size);
+char *mty_tlocal_vsprintf(const char *fmt, va_list args);
+char *mty_tlocal_sprintf(const char *fmt, ...) MTY_FMT(1, 2);
+struct tlocal_mark mty_tlocal_mark(void);
+void mty_tlocal_release(struct tlocal_mark mark);
+void mty_tlocal_thread_exit(void);
@@ -206,43 +206,58 @@ void MTY_WebSocketDestroy(MTY_WebSocket **webSocket)
 	*webSocket = NULL;
 }
 
-MTY_Async MTY_WebSocketRead(MTY_WebSocket *ctx, uint32_t timeout, char *msg, size_t size)
+static MTY_Async ws_read(MTY_WebSocket *ctx, char *msg, size_t size)
 {
-	do {
-		// Server has closed the connection
-		if (ctx->closed)
-			return MTY_ASYNC_DONE;
+	// Server has closed the connection
+	if (ctx->closed)
+		return MTY_ASYNC_DONE;
 
-		// Full message has been received
-		if (ctx->complete) {
-			if (ctx->pos < size) {
-				memcpy(msg, ctx->buf, ctx->pos);
-				msg[ctx->pos] = '\0';
+	// Full message has been received
+	if (ctx->complete) {
+		if (ctx->pos < size) {
+			memcpy(msg, ctx->buf, ctx->pos);
+			msg[ctx->pos] = '\0';
 
-				ctx->complete = false;
-				ctx->pos = 0;
+			ctx->complete = false;
+			ctx->pos = 0;
 
-				return MTY_ASYNC_OK;
-			}
+			return MTY_ASYNC_OK;
+		}
+
+		MTY_Log("WebSocket read buffer is not large enough for message + 1");
 
-			MTY_Log("WebSocket read buffer is not large enough for message + 1");
+		return MTY_ASYNC_ERROR;
+	}
 
+	// This function will return ERROR_INVALID_OPERATION if a previous read is in progress
+	DWORD e = WinHttpWebSocketReceive(ctx->ws, ctx->buf + ctx->pos, ctx->len - ctx->pos, NULL, NULL);
+
+	if (e != NO_ERROR && e != ERROR_INVALID_OPERATION) {
+		// Connection has been disrupted
+		if (e == ERROR_WINHTTP_CONNECTION_ERROR) {
+			ctx->closed = true;
+
+		} else {
+			MTY_Log("'WinHttpWebSocketReceive' failed with error 0x%X", e);
 			return MTY_ASYNC_ERROR;
 		}
+	}
 
-		// This function will return ERROR_INVALID_OPERATION if a previous read is in progress
-		DWORD e = WinHttpWebSocketReceive(ctx->ws, ctx->buf + ctx->pos, ctx->len - ctx->pos, NULL, NULL);
+	return MTY_ASYNC_CONTINUE;
+}
 
-		if (e != NO_ERROR && e != ERROR_INVALID_OPERATION) {
-			// Connection has been disrupted
-			if (e == ERROR_WINHTTP_CONNECTION_ERROR) {
-				ctx->closed = true;
+MTY_Async MTY_WebSocketRead(MTY_WebSocket *ctx, uint32_t timeout, char *msg, size_t size)
+{
+	do {
+		// Waiting on the read event is left out of the zone, as with the poll on Unix
+		MTY_TRACE_BEGIN("MTY_WebSocketRead");
 
-			} else {
-				MTY_Log("'WinHttpWebSocketReceive' failed with error 0x%X", e);
-				return MTY_ASYNC_ERROR;
-			}
-		}
+		MTY_Async r = ws_read(ctx, msg, size);
+
+		MTY_TRACE_END();
+
+		if (r != MTY_ASYNC_CONTINUE)
+			return r;
 
 	} while (MTY_WaitableWait(ctx->read_event, timeout));
 
@@ -251,13 +266,16 @@ MTY_Async MTY_WebSocketRead(MTY_WebSocket *ctx, uint32_t timeout, char *msg, siz
 
 bool MTY_WebSocketWrite(MTY_WebSocket *ctx, const char *msg)
 {
+	MTY_TRACE_BEGIN("MTY_WebSocketWrite");
+
 	DWORD e = WinHttpWebSocketSend(ctx->ws, WINHTTP_WEB_SOCKET_UTF8_MESSAGE_BUFFER_TYPE,
 		(char *) msg, (DWORD) strlen(msg));
 
-	if (e != NO_ERROR)
-		return false;
+	bool r = e == NO_ERROR && MTY_WaitableWait(ctx->write_event, 1000);
+
+	MTY_TRACE_END();
 
-	return MTY_WaitableWait(ctx->write_event, 1000);
+	return r;
 }
 
 uint16_t MTY_WebSocketGetCloseCode(MTY_WebSocket *ctx)
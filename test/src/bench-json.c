@@ -0,0 +1,888 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BENCH_RUNS    5
+#define BENCH_RUN_NS  50000000.0
+#define BENCH_QUERIES 4
+
+// Throughput is always relative to the size of the text document, so every mode of
+// a corpus can be compared directly, including the CBOR ones
+
+
+// Allocations
+
+// With the linker wrapping calloc, realloc, and free, every allocation made through
+// MTY_Alloc and MTY_Realloc is counted along with the live heap size
+
+#if defined(BENCH_WRAP)
+
+#include <malloc.h>
+
+void *__real_calloc(size_t len, size_t size);
+void *__real_realloc(void *mem, size_t size);
+void __real_free(void *mem);
+
+static MTY_Atomic64 BENCH_ALLOCS;
+static MTY_Atomic64 BENCH_BYTES;
+static MTY_Atomic64 BENCH_PEAK;
+
+static void bench_track(int64_t delta)
+{
+	int64_t bytes = MTY_Atomic64FetchAdd(&BENCH_BYTES, delta, MTY_ATOMIC_RELAXED) + delta;
+
+	// The hooks also run on the worker threads of the parse-lines mode
+	int64_t peak = MTY_Atomic64Load(&BENCH_PEAK, MTY_ATOMIC_RELAXED);
+
+	while (bytes > peak && !MTY_Atomic64CompareExchange(&BENCH_PEAK, peak, bytes, MTY_ATOMIC_RELAXED))
+		peak = MTY_Atomic64Load(&BENCH_PEAK, MTY_ATOMIC_RELAXED);
+}
+
+void *__wrap_calloc(size_t len, size_t size)
+{
+	void *mem = __real_calloc(len, size);
+
+	if (mem) {
+		MTY_Atomic64FetchAdd(&BENCH_ALLOCS, 1, MTY_ATOMIC_RELAXED);
+		bench_track(malloc_usable_size(mem));
+	}
+
+	return mem;
+}
+
+void *__wrap_realloc(void *mem, size_t size)
+{
+	size_t prev = mem ? malloc_usable_size(mem) : 0;
+	void *new_mem = __real_realloc(mem, size);
+
+	if (new_mem) {
+		MTY_Atomic64FetchAdd(&BENCH_ALLOCS, 1, MTY_ATOMIC_RELAXED);
+		bench_track((int64_t) malloc_usable_size(new_mem) - (int64_t) prev);
+
+	} else if (size == 0) {
+		bench_track(-(int64_t) prev);
+	}
+
+	return new_mem;
+}
+
+void __wrap_free(void *mem)
+{
+	if (mem)
+		bench_track(-(int64_t) malloc_usable_size(mem));
+
+	__real_free(mem);
+}
+
+static bool bench_alloc_begin(int64_t *allocs, int64_t *bytes)
+{
+	*allocs = MTY_Atomic64Load(&BENCH_ALLOCS, MTY_ATOMIC_RELAXED);
+	*bytes = MTY_Atomic64Load(&BENCH_BYTES, MTY_ATOMIC_RELAXED);
+	MTY_Atomic64Store(&BENCH_PEAK, *bytes, MTY_ATOMIC_RELAXED);
+
+	return true;
+}
+
+static void bench_alloc_end(int64_t allocs, int64_t bytes, double *count, double *peak)
+{
+	*count = (double) (MTY_Atomic64Load(&BENCH_ALLOCS, MTY_ATOMIC_RELAXED) - allocs);
+	*peak = (double) (MTY_Atomic64Load(&BENCH_PEAK, MTY_ATOMIC_RELAXED) - bytes);
+}
+
+#else
+
+static bool bench_alloc_begin(int64_t *allocs, int64_t *bytes)
+{
+	return false;
+}
+
+static void bench_alloc_end(int64_t allocs, int64_t bytes, double *count, double *peak)
+{
+}
+
+#endif
+
+
+// Harness
+
+typedef void (*bench_func)(void *opaque);
+
+struct bench_result {
+	double ns;
+	double mbps;
+	double allocs;
+	double peak;
+	bool tracked;
+};
+
+static struct bench_result bench_measure(bench_func func, void *opaque, size_t bytes)
+{
+	struct bench_result r = {0};
+
+	// A single op with allocation tracking, which also warms up caches
+	int64_t allocs = 0;
+	int64_t heap = 0;
+	r.tracked = bench_alloc_begin(&allocs, &heap);
+
+	uint64_t ts = MTY_GetTimeNS();
+	func(opaque);
+	double once = (double) (MTY_GetTimeNS() - ts);
+
+	if (r.tracked)
+		bench_alloc_end(allocs, heap, &r.allocs, &r.peak);
+
+	uint32_t ops = once > 0 && once < BENCH_RUN_NS ? (uint32_t) (BENCH_RUN_NS / once) : 1;
+
+	// Keep the fastest run, which has the least interference from the rest of the system
+	for (uint32_t x = 0; x < BENCH_RUNS; x++) {
+		ts = MTY_GetTimeNS();
+
+		for (uint32_t y = 0; y < ops; y++)
+			func(opaque);
+
+		double ns = (double) (MTY_GetTimeNS() - ts) / ops;
+
+		if (x == 0 || ns < r.ns)
+			r.ns = ns;
+	}
+
+	r.mbps = bytes > 0 && r.ns > 0 ? (double) bytes / (1024.0 * 1024.0) / (r.ns / 1e9) : 0;
+
+	return r;
+}
+
+
+// Corpus
+
+struct bench_corpus {
+	const char *name;
+	char *text;
+	size_t size;
+	void *cbor;
+	size_t cbor_size;
+	char *scratch;
+	char *queries[BENCH_QUERIES];
+
+	MTY_JSON *json;
+	MTY_JSONDoc *doc;
+
+	// The array of records at `records` is also written as newline delimited JSON
+	const char *records;
+	char *lines;
+	size_t lines_size;
+
+	// Corpora with a fixed layout are also bound to a struct
+	const MTY_JSONField *fields;
+	uint32_t num_fields;
+	size_t struct_size;
+	void *dst;
+};
+
+static uint64_t BENCH_RNG = 0x9E3779B97F4A7C15;
+
+static uint32_t bench_rand(uint32_t n)
+{
+	// xorshift64, the corpus is the same on every run and every platform
+	BENCH_RNG ^= BENCH_RNG << 13;
+	BENCH_RNG ^= BENCH_RNG >> 7;
+	BENCH_RNG ^= BENCH_RNG << 17;
+
+	return (uint32_t) (BENCH_RNG >> 32) % n;
+}
+
+static double bench_rand_double(double min, double max)
+{
+	return min + (max - min) * bench_rand(UINT32_MAX) / (double) UINT32_MAX;
+}
+
+static void bench_rand_text(MTY_JSONWriter *w, uint32_t min, uint32_t max)
+{
+	static const char *PIECES[] = {
+		"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dogs ", "and ",
+		"caf\xc3\xa9 ", "\xe6\x97\xa5\xe6\x9c\xac ", "\xf0\x9f\x98\x80 ", "\"quoted\" ",
+		"line\n", "tab\t", "back\\slash ", "https://example.com/a/b ", "#tag ", "@user ",
+	};
+
+	char buf[512];
+	size_t len = 0;
+	uint32_t target = min + bench_rand(max - min + 1);
+
+	while (len < target) {
+		const char *p = PIECES[bench_rand(sizeof(PIECES) / sizeof(const char *))];
+		size_t n = strlen(p);
+
+		if (len + n >= sizeof(buf))
+			break;
+
+		memcpy(buf + len, p, n);
+		len += n;
+	}
+
+	buf[len] = '\0';
+
+	MTY_JSONWriterString(w, buf);
+}
+
+static void bench_gen_numeric(MTY_JSONWriter *w, struct bench_corpus *c)
+{
+	// Polygons with coordinate pairs, in the spirit of GeoJSON exports
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterKey(w, "type");
+	MTY_JSONWriterString(w, "FeatureCollection");
+	MTY_JSONWriterKey(w, "features");
+	MTY_JSONWriterBeginArray(w);
+
+	for (uint32_t x = 0; x < 20; x++) {
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "id");
+		MTY_JSONWriterInt(w, x);
+		MTY_JSONWriterKey(w, "geometry");
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "type");
+		MTY_JSONWriterString(w, "Polygon");
+		MTY_JSONWriterKey(w, "coordinates");
+		MTY_JSONWriterBeginArray(w);
+		MTY_JSONWriterBeginArray(w);
+
+		for (uint32_t y = 0; y < 2000; y++) {
+			MTY_JSONWriterBeginArray(w);
+			MTY_JSONWriterNumber(w, bench_rand_double(-180, 180));
+			MTY_JSONWriterNumber(w, bench_rand_double(-90, 90));
+			MTY_JSONWriterEndArray(w);
+		}
+
+		MTY_JSONWriterEndArray(w);
+		MTY_JSONWriterEndArray(w);
+		MTY_JSONWriterEndObject(w);
+		MTY_JSONWriterEndObject(w);
+	}
+
+	MTY_JSONWriterEndArray(w);
+	MTY_JSONWriterEndObject(w);
+
+	c->records = "/features";
+
+	c->queries[0] = MTY_Strdup("/type");
+	c->queries[1] = MTY_Strdup("/features/0/geometry/coordinates/0/0/1");
+	c->queries[2] = MTY_Strdup("/features/10/geometry/coordinates/0/1000/0");
+	c->queries[3] = MTY_Strdup("/features/19/geometry/coordinates/0/1999/1");
+}
+
+static void bench_gen_strings(MTY_JSONWriter *w, struct bench_corpus *c)
+{
+	// Short messages with UTF-8 and characters that need escaping, like a social feed
+	MTY_JSONWriterBeginArray(w);
+
+	for (uint32_t x = 0; x < 5000; x++) {
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "text");
+		bench_rand_text(w, 20, 200);
+		MTY_JSONWriterKey(w, "user");
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "name");
+		bench_rand_text(w, 4, 20);
+		MTY_JSONWriterKey(w, "description");
+		bench_rand_text(w, 0, 80);
+		MTY_JSONWriterEndObject(w);
+		MTY_JSONWriterKey(w, "lang");
+		MTY_JSONWriterString(w, "en");
+		MTY_JSONWriterEndObject(w);
+	}
+
+	MTY_JSONWriterEndArray(w);
+
+	c->records = "";
+
+	c->queries[0] = MTY_Strdup("/0/text");
+	c->queries[1] = MTY_Strdup("/2500/user/name");
+	c->queries[2] = MTY_Strdup("/4999/lang");
+	c->queries[3] = MTY_Strdup("/1234/user/description");
+}
+
+static void bench_gen_nested(MTY_JSONWriter *w, struct bench_corpus *c)
+{
+	// Chains of objects and arrays 100 levels deep
+	MTY_JSONWriterBeginArray(w);
+
+	for (uint32_t x = 0; x < 2000; x++) {
+		for (uint32_t y = 0; y < 50; y++) {
+			MTY_JSONWriterBeginObject(w);
+			MTY_JSONWriterKey(w, "n");
+			MTY_JSONWriterBeginArray(w);
+		}
+
+		MTY_JSONWriterInt(w, x);
+
+		for (uint32_t y = 0; y < 50; y++) {
+			MTY_JSONWriterEndArray(w);
+			MTY_JSONWriterEndObject(w);
+		}
+	}
+
+	MTY_JSONWriterEndArray(w);
+
+	MTY_StrBuf sb;
+	MTY_StrBufInit(&sb, NULL, 0);
+
+	for (uint32_t x = 0; x < BENCH_QUERIES; x++) {
+		MTY_StrBufPrintf(&sb, "/%u", x * 600);
+
+		for (uint32_t y = 0; y < 50; y++)
+			MTY_StrBufAppend(&sb, "/n/0");
+
+		c->queries[x] = MTY_StrBufMove(&sb);
+	}
+
+	c->records = "";
+}
+
+static void bench_gen_wide(MTY_JSONWriter *w, struct bench_corpus *c)
+{
+	// A single object with a very large number of members
+	MTY_JSONWriterBeginObject(w);
+
+	for (uint32_t x = 0; x < 50000; x++) {
+		char key[32];
+		snprintf(key, sizeof(key), "property_%05u", x);
+
+		MTY_JSONWriterKey(w, key);
+
+		switch (x % 4) {
+			case 0: MTY_JSONWriterInt(w, bench_rand(1000000)); break;
+			case 1: MTY_JSONWriterBool(w, bench_rand(2) == 0); break;
+			case 2: MTY_JSONWriterNumber(w, bench_rand_double(0, 1)); break;
+			case 3: bench_rand_text(w, 4, 16); break;
+		}
+	}
+
+	MTY_JSONWriterEndObject(w);
+
+	c->queries[0] = MTY_Strdup("/property_00000");
+	c->queries[1] = MTY_Strdup("/property_12345");
+	c->queries[2] = MTY_Strdup("/property_33333");
+	c->queries[3] = MTY_Strdup("/property_49999");
+}
+
+struct bench_address {
+	char city[16];
+	int32_t zip;
+	double geo[2];
+};
+
+struct bench_user {
+	int32_t id;
+	char uuid[40];
+	char email[32];
+	char name[128];
+	char created_at[24];
+	double score;
+	bool active;
+	char roles[3][16];
+	struct bench_address address;
+};
+
+struct bench_paging {
+	char next[64];
+	int32_t total;
+};
+
+struct bench_api {
+	char status[8];
+	struct bench_user data[3000];
+	struct bench_paging paging;
+};
+
+static const MTY_JSONField BENCH_ADDRESS_FIELDS[] = {
+	{.name = "city", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_address, city),
+		.size = 16},
+	{.name = "zip", .type = MTY_JSON_FIELD_INT32, .offset = offsetof(struct bench_address, zip)},
+	{.name = "geo", .type = MTY_JSON_FIELD_DOUBLE, .offset = offsetof(struct bench_address, geo),
+		.count = 2},
+};
+
+static const MTY_JSONField BENCH_USER_FIELDS[] = {
+	{.name = "id", .type = MTY_JSON_FIELD_INT32, .offset = offsetof(struct bench_user, id)},
+	{.name = "uuid", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_user, uuid),
+		.size = 40},
+	{.name = "email", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_user, email),
+		.size = 32},
+	{.name = "name", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_user, name),
+		.size = 128},
+	{.name = "created_at", .type = MTY_JSON_FIELD_STRING,
+		.offset = offsetof(struct bench_user, created_at), .size = 24},
+	{.name = "score", .type = MTY_JSON_FIELD_DOUBLE, .offset = offsetof(struct bench_user, score)},
+	{.name = "active", .type = MTY_JSON_FIELD_BOOL, .offset = offsetof(struct bench_user, active)},
+	{.name = "roles", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_user, roles),
+		.size = 16, .count = 3},
+	{.name = "address", .type = MTY_JSON_FIELD_STRUCT, .offset = offsetof(struct bench_user, address),
+		.size = sizeof(struct bench_address), .fields = BENCH_ADDRESS_FIELDS, .numFields = 3},
+};
+
+static const MTY_JSONField BENCH_PAGING_FIELDS[] = {
+	{.name = "next", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_paging, next),
+		.size = 64},
+	{.name = "total", .type = MTY_JSON_FIELD_INT32, .offset = offsetof(struct bench_paging, total)},
+};
+
+static const MTY_JSONField BENCH_API_FIELDS[] = {
+	{.name = "status", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct bench_api, status),
+		.size = 8},
+	{.name = "data", .type = MTY_JSON_FIELD_STRUCT, .offset = offsetof(struct bench_api, data),
+		.size = sizeof(struct bench_user), .count = 3000, .fields = BENCH_USER_FIELDS, .numFields = 9},
+	{.name = "paging", .type = MTY_JSON_FIELD_STRUCT, .offset = offsetof(struct bench_api, paging),
+		.size = sizeof(struct bench_paging), .fields = BENCH_PAGING_FIELDS, .numFields = 2},
+};
+
+static void bench_gen_api(MTY_JSONWriter *w, struct bench_corpus *c)
+{
+	// A paged REST response with a mix of every type
+	static const char *ROLES[] = {"admin", "editor", "viewer", "billing", "support"};
+	static const char *CITIES[] = {"Lisbon", "Osaka", "Denver", "Nairobi", "Reykjav\xc3\xadk"};
+
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterKey(w, "status");
+	MTY_JSONWriterString(w, "ok");
+	MTY_JSONWriterKey(w, "data");
+	MTY_JSONWriterBeginArray(w);
+
+	for (uint32_t x = 0; x < 3000; x++) {
+		char buf[64];
+
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "id");
+		MTY_JSONWriterInt(w, 100000 + x);
+
+		snprintf(buf, sizeof(buf), "%08x-%04x-4%03x-a%03x-%012x", bench_rand(UINT32_MAX),
+			bench_rand(0xFFFF), bench_rand(0xFFF), bench_rand(0xFFF), bench_rand(UINT32_MAX));
+		MTY_JSONWriterKey(w, "uuid");
+		MTY_JSONWriterString(w, buf);
+
+		snprintf(buf, sizeof(buf), "user%u@example.com", x);
+		MTY_JSONWriterKey(w, "email");
+		MTY_JSONWriterString(w, buf);
+
+		MTY_JSONWriterKey(w, "name");
+		bench_rand_text(w, 6, 24);
+
+		snprintf(buf, sizeof(buf), "2024-%02u-%02uT%02u:%02u:%02uZ", 1 + bench_rand(12),
+			1 + bench_rand(28), bench_rand(24), bench_rand(60), bench_rand(60));
+		MTY_JSONWriterKey(w, "created_at");
+		MTY_JSONWriterString(w, buf);
+
+		MTY_JSONWriterKey(w, "score");
+		MTY_JSONWriterNumber(w, bench_rand_double(0, 100));
+		MTY_JSONWriterKey(w, "active");
+		MTY_JSONWriterBool(w, bench_rand(4) != 0);
+
+		MTY_JSONWriterKey(w, "roles");
+		MTY_JSONWriterBeginArray(w);
+
+		for (uint32_t y = bench_rand(3); y < 3; y++)
+			MTY_JSONWriterString(w, ROLES[bench_rand(5)]);
+
+		MTY_JSONWriterEndArray(w);
+
+		MTY_JSONWriterKey(w, "address");
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "city");
+		MTY_JSONWriterString(w, CITIES[bench_rand(5)]);
+		MTY_JSONWriterKey(w, "zip");
+		MTY_JSONWriterInt(w, bench_rand(100000));
+		MTY_JSONWriterKey(w, "geo");
+		MTY_JSONWriterBeginArray(w);
+		MTY_JSONWriterNumber(w, bench_rand_double(-90, 90));
+		MTY_JSONWriterNumber(w, bench_rand_double(-180, 180));
+		MTY_JSONWriterEndArray(w);
+		MTY_JSONWriterEndObject(w);
+
+		MTY_JSONWriterKey(w, "manager");
+		MTY_JSONWriterNull(w);
+		MTY_JSONWriterEndObject(w);
+	}
+
+	MTY_JSONWriterEndArray(w);
+	MTY_JSONWriterKey(w, "paging");
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterKey(w, "next");
+	MTY_JSONWriterString(w, "https://api.example.com/v1/users?cursor=3000");
+	MTY_JSONWriterKey(w, "total");
+	MTY_JSONWriterInt(w, 125000);
+	MTY_JSONWriterEndObject(w);
+	MTY_JSONWriterEndObject(w);
+
+	c->records = "/data";
+
+	c->fields = BENCH_API_FIELDS;
+	c->num_fields = 3;
+	c->struct_size = sizeof(struct bench_api);
+
+	c->queries[0] = MTY_Strdup("/paging/next");
+	c->queries[1] = MTY_Strdup("/data/0/email");
+	c->queries[2] = MTY_Strdup("/data/1500/address/city");
+	c->queries[3] = MTY_Strdup("/data/2999/address/geo/1");
+}
+
+static const MTY_JSON *bench_json_pointer(const MTY_JSON *j, const char *pointer)
+{
+	// The benchmark pointers have no escaped characters
+	char token[64];
+
+	for (const char *p = pointer; j && *p == '/';) {
+		const char *end = strchr(p + 1, '/');
+		size_t len = end ? (size_t) (end - p) - 1 : strlen(p + 1);
+
+		if (len >= sizeof(token))
+			return NULL;
+
+		memcpy(token, p + 1, len);
+		token[len] = '\0';
+
+		j = MTY_JSONGetType(j) == MTY_JSON_OBJECT ? MTY_JSONObjGetItem(j, token) :
+			MTY_JSONArrayGetItem(j, (uint32_t) strtoul(token, NULL, 10));
+
+		p += len + 1;
+	}
+
+	return j;
+}
+
+static void bench_corpus_create(struct bench_corpus *c, const char *name,
+	void (*gen)(MTY_JSONWriter *w, struct bench_corpus *c))
+{
+	MTY_JSONWriter *w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_TEXT);
+	gen(w, c);
+
+	if (!MTY_JSONWriterFinish(w))
+		MTY_LogFatal("Corpus '%s' is incomplete", name);
+
+	c->name = name;
+	c->text = MTY_Strdup(MTY_JSONWriterGetString(w, &c->size));
+	c->scratch = MTY_Alloc(c->size, 1);
+
+	MTY_JSONWriterDestroy(&w);
+
+	c->json = MTY_JSONParse(c->text);
+	c->doc = MTY_JSONDocParse(c->text, c->size);
+	c->cbor = MTY_JSONSerializeCBOR(c->json, &c->cbor_size);
+
+	for (uint32_t x = 0; x < BENCH_QUERIES; x++) {
+		MTY_JSONDocItem item = MTY_JSONDocPointer(c->doc, MTY_JSON_DOC_ROOT, c->queries[x]);
+
+		if (!bench_json_pointer(c->json, c->queries[x]) || item == MTY_JSON_DOC_NONE)
+			MTY_LogFatal("Query '%s' not found in corpus '%s'", c->queries[x], name);
+	}
+
+	if (c->records) {
+		const MTY_JSON *records = bench_json_pointer(c->json, c->records);
+
+		MTY_StrBuf sb;
+		MTY_StrBufInit(&sb, NULL, 0);
+
+		for (uint32_t x = 0; x < MTY_JSONArrayGetLength(records); x++) {
+			char *line = MTY_JSONSerialize(MTY_JSONArrayGetItem(records, x));
+			MTY_StrBufPrintf(&sb, "%s\n", line);
+			MTY_Free(line);
+		}
+
+		c->lines_size = sb.len;
+		c->lines = MTY_StrBufMove(&sb);
+	}
+
+	if (c->fields) {
+		c->dst = MTY_Alloc(1, c->struct_size);
+
+		if (!MTY_JSONParseStruct(c->text, c->size, c->fields, c->num_fields, c->dst))
+			MTY_LogFatal("Corpus '%s' does not match its struct", name);
+	}
+}
+
+static void bench_corpus_destroy(struct bench_corpus *c)
+{
+	for (uint32_t x = 0; x < BENCH_QUERIES; x++)
+		MTY_Free(c->queries[x]);
+
+	MTY_JSONDocDestroy(&c->doc);
+	MTY_JSONDestroy(&c->json);
+
+	MTY_Free(c->dst);
+	MTY_Free(c->lines);
+	MTY_Free(c->cbor);
+	MTY_Free(c->scratch);
+	MTY_Free(c->text);
+}
+
+
+// Modes
+
+static void bench_parse(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	MTY_JSON *j = MTY_JSONParse(c->text);
+	MTY_JSONDestroy(&j);
+}
+
+static void bench_parse_in_place(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	// Includes copying the text, which the parse overwrites
+	memcpy(c->scratch, c->text, c->size);
+
+	MTY_JSON *j = MTY_JSONParseInPlace(c->scratch, c->size);
+	MTY_JSONDestroy(&j);
+}
+
+static void bench_parse_doc(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	MTY_JSONDoc *doc = MTY_JSONDocParse(c->text, c->size);
+	MTY_JSONDocDestroy(&doc);
+}
+
+static void bench_parse_cbor(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	MTY_JSON *j = MTY_JSONParseCBOR(c->cbor, c->cbor_size, NULL);
+	MTY_JSONDestroy(&j);
+}
+
+static void bench_query_dom(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	for (uint32_t x = 0; x < BENCH_QUERIES; x++)
+		bench_json_pointer(c->json, c->queries[x]);
+}
+
+static void bench_query_doc(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	for (uint32_t x = 0; x < BENCH_QUERIES; x++)
+		MTY_JSONDocPointer(c->doc, MTY_JSON_DOC_ROOT, c->queries[x]);
+}
+
+static void bench_parse_query_doc(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	MTY_JSONDoc *doc = MTY_JSONDocParse(c->text, c->size);
+
+	for (uint32_t x = 0; x < BENCH_QUERIES; x++)
+		MTY_JSONDocPointer(doc, MTY_JSON_DOC_ROOT, c->queries[x]);
+
+	MTY_JSONDocDestroy(&doc);
+}
+
+static bool bench_lines_func(size_t line, const MTY_JSON *json, void *opaque)
+{
+	return json != NULL;
+}
+
+static void bench_parse_lines(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	// Chunks of lines are parsed on the worker threads
+	MTY_JSONParseLines(c->lines, c->lines_size, bench_lines_func, NULL);
+}
+
+static void bench_parse_struct(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	MTY_JSONParseStruct(c->text, c->size, c->fields, c->num_fields, c->dst);
+}
+
+static void bench_serialize(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	char *str = MTY_JSONSerialize(c->json);
+	MTY_Free(str);
+}
+
+static void bench_serialize_cbor(void *opaque)
+{
+	struct bench_corpus *c = opaque;
+
+	size_t size = 0;
+	void *cbor = MTY_JSONSerializeCBOR(c->json, &size);
+	MTY_Free(cbor);
+}
+
+#define BENCH_NEEDS_LINES  0x01
+#define BENCH_NEEDS_STRUCT 0x02
+
+static const struct {
+	const char *name;
+	bench_func func;
+	bool throughput;
+	uint8_t needs;
+} BENCH_MODES[] = {
+	{"parse",           bench_parse,           true},
+	{"parse-in-place",  bench_parse_in_place,  true},
+	{"parse-doc",       bench_parse_doc,       true},
+	{"parse-cbor",      bench_parse_cbor,      true},
+	{"parse-lines",     bench_parse_lines,     true,  BENCH_NEEDS_LINES},
+	{"parse-struct",    bench_parse_struct,    true,  BENCH_NEEDS_STRUCT},
+	{"query-dom",       bench_query_dom,       false},
+	{"query-doc",       bench_query_doc,       false},
+	{"parse-query-doc", bench_parse_query_doc, true},
+	{"serialize",       bench_serialize,       true},
+	{"serialize-cbor",  bench_serialize_cbor,  true},
+};
+
+#define BENCH_NUM_MODES (sizeof(BENCH_MODES) / sizeof(BENCH_MODES[0]))
+
+
+// Report
+
+static void bench_print_delta(const MTY_JSONDoc *baseline, const char *corpus, const char *mode,
+	double mbps)
+{
+	char pointer[128];
+	snprintf(pointer, sizeof(pointer), "/%s/%s/mbps", corpus, mode);
+
+	double prev = 0;
+	MTY_JSONDocItem item = MTY_JSONDocPointer(baseline, MTY_JSON_DOC_ROOT, pointer);
+
+	if (mbps > 0 && MTY_JSONDocNumber(baseline, item, &prev) && prev > 0) {
+		printf(" %+8.1f%%", (mbps - prev) / prev * 100.0);
+
+	} else {
+		printf(" %9s", "-");
+	}
+}
+
+static void bench_report(MTY_JSONWriter *w, const char *mode, const struct bench_result *r)
+{
+	MTY_JSONWriterKey(w, mode);
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterKey(w, "ns");
+	MTY_JSONWriterNumber(w, r->ns);
+	MTY_JSONWriterKey(w, "mbps");
+	MTY_JSONWriterNumber(w, r->mbps);
+
+	if (r->tracked) {
+		MTY_JSONWriterKey(w, "allocs");
+		MTY_JSONWriterNumber(w, r->allocs);
+		MTY_JSONWriterKey(w, "peak");
+		MTY_JSONWriterNumber(w, r->peak);
+	}
+
+	MTY_JSONWriterEndObject(w);
+}
+
+
+// Main
+
+// Usage: mty [report.json] [baseline.json]
+// Results are written to the report file as JSON. When a baseline report from an
+// earlier run is given, the change in throughput is printed for each mode.
+
+int32_t main(int32_t argc, char **argv)
+{
+	const char *report = argc > 1 ? argv[1] : NULL;
+	MTY_JSONDoc *baseline = argc > 2 ? MTY_JSONDocReadFile(argv[2]) : NULL;
+
+	if (argc > 2 && !baseline) {
+		printf("Could not read baseline '%s'\n", argv[2]);
+		return 1;
+	}
+
+	static const struct {
+		const char *name;
+		void (*gen)(MTY_JSONWriter *w, struct bench_corpus *c);
+	} CORPORA[] = {
+		{"numeric", bench_gen_numeric},
+		{"strings", bench_gen_strings},
+		{"nested",  bench_gen_nested},
+		{"wide",    bench_gen_wide},
+		{"api",     bench_gen_api},
+	};
+
+	MTY_JSONWriter *w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_PRETTY);
+	MTY_JSONWriterBeginObject(w);
+
+	printf("%-8s %-16s %10s %12s %10s %12s %12s %9s\n", "Corpus", "Mode", "Size KB", "us/op",
+		"MB/s", "allocs/op", "peak KB/op", "vs base");
+
+	for (size_t x = 0; x < sizeof(CORPORA) / sizeof(CORPORA[0]); x++) {
+		struct bench_corpus c = {0};
+		bench_corpus_create(&c, CORPORA[x].name, CORPORA[x].gen);
+
+		MTY_JSONWriterKey(w, c.name);
+		MTY_JSONWriterBeginObject(w);
+		MTY_JSONWriterKey(w, "size");
+		MTY_JSONWriterInt(w, c.size);
+
+		for (size_t y = 0; y < BENCH_NUM_MODES; y++) {
+			if (((BENCH_MODES[y].needs & BENCH_NEEDS_LINES) && !c.lines) ||
+				((BENCH_MODES[y].needs & BENCH_NEEDS_STRUCT) && !c.fields))
+				continue;
+
+			struct bench_result r = bench_measure(BENCH_MODES[y].func, &c,
+				BENCH_MODES[y].throughput ? c.size : 0);
+
+			printf("%-8s %-16s %10.1f %12.1f", c.name, BENCH_MODES[y].name, c.size / 1024.0,
+				r.ns / 1000.0);
+
+			if (r.mbps > 0) {
+				printf(" %10.1f", r.mbps);
+
+			} else {
+				printf(" %10s", "-");
+			}
+
+			if (r.tracked) {
+				printf(" %12.0f %12.1f", r.allocs, r.peak / 1024.0);
+
+			} else {
+				printf(" %12s %12s", "-", "-");
+			}
+
+			if (baseline) {
+				bench_print_delta(baseline, c.name, BENCH_MODES[y].name, r.mbps);
+
+			} else {
+				printf(" %9s", "-");
+			}
+
+			printf("\n");
+
+			bench_report(w, BENCH_MODES[y].name, &r);
+		}
+
+		MTY_JSONWriterEndObject(w);
+
+		bench_corpus_destroy(&c);
+	}
+
+	MTY_JSONWriterEndObject(w);
+
+	if (report) {
+		size_t len = 0;
+		const char *str = MTY_JSONWriterFinish(w) ? MTY_JSONWriterGetString(w, &len) : NULL;
+
+		if (!str || !MTY_WriteFile(report, str, len)) {
+			printf("Could not write report '%s'\n", report);
+			return 1;
+		}
+	}
+
+	MTY_JSONWriterDestroy(&w);
+	MTY_JSONDocDestroy(&baseline);
+
+	return 0;
+}
@@ -0,0 +1,289 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define BENCH_RUNS 5
+
+
+// Harness
+
+typedef void (*bench_func)(void *opaque, uint32_t ops);
+
+static MTY_PerfCounters *BENCH_PERF;
+
+static void bench_print_counter(uint32_t available, MTY_PerfCounter counter, uint64_t value,
+	uint32_t ops)
+{
+	if (available & counter) {
+		printf(" %12.1f", (double) value / ops);
+
+	} else {
+		printf(" %12s", "-");
+	}
+}
+
+static void bench_run(const char *name, uint32_t ops, bench_func func, void *opaque)
+{
+	// Warm up caches and branch predictors
+	func(opaque, ops);
+
+	double best_ns = 0;
+	MTY_PerfCounterValues best = {0};
+
+	// Keep the fastest run, which has the least interference from the rest of the system
+	for (uint32_t x = 0; x < BENCH_RUNS; x++) {
+		MTY_PerfCounterValues values = {0};
+
+		uint64_t ts = MTY_GetTimeNS();
+		MTY_PerfCountersBegin(BENCH_PERF);
+
+		func(opaque, ops);
+
+		MTY_PerfCountersEnd(BENCH_PERF, &values);
+		double ns = (double) (MTY_GetTimeNS() - ts);
+
+		if (x == 0 || ns < best_ns) {
+			best_ns = ns;
+			best = values;
+		}
+	}
+
+	printf("%-24s %12.1f", name, best_ns / ops);
+
+	bench_print_counter(best.available, MTY_PERF_COUNTER_CYCLES, best.cycles, ops);
+	bench_print_counter(best.available, MTY_PERF_COUNTER_INSTRUCTIONS, best.instructions, ops);
+
+	if ((best.available & MTY_PERF_COUNTER_CYCLES) && (best.available & MTY_PERF_COUNTER_INSTRUCTIONS)) {
+		printf(" %6.2f", best.cycles > 0 ? (double) best.instructions / best.cycles : 0);
+
+	} else {
+		printf(" %6s", "-");
+	}
+
+	bench_print_counter(best.available, MTY_PERF_COUNTER_CACHE_MISSES, best.cacheMisses, ops);
+	bench_print_counter(best.available, MTY_PERF_COUNTER_BRANCH_MISSES, best.branchMisses, ops);
+
+	printf("\n");
+}
+
+
+// Resample
+
+struct bench_resample {
+	MTY_Resampler *rs;
+	int16_t frames[480 * 2];
+};
+
+static void bench_resample(void *opaque, uint32_t ops)
+{
+	struct bench_resample *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		size_t out = 0;
+		MTY_Resample(ctx->rs, 44100.0f / 48000.0f, ctx->frames, 480, &out);
+	}
+}
+
+
+// JSON
+
+struct bench_json {
+	char *str;
+	MTY_JSON *json;
+};
+
+static void bench_json_parse(void *opaque, uint32_t ops)
+{
+	struct bench_json *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		MTY_JSON *j = MTY_JSONParse(ctx->str);
+		MTY_JSONDestroy(&j);
+	}
+}
+
+static void bench_json_serialize(void *opaque, uint32_t ops)
+{
+	struct bench_json *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		char *str = MTY_JSONSerialize(ctx->json);
+		MTY_Free(str);
+	}
+}
+
+
+// Hash
+
+#define BENCH_HASH_KEYS 10000
+
+struct bench_hash {
+	MTY_Hash *hash;
+	char keys[BENCH_HASH_KEYS][16];
+};
+
+static void bench_hash_get(void *opaque, uint32_t ops)
+{
+	struct bench_hash *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++)
+		MTY_HashGet(ctx->hash, ctx->keys[x % BENCH_HASH_KEYS]);
+}
+
+static void bench_hash_get_int(void *opaque, uint32_t ops)
+{
+	struct bench_hash *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++)
+		MTY_HashGetInt(ctx->hash, x % BENCH_HASH_KEYS);
+}
+
+
+// Sort
+
+#define BENCH_SORT_LEN 100000
+
+struct bench_sort {
+	uint32_t src[BENCH_SORT_LEN];
+	uint32_t buf[BENCH_SORT_LEN];
+};
+
+static int32_t bench_sort_compare(const void *a, const void *b)
+{
+	uint32_t ua = *(const uint32_t *) a;
+	uint32_t ub = *(const uint32_t *) b;
+
+	return ua < ub ? -1 : ua > ub ? 1 : 0;
+}
+
+static void bench_sort(void *opaque, uint32_t ops)
+{
+	struct bench_sort *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		memcpy(ctx->buf, ctx->src, sizeof(ctx->src));
+		MTY_Sort(ctx->buf, BENCH_SORT_LEN, sizeof(uint32_t), bench_sort_compare);
+	}
+}
+
+#define bench_sort_less(a, b) (*(a) < *(b))
+
+MTY_SORT_DEFINE(bench_sort_u32, uint32_t, bench_sort_less)
+
+static void bench_sort_typed(void *opaque, uint32_t ops)
+{
+	struct bench_sort *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		memcpy(ctx->buf, ctx->src, sizeof(ctx->src));
+		bench_sort_u32_sort(ctx->buf, BENCH_SORT_LEN);
+	}
+}
+
+static void bench_sort_parallel(void *opaque, uint32_t ops)
+{
+	struct bench_sort *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		memcpy(ctx->buf, ctx->src, sizeof(ctx->src));
+		MTY_SortParallel(ctx->buf, BENCH_SORT_LEN, sizeof(uint32_t), bench_sort_compare);
+	}
+}
+
+static void bench_radix_sort(void *opaque, uint32_t ops)
+{
+	struct bench_sort *ctx = opaque;
+
+	for (uint32_t x = 0; x < ops; x++) {
+		memcpy(ctx->buf, ctx->src, sizeof(ctx->src));
+		MTY_RadixSort(ctx->buf, BENCH_SORT_LEN, sizeof(uint32_t), 0, MTY_SORT_KEY_UINT32);
+	}
+}
+
+
+// Main
+
+int32_t main(int32_t argc, char **argv)
+{
+	BENCH_PERF = MTY_PerfCountersCreate();
+
+	printf("%-24s %12s %12s %12s %6s %12s %12s\n", "Benchmark", "ns/op", "cycles/op",
+		"instr/op", "IPC", "llc-miss/op", "br-miss/op");
+
+	// Resample
+	struct bench_resample rs = {0};
+	rs.rs = MTY_ResamplerCreate();
+
+	for (uint32_t x = 0; x < 480 * 2; x++)
+		rs.frames[x] = (int16_t) (rand() % 2000 - 1000);
+
+	bench_run("MTY_Resample (10 ms)", 1000, bench_resample, &rs);
+
+	MTY_ResamplerDestroy(&rs.rs);
+
+	// JSON
+	struct bench_json js = {0};
+	js.json = MTY_JSONArrayCreate(1000);
+
+	for (uint32_t x = 0; x < 1000; x++) {
+		MTY_JSON *item = MTY_JSONObjCreate();
+		MTY_JSONObjSetInt(item, "id", x);
+		MTY_JSONObjSetNumber(item, "value", x * 1.5);
+		MTY_JSONObjSetString(item, "name", "libmatoya benchmark item");
+		MTY_JSONObjSetBool(item, "active", x % 2 == 0);
+		MTY_JSONArraySetItem(js.json, x, item);
+	}
+
+	js.str = MTY_JSONSerialize(js.json);
+
+	bench_run("MTY_JSONParse (1000)", 100, bench_json_parse, &js);
+	bench_run("MTY_JSONSerialize (1000)", 100, bench_json_serialize, &js);
+
+	MTY_Free(js.str);
+	MTY_JSONDestroy(&js.json);
+
+	// Hash
+	struct bench_hash *hs = MTY_Alloc(1, sizeof(struct bench_hash));
+	hs->hash = MTY_HashCreate(0);
+
+	for (uint32_t x = 0; x < BENCH_HASH_KEYS; x++) {
+		snprintf(hs->keys[x], 16, "key%u", x);
+		MTY_HashSet(hs->hash, hs->keys[x], hs);
+		MTY_HashSetInt(hs->hash, x, hs);
+	}
+
+	bench_run("MTY_HashGet", 1000000, bench_hash_get, hs);
+	bench_run("MTY_HashGetInt", 1000000, bench_hash_get_int, hs);
+
+	MTY_HashDestroy(&hs->hash, NULL);
+	MTY_Free(hs);
+
+	// Sort
+	struct bench_sort *ss = MTY_Alloc(1, sizeof(struct bench_sort));
+
+	for (uint32_t x = 0; x < BENCH_SORT_LEN; x++)
+		ss->src[x] = (uint32_t) rand();
+
+	bench_run("MTY_Sort (100000)", 10, bench_sort, ss);
+	bench_run("MTY_SORT_DEFINE (100000)", 10, bench_sort_typed, ss);
+	bench_run("MTY_SortParallel (100000)", 10, bench_sort_parallel, ss);
+	bench_run("MTY_RadixSort (100000)", 10, bench_radix_sort, ss);
+
+	for (uint32_t x = 0; x < BENCH_SORT_LEN; x++)
+		ss->src[x] = x % 100 == 0 ? (uint32_t) rand() : x;
+
+	bench_run("MTY_Sort (mostly sorted)", 10, bench_sort, ss);
+
+	MTY_Free(ss);
+
+	MTY_PerfCountersDestroy(&BENCH_PERF);
+
+	return 0;
+}
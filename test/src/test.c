@@ -18,9 +18,11 @@
 
 /// Modules
 #include "test/memory.h"
+#include "test/metrics.h"
 #include "test/json.h"
 #include "test/version.h"
 #include "test/time.h"
+#include "test/trace.h"
 #include "test/log.h"
 #include "test/file.h"
 #include "test/struct.h"
@@ -55,12 +57,18 @@ int32_t main(int32_t argc, char **argv)
 	if (!time_main())
 		return 1;
 
+	if (!trace_main())
+		return 1;
+
 	if (!file_main())
 		return 1;
 
 	if (!memory_main())
 		return 1;
 
+	if (!metrics_main())
+		return 1;
+
 	if (!log_main())
 		return 1;
 
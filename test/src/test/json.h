@@ -201,6 +201,54 @@ static bool json_duplication(void)
 	return true;
 }
 
+static bool json_wide(void)
+{
+	// Objects with many members are given larger hashes when parsed
+	MTY_StrBuf sb;
+	MTY_StrBufInit(&sb, NULL, 0);
+	MTY_StrBufAppend(&sb, "{");
+
+	for (uint32_t x = 0; x < 5000; x++)
+		MTY_StrBufPrintf(&sb, "\"k%u\":%u,", x, x);
+
+	MTY_StrBufAppend(&sb, "\"k5\":-1}");
+
+	MTY_JSON *j = MTY_JSONParse(sb.str);
+	test_cmp("MTY_JSONParse", j != NULL);
+
+	bool found = true;
+	for (uint32_t x = 0; x < 5000 && found; x++) {
+		int32_t val = 0;
+		found = MTY_JSONObjGetInt(j, MTY_SprintfDL("k%u", x), &val) && val == (x == 5 ? -1 : (int32_t) x);
+	}
+
+	test_cmp("MTY_JSONObjGetItem", found);
+
+	uint32_t keys = 0;
+	uint64_t iter = 0;
+	const char *key = NULL;
+
+	while (MTY_JSONObjGetNextKey(j, &iter, &key))
+		keys++;
+
+	test_cmp("MTY_JSONObjGetNextKey", keys == 5000);
+
+	// Serializing and parsing again keeps the same order
+	char *str = MTY_JSONSerialize(j);
+	MTY_JSON *j2 = MTY_JSONParse(str);
+	char *str2 = MTY_JSONSerialize(j2);
+
+	test_cmp("MTY_JSONSerialize", !strcmp(str, str2));
+
+	MTY_Free(str2);
+	MTY_Free(str);
+	MTY_JSONDestroy(&j2);
+	MTY_JSONDestroy(&j);
+	MTY_StrBufFree(&sb);
+
+	return true;
+}
+
 static bool json_utf16(void)
 {
 	MTY_JSON *j = MTY_JSONParse(JSON_UTF16);
@@ -218,6 +266,1021 @@ static bool json_utf16(void)
 	return true;
 }
 
+static bool json_parse_errors(void)
+{
+	static const char *INVALID[] = {
+		"[truex]",
+		"[nul]",
+		"{\"a\":1}x",
+		"[\"\\u 123\"]",
+		"[\"\\u-123\"]",
+		"[\"a\tb\"]",
+		"[\"unterminated]",
+		"[\"\xC0\xAF\"]",         // Overlong
+		"[\"\xED\xA0\x80\"]",     // Surrogate
+		"[\"\xF4\x90\x80\x80\"]", // Past U+10FFFF
+		"[\"\xE2\x82\"]",         // Truncated
+		"[\"\xE2" "A" "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa" "\x82\xAC\"]", // Cut short, continued in the next block
+		"[\"\x80\"]",
+		"[1,]",
+		"[1 2]",
+		"{\"a\"}",
+		"{\"a\":}",
+		"{\"a\":1,}",
+		"{,}",
+		"[}",
+		"1 2",
+		"",
+	};
+
+	bool rejected = true;
+	MTY_DisableLog(true);
+
+	for (size_t x = 0; x < sizeof(INVALID) / sizeof(const char *); x++) {
+		MTY_JSON *j = MTY_JSONParse(INVALID[x]);
+		MTY_JSONDoc *doc = MTY_JSONDocParse(INVALID[x], strlen(INVALID[x]));
+		rejected = rejected && !j && !doc;
+
+		MTY_JSONDestroy(&j);
+		MTY_JSONDocDestroy(&doc);
+	}
+
+	MTY_DisableLog(false);
+	test_cmp("MTY_JSONParse", rejected);
+
+	// Escapes, multi-byte characters and strings crossing the 64 byte blocks
+	char buf[256];
+
+	for (uint32_t pad = 0; pad < 70; pad++) {
+		memset(buf, ' ', pad);
+		snprintf(buf + pad, sizeof(buf) - pad, "{\"k\\\\\":[\"\\\"\xE2\x82\xAC\xF0\x9F\x98\x80\\\\\", true, -1.5e3]}");
+
+		MTY_JSON *j = MTY_JSONParse(buf);
+		const MTY_JSON *a = MTY_JSONObjGetItem(j, "k\\");
+
+		const char *str = MTY_JSONStringPtr(MTY_JSONArrayGetItem(a, 0));
+		bool ok = str && !strcmp(str, "\"\xE2\x82\xAC\xF0\x9F\x98\x80\\");
+
+		double num = 0;
+		ok = ok && MTY_JSONNumber(MTY_JSONArrayGetItem(a, 2), &num) && num == -1500;
+
+		MTY_JSONDestroy(&j);
+
+		if (!ok)
+			test_failed("Bad parse across blocks");
+	}
+
+	test_passed("JSON parse errors");
+
+	return true;
+}
+
+static bool json_numbers(void)
+{
+	// Doubles survive a round trip exactly
+	bool exact = true;
+
+	for (uint32_t x = 0; x < JSON_ITER * 10; x++) {
+		double num = 0;
+		MTY_GetRandomBytes(&num, sizeof(double));
+
+		if (isnan(num) || isinf(num))
+			continue;
+
+		MTY_JSON *j = MTY_JSONNumberCreate(num);
+		char *str = MTY_JSONSerialize(j);
+		MTY_JSONDestroy(&j);
+
+		j = MTY_JSONParse(str);
+
+		double val = 0;
+		exact = exact && MTY_JSONNumber(j, &val) && !memcmp(&val, &num, sizeof(double));
+
+		MTY_JSONDestroy(&j);
+		MTY_Free(str);
+	}
+
+	test_cmp("MTY_JSONNumber", exact);
+
+	MTY_JSON *j = MTY_JSONParse("[0.1, -0, 1.5E3, 2147483647, 2147483648, -2147483648, "
+		"12345678901234567890123, 1e-400, 4.9e-324, 1.7976931348623157e308, "
+		"0.000000000000000000000000000000123456789012345678901234]");
+
+	char *str = MTY_JSONSerialize(j);
+	test_cmp("MTY_JSONParse", !strcmp(str, "[0.1,0,1500,2147483647,2147483648,-2147483648,"
+		"1.2345678901234568e+22,0,5e-324,1.7976931348623157e+308,1.2345678901234568e-31]"));
+
+	MTY_Free(str);
+	MTY_JSONDestroy(&j);
+
+	return true;
+}
+
+static bool json_writer_append(const void *buf, size_t size, void *opaque)
+{
+	MTY_StrBufAppendLen(opaque, buf, size);
+
+	return true;
+}
+
+static bool json_writer(void)
+{
+	// Incremental writing, pretty printed
+	MTY_JSONWriter *w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_PRETTY);
+
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterKey(w, "a\"\x01");
+	MTY_JSONWriterBeginArray(w);
+	MTY_JSONWriterInt(w, -9007199254740993LL);
+	MTY_JSONWriterNumber(w, 0.5);
+	MTY_JSONWriterBool(w, true);
+	MTY_JSONWriterNull(w);
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterEndObject(w);
+	MTY_JSONWriterEndArray(w);
+	MTY_JSONWriterKey(w, "b");
+	MTY_JSONWriterString(w, "c\n");
+	MTY_JSONWriterEndObject(w);
+
+	test_cmp("MTY_JSONWriterFinish", MTY_JSONWriterFinish(w));
+
+	const char *str = MTY_JSONWriterGetString(w, NULL);
+	test_cmp("MTY_JSONWriterGetString", str && !strcmp(str, "{\n\t\"a\\\"\\u0001\": [\n\t\t-9007199254740993,"
+		"\n\t\t0.5,\n\t\ttrue,\n\t\tnull,\n\t\t{}\n\t],\n\t\"b\": \"c\\n\"\n}"));
+
+	MTY_JSONWriterDestroy(&w);
+
+	// Misuse fails and stays failed
+	MTY_DisableLog(true);
+
+	w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_TEXT);
+	MTY_JSONWriterBeginObject(w);
+	test_cmp("MTY_JSONWriterKey", !MTY_JSONWriterInt(w, 1));
+	test_cmp("MTY_JSONWriterKey", !MTY_JSONWriterKey(w, "a"));
+	MTY_JSONWriterDestroy(&w);
+
+	w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_TEXT);
+	MTY_JSONWriterBeginArray(w);
+	test_cmp("MTY_JSONWriterEndObject", !MTY_JSONWriterEndObject(w));
+	MTY_JSONWriterDestroy(&w);
+
+	w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_TEXT);
+	MTY_JSONWriterNull(w);
+	test_cmp("MTY_JSONWriterNull", !MTY_JSONWriterNull(w));
+	MTY_JSONWriterDestroy(&w);
+
+	w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_TEXT);
+	MTY_JSONWriterBeginArray(w);
+	test_cmp("MTY_JSONWriterFinish", !MTY_JSONWriterFinish(w));
+	MTY_JSONWriterDestroy(&w);
+
+	// Caller supplied buffers fail when full
+	char buf[8];
+	w = MTY_JSONWriterCreateBuffer(buf, sizeof(buf), MTY_JSON_FORMAT_TEXT);
+	test_cmp("MTY_JSONWriterCreateBuffer", MTY_JSONWriterString(w, "abcde"));
+	MTY_JSONWriterDestroy(&w);
+
+	w = MTY_JSONWriterCreateBuffer(buf, sizeof(buf), MTY_JSON_FORMAT_TEXT);
+	test_cmp("MTY_JSONWriterCreateBuffer", !MTY_JSONWriterString(w, "abcdef"));
+	test_cmp("MTY_JSONWriterGetString", !MTY_JSONWriterGetString(w, NULL));
+	MTY_JSONWriterDestroy(&w);
+
+	MTY_DisableLog(false);
+
+	// Existing items written through a function match MTY_JSONSerialize
+	for (uint32_t x = 0; x < JSON_ITER / 10; x++) {
+		uint32_t n = 0;
+		MTY_JSON *j = json_random(&n);
+
+		MTY_StrBuf sb;
+		MTY_StrBufInit(&sb, NULL, 0);
+
+		w = MTY_JSONWriterCreateFunc(json_writer_append, &sb, MTY_JSON_FORMAT_TEXT);
+		bool ok = MTY_JSONWriterItem(w, j) && MTY_JSONWriterFinish(w);
+		MTY_JSONWriterDestroy(&w);
+
+		char *str2 = MTY_JSONSerialize(j);
+
+		if (!ok || strcmp(sb.str, str2))
+			test_failed("Mismatching writer/serialize");
+
+		MTY_Free(str2);
+		MTY_StrBufFree(&sb);
+		MTY_JSONDestroy(&j);
+	}
+
+	test_passed("JSON writer");
+
+	return true;
+}
+
+static bool json_doc_equal(const MTY_JSONDoc *doc, MTY_JSONDocItem item, const MTY_JSON *j)
+{
+	MTY_JSONType type = MTY_JSONGetType(j);
+
+	if (MTY_JSONDocGetType(doc, item) != type)
+		return false;
+
+	switch (type) {
+		case MTY_JSON_NULL:
+			return true;
+		case MTY_JSON_BOOL: {
+			bool v0 = false, v1 = false;
+			return MTY_JSONBool(j, &v0) && MTY_JSONDocBool(doc, item, &v1) && v0 == v1;
+		}
+		case MTY_JSON_NUMBER: {
+			double v0 = 0, v1 = 0;
+			return MTY_JSONNumber(j, &v0) && MTY_JSONDocNumber(doc, item, &v1) && v0 == v1;
+		}
+		case MTY_JSON_STRING: {
+			char v[JSON_STRING_MAX * 4];
+			return MTY_JSONDocString(doc, item, v, sizeof(v)) && !strcmp(v, MTY_JSONStringPtr(j));
+		}
+		case MTY_JSON_ARRAY: {
+			uint32_t len = MTY_JSONArrayGetLength(j);
+
+			if (MTY_JSONDocArrayGetLength(doc, item) != len)
+				return false;
+
+			for (uint32_t x = 0; x < len; x++)
+				if (!json_doc_equal(doc, MTY_JSONDocArrayGetItem(doc, item, x), MTY_JSONArrayGetItem(j, x)))
+					return false;
+
+			return MTY_JSONDocArrayGetItem(doc, item, len) == MTY_JSON_DOC_NONE;
+		}
+		case MTY_JSON_OBJECT: {
+			uint64_t iter = 0;
+			const char *key = NULL;
+
+			while (MTY_JSONObjGetNextKey(j, &iter, &key))
+				if (!json_doc_equal(doc, MTY_JSONDocObjGetItem(doc, item, key), MTY_JSONObjGetItem(j, key)))
+					return false;
+
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+static bool json_doc(void)
+{
+	// Lazy access agrees with the parsed tree
+	for (uint32_t x = 0; x < JSON_ITER / 4; x++) {
+		uint32_t n = 0;
+		MTY_JSON *j = json_random(&n);
+		char *str = MTY_JSONSerialize(j);
+
+		// Random arrays may have unset elements, which are not serialized
+		MTY_JSONDestroy(&j);
+		j = MTY_JSONParse(str);
+
+		MTY_JSONDoc *doc = MTY_JSONDocParse(str, strlen(str));
+		if (!doc)
+			test_failed("Bad doc parse");
+
+		if (!json_doc_equal(doc, MTY_JSON_DOC_ROOT, j))
+			test_failed("Mismatching doc/parse");
+
+		MTY_JSON *j2 = MTY_JSONDocGetJSON(doc, MTY_JSON_DOC_ROOT);
+		char *str2 = MTY_JSONSerialize(j2);
+
+		if (strcmp(str, str2))
+			test_failed("Mismatching doc/serialize");
+
+		MTY_Free(str2);
+		MTY_JSONDestroy(&j2);
+		MTY_JSONDocDestroy(&doc);
+		MTY_Free(str);
+		MTY_JSONDestroy(&j);
+	}
+
+	test_passed("JSON doc");
+
+	// RFC 6901 examples
+	const char *rfc = "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, "
+		"\"g|h\": 4, \"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8, \"o\": {\"p\": [true, null]}}";
+
+	MTY_JSONDoc *doc = MTY_JSONDocParse(rfc, strlen(rfc));
+
+	const char *ptrs[] = {"/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n"};
+	bool found = MTY_JSONDocGetType(doc, MTY_JSONDocPointer(doc, MTY_JSON_DOC_ROOT, "")) == MTY_JSON_OBJECT;
+
+	for (int32_t x = 0; x < (int32_t) (sizeof(ptrs) / sizeof(const char *)); x++) {
+		int32_t v = -1;
+		found = found && MTY_JSONDocInt32(doc, MTY_JSONDocPointer(doc, MTY_JSON_DOC_ROOT, ptrs[x]), &v) && v == x;
+	}
+
+	test_cmp("MTY_JSONDocPointer", found);
+
+	char str[8] = {0};
+	MTY_JSONDocItem foo = MTY_JSONDocObjGetItem(doc, MTY_JSON_DOC_ROOT, "foo");
+	test_cmp("MTY_JSONDocPointer", MTY_JSONDocString(doc, MTY_JSONDocPointer(doc, foo, "/1"), str, sizeof(str)) && !strcmp(str, "baz"));
+
+	bool b = false;
+	test_cmp("MTY_JSONDocPointer", MTY_JSONDocBool(doc, MTY_JSONDocPointer(doc, MTY_JSON_DOC_ROOT, "/o/p/0"), &b) && b);
+	test_cmp("MTY_JSONDocPointer", MTY_JSONDocGetType(doc, MTY_JSONDocPointer(doc, MTY_JSON_DOC_ROOT, "/o/p/1")) == MTY_JSON_NULL);
+
+	MTY_DisableLog(true);
+
+	const char *missing[] = {"/foo/2", "/foo/-", "/foo/01", "/o/q", "/o/p/0/x", "foo", "/m~2n"};
+
+	for (size_t x = 0; x < sizeof(missing) / sizeof(const char *); x++)
+		found = found && MTY_JSONDocPointer(doc, MTY_JSON_DOC_ROOT, missing[x]) == MTY_JSON_DOC_NONE;
+
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONDocPointer", found);
+
+	MTY_JSONDocDestroy(&doc);
+
+	// Overflowing numbers read the same as they do from the parsed tree
+	const char *big = "[1e400, -1e400]";
+	doc = MTY_JSONDocParse(big, strlen(big));
+	MTY_JSON *j = MTY_JSONParse(big);
+
+	double v0 = -1, v1 = -1;
+	int32_t i = -1;
+	MTY_JSONDocItem item = MTY_JSONDocArrayGetItem(doc, MTY_JSON_DOC_ROOT, 1);
+
+	test_cmp("MTY_JSONDocNumber", MTY_JSONDocNumber(doc, item, &v0) && v0 == 0);
+	test_cmp("MTY_JSONDocNumber", MTY_JSONNumber(MTY_JSONArrayGetItem(j, 1), &v1) && v1 == v0);
+	test_cmp("MTY_JSONDocInt32", MTY_JSONDocInt32(doc, MTY_JSONDocArrayGetItem(doc, MTY_JSON_DOC_ROOT, 0), &i) && i == 0);
+
+	MTY_JSONDestroy(&j);
+	MTY_JSONDocDestroy(&doc);
+
+	return true;
+}
+
+static bool json_cbor_encodes(MTY_JSON *j, const char *hex)
+{
+	size_t size = 0;
+	uint8_t *buf = MTY_JSONSerializeCBOR(j, &size);
+
+	char str[64] = {0};
+	for (size_t x = 0; x < size && x < sizeof(str) / 2 - 1; x++)
+		snprintf(str + x * 2, 3, "%02x", buf[x]);
+
+	MTY_Free(buf);
+	MTY_JSONDestroy(&j);
+
+	return !strcmp(str, hex);
+}
+
+static bool json_cbor_decodes(const char *hex, const char *text)
+{
+	uint8_t buf[64];
+	size_t size = strlen(hex) / 2;
+
+	for (size_t x = 0; x < size; x++) {
+		unsigned int b = 0;
+		sscanf(hex + x * 2, "%02x", &b);
+		buf[x] = (uint8_t) b;
+	}
+
+	size_t used = 0;
+	MTY_JSON *j = MTY_JSONParseCBOR(buf, size, &used);
+	char *str = j ? MTY_JSONSerialize(j) : NULL;
+
+	bool r = text ? str && used == size && !strcmp(str, text) : !j && used == 0;
+
+	MTY_Free(str);
+	MTY_JSONDestroy(&j);
+
+	return r;
+}
+
+static bool json_cbor(void)
+{
+	// Round trip through CBOR matches the text serialization
+	for (uint32_t x = 0; x < JSON_ITER; x++) {
+		uint32_t n = 0;
+		MTY_JSON *j = json_random(&n);
+		char *str = MTY_JSONSerialize(j);
+
+		size_t size = 0;
+		void *buf = MTY_JSONSerializeCBOR(j, &size);
+		MTY_JSONDestroy(&j);
+
+		j = MTY_JSONParseCBOR(buf, size, NULL);
+		char *str2 = MTY_JSONSerialize(j);
+
+		if (!j || strcmp(str, str2))
+			test_failed("Mismatching CBOR round trip");
+
+		MTY_Free(str2);
+		MTY_JSONDestroy(&j);
+		MTY_Free(buf);
+		MTY_Free(str);
+	}
+
+	test_passed("JSON CBOR");
+
+	// RFC 8949 Appendix A
+	bool ok = json_cbor_encodes(MTY_JSONIntCreate(1000), "1903e8") &&
+		json_cbor_encodes(MTY_JSONIntCreate(-1000), "3903e7") &&
+		json_cbor_encodes(MTY_JSONNumberCreate(1.5), "f93e00") &&
+		json_cbor_encodes(MTY_JSONNumberCreate(65504.0), "f97bff") &&
+		json_cbor_encodes(MTY_JSONNumberCreate(5.960464477539063e-8), "f90001") &&
+		json_cbor_encodes(MTY_JSONNumberCreate(100000.0), "fa47c35000") &&
+		json_cbor_encodes(MTY_JSONNumberCreate(1.1), "fb3ff199999999999a") &&
+		json_cbor_encodes(MTY_JSONNumberCreate(-4.1), "fbc010666666666666") &&
+		json_cbor_encodes(MTY_JSONParse("[1,[2,3],{\"a\":null,\"b\":[]}]"), "8301820203a26161f6616280");
+
+	test_cmp("MTY_JSONSerializeCBOR", ok);
+
+	MTY_DisableLog(true);
+
+	ok = json_cbor_decodes("1b000000e8d4a51000", "1000000000000") &&
+		json_cbor_decodes("3bffffffffffffffff", "-18446744073709552000") &&
+		json_cbor_decodes("f90400", "0.00006103515625") &&
+		json_cbor_decodes("f9c400", "-4") &&
+		json_cbor_decodes("c11a514b67b0", "1363896240") &&
+		json_cbor_decodes("9f018202039f0405ffff", "[1,[2,3],[4,5]]") &&
+		json_cbor_decodes("bf6346756ef563416d7421ff", "{\"Amt\":-2,\"Fun\":true}") &&
+		json_cbor_decodes("7f657374726561646d696e67ff", "\"streaming\"") &&
+		json_cbor_decodes("f7", "null") &&
+		json_cbor_decodes("4401020304", NULL) &&
+		json_cbor_decodes("a10102", NULL) &&
+		json_cbor_decodes("62c328", NULL) &&
+		json_cbor_decodes("9f01", NULL) &&
+		json_cbor_decodes("9bffffffffffffffff", NULL) &&
+		json_cbor_decodes("ff", NULL);
+
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONParseCBOR", ok);
+
+	// Incremental CBOR uses indefinite lengths
+	MTY_JSONWriter *w = MTY_JSONWriterCreate(MTY_JSON_FORMAT_CBOR);
+	MTY_JSONWriterBeginObject(w);
+	MTY_JSONWriterKey(w, "a");
+	MTY_JSONWriterBeginArray(w);
+	MTY_JSONWriterInt(w, 24);
+	MTY_JSONWriterBool(w, false);
+	MTY_JSONWriterEndArray(w);
+	MTY_JSONWriterEndObject(w);
+
+	size_t len = 0;
+	const char *out = MTY_JSONWriterGetString(w, &len);
+	test_cmp("MTY_JSONWriterGetString", MTY_JSONWriterFinish(w) && len == 9 &&
+		!memcmp(out, "\xbf\x61" "a" "\x9f\x18\x18\xf4\xff\xff", 9));
+
+	MTY_JSONWriterDestroy(&w);
+
+	return true;
+}
+
+static bool json_in_place(void)
+{
+	for (uint32_t x = 0; x < JSON_ITER; x++) {
+		uint32_t n = 0;
+
+		MTY_JSON *j = json_random(&n);
+		char *str = MTY_JSONSerialize(j);
+		MTY_JSONDestroy(&j);
+
+		// Without a null terminator
+		size_t size = strlen(str);
+		char *buf = MTY_Dup(str, size);
+
+		j = MTY_JSONParseInPlace(buf, size);
+		if (!j)
+			test_failed("Bad in place parse");
+
+		char *str2 = MTY_JSONSerialize(j);
+		if (strcmp(str, str2))
+			test_failed("Mismatching in place parse/serialize");
+
+		MTY_JSONDestroy(&j);
+		MTY_Free(buf);
+		MTY_Free(str);
+		MTY_Free(str2);
+	}
+
+	test_passed("MTY_JSONParseInPlace");
+
+	char buf[] = "{\"k\\n\":\"a\\u00e9\\\"b\",\"k\\n\":\"c\",\"e\":[\"\\ud83d\\ude00\",\"\"]}";
+
+	MTY_JSON *j = MTY_JSONParseInPlace(buf, sizeof(buf) - 1);
+	const MTY_JSON *e = MTY_JSONObjGetItem(j, "e");
+	test_cmp("MTY_JSONParseInPlace", j && !strcmp(MTY_JSONObjGetStringPtr(j, "k\n"), "c") &&
+		!strcmp(MTY_JSONStringPtr(MTY_JSONArrayGetItem(e, 0)), "\xf0\x9f\x98\x80") &&
+		!strcmp(MTY_JSONStringPtr(MTY_JSONArrayGetItem(e, 1)), ""));
+
+	// Borrowed keys and strings are mixed with owned ones after changes
+	MTY_JSONObjSetItem(j, "k\n", MTY_JSONStringCreate("d"));
+	MTY_JSONObjSetItem(j, "f", MTY_JSONStringCreate("g"));
+	MTY_JSONObjSetItem(j, "e", NULL);
+
+	test_cmp("MTY_JSONParseInPlace", !strcmp(MTY_JSONObjGetStringPtr(j, "k\n"), "d") &&
+		!strcmp(MTY_JSONObjGetStringPtr(j, "f"), "g") && !MTY_JSONObjGetItem(j, "e"));
+
+	MTY_JSONDestroy(&j);
+
+	char bad[] = "{\"a\":\"\\x\"}";
+
+	MTY_DisableLog(true);
+	j = MTY_JSONParseInPlace(bad, sizeof(bad) - 1);
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONParseInPlace", !j);
+
+	return true;
+}
+
+static void json_lines_append(MTY_StrBuf *sb, size_t line, const MTY_JSON *json)
+{
+	char *str = json ? MTY_JSONSerialize(json) : NULL;
+
+	MTY_StrBufPrintf(sb, "%zu:%s\n", line, str ? str : "!");
+	MTY_Free(str);
+}
+
+static bool json_lines_func(size_t line, const MTY_JSON *json, void *opaque)
+{
+	json_lines_append(opaque, line, json);
+
+	return true;
+}
+
+static bool json_lines_stop(size_t line, const MTY_JSON *json, void *opaque)
+{
+	uint32_t *n = opaque;
+
+	return ++(*n) < 3;
+}
+
+static bool json_lines(void)
+{
+	MTY_StrBuf in;
+	MTY_StrBuf expect;
+	MTY_StrBufInit(&in, NULL, 0);
+	MTY_StrBufInit(&expect, NULL, 0);
+
+	// Blank lines, invalid lines, and CRLF line endings mixed in with random items
+	for (uint32_t x = 1; x <= JSON_ITER; x++) {
+		if (x % 7 == 0) {
+			MTY_StrBufAppend(&in, " \t\r\n");
+
+		} else if (x % 13 == 0) {
+			MTY_StrBufAppend(&in, "{\"a\":}\n");
+			json_lines_append(&expect, x, NULL);
+
+		} else {
+			uint32_t n = 0;
+			MTY_JSON *j = json_random(&n);
+			char *str = MTY_JSONSerialize(j);
+
+			MTY_StrBufAppend(&in, str);
+			MTY_StrBufAppend(&in, x % 2 ? "\r\n" : "\n");
+			json_lines_append(&expect, x, j);
+
+			MTY_JSONDestroy(&j);
+			MTY_Free(str);
+		}
+	}
+
+	MTY_StrBuf out;
+	MTY_StrBufInit(&out, NULL, 0);
+
+	// The final line has no newline
+	in.str[--in.len] = '\0';
+
+	MTY_DisableLog(true);
+	bool r = MTY_JSONParseLines(in.str, in.len, json_lines_func, &out);
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONParseLines", r && !strcmp(out.str, expect.str));
+
+	const char *path = "json-lines.tmp";
+	MTY_WriteFile(path, in.str, in.len);
+	MTY_StrBufClear(&out);
+
+	MTY_DisableLog(true);
+	r = MTY_JSONReadLinesFile(path, json_lines_func, &out);
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONReadLinesFile", r && !strcmp(out.str, expect.str));
+
+	uint32_t n = 0;
+
+	MTY_DisableLog(true);
+	r = MTY_JSONReadLinesFile(path, json_lines_stop, &n);
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONReadLinesFile", !r && n == 3);
+
+	MTY_DeleteFile(path);
+
+	MTY_DisableLog(true);
+	r = MTY_JSONReadLinesFile(path, json_lines_func, &out);
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONReadLinesFile", !r);
+
+	MTY_StrBufFree(&in);
+	MTY_StrBufFree(&expect);
+	MTY_StrBufFree(&out);
+
+	return true;
+}
+
+struct json_point {
+	float x;
+	float y;
+};
+
+struct json_message {
+	int32_t id;
+	uint32_t flags;
+	int64_t big;
+	bool ok;
+	double value;
+	char name[16];
+	struct json_point pos;
+	int32_t list[4];
+	struct json_point path[2];
+	char tags[2][8];
+};
+
+static const MTY_JSONField JSON_POINT_FIELDS[] = {
+	{.name = "x", .type = MTY_JSON_FIELD_FLOAT, .offset = offsetof(struct json_point, x)},
+	{.name = "y", .type = MTY_JSON_FIELD_FLOAT, .offset = offsetof(struct json_point, y)},
+};
+
+static const MTY_JSONField JSON_MESSAGE_FIELDS[] = {
+	{.name = "id", .type = MTY_JSON_FIELD_INT32, .offset = offsetof(struct json_message, id)},
+	{.name = "flags", .type = MTY_JSON_FIELD_UINT32, .offset = offsetof(struct json_message, flags)},
+	{.name = "big", .type = MTY_JSON_FIELD_INT64, .offset = offsetof(struct json_message, big)},
+	{.name = "ok", .type = MTY_JSON_FIELD_BOOL, .offset = offsetof(struct json_message, ok)},
+	{.name = "value", .type = MTY_JSON_FIELD_DOUBLE, .offset = offsetof(struct json_message, value)},
+	{.name = "name", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct json_message, name),
+		.size = 16},
+	{.name = "pos", .type = MTY_JSON_FIELD_STRUCT, .offset = offsetof(struct json_message, pos),
+		.size = sizeof(struct json_point), .fields = JSON_POINT_FIELDS, .numFields = 2},
+	{.name = "list", .type = MTY_JSON_FIELD_INT32, .offset = offsetof(struct json_message, list),
+		.count = 4},
+	{.name = "path", .type = MTY_JSON_FIELD_STRUCT, .offset = offsetof(struct json_message, path),
+		.size = sizeof(struct json_point), .count = 2, .fields = JSON_POINT_FIELDS, .numFields = 2},
+	{.name = "tags", .type = MTY_JSON_FIELD_STRING, .offset = offsetof(struct json_message, tags),
+		.size = 8, .count = 2},
+};
+
+#define JSON_MESSAGE_NUM_FIELDS (sizeof(JSON_MESSAGE_FIELDS) / sizeof(MTY_JSONField))
+
+static bool json_struct_parses(const char *input)
+{
+	struct json_message m = {0};
+
+	return MTY_JSONParseStruct(input, strlen(input), JSON_MESSAGE_FIELDS, JSON_MESSAGE_NUM_FIELDS, &m);
+}
+
+static bool json_struct(void)
+{
+	const char *input = "{\"id\":-7, \"skip\":{\"a\":[1,{\"b\":null}],\"c\":\"\\u00e9\"}, \"flags\":4000000000,"
+		"\"big\":-4294967296123,\"ok\":true,\"value\":0.1,\"n\\u0061me\":\"a\\u00e9\\n\",\"pos\":{\"y\":-2.25,\"x\":1.5},"
+		"\"list\":[1,2,3],\"path\":[{\"x\":1},{\"y\":2}],\"tags\":[\"one\",\"two\"],\"more\":false}";
+
+	struct json_message m = {0};
+	m.list[3] = 9;
+
+	bool r = MTY_JSONParseStruct(input, strlen(input), JSON_MESSAGE_FIELDS, JSON_MESSAGE_NUM_FIELDS, &m);
+
+	test_cmp("MTY_JSONParseStruct", r && m.id == -7 && m.flags == 4000000000 && m.big == -4294967296123 &&
+		m.ok && m.value == 0.1 && !strcmp(m.name, "a\xc3\xa9\n") && m.pos.x == 1.5f && m.pos.y == -2.25f);
+	test_cmp("MTY_JSONParseStruct", m.list[0] == 1 && m.list[2] == 3 && m.list[3] == 9 &&
+		m.path[0].x == 1 && m.path[1].y == 2 && !strcmp(m.tags[0], "one") && !strcmp(m.tags[1], "two"));
+
+	char buf[512];
+	size_t len = MTY_JSONSerializeStruct(JSON_MESSAGE_FIELDS, JSON_MESSAGE_NUM_FIELDS, &m, buf, sizeof(buf));
+
+	test_cmp("MTY_JSONSerializeStruct", len == strlen(buf) && !strcmp(buf, "{\"id\":-7,\"flags\":4000000000,"
+		"\"big\":-4294967296123,\"ok\":true,\"value\":0.1,\"name\":\"a\xc3\xa9\\n\",\"pos\":{\"x\":1.5,\"y\":-2.25},"
+		"\"list\":[1,2,3,9],\"path\":[{\"x\":1,\"y\":0},{\"x\":0,\"y\":2}],\"tags\":[\"one\",\"two\"]}"));
+
+	struct json_message m2 = {0};
+	r = MTY_JSONParseStruct(buf, len, JSON_MESSAGE_FIELDS, JSON_MESSAGE_NUM_FIELDS, &m2);
+	test_cmp("MTY_JSONParseStruct", r && !memcmp(&m, &m2, sizeof(struct json_message)));
+
+	// 64-bit integers are exact beyond the precision of a double
+	static const int64_t INT64S[] = {INT64_C(9007199254740993), INT64_C(1234567890123456789), INT64_MAX,
+		INT64_MIN};
+
+	for (size_t x = 0; x < sizeof(INT64S) / sizeof(int64_t); x++) {
+		char num[64];
+		snprintf(num, sizeof(num), "{\"big\":%" PRId64 "}", INT64S[x]);
+
+		char member[64];
+		snprintf(member, sizeof(member), "\"big\":%" PRId64 ",", INT64S[x]);
+
+		struct json_message m3 = {0};
+		r = MTY_JSONParseStruct(num, strlen(num), JSON_MESSAGE_FIELDS, JSON_MESSAGE_NUM_FIELDS, &m3);
+		test_cmpi64("MTY_JSONParseStruct", r && m3.big == INT64S[x], m3.big);
+
+		char out[512];
+		MTY_JSONSerializeStruct(JSON_MESSAGE_FIELDS, JSON_MESSAGE_NUM_FIELDS, &m3, out, sizeof(out));
+		test_cmp("MTY_JSONSerializeStruct", strstr(out, member) != NULL);
+	}
+
+	MTY_DisableLog(true);
+
+	test_cmp("MTY_JSONSerializeStruct", MTY_JSONSerializeStruct(JSON_MESSAGE_FIELDS,
+		JSON_MESSAGE_NUM_FIELDS, &m, buf, len) == 0);
+
+	static const char *INVALID[] = {
+		"{\"list\":[1,2,3,4,5]}",
+		"{\"name\":\"0123456789abcdef\"}",
+		"{\"name\":\"0123456789abcd\\u00e9\"}",
+		"{\"id\":2147483648}",
+		"{\"id\":1.5}",
+		"{\"big\":9223372036854775808}",
+		"{\"big\":-9223372036854775809}",
+		"{\"big\":99999999999999999999}",
+		"{\"big\":01}",
+		"{\"big\":-}",
+		"{\"big\":1.5}",
+		"{\"pos\":{\"x\":1e300}}",
+		"{\"pos\":{\"x\":-3.5e38}}",
+		"{\"flags\":-1}",
+		"{\"ok\":1}",
+		"{\"pos\":[]}",
+		"{\"id\":1} x",
+		"{\"id\":1,}",
+		"{\"skip\":[1,}",
+		"{\"skip\":\"\\x\"}",
+		"[]",
+	};
+
+	for (size_t x = 0; x < sizeof(INVALID) / sizeof(const char *); x++)
+		if (json_struct_parses(INVALID[x]))
+			test_failed(INVALID[x]);
+
+	MTY_StrBuf deep;
+	MTY_StrBufInit(&deep, NULL, 0);
+	MTY_StrBufAppend(&deep, "{\"skip\":");
+
+	for (uint32_t x = 0; x < 1000; x++)
+		MTY_StrBufAppendChar(&deep, '[');
+
+	r = json_struct_parses(deep.str);
+	MTY_StrBufFree(&deep);
+
+	MTY_DisableLog(false);
+
+	test_cmp("MTY_JSONParseStruct", !r && json_struct_parses("{\"name\":\"0123456789abcde\",\"id\":null}"));
+
+	return true;
+}
+
+static MTY_JSON *json_mutate(const MTY_JSON *j)
+{
+	uint32_t n = 0;
+
+	if (MTY_GetRandomUInt(0, 8) == 0)
+		return json_random(&n);
+
+	MTY_JSON *r = NULL;
+
+	if (MTY_JSONGetType(j) == MTY_JSON_ARRAY) {
+		// Elements are dropped, changed, and inserted anywhere in the array
+		uint32_t len = MTY_JSONArrayGetLength(j);
+		MTY_JSON **values = MTY_Alloc(len * 2 + 1, sizeof(MTY_JSON *));
+		uint32_t count = 0;
+
+		for (uint32_t x = 0; x <= len; x++) {
+			if (MTY_GetRandomUInt(0, 6) == 0)
+				values[count++] = json_random(&n);
+
+			if (x == len)
+				break;
+
+			const MTY_JSON *item = MTY_JSONArrayGetItem(j, x);
+			uint32_t action = MTY_GetRandomUInt(0, 8);
+
+			if (action == 0)
+				continue;
+
+			values[count++] = action == 1 ? json_mutate(item) : MTY_JSONDuplicate(item);
+		}
+
+		r = MTY_JSONArrayCreate(count);
+
+		for (uint32_t x = 0; x < count; x++)
+			MTY_JSONArraySetItem(r, x, values[x]);
+
+		MTY_Free(values);
+
+	} else if (MTY_JSONGetType(j) == MTY_JSON_OBJECT) {
+		r = MTY_JSONObjCreate();
+
+		const char *key = NULL;
+
+		for (uint64_t iter = 0; MTY_JSONObjGetNextKey(j, &iter, &key);) {
+			const MTY_JSON *item = MTY_JSONObjGetItem(j, key);
+			uint32_t action = MTY_GetRandomUInt(0, 8);
+
+			if (action != 0)
+				MTY_JSONObjSetItem(r, key, action == 1 ? json_mutate(item) : MTY_JSONDuplicate(item));
+		}
+
+		if (MTY_GetRandomUInt(0, 4) == 0) {
+			char *str = json_random_string();
+			MTY_JSONObjSetItem(r, str, json_random(&n));
+
+			MTY_Free(str);
+		}
+
+	} else {
+		r = MTY_JSONDuplicate(j);
+	}
+
+	return r;
+}
+
+static MTY_JSON *json_reparse(MTY_JSON *j)
+{
+	// Serialized items have no unset array elements
+	char *str = MTY_JSONSerialize(j);
+	MTY_JSON *r = MTY_JSONParse(str);
+
+	MTY_JSONDestroy(&j);
+	MTY_Free(str);
+
+	return r;
+}
+
+static bool json_patched(const char *doc, const char *patch, const char *expected)
+{
+	MTY_JSON *j = MTY_JSONParse(doc);
+	MTY_JSON *p = MTY_JSONParse(patch);
+	MTY_JSON *e = expected ? MTY_JSONParse(expected) : NULL;
+
+	bool r = MTY_JSONPatch(&j, p);
+
+	if (r && e) {
+		MTY_JSON *d = MTY_JSONDiff(j, e);
+		r = MTY_JSONArrayGetLength(d) == 0;
+
+		MTY_JSONDestroy(&d);
+	}
+
+	MTY_JSONDestroy(&j);
+	MTY_JSONDestroy(&p);
+	MTY_JSONDestroy(&e);
+
+	return expected ? r : !r;
+}
+
+static bool json_diff(void)
+{
+	for (uint32_t x = 0; x < JSON_ITER; x++) {
+		uint32_t n = 0;
+
+		MTY_JSON *from = json_reparse(json_random(&n));
+		MTY_JSON *to = json_reparse(json_mutate(from));
+
+		// Patches are meant to be sent, so they go through serialization too
+		MTY_JSON *patch = json_reparse(MTY_JSONDiff(from, to));
+		MTY_JSON *j = MTY_JSONDuplicate(from);
+
+		if (!MTY_JSONPatch(&j, patch))
+			test_failed("MTY_JSONPatch failed on a diff");
+
+		MTY_JSON *rest = MTY_JSONDiff(j, to);
+		MTY_JSON *none = MTY_JSONDiff(from, from);
+
+		if (MTY_JSONArrayGetLength(rest) != 0 || MTY_JSONArrayGetLength(none) != 0)
+			test_failed("Mismatching diff/patch");
+
+		MTY_JSONDestroy(&rest);
+		MTY_JSONDestroy(&none);
+		MTY_JSONDestroy(&patch);
+		MTY_JSONDestroy(&j);
+		MTY_JSONDestroy(&from);
+		MTY_JSONDestroy(&to);
+	}
+
+	test_passed("MTY_JSONDiff/MTY_JSONPatch");
+
+	// Changes deep in a large item, and insertions into an array, produce single operations
+	MTY_JSON *from = MTY_JSONArrayCreate(1000);
+
+	for (uint32_t x = 0; x < 1000; x++) {
+		MTY_JSON *item = MTY_JSONObjCreate();
+		MTY_JSONObjSetItem(item, "id", MTY_JSONIntCreate(x));
+		MTY_JSONObjSetItem(item, "name", MTY_JSONStringCreate("item"));
+		MTY_JSONArraySetItem(from, x, item);
+	}
+
+	MTY_JSON *to = MTY_JSONDuplicate(from);
+	MTY_JSONObjSetItem((MTY_JSON *) MTY_JSONArrayGetItem(to, 500), "name", MTY_JSONStringCreate("x/~"));
+
+	MTY_JSON *patch = MTY_JSONDiff(from, to);
+	const MTY_JSON *op = MTY_JSONArrayGetItem(patch, 0);
+
+	test_cmp("MTY_JSONDiff", MTY_JSONArrayGetLength(patch) == 1 &&
+		!strcmp(MTY_JSONObjGetStringPtr(op, "op"), "replace") &&
+		!strcmp(MTY_JSONObjGetStringPtr(op, "path"), "/500/name"));
+
+	MTY_JSONDestroy(&patch);
+	MTY_JSONDestroy(&to);
+
+	to = MTY_JSONParse("{\"a/b\":{\"~\":[1]}}");
+	patch = MTY_JSONDiff(from, to);
+	op = MTY_JSONArrayGetItem(patch, 0);
+
+	test_cmp("MTY_JSONDiff", MTY_JSONArrayGetLength(patch) == 1 &&
+		!strcmp(MTY_JSONObjGetStringPtr(op, "path"), ""));
+
+	MTY_JSONDestroy(&patch);
+	MTY_JSONDestroy(&to);
+
+	patch = MTY_JSONParse("[{\"op\":\"move\",\"from\":\"/999\",\"path\":\"/0\"},"
+		"{\"op\":\"add\",\"path\":\"/500\",\"value\":{\"id\":-1}}]");
+	to = MTY_JSONDuplicate(from);
+
+	test_cmp("MTY_JSONPatch", MTY_JSONPatch(&to, patch));
+	MTY_JSONDestroy(&patch);
+
+	patch = MTY_JSONDiff(from, to);
+	char *str = MTY_JSONSerialize(patch);
+
+	test_cmp("MTY_JSONDiff", MTY_JSONArrayGetLength(patch) == 3 && strlen(str) < 200);
+
+	MTY_Free(str);
+	MTY_JSONDestroy(&patch);
+	MTY_JSONDestroy(&to);
+	MTY_JSONDestroy(&from);
+
+	// Examples from RFC 6902 Appendix A
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":\"bar\"}",
+		"[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]", "{\"baz\":\"qux\",\"foo\":\"bar\"}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":[\"bar\",\"baz\"]}",
+		"[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"baz\":\"qux\",\"foo\":\"bar\"}",
+		"[{\"op\":\"remove\",\"path\":\"/baz\"}]", "{\"foo\":\"bar\"}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":[\"bar\",\"qux\",\"baz\"]}",
+		"[{\"op\":\"remove\",\"path\":\"/foo/1\"}]", "{\"foo\":[\"bar\",\"baz\"]}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"baz\":\"qux\",\"foo\":\"bar\"}",
+		"[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]", "{\"baz\":\"boo\",\"foo\":\"bar\"}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+		"[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]",
+		"{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+		"[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]", "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+		"[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]",
+		"{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":\"bar\"}",
+		"[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]",
+		"{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":\"bar\"}",
+		"[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\",\"xyz\":123}]", "{\"foo\":\"bar\",\"baz\":\"qux\"}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"/\":9,\"~1\":10}",
+		"[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10}]", "{\"/\":9,\"~1\":10}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"foo\":[\"bar\"]}",
+		"[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]", "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}"));
+
+	test_cmp("MTY_JSONPatch", json_patched("{\"a\":[1,{\"b\":2}]}",
+		"[{\"op\":\"copy\",\"from\":\"/a/1\",\"path\":\"/c\"},{\"op\":\"test\",\"path\":\"/c/b\",\"value\":2.0}]",
+		"{\"a\":[1,{\"b\":2}],\"c\":{\"b\":2}}"));
+	test_cmp("MTY_JSONPatch", json_patched("{\"a\":1}",
+		"[{\"op\":\"replace\",\"path\":\"\",\"value\":[true]},{\"op\":\"move\",\"from\":\"/0\",\"path\":\"/0\"}]",
+		"[true]"));
+
+	MTY_DisableLog(true);
+
+	static const char *FAILING[][2] = {
+		{"{\"baz\":\"qux\"}", "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]"},
+		{"{\"foo\":\"bar\"}", "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]"},
+		{"{\"/\":9,\"~1\":10}", "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":\"10\"}]"},
+		{"{\"a\":{\"b\":1}}", "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/c\"}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"add\",\"path\":\"/a/2\",\"value\":1}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"add\",\"path\":\"/a/01\",\"value\":1}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"replace\",\"path\":\"/b\",\"value\":1}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"remove\",\"path\":\"/a/1\"}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"remove\",\"path\":\"\"}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"test\",\"path\":\"/b\",\"value\":null}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"copy\",\"path\":\"/b\"}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"add\",\"path\":\"a\",\"value\":1}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"add\",\"path\":\"/~2\",\"value\":1}]"},
+		{"{\"a\":[1]}", "[{\"op\":\"swap\",\"path\":\"/a\"}]"},
+		{"{\"a\":[1]}", "{\"op\":\"remove\",\"path\":\"/a\"}"},
+	};
+
+	for (size_t x = 0; x < sizeof(FAILING) / sizeof(FAILING[0]); x++)
+		if (!json_patched(FAILING[x][0], FAILING[x][1], NULL))
+			test_failed(FAILING[x][1]);
+
+	MTY_DisableLog(false);
+
+	test_passed("MTY_JSONPatch");
+
+	return true;
+}
+
 static bool json_main(void)
 {
 	json_test_suite();
@@ -228,8 +1291,38 @@ static bool json_main(void)
 	if (!json_duplication())
 		return false;
 
+	if (!json_wide())
+		return false;
+
 	if (!json_utf16())
 		return false;
 
+	if (!json_parse_errors())
+		return false;
+
+	if (!json_numbers())
+		return false;
+
+	if (!json_writer())
+		return false;
+
+	if (!json_doc())
+		return false;
+
+	if (!json_cbor())
+		return false;
+
+	if (!json_in_place())
+		return false;
+
+	if (!json_lines())
+		return false;
+
+	if (!json_struct())
+		return false;
+
+	if (!json_diff())
+		return false;
+
 	return true;
 }
@@ -101,6 +101,280 @@ static bool memory_printf(void)
 	return true;
 }
 
+struct memory_sort_elem {
+	int32_t key;
+	uint32_t index;
+	float fkey;
+	int64_t wkey;
+};
+
+static int32_t memory_sort_compare(const void *a, const void *b)
+{
+	const struct memory_sort_elem *ea = a;
+	const struct memory_sort_elem *eb = b;
+
+	return ea->key < eb->key ? -1 : ea->key > eb->key ? 1 : 0;
+}
+
+#define memory_sort_less(a, b) ((a)->key < (b)->key)
+
+MTY_SORT_DEFINE(memory_sort_typed, struct memory_sort_elem, memory_sort_less)
+
+static int32_t memory_sort_compare_stable(const void *a, const void *b)
+{
+	const struct memory_sort_elem *ea = a;
+	const struct memory_sort_elem *eb = b;
+
+	int32_t r = memory_sort_compare(a, b);
+
+	return r != 0 ? r : ea->index < eb->index ? -1 : ea->index > eb->index ? 1 : 0;
+}
+
+static bool memory_sort_check(const struct memory_sort_elem *e, const struct memory_sort_elem *ref, size_t len)
+{
+	// Indices are unique, so matching the reference element by element means the
+	// output is a stable permutation of the input, not just ordered
+	for (size_t x = 0; x < len; x++)
+		if (e[x].key != ref[x].key || e[x].index != ref[x].index ||
+			e[x].fkey != ref[x].fkey || e[x].wkey != ref[x].wkey)
+			return false;
+
+	return true;
+}
+
+static void memory_sort_fill(struct memory_sort_elem *e, size_t len, uint32_t pattern)
+{
+	for (size_t x = 0; x < len; x++) {
+		switch (pattern) {
+			case 0: // Many duplicates
+				e[x].key = (int32_t) (rand() % 100) - 50;
+				break;
+			case 1: // Random
+				e[x].key = rand() % 0x800000 - 0x400000;
+				break;
+			case 2: // Sorted
+				e[x].key = (int32_t) x;
+				break;
+			case 3: // Reversed
+				e[x].key = (int32_t) (len - x);
+				break;
+			case 4: // Sawtooth
+				e[x].key = (int32_t) (x % 1000);
+				break;
+			case 5: // Mostly sorted
+				e[x].key = x % 100 == 0 ? rand() % 0x400000 : (int32_t) x;
+				break;
+		}
+
+		e[x].index = (uint32_t) x;
+		e[x].fkey = (float) e[x].key * 0.25f;
+		e[x].wkey = (int64_t) e[x].key * 0x100000000;
+	}
+}
+
+static bool memory_sort(void)
+{
+	size_t lens[] = {0, 1, 2, 31, 32, 33, 1000, 100000, 300001};
+	bool sort_ok = true;
+	bool parallel_ok = true;
+	bool typed_ok = true;
+	bool search_ok = true;
+	bool radix_ok = true;
+
+	for (uint32_t x = 0; x < sizeof(lens) / sizeof(size_t); x++) {
+		size_t len = lens[x];
+		size_t size = (len + 1) * sizeof(struct memory_sort_elem);
+		struct memory_sort_elem *in = MTY_Alloc(len + 1, sizeof(struct memory_sort_elem));
+		struct memory_sort_elem *ref = MTY_Alloc(len + 1, sizeof(struct memory_sort_elem));
+		struct memory_sort_elem *e = MTY_Alloc(len + 1, sizeof(struct memory_sort_elem));
+
+		for (uint32_t y = 0; y < 6; y++) {
+			memory_sort_fill(in, len, y);
+			memcpy(ref, in, size);
+			qsort(ref, len, sizeof(struct memory_sort_elem), memory_sort_compare_stable);
+
+			memcpy(e, in, size);
+			MTY_Sort(e, len, sizeof(struct memory_sort_elem), memory_sort_compare);
+			sort_ok = sort_ok && memory_sort_check(e, ref, len);
+
+			memcpy(e, in, size);
+			memory_sort_typed_sort(e, len);
+			typed_ok = typed_ok && memory_sort_check(e, ref, len);
+
+			// Every key is found at the start of its range of equal keys
+			for (size_t z = 0; z < len && search_ok; z += len / 50 + 1) {
+				size_t lo = memory_sort_typed_lower_bound(e, len, &e[z]);
+				size_t hi = memory_sort_typed_upper_bound(e, len, &e[z]);
+
+				search_ok = lo <= z && z < hi && e[lo].key == e[z].key &&
+					(lo == 0 || e[lo - 1].key < e[z].key) && (hi == len || e[hi].key > e[z].key) &&
+					memory_sort_typed_search(e, len, &e[z]) == &e[lo];
+			}
+
+			memcpy(e, in, size);
+			MTY_SortParallel(e, len, sizeof(struct memory_sort_elem), memory_sort_compare);
+			parallel_ok = parallel_ok && memory_sort_check(e, ref, len);
+
+			memcpy(e, in, size);
+			MTY_RadixSort(e, len, sizeof(struct memory_sort_elem), 0, MTY_SORT_KEY_INT32);
+			radix_ok = radix_ok && memory_sort_check(e, ref, len);
+
+			memcpy(e, in, size);
+			MTY_RadixSort(e, len, sizeof(struct memory_sort_elem),
+				offsetof(struct memory_sort_elem, fkey), MTY_SORT_KEY_FLOAT);
+			radix_ok = radix_ok && memory_sort_check(e, ref, len);
+
+			memcpy(e, in, size);
+			MTY_RadixSort(e, len, sizeof(struct memory_sort_elem),
+				offsetof(struct memory_sort_elem, wkey), MTY_SORT_KEY_INT64);
+			radix_ok = radix_ok && memory_sort_check(e, ref, len);
+		}
+
+		MTY_Free(in);
+		MTY_Free(ref);
+		MTY_Free(e);
+	}
+
+	test_cmp("MTY_Sort", sort_ok);
+	test_cmp("MTY_SortParallel", parallel_ok);
+	test_cmp("MTY_SORT_DEFINE", typed_ok);
+	test_cmp("MTY_SORT_DEFINE", search_ok);
+
+	// Keys missing from the buffer
+	struct memory_sort_elem s[4] = {{.key = 1}, {.key = 3}, {.key = 3}, {.key = 5}};
+	struct memory_sort_elem k = {.key = 4};
+	test_cmp("MTY_SORT_DEFINE", memory_sort_typed_lower_bound(s, 4, &k) == 3);
+	test_cmp("MTY_SORT_DEFINE", memory_sort_typed_upper_bound(s, 4, &k) == 3);
+	test_cmp("MTY_SORT_DEFINE", memory_sort_typed_search(s, 4, &k) == NULL);
+
+	k.key = 0;
+	test_cmp("MTY_SORT_DEFINE", memory_sort_typed_lower_bound(s, 4, &k) == 0);
+
+	k.key = 6;
+	test_cmp("MTY_SORT_DEFINE", memory_sort_typed_upper_bound(s, 4, &k) == 4);
+
+	k.key = 3;
+	test_cmp("MTY_SORT_DEFINE", memory_sort_typed_search(s, 4, &k) == &s[1]);
+	test_cmp("MTY_RadixSort", radix_ok);
+
+	return true;
+}
+
+static bool memory_strbuf(void)
+{
+	char stack[16];
+
+	MTY_StrBuf sb;
+	MTY_StrBufInit(&sb, stack, sizeof(stack));
+	test_cmp("MTY_StrBufInit", sb.str == stack && sb.len == 0 && sb.str[0] == '\0');
+
+	MTY_StrBufAppend(&sb, "abc");
+	MTY_StrBufAppendChar(&sb, '-');
+	MTY_StrBufAppendLen(&sb, "xyz123", 3);
+	test_cmp("MTY_StrBufAppend", !strcmp(sb.str, "abc-xyz") && sb.len == 7 && !sb.heap);
+
+	// Outgrows the stack buffer
+	MTY_StrBufPrintf(&sb, " %d %s", 42, "a longer formatted string");
+	test_cmp("MTY_StrBufPrintf", !strcmp(sb.str, "abc-xyz 42 a longer formatted string") && sb.heap);
+
+	MTY_StrBufClear(&sb);
+	MTY_StrBufAppendInt(&sb, INT64_MIN);
+	MTY_StrBufAppendChar(&sb, ' ');
+	MTY_StrBufAppendInt(&sb, 0);
+	MTY_StrBufAppendChar(&sb, ' ');
+	MTY_StrBufAppendInt(&sb, 1234567);
+	test_cmp("MTY_StrBufAppendInt", !strcmp(sb.str, "-9223372036854775808 0 1234567"));
+
+	MTY_StrBufClear(&sb);
+	MTY_StrBufAppendFloat(&sb, 3.0);
+	MTY_StrBufAppendChar(&sb, ' ');
+	MTY_StrBufAppendFloat(&sb, -0.5);
+	MTY_StrBufAppendChar(&sb, ' ');
+	MTY_StrBufAppendFloat(&sb, 1e21);
+	MTY_StrBufAppendChar(&sb, ' ');
+	MTY_StrBufAppendFloat(&sb, 0.1 + 0.2);
+	MTY_StrBufAppendChar(&sb, ' ');
+	MTY_StrBufAppendFloat(&sb, 5e-7);
+	test_cmp("MTY_StrBufAppendFloat", !strcmp(sb.str, "3 -0.5 1e+21 0.30000000000000004 5e-7"));
+
+	// Many appends grow geometrically
+	MTY_StrBufClear(&sb);
+	for (uint32_t x = 0; x < 10000; x++)
+		MTY_StrBufPrintf(&sb, "%04u", x % 10000);
+
+	test_cmp("MTY_StrBufPrintf", sb.len == 40000 && !memcmp(sb.str + 39996, "9999", 5));
+
+	char *str = MTY_StrBufMove(&sb);
+	test_cmp("MTY_StrBufMove", strlen(str) == 40000 && sb.len == 0 && sb.str[0] == '\0');
+	MTY_Free(str);
+
+	// Moving a string still on the stack copies it
+	MTY_StrBufInit(&sb, stack, sizeof(stack));
+	MTY_StrBufAppend(&sb, "short");
+	str = MTY_StrBufMove(&sb);
+	test_cmp("MTY_StrBufMove", str != stack && !strcmp(str, "short"));
+	MTY_Free(str);
+
+	MTY_StrBufFree(&sb);
+	test_cmp("MTY_StrBufFree", sb.len == 0 && !sb.heap);
+
+	return true;
+}
+
+static void *memory_tlocal_thread(void *opaque)
+{
+	const char *big = MTY_SprintfDL("%0*d", 50000, 7);
+
+	return (void *) (uintptr_t) (strlen(big) == 50000);
+}
+
+static void *memory_tlocal_args_thread(void *opaque)
+{
+	char b[3001];
+	memset(b, 'b', 3000);
+	b[3000] = '\0';
+
+	// Formatting a string that does not fit in the current chunk must not move into a
+	// chunk that still holds one of its arguments
+	const char *s = MTY_SprintfDL("%s", b);
+	MTY_SprintfDL("%0*d", 2000, 0);
+	MTY_SprintfDL("%0*d", 2000, 0);
+
+	const char *str = MTY_SprintfDL("XYZ%s", s);
+
+	return (void *) (uintptr_t) (strlen(str) == 3003 && !memcmp(str, "XYZ", 3) && !strcmp(str + 3, b));
+}
+
+static bool memory_tlocal(void)
+{
+	// Thread local strings larger than the static storage are not truncated
+	const char *big = MTY_SprintfDL("%0*d", 20000, 1);
+	test_cmp("MTY_SprintfDL", strlen(big) == 20000);
+	test_cmp("MTY_SprintfDL", big[19999] == '1');
+
+	// The ring keeps recent strings valid while older ones are evicted
+	const char *prev = NULL;
+	for (uint32_t x = 0; x < 10000; x++) {
+		const char *str = MTY_SprintfDL("ring %u", x);
+
+		if (prev && strcmp(prev, MTY_SprintfDL("ring %u", x - 1)))
+			test_cmp("MTY_SprintfDL", false);
+
+		prev = str;
+	}
+
+	test_cmp("MTY_SprintfDL", !strcmp(prev, "ring 9999"));
+
+	// Threads that grew their storage release it on exit
+	MTY_Thread *thread = MTY_ThreadCreate(memory_tlocal_thread, NULL);
+	test_cmp("MTY_SprintfDL", MTY_ThreadDestroy(&thread) != NULL);
+
+	thread = MTY_ThreadCreate(memory_tlocal_args_thread, NULL);
+	test_cmp("MTY_SprintfDL", MTY_ThreadDestroy(&thread) != NULL);
+
+	return true;
+}
+
 static bool memory_main(void)
 {
 	bool failed = false;
@@ -262,5 +536,14 @@ static bool memory_main(void)
 
 	failed = !memory_printf();
 
+	if (!failed)
+		failed = !memory_tlocal();
+
+	if (!failed)
+		failed = !memory_sort();
+
+	if (!failed)
+		failed = !memory_strbuf();
+
 	return !failed;
 }
@@ -0,0 +1,238 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define test_metrics_threads 4
+#define test_metrics_values  100000
+
+static void *metrics_record_thread(void *opaque)
+{
+	MTY_Histogram *h = opaque;
+
+	for (uint64_t x = 1; x <= test_metrics_values; x++)
+		MTY_HistogramRecord(h, x);
+
+	return NULL;
+}
+
+static void *metrics_push_thread(void *opaque)
+{
+	MTY_Queue *q = opaque;
+
+	MTY_Sleep(20);
+	MTY_QueuePushPtr(q, q, 0);
+
+	return NULL;
+}
+
+static bool metrics_within(uint64_t value, uint64_t expected, double error)
+{
+	return fabs((double) value - (double) expected) <= (double) expected * error;
+}
+
+static bool metrics_main(void)
+{
+	MTY_Histogram *h = MTY_HistogramCreate(1000000, 3);
+
+	test_cmpi64("MTY_HistogramGetPercentile", MTY_HistogramGetPercentile(h, 50) == 0,
+		MTY_HistogramGetPercentile(h, 50));
+
+	for (uint64_t x = 1; x <= 10000; x++)
+		MTY_HistogramRecord(h, x);
+
+	uint64_t v = MTY_HistogramGetCount(h);
+	test_cmpi64("MTY_HistogramGetCount", v == 10000, v);
+
+	v = MTY_HistogramGetMin(h);
+	test_cmpi64("MTY_HistogramGetMin", v == 1, v);
+
+	v = MTY_HistogramGetMax(h);
+	test_cmpi64("MTY_HistogramGetMax", v == 10000, v);
+
+	double mean = MTY_HistogramGetMean(h);
+	test_cmpf("MTY_HistogramGetMean", mean == 5000.5, mean);
+
+	v = MTY_HistogramGetPercentile(h, 50);
+	test_cmpi64("MTY_HistogramGetPercentile", metrics_within(v, 5000, 0.001), v);
+
+	v = MTY_HistogramGetPercentile(h, 99.9);
+	test_cmpi64("MTY_HistogramGetPercentile", metrics_within(v, 9990, 0.001), v);
+
+	v = MTY_HistogramGetPercentile(h, 100);
+	test_cmpi64("MTY_HistogramGetPercentile", v == 10000, v);
+
+	MTY_HistogramRecord(h, 5000000);
+	v = MTY_HistogramGetMax(h);
+	test_cmpi64("MTY_HistogramRecord", v == 1000000, v);
+
+	MTY_HistogramReset(h);
+	v = MTY_HistogramGetCount(h);
+	test_cmpi64("MTY_HistogramReset", v == 0 && MTY_HistogramGetMin(h) == 0, v);
+
+	// Low precision, large values
+	MTY_Histogram *h2 = MTY_HistogramCreate(UINT64_C(1) << 40, 2);
+
+	for (uint64_t x = 1; x <= 1000; x++)
+		MTY_HistogramRecord(h2, x * 1000000);
+
+	v = MTY_HistogramGetPercentile(h2, 90);
+	test_cmpi64("MTY_HistogramGetPercentile", metrics_within(v, 900000000, 0.01), v);
+
+	// Concurrent recording
+	MTY_Thread *threads[test_metrics_threads];
+
+	for (uint32_t x = 0; x < test_metrics_threads; x++)
+		threads[x] = MTY_ThreadCreate(metrics_record_thread, h);
+
+	for (uint32_t x = 0; x < test_metrics_threads; x++)
+		MTY_ThreadDestroy(&threads[x]);
+
+	v = MTY_HistogramGetCount(h);
+	test_cmpi64("MTY_HistogramRecord", v == test_metrics_threads * test_metrics_values, v);
+
+	v = MTY_HistogramGetPercentile(h, 50);
+	test_cmpi64("MTY_HistogramRecord", metrics_within(v, test_metrics_values / 2, 0.001), v);
+
+	MTY_HistogramMerge(h2, h);
+	v = MTY_HistogramGetCount(h2);
+	test_cmpi64("MTY_HistogramMerge", v == 1000 + test_metrics_threads * test_metrics_values, v);
+
+	v = MTY_HistogramGetMin(h2);
+	test_cmpi64("MTY_HistogramMerge", v == 1, v);
+
+	// Merging keeps the exact sum, min and max, also across different precisions
+	MTY_HistogramReset(h2);
+	MTY_HistogramReset(h);
+	MTY_HistogramRecord(h, 10);
+	MTY_HistogramRecord(h, 20);
+	MTY_HistogramRecord(h, 1000);
+
+	MTY_Histogram *h3 = MTY_HistogramCreate(1000000, 3);
+	MTY_HistogramRecord(h3, 30);
+
+	MTY_HistogramMerge(h3, h);
+	MTY_HistogramMerge(h2, h);
+
+	mean = MTY_HistogramGetMean(h3);
+	test_cmpf("MTY_HistogramMerge", mean == 265, mean);
+
+	v = MTY_HistogramGetMin(h3);
+	test_cmpi64("MTY_HistogramMerge", v == 10, v);
+
+	v = MTY_HistogramGetMax(h3);
+	test_cmpi64("MTY_HistogramMerge", v == 1000, v);
+
+	mean = MTY_HistogramGetMean(h2);
+	test_cmpf("MTY_HistogramMerge", fabs(mean - 1030 / 3.0) < 1e-9, mean);
+
+	v = MTY_HistogramGetMax(h2);
+	test_cmpi64("MTY_HistogramMerge", v == 1000 && MTY_HistogramGetMin(h2) == 10, v);
+
+	v = MTY_HistogramGetPercentile(h2, 100);
+	test_cmpi64("MTY_HistogramMerge", v == 1000, v);
+
+	MTY_HistogramDestroy(&h3);
+	MTY_HistogramDestroy(&h2);
+	MTY_HistogramDestroy(&h);
+	test_cmp("MTY_HistogramDestroy", h == NULL);
+
+	// Registry
+	test_cmp("MTY_MetricsGetHistogram", MTY_MetricsGetHistogram("test.hist", 1000, 2) == NULL);
+
+	MTY_MetricsCreate();
+
+	h = MTY_MetricsGetHistogram("test.hist", 1000, 2);
+	test_cmp("MTY_MetricsGetHistogram", h != NULL);
+	test_cmp("MTY_MetricsGetHistogram", MTY_MetricsGetHistogram("test.hist", 0, 0) == h);
+
+	MTY_Atomic64 *c = MTY_MetricsGetCounter("test.counter");
+	test_cmp("MTY_MetricsGetCounter", c != NULL);
+	test_cmp("MTY_MetricsGetCounter", MTY_MetricsGetCounter("test.hist") == NULL);
+	test_cmp("MTY_MetricsGetHistogram", MTY_MetricsGetHistogram("test.counter", 1000, 2) == NULL);
+
+	MTY_Atomic64FetchAdd(c, 3, MTY_ATOMIC_RELAXED);
+	MTY_HistogramRecord(h, 10);
+	MTY_HistogramRecord(h, 20);
+
+	// libmatoya's own metrics
+	MTY_Queue *q = MTY_QueueCreate(2, sizeof(void *));
+	MTY_Thread *thread = MTY_ThreadCreate(metrics_push_thread, q);
+
+	void *ptr = NULL;
+	MTY_QueuePopPtr(q, 1000, &ptr, NULL);
+
+	MTY_ThreadDestroy(&thread);
+	MTY_QueueDestroy(&q);
+
+	MTY_JSON *j = MTY_MetricsSnapshot(true);
+
+	double n = 0;
+	MTY_JSONNumber(MTY_JSONObjGetItem(j, "test.counter"), &n);
+	test_cmpf("MTY_MetricsSnapshot", n == 3, n);
+
+	const MTY_JSON *jh = MTY_JSONObjGetItem(j, "test.hist");
+	MTY_JSONNumber(MTY_JSONObjGetItem(jh, "count"), &n);
+	test_cmpf("MTY_MetricsSnapshot", n == 2, n);
+
+	MTY_JSONNumber(MTY_JSONObjGetItem(jh, "p99"), &n);
+	test_cmpf("MTY_MetricsSnapshot", n == 20, n);
+
+	jh = MTY_JSONObjGetItem(j, "mty.queue.wait_us");
+	MTY_JSONNumber(MTY_JSONObjGetItem(jh, "max"), &n);
+	test_cmpf("MTY_MetricsSnapshot", n >= 15000, n);
+
+	MTY_JSONDestroy(&j);
+
+	j = MTY_MetricsSnapshot(false);
+	MTY_JSONNumber(MTY_JSONObjGetItem(j, "test.counter"), &n);
+	test_cmpf("MTY_MetricsSnapshot", n == 0, n);
+	MTY_JSONDestroy(&j);
+
+	MTY_MetricsDestroy();
+	test_cmp("MTY_MetricsDestroy", MTY_MetricsGetCounter("test.counter") == NULL);
+
+	// Cached internal histograms do not outlive the registry
+	MTY_MetricsCreate();
+
+	q = MTY_QueueCreate(2, sizeof(void *));
+	thread = MTY_ThreadCreate(metrics_push_thread, q);
+
+	MTY_QueuePopPtr(q, 1000, &ptr, NULL);
+
+	MTY_ThreadDestroy(&thread);
+	MTY_QueueDestroy(&q);
+
+	j = MTY_MetricsSnapshot(false);
+	jh = MTY_JSONObjGetItem(j, "mty.queue.wait_us");
+	MTY_JSONNumber(MTY_JSONObjGetItem(jh, "count"), &n);
+	test_cmpf("MTY_MetricsCreate", n == 1, n);
+	MTY_JSONDestroy(&j);
+
+	MTY_MetricsDestroy();
+
+	// Counters may legitimately be unavailable, but whatever is reported must be sane
+	MTY_PerfCounters *perf = MTY_PerfCountersCreate();
+	uint32_t available = MTY_PerfCountersGetAvailable(perf);
+
+	MTY_PerfCounterValues values = {0};
+	MTY_PerfCountersBegin(perf);
+
+	volatile uint64_t sum = 0;
+	for (uint32_t x = 0; x < 100000; x++)
+		sum += x;
+
+	MTY_PerfCountersEnd(perf, &values);
+
+	test_cmpi64("MTY_PerfCountersEnd", (values.available & ~available) == 0, values.available);
+	test_cmpi64("MTY_PerfCountersEnd", !(values.available & MTY_PERF_COUNTER_CYCLES) ||
+		values.cycles > 0, values.cycles);
+	test_cmpi64("MTY_PerfCountersEnd", !(values.available & MTY_PERF_COUNTER_INSTRUCTIONS) ||
+		values.instructions >= 100000, values.instructions);
+	test_cmpi64("MTY_PerfCountersEnd", (values.available & MTY_PERF_COUNTER_CYCLES) ||
+		values.cycles == 0, values.cycles);
+
+	MTY_PerfCountersDestroy(&perf);
+	test_cmp("MTY_PerfCountersDestroy", perf == NULL);
+
+	return true;
+}
@@ -129,5 +129,50 @@ static bool struct_main(void)
 	MTY_ListDestroy(&listctx, NULL);
 	test_cmp("MTY_ListDestroy", listctx == NULL);
 
+	MTY_Vec vec;
+	MTY_VecInit(&vec, sizeof(uint32_t));
+	test_cmp("MTY_VecInit", vec.data == NULL && vec.len == 0 && vec.size == sizeof(uint32_t));
+
+	size_t reallocs = 0;
+	void *prev = NULL;
+
+	for (uint32_t x = 0; x < 100000; x++) {
+		uint32_t *v = MTY_VecPush(&vec);
+		*v = x;
+
+		if (vec.data != prev) {
+			prev = vec.data;
+			reallocs++;
+		}
+	}
+
+	uint32_t *vals = vec.data;
+	test_cmp("MTY_VecPush", vec.len == 100000 && vals[0] == 0 && vals[99999] == 99999);
+	test_cmpi64("MTY_VecPush", reallocs < 64, reallocs);
+
+	uint32_t more[3] = {7, 8, 9};
+	uint32_t *app = MTY_VecAppend(&vec, more, 3);
+	test_cmp("MTY_VecAppend", vec.len == 100003 && app[0] == 7 && app[2] == 9);
+
+	MTY_VecResize(&vec, 10);
+	MTY_VecResize(&vec, 12);
+	vals = vec.data;
+	test_cmp("MTY_VecResize", vec.len == 12 && vals[9] == 9 && vals[10] == 0 && vals[11] == 0);
+
+	MTY_VecShrink(&vec);
+	test_cmp("MTY_VecShrink", vec.capacity == 12);
+
+	MTY_VecReserve(&vec, 1000);
+	test_cmp("MTY_VecReserve", vec.capacity >= 1000 && vec.len == 12);
+
+	size_t len = 0;
+	uint32_t *moved = MTY_VecMove(&vec, &len);
+	test_cmp("MTY_VecMove", moved && len == 12 && moved[9] == 9 && !vec.data && vec.len == 0);
+	MTY_Free(moved);
+
+	MTY_VecPush(&vec);
+	MTY_VecFree(&vec);
+	test_cmp("MTY_VecFree", vec.data == NULL && vec.len == 0 && vec.capacity == 0);
+
 	return true;
 }
@@ -438,6 +438,280 @@ static bool test_thread_creation()
 	return true;
 }
 
+struct test_atomic_data {
+	MTY_Atomic32 counter;
+	MTY_CACHE_PAD(pad0, sizeof(MTY_Atomic32));
+	MTY_AtomicPtr msg;
+};
+
+struct test_atomic_producer {
+	struct test_atomic_data *data;
+	int32_t payload;
+};
+
+static void *test_atomics_producer(void *opaque)
+{
+	struct test_atomic_producer *producer = (struct test_atomic_producer *) opaque;
+	struct test_atomic_data *data = producer->data;
+
+	for (int32_t x = 0; x < 100000; x++)
+		MTY_Atomic32FetchAdd(&data->counter, 1, MTY_ATOMIC_RELAXED);
+
+	// Each producer owns its payload, which is only written before the release store
+	// that publishes it, so the acquire load on the other side makes reading it race-free
+	producer->payload = 42;
+	MTY_AtomicPtrStore(&data->msg, &producer->payload, MTY_ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+static bool test_atomics(void)
+{
+	MTY_Atomic32 a32 = {0};
+	MTY_Atomic64 a64 = {0};
+
+	MTY_Atomic32Store(&a32, 0x0F, MTY_ATOMIC_RELAXED);
+	test_cmp("MTY_Atomic32Load", MTY_Atomic32Load(&a32, MTY_ATOMIC_ACQUIRE) == 0x0F);
+	test_cmp("MTY_Atomic32FetchOr", MTY_Atomic32FetchOr(&a32, 0xF0, MTY_ATOMIC_ACQ_REL) == 0x0F);
+	test_cmp("MTY_Atomic32FetchAnd", MTY_Atomic32FetchAnd(&a32, 0x3C, MTY_ATOMIC_RELEASE) == 0xFF);
+	test_cmp("MTY_Atomic32Exchange", MTY_Atomic32Exchange(&a32, 7, MTY_ATOMIC_SEQ_CST) == 0x3C);
+	test_cmp("MTY_Atomic32FetchAdd", MTY_Atomic32FetchAdd(&a32, -2, MTY_ATOMIC_RELAXED) == 7);
+	test_cmp("MTY_Atomic32CompareExchange", !MTY_Atomic32CompareExchange(&a32, 7, 1, MTY_ATOMIC_ACQ_REL));
+	test_cmp("MTY_Atomic32CompareExchange", MTY_Atomic32CompareExchange(&a32, 5, 1, MTY_ATOMIC_ACQ_REL));
+	test_cmp("MTY_Atomic32Get", MTY_Atomic32Get(&a32) == 1);
+
+	MTY_Atomic64Store(&a64, INT64_C(0x100000000), MTY_ATOMIC_RELEASE);
+	test_cmp("MTY_Atomic64FetchAdd", MTY_Atomic64FetchAdd(&a64, 1, MTY_ATOMIC_RELAXED) == INT64_C(0x100000000));
+	test_cmp("MTY_Atomic64FetchOr", MTY_Atomic64FetchOr(&a64, 2, MTY_ATOMIC_RELAXED) == INT64_C(0x100000001));
+	test_cmp("MTY_Atomic64FetchAnd", MTY_Atomic64FetchAnd(&a64, 3, MTY_ATOMIC_RELAXED) == INT64_C(0x100000003));
+	test_cmp("MTY_Atomic64Exchange", MTY_Atomic64Exchange(&a64, -1, MTY_ATOMIC_ACQ_REL) == 3);
+	test_cmp("MTY_Atomic64CompareExchange", MTY_Atomic64CompareExchange(&a64, -1, 9, MTY_ATOMIC_SEQ_CST));
+	test_cmp("MTY_Atomic64Load", MTY_Atomic64Load(&a64, MTY_ATOMIC_RELAXED) == 9);
+
+	struct test_atomic_data data = {0};
+	test_cmp("MTY_CACHE_PAD", (uint8_t *) &data.msg - (uint8_t *) &data.counter >= MTY_CACHE_LINE);
+
+	int32_t dummy = 0;
+	test_cmp("MTY_AtomicPtrCompareExchange", !MTY_AtomicPtrCompareExchange(&data.msg, &dummy, &dummy, MTY_ATOMIC_ACQ_REL));
+	test_cmp("MTY_AtomicPtrExchange", MTY_AtomicPtrExchange(&data.msg, &dummy, MTY_ATOMIC_ACQ_REL) == NULL);
+	test_cmp("MTY_AtomicPtrCompareExchange", MTY_AtomicPtrCompareExchange(&data.msg, &dummy, NULL, MTY_ATOMIC_ACQ_REL));
+
+	MTY_Thread *threads[4];
+	struct test_atomic_producer producers[4] = {0};
+
+	for (uint8_t x = 0; x < 4; x++) {
+		producers[x].data = &data;
+		threads[x] = MTY_ThreadCreate(test_atomics_producer, &producers[x]);
+	}
+
+	int32_t *msg = NULL;
+	while (!(msg = MTY_AtomicPtrLoad(&data.msg, MTY_ATOMIC_ACQUIRE)))
+		MTY_Sleep(0);
+
+	test_cmp("MTY_AtomicPtrLoad", *msg == 42);
+
+	for (uint8_t x = 0; x < 4; x++)
+		MTY_ThreadDestroy(&threads[x]);
+
+	test_cmp("MTY_Atomic32FetchAdd", MTY_Atomic32Load(&data.counter, MTY_ATOMIC_RELAXED) == 400000);
+
+	return true;
+}
+
+#define test_parallel_len 1000000
+
+static void test_parallel_fill(int64_t begin, int64_t end, void *opaque)
+{
+	int32_t *values = opaque;
+
+	for (int64_t x = begin; x < end; x++)
+		values[x] += (int32_t) x;
+}
+
+static void test_parallel_nested(int64_t begin, int64_t end, void *opaque)
+{
+	int32_t *values = opaque;
+
+	for (int64_t x = begin; x < end; x++)
+		MTY_ParallelFor(x * 1000, (x + 1) * 1000, 100, test_parallel_fill, values);
+}
+
+static void test_parallel_sum(int64_t begin, int64_t end, void *partial, void *opaque)
+{
+	int32_t *values = opaque;
+	int64_t *sum = partial;
+
+	for (int64_t x = begin; x < end; x++)
+		*sum += values[x];
+}
+
+static void test_parallel_combine(void *result, const void *partial, void *opaque)
+{
+	*(int64_t *) result += *(const int64_t *) partial;
+}
+
+static void test_parallel_count(int64_t begin, int64_t end, void *opaque)
+{
+	MTY_Atomic32FetchAdd(opaque, 1, MTY_ATOMIC_RELAXED);
+}
+
+struct test_parallel_span {
+	int64_t begin;
+	int64_t end;
+	bool ordered;
+};
+
+static void test_parallel_span_add(struct test_parallel_span *span, int64_t begin, int64_t end)
+{
+	// Spans only ever grow at their end, so any out of order merge is detected
+	if (span->end != -1 && span->end != begin)
+		span->ordered = false;
+
+	if (span->begin == -1)
+		span->begin = begin;
+
+	span->end = end;
+}
+
+static void test_parallel_span(int64_t begin, int64_t end, void *partial, void *opaque)
+{
+	test_parallel_span_add(partial, begin, end);
+}
+
+static void test_parallel_span_combine(void *result, const void *partial, void *opaque)
+{
+	const struct test_parallel_span *p = partial;
+	struct test_parallel_span *r = result;
+
+	r->ordered = r->ordered && p->ordered;
+
+	if (p->begin != -1)
+		test_parallel_span_add(r, p->begin, p->end);
+}
+
+static bool test_parallel(void)
+{
+	int32_t *values = MTY_Alloc(test_parallel_len, sizeof(int32_t));
+
+	test_cmp("MTY_GetCPUCount", MTY_GetCPUCount() > 0);
+
+	MTY_ParallelFor(0, test_parallel_len, 0, test_parallel_fill, values);
+
+	bool ok = true;
+	for (int32_t x = 0; x < test_parallel_len && ok; x++)
+		ok = values[x] == x;
+
+	test_cmp("MTY_ParallelFor", ok);
+
+	MTY_ParallelFor(0, test_parallel_len / 1000, 1, test_parallel_nested, values);
+
+	ok = true;
+	for (int32_t x = 0; x < test_parallel_len && ok; x++)
+		ok = values[x] == x * 2;
+
+	test_cmp("MTY_ParallelFor (nested)", ok);
+
+	MTY_Atomic32 calls = {0};
+	MTY_ParallelFor(5, 5, 0, test_parallel_count, &calls);
+	MTY_ParallelFor(5, 4, 0, test_parallel_count, &calls);
+	test_cmp("MTY_ParallelFor (empty)", MTY_Atomic32Load(&calls, MTY_ATOMIC_RELAXED) == 0);
+
+	int64_t sum = 0;
+	MTY_ParallelReduce(0, test_parallel_len, 1000, &sum, sizeof(int64_t),
+		test_parallel_sum, test_parallel_combine, values);
+	test_cmpi64("MTY_ParallelReduce", sum == (int64_t) test_parallel_len * (test_parallel_len - 1), sum);
+
+	// Partials cover contiguous runs and are combined in order
+	struct test_parallel_span span = {.begin = -1, .end = -1, .ordered = true};
+	MTY_ParallelReduce(0, test_parallel_len, 10, &span, sizeof(struct test_parallel_span),
+		test_parallel_span, test_parallel_span_combine, NULL);
+	test_cmp("MTY_ParallelReduce", span.ordered && span.begin == 0 && span.end == test_parallel_len);
+
+	MTY_Free(values);
+
+	return true;
+}
+
+struct test_task_data {
+	MTY_TaskGraph *graph;
+	MTY_Atomic32 seq;
+	int32_t order[4];
+	MTY_Atomic32 count;
+	bool continued;
+};
+
+struct test_task {
+	struct test_task_data *data;
+	int32_t index;
+};
+
+static void test_task_order(void *opaque)
+{
+	struct test_task *task = opaque;
+
+	task->data->order[task->index] = MTY_Atomic32FetchAdd(&task->data->seq, 1, MTY_ATOMIC_ACQ_REL);
+}
+
+static void test_task_count(void *opaque)
+{
+	struct test_task_data *data = opaque;
+
+	MTY_Atomic32FetchAdd(&data->count, 1, MTY_ATOMIC_RELAXED);
+}
+
+static void test_task_continuation(void *opaque)
+{
+	struct test_task_data *data = opaque;
+
+	data->continued = true;
+}
+
+static void test_task_spawn(void *opaque)
+{
+	struct test_task_data *data = opaque;
+
+	MTY_TaskGraphAdd(data->graph, test_task_continuation, data, NULL, 0);
+}
+
+static bool test_task_graph(void)
+{
+	struct test_task_data data = {0};
+	struct test_task tasks[4];
+
+	data.graph = MTY_TaskGraphCreate();
+	test_cmp("MTY_TaskGraphCreate", data.graph != NULL);
+
+	for (int32_t x = 0; x < 4; x++) {
+		tasks[x].data = &data;
+		tasks[x].index = x;
+	}
+
+	// Diamond: 0 -> (1, 2) -> 3
+	uint32_t a = MTY_TaskGraphAdd(data.graph, test_task_order, &tasks[0], NULL, 0);
+	uint32_t b = MTY_TaskGraphAdd(data.graph, test_task_order, &tasks[1], &a, 1);
+	uint32_t c = MTY_TaskGraphAdd(data.graph, test_task_order, &tasks[2], &a, 1);
+	uint32_t deps[2] = {b, c};
+	MTY_TaskGraphAdd(data.graph, test_task_order, &tasks[3], deps, 2);
+
+	test_cmp("MTY_TaskGraphAdd", a > 0 && b > 0 && c > 0);
+	test_cmp("MTY_TaskGraphWait", MTY_TaskGraphWait(data.graph, -1));
+	test_cmp("MTY_TaskGraph order", data.order[0] == 0 && data.order[3] == 3);
+	test_cmp("MTY_TaskGraph order", data.order[1] > 0 && data.order[2] > 0);
+
+	uint32_t root = MTY_TaskGraphAdd(data.graph, test_task_spawn, &data, NULL, 0);
+	for (int32_t x = 0; x < 1000; x++)
+		MTY_TaskGraphAdd(data.graph, test_task_count, &data, &root, 1);
+
+	test_cmp("MTY_TaskGraphWait", MTY_TaskGraphWait(data.graph, -1));
+	test_cmp("MTY_TaskGraph fan out", MTY_Atomic32Load(&data.count, MTY_ATOMIC_RELAXED) == 1000);
+	test_cmp("MTY_TaskGraph continuation", data.continued);
+
+	MTY_TaskGraphDestroy(&data.graph);
+	test_cmp("MTY_TaskGraphDestroy", data.graph == NULL);
+
+	return true;
+}
+
 static bool thread_main()
 {
 	MTY_SetTimerResolution(1);
@@ -459,6 +733,15 @@ static bool thread_main()
 	if (!test_waitables())
 		return false;
 
+	if (!test_atomics())
+		return false;
+
+	if (!test_parallel())
+		return false;
+
+	if (!test_task_graph())
+		return false;
+
 	MTY_RevertTimerResolution(1);
 
 	return true;
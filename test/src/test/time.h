@@ -2,6 +2,126 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+#define test_timer_count 2000
+
+struct test_timer {
+	MTY_Time start;
+	double delay;
+	uint32_t fired;
+	bool early;
+};
+
+static void test_timer_func(uint64_t id, void *opaque)
+{
+	struct test_timer *t = opaque;
+
+	if (MTY_TimeDiff(t->start, MTY_GetTime()) < t->delay)
+		t->early = true;
+
+	t->fired++;
+}
+
+static bool test_timer_wheel(void)
+{
+	MTY_TimerWheel *wheel = MTY_TimerWheelCreate(0.01);
+	test_cmp("MTY_TimerWheelCreate", wheel != NULL);
+	test_cmpf("MTY_TimerWheelGetTimeout", MTY_TimerWheelGetTimeout(wheel) < 0.0, MTY_TimerWheelGetTimeout(wheel));
+
+	// Spread over several wheel levels at 10us resolution
+	struct test_timer *timers = MTY_Alloc(test_timer_count, sizeof(struct test_timer));
+	uint64_t *ids = MTY_Alloc(test_timer_count, sizeof(uint64_t));
+
+	for (uint32_t x = 0; x < test_timer_count; x++) {
+		timers[x].start = MTY_GetTime();
+		timers[x].delay = (x * 7919 % 1000) / 4.0;
+		ids[x] = MTY_TimerWheelAdd(wheel, timers[x].delay, 0, test_timer_func, &timers[x]);
+	}
+
+	bool canceled = true;
+	for (uint32_t x = 0; x < test_timer_count; x += 10)
+		canceled = canceled && MTY_TimerWheelCancel(wheel, ids[x]);
+
+	test_cmp("MTY_TimerWheelCancel", canceled);
+	test_cmp("MTY_TimerWheelCancel", !MTY_TimerWheelCancel(wheel, ids[0]));
+
+	double timeout = MTY_TimerWheelGetTimeout(wheel);
+	test_cmpf("MTY_TimerWheelGetTimeout", timeout >= 0.0 && timeout < 250.0, timeout);
+
+	uint32_t fired = 0;
+	MTY_Time start = MTY_GetTime();
+
+	while (fired < test_timer_count - test_timer_count / 10 && MTY_TimeDiff(start, MTY_GetTime()) < 2000.0) {
+		MTY_Sleep(1);
+		fired += MTY_TimerWheelAdvance(wheel);
+	}
+
+	bool ok = true;
+	for (uint32_t x = 0; x < test_timer_count; x++)
+		ok = ok && !timers[x].early && timers[x].fired == (x % 10 == 0 ? 0 : 1);
+
+	test_cmp("MTY_TimerWheelAdvance", fired == test_timer_count - test_timer_count / 10);
+	test_cmp("MTY_TimerWheelAdvance", ok);
+	test_cmpf("MTY_TimerWheelGetTimeout", MTY_TimerWheelGetTimeout(wheel) < 0.0, MTY_TimerWheelGetTimeout(wheel));
+
+	MTY_TimerWheelDestroy(&wheel);
+	test_cmp("MTY_TimerWheelDestroy", wheel == NULL);
+
+	// Periodic timer on a dedicated thread
+	wheel = MTY_TimerWheelCreate(1.0);
+	MTY_TimerWheelStart(wheel);
+
+	memset(timers, 0, sizeof(struct test_timer));
+	timers[0].start = MTY_GetTime();
+	uint64_t id = MTY_TimerWheelAdd(wheel, 10, 10, test_timer_func, &timers[0]);
+
+	MTY_Sleep(105);
+	test_cmp("MTY_TimerWheelCancel", MTY_TimerWheelCancel(wheel, id));
+	test_cmpi32("MTY_TimerWheelStart", timers[0].fired >= 5 && timers[0].fired <= 10, timers[0].fired);
+	test_cmp("MTY_TimerWheelStart", !timers[0].early);
+
+	MTY_TimerWheelDestroy(&wheel);
+
+	// Periods missed while the wheel is not advanced fire once
+	wheel = MTY_TimerWheelCreate(1.0);
+
+	memset(timers, 0, sizeof(struct test_timer));
+	timers[0].start = MTY_GetTime();
+	MTY_TimerWheelAdd(wheel, 10, 10, test_timer_func, &timers[0]);
+
+	MTY_Sleep(55);
+	fired = MTY_TimerWheelAdvance(wheel);
+	test_cmpi32("MTY_TimerWheelAdvance", fired == 1, fired);
+
+	timeout = MTY_TimerWheelGetTimeout(wheel);
+	test_cmpf("MTY_TimerWheelGetTimeout", timeout > 0.0 && timeout <= 10.0, timeout);
+
+	MTY_TimerWheelDestroy(&wheel);
+
+	// Delays past the range of the wheel, 2^32 ticks of 1us
+	wheel = MTY_TimerWheelCreate(0.001);
+
+	memset(timers, 0, sizeof(struct test_timer));
+	timers[0].start = MTY_GetTime();
+	timers[0].delay = 4600;
+	MTY_TimerWheelAdd(wheel, timers[0].delay, 0, test_timer_func, &timers[0]);
+
+	start = MTY_GetTime();
+
+	while (timers[0].fired == 0 && MTY_TimeDiff(start, MTY_GetTime()) < 6000.0) {
+		MTY_Sleep(20);
+		MTY_TimerWheelAdvance(wheel);
+	}
+
+	test_cmpi32("MTY_TimerWheelAdvance", timers[0].fired == 1 && !timers[0].early, timers[0].fired);
+
+	MTY_TimerWheelDestroy(&wheel);
+
+	MTY_Free(timers);
+	MTY_Free(ids);
+
+	return true;
+}
+
 static bool time_main(void)
 {
 	MTY_SetTimerResolution(1);
@@ -15,6 +135,54 @@ static bool time_main(void)
 	double diff = MTY_TimeDiff(ts, MTY_GetTime());
 	test_cmpf("MTY_TimeDiff", diff >= 99.0f && diff <= 115.0f, diff);
 
+	uint64_t ticks = MTY_GetTicks();
+	uint64_t ns = MTY_GetTimeNS();
+	MTY_Sleep(50);
+	uint64_t dticks = MTY_TicksToNS(MTY_GetTicks() - ticks);
+	uint64_t dns = MTY_GetTimeNS() - ns;
+	test_cmpi64("MTY_GetTicks", dticks >= 49000000 && dticks <= 60000000, dticks);
+	test_cmpi64("MTY_GetTimeNS", dns >= 49000000 && dns <= 60000000, dns);
+	test_cmpi64("MTY_TicksToNS", MTY_TicksToNS(0) == 0, MTY_TicksToNS(0));
+
+	ts = MTY_GetTime();
+	MTY_SleepUntil(ts, 20.0, 1.0);
+	diff = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_SleepUntil", diff >= 20.0 && diff <= 25.0, diff);
+
+	ts = MTY_GetTime();
+	MTY_PreciseSleep(15.5, 1.0);
+	diff = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_PreciseSleep", diff >= 15.5 && diff <= 20.0, diff);
+
+	MTY_FramePacer *pacer = MTY_FramePacerCreate(10.0, 1.0);
+	test_cmp("MTY_FramePacerCreate", pacer != NULL);
+
+	ts = MTY_GetTime();
+	for (uint32_t x = 0; x < 20; x++)
+		MTY_FramePacerWait(pacer);
+
+	diff = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_FramePacerWait", diff >= 199.0 && diff <= 215.0, diff);
+
+	MTY_FramePacerStats stats = {0};
+	MTY_FramePacerGetStats(pacer, &stats);
+	test_cmpi64("MTY_FramePacerGetStats", stats.frames == 20, stats.frames);
+	test_cmpf("MTY_FramePacerGetStats", stats.overshootAvg >= 0.0 && stats.overshootAvg < 2.0, stats.overshootAvg);
+
+	MTY_FramePacerReset(pacer, 5.0);
+	MTY_FramePacerWait(pacer);
+	MTY_Sleep(22);
+	MTY_FramePacerWait(pacer);
+	MTY_FramePacerGetStats(pacer, &stats);
+	test_cmpi64("MTY_FramePacerReset", stats.frames == 2, stats.frames);
+	test_cmpi64("MTY_FramePacerWait", stats.missed >= 3, stats.missed);
+
+	MTY_FramePacerDestroy(&pacer);
+	test_cmp("MTY_FramePacerDestroy", pacer == NULL);
+
+	if (!test_timer_wheel())
+		return false;
+
 	MTY_RevertTimerResolution(1);
 
 	return true;
@@ -0,0 +1,101 @@
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define test_trace_events 20000
+
+static void *trace_thread(void *opaque)
+{
+	MTY_TraceSetThreadName("trace_thread");
+
+	MTY_TraceBegin("thread");
+	MTY_TraceFlowEnd("flow", 7);
+	MTY_TraceEnd();
+
+	return NULL;
+}
+
+static uint32_t trace_count(const MTY_JSON *events, const char *ph, const char *name)
+{
+	uint32_t n = 0;
+
+	for (uint32_t x = 0; x < MTY_JSONArrayGetLength(events); x++) {
+		const MTY_JSON *evt = MTY_JSONArrayGetItem(events, x);
+		const char *eph = MTY_JSONObjGetStringPtr(evt, "ph");
+		const char *ename = MTY_JSONObjGetStringPtr(evt, "name");
+
+		if (eph && !strcmp(eph, ph) && (!name || (ename && !strcmp(ename, name))))
+			n++;
+	}
+
+	return n;
+}
+
+static bool trace_main(void)
+{
+	MTY_TraceBegin("before");
+	MTY_TraceStart();
+	test_cmp("MTY_TraceIsActive", MTY_TraceIsActive());
+
+	MTY_TraceBegin("main");
+	MTY_TraceCounter("counter", 42);
+	MTY_TraceFlowBegin("flow", 7);
+
+	MTY_Thread *thread = MTY_ThreadCreate(trace_thread, NULL);
+	MTY_ThreadDestroy(&thread);
+
+	MTY_TraceEnd();
+	MTY_TraceStop();
+	MTY_TraceBegin("after");
+
+	test_cmp("MTY_TraceStop", !MTY_TraceIsActive());
+
+	MTY_JSON *trace = MTY_TraceExport();
+	const MTY_JSON *events = MTY_JSONObjGetItem(trace, "traceEvents");
+
+	test_cmp("MTY_TraceExport", MTY_JSONGetType(events) == MTY_JSON_ARRAY);
+	test_cmp("MTY_TraceBegin", trace_count(events, "B", "main") == 1 &&
+		trace_count(events, "B", "thread") == 1);
+	test_cmp("MTY_TraceEnd", trace_count(events, "E", NULL) == 2);
+	test_cmp("MTY_TraceStart", trace_count(events, "B", "before") == 0);
+	test_cmp("MTY_TraceStop", trace_count(events, "B", "after") == 0);
+	test_cmp("MTY_TraceFlowBegin", trace_count(events, "s", "flow") == 1);
+	test_cmp("MTY_TraceFlowEnd", trace_count(events, "f", "flow") == 1);
+	test_cmp("MTY_TraceSetThreadName", trace_count(events, "M", "thread_name") >= 1);
+
+	double value = 0;
+	for (uint32_t x = 0; x < MTY_JSONArrayGetLength(events); x++) {
+		const MTY_JSON *evt = MTY_JSONArrayGetItem(events, x);
+		const char *ph = MTY_JSONObjGetStringPtr(evt, "ph");
+
+		if (ph && !strcmp(ph, "C"))
+			MTY_JSONNumber(MTY_JSONObjGetItem(MTY_JSONObjGetItem(evt, "args"), "value"), &value);
+	}
+
+	test_cmpf("MTY_TraceCounter", value == 42, value);
+
+	MTY_JSONDestroy(&trace);
+
+	// Restarting discards the previous capture, overflow keeps the newest events
+	MTY_TraceStart();
+
+	for (uint32_t x = 0; x < test_trace_events; x++)
+		MTY_TraceCounter("overflow", x);
+
+	MTY_TraceStop();
+
+	trace = MTY_TraceExport();
+	events = MTY_JSONObjGetItem(trace, "traceEvents");
+
+	uint32_t n = trace_count(events, "C", "overflow");
+	test_cmpi64("MTY_TraceExport", n > 0 && n < test_trace_events, n);
+	test_cmp("MTY_TraceExport", trace_count(events, "B", "main") == 0);
+
+	const MTY_JSON *last = MTY_JSONArrayGetItem(events, MTY_JSONArrayGetLength(events) - 1);
+	MTY_JSONNumber(MTY_JSONObjGetItem(MTY_JSONObjGetItem(last, "args"), "value"), &value);
+	test_cmpf("MTY_TraceExport", value == test_trace_events - 1, value);
+
+	MTY_JSONDestroy(&trace);
+
+	return true;
+}